@@ -40,6 +40,7 @@ set_option(BUILD_APPLICATIONS         "Build LibSourcey applications"
 set_option(BUILD_DEPENDENCIES         "Build third party dependencies"                           ON)
 set_option(BUILD_TESTS                "Build module test applications?"                          ON   IF CMAKE_COMPILER_IS_GNUCXX)
 set_option(BUILD_SAMPLES              "Build module sample applications?"                        ON   IF CMAKE_COMPILER_IS_GNUCXX)
+set_option(BUILD_BENCHMARKS           "Build the libsourcey_bench benchmark suite?"              OFF)
 set_option(BUILD_WITH_DEBUG_INFO      "Include debug info into debug libs"                       ON)
 set_option(BUILD_WITH_STATIC_CRT      "Enables statically linked CRT for statically linked libraries" OFF)
 set_option(BUILD_ALPHA                "Build alpha development modules"                          OFF)
@@ -61,9 +62,16 @@ set_option(ENABLE_SSE42               "Enable SSE4.2 instructions"
 set_option(ENABLE_NOISY_WARNINGS      "Show all warnings even if they are too noisy"             OFF )
 set_option(ENABLE_WARNINGS_ARE_ERRORS "Treat warnings as errors"                                 OFF )
 set_option(ENABLE_LOGGING             "Enable internal debug logging"                            ON   IF (CMAKE_BUILD_TYPE MATCHES DEBUG) )
+set_option(ENABLE_COROUTINES          "Build C++20 coroutine adapters (requires C++20)"          OFF  IF (CMAKE_COMPILER_IS_GNUCXX OR CMAKE_CXX_COMPILER_ID MATCHES "Clang") )
 set_option(EXCEPTION_RECOVERY         "Attempt to recover from internal exceptions"              ON   IF (CMAKE_BUILD_TYPE MATCHES DEBUG) )
 set_option(MSG_VERBOSE                "Print verbose debug status messages"                      OFF )
 
+set(MIN_LOG_LEVEL 0 CACHE STRING "Minimum compiled log level (0=trace, 1=debug, 2=info, 3=warn, 4=error, 5=fatal)")
+set_property(CACHE MIN_LOG_LEVEL PROPERTY STRINGS 0 1 2 3 4 5)
+if(NOT MIN_LOG_LEVEL MATCHES "^[0-5]$")
+  message(FATAL_ERROR "MIN_LOG_LEVEL must be between 0 and 5, got '${MIN_LOG_LEVEL}'")
+endif()
+
 
 # ----------------------------------------------------------------------------
 # LibSourcey internal options
@@ -335,6 +343,11 @@ foreach(name ${subdirs})
   endif()
 endforeach()
 
+# Include the benchmark suite once all modules are defined
+if (BUILD_BENCHMARKS)
+  add_subdirectory(${LibSourcey_DIR}/bench ${LibSourcey_BUILD_DIR}/bench)
+endif()
+
 # Condense related sublists into main variables
 list(APPEND LibSourcey_INCLUDE_DIRS ${LibSourcey_MODULE_INCLUDE_DIRS} ${LibSourcey_VENDOR_INCLUDE_DIRS})
 list(APPEND LibSourcey_LIBRARY_DIRS ${LibSourcey_MODULE_LIBRARY_DIRS} ${LibSourcey_BUILD_DIR})
@@ -391,6 +404,8 @@ install(FILES ${LibSourcey_PC} DESTINATION ${LibSourcey_PKGCONFIG_DIR} COMPONENT
 
 # Variables for libsourcey.h
 set(SCY_ENABLE_LOGGING ${ENABLE_LOGGING})
+set(SCY_ENABLE_COROUTINES ${ENABLE_COROUTINES})
+set(SCY_MIN_LOG_LEVEL ${MIN_LOG_LEVEL})
 set(SCY_EXCEPTION_RECOVERY ${EXCEPTION_RECOVERY})
 set(SCY_SHARED_LIBRARY ${BUILD_SHARED_LIBS})
 
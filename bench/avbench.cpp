@@ -0,0 +1,123 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+
+#ifdef HAVE_FFMPEG
+
+#include "scy/av/audioencoder.h"
+#include "scy/av/videoconverter.h"
+#include "scy/av/videoencoder.h"
+
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+
+const int kWidth = 640;
+const int kHeight = 480;
+
+
+// Fill a YUV420P frame with a moving gradient so the encoder
+// has real work to do on every frame
+void fillFrame(AVFrame* frame, uint64_t index)
+{
+    for (int y = 0; y < frame->height; y++)
+        for (int x = 0; x < frame->width; x++)
+            frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(x + y + index * 3);
+    for (int y = 0; y < frame->height / 2; y++) {
+        for (int x = 0; x < frame->width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = static_cast<uint8_t>(128 + y + index * 2);
+            frame->data[2][y * frame->linesize[2] + x] = static_cast<uint8_t>(64 + x + index * 5);
+        }
+    }
+}
+
+
+} // namespace
+
+
+void registerAV(Runner& runner)
+{
+    const uint64_t frameBytes = kWidth * kHeight * 3 / 2;
+
+    runner.add("av/convert yuv420p to rgb24 640x480", [](uint64_t n) {
+        av::VideoConverter conv;
+        conv.iparams = av::VideoCodec(kWidth, kHeight, 25, "yuv420p");
+        conv.oparams = av::VideoCodec(kWidth, kHeight, 25, "rgb24");
+        conv.create();
+        AVFrame* frame = av::createVideoFrame(AV_PIX_FMT_YUV420P, kWidth, kHeight);
+        fillFrame(frame, 0);
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(conv.convert(frame));
+        av_frame_free(&frame);
+    }, frameBytes);
+
+    runner.add("av/encode mpeg4 640x480", [](uint64_t n) {
+        av::VideoEncoder encoder;
+        encoder.iparams = av::VideoCodec(kWidth, kHeight, 25, "yuv420p");
+        encoder.oparams = av::VideoCodec("MPEG4", "mpeg4", kWidth, kHeight, 25, 400000, 0, "yuv420p");
+        encoder.create();
+        encoder.open();
+        AVFrame* frame = av::createVideoFrame(AV_PIX_FMT_YUV420P, kWidth, kHeight);
+        for (uint64_t i = 0; i < n; i++) {
+            fillFrame(frame, i);
+            frame->pts = static_cast<int64_t>(i);
+            doNotOptimize(encoder.encode(frame));
+        }
+        encoder.flush();
+        av_frame_free(&frame);
+    }, frameBytes);
+
+    const int numSamples = 1152;
+    const int channels = 2;
+    runner.add("av/encode mp2 audio", [](uint64_t n) {
+        av::AudioEncoder encoder;
+        encoder.iparams = av::AudioCodec(channels, 44100, "s16");
+        encoder.oparams = av::AudioCodec("MP2", "mp2", channels, 44100, 128000, "s16");
+        encoder.create();
+        encoder.open();
+        std::vector<int16_t> samples(numSamples * channels);
+        for (size_t i = 0; i < samples.size(); i++)
+            samples[i] = static_cast<int16_t>((i * 97) % 65536 - 32768);
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(encoder.encode(reinterpret_cast<uint8_t*>(samples.data()),
+                                         numSamples, static_cast<int64_t>(i * numSamples)));
+        encoder.flush();
+    }, numSamples * channels * sizeof(int16_t));
+}
+
+
+} // namespace bench
+} // namespace scy
+
+#else
+
+namespace scy {
+namespace bench {
+
+
+void registerAV(Runner&)
+{
+}
+
+
+} // namespace bench
+} // namespace scy
+
+#endif
@@ -0,0 +1,213 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/base64.h"
+#include "scy/executor.h"
+#include "scy/hex.h"
+#include "scy/loop.h"
+#include "scy/packetstream.h"
+#include "scy/queue.h"
+#include "scy/signal.h"
+#include "scy/thread.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+
+// Pass through processor for measuring stream overhead
+struct PassProcessor : public PacketProcessor
+{
+    PacketSignal emitter;
+
+    PassProcessor()
+        : PacketProcessor(emitter)
+    {
+    }
+
+    void process(IPacket& packet) override
+    {
+        emitter.emit(packet);
+    }
+};
+
+
+struct QueueNode
+{
+    std::atomic<QueueNode*> next;
+    uint64_t value;
+
+    QueueNode()
+        : next(nullptr)
+        , value(0)
+    {
+    }
+};
+
+
+std::string randomBytes(size_t size)
+{
+    std::string data(size, '\0');
+    uint32_t seed = 0x12345678;
+    for (auto& c : data) {
+        seed = seed * 1664525 + 1013904223;
+        c = static_cast<char>(seed >> 24);
+    }
+    return data;
+}
+
+
+} // namespace
+
+
+void registerBase(Runner& runner)
+{
+    //
+    // Signals
+    //
+
+    runner.add("base/signal emit 1 slot", [](uint64_t n) {
+        Signal<void(uint64_t)> signal;
+        uint64_t sum = 0;
+        signal += [&](uint64_t v) { sum += v; };
+        for (uint64_t i = 0; i < n; i++)
+            signal.emit(i);
+        doNotOptimize(sum);
+    });
+
+    runner.add("base/signal emit 8 slots", [](uint64_t n) {
+        Signal<void(uint64_t)> signal;
+        uint64_t sum = 0;
+        for (int i = 0; i < 8; i++)
+            signal += [&](uint64_t v) { sum += v; };
+        for (uint64_t i = 0; i < n; i++)
+            signal.emit(i);
+        doNotOptimize(sum);
+    });
+
+    runner.add("base/signal attach detach", [](uint64_t n) {
+        Signal<void(uint64_t)> signal;
+        for (uint64_t i = 0; i < n; i++) {
+            int id = signal.attach([](uint64_t) {});
+            signal.detach(id);
+        }
+    });
+
+    //
+    // Packet Stream
+    //
+
+    const size_t packetSize = 1024;
+    runner.add("base/packetstream 3 processors 1KB", [packetSize](uint64_t n) {
+        std::string payload(packetSize, 'x');
+        size_t received = 0;
+        PacketStream stream;
+        stream.attach(new PassProcessor, 1);
+        stream.attach(new PassProcessor, 2);
+        stream.attach(new PassProcessor, 3);
+        stream.emitter += [&](IPacket& packet) { received += packet.size(); };
+        stream.start();
+        for (uint64_t i = 0; i < n; i++)
+            stream.write(payload.data(), payload.size());
+        stream.close();
+        doNotOptimize(received);
+    }, packetSize);
+
+    //
+    // Queues
+    //
+
+    runner.add("base/mpsc queue push pop", [](uint64_t n) {
+        std::vector<QueueNode> nodes(64);
+        uv::MPSCQueue<QueueNode> queue;
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            QueueNode& node = nodes[i % nodes.size()];
+            node.value = i;
+            queue.push(&node);
+            sum += queue.pop()->value;
+        }
+        doNotOptimize(sum);
+    });
+
+    runner.add("base/executor post cross-thread", [](uint64_t n) {
+        auto loop = uv::defaultLoop();
+        auto& executor = uv::Executor::get(loop);
+        uint64_t count = 0;
+        executor.ref();
+        Thread producer([&]() {
+            for (uint64_t i = 0; i < n; i++) {
+                executor.post([&]() {
+                    if (++count == n)
+                        executor.unref();
+                });
+            }
+        });
+        uv::runLoop(loop);
+        producer.join();
+    });
+
+    runner.add("base/syncqueue push dispatch cross-thread", [](uint64_t n) {
+        auto loop = uv::defaultLoop();
+        uint64_t count = 0;
+        SyncQueue<uint64_t> queue(loop, 0);
+        queue.ondispatch = [&](uint64_t&) {
+            if (++count == n)
+                queue.cancel();
+        };
+        Thread producer([&]() {
+            for (uint64_t i = 0; i < n; i++)
+                queue.push(new uint64_t(i));
+        });
+        uv::runLoop(loop);
+        producer.join();
+    });
+
+    //
+    // Encoding
+    //
+
+    const size_t dataSize = 4096;
+    const std::string data = randomBytes(dataSize);
+    const std::string encoded64 = base64::encode(data, 0);
+    const std::string encodedHex = hex::encode(data);
+
+    runner.add("base/base64 encode 4KB", [data](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(base64::encode(data, 0));
+    }, dataSize);
+
+    runner.add("base/base64 decode 4KB", [encoded64](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(base64::decode(encoded64));
+    }, dataSize);
+
+    runner.add("base/hex encode 4KB", [data](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(hex::encode(data));
+    }, dataSize);
+
+    runner.add("base/hex decode 4KB", [encodedHex](uint64_t n) {
+        std::vector<char> out(encodedHex.size() / 2);
+        for (uint64_t i = 0; i < n; i++)
+            doNotOptimize(hex::decode(encodedHex.data(), encodedHex.size(), out.data()));
+    }, dataSize);
+}
+
+
+} // namespace bench
+} // namespace scy
@@ -0,0 +1,245 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/json/json.h"
+#include "scy/platform.h"
+#include "scy/time.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+// Upper bound for calibrated iteration counts
+const uint64_t kMaxIterations = 1000000000;
+
+
+double timeRun(const Benchmark& bench, uint64_t iterations)
+{
+    uint64_t start = time::hrtime();
+    bench.func(iterations);
+    return static_cast<double>(time::hrtime() - start);
+}
+
+
+uint64_t calibrate(const Benchmark& bench, double minTime)
+{
+    // Grow the iteration count until a run takes the minimum time.
+    // The calibration runs double as warm up runs.
+    const double minNs = minTime * 1e9;
+    uint64_t iterations = 1;
+    for (;;) {
+        double elapsed = timeRun(bench, iterations);
+        if (elapsed >= minNs || iterations >= kMaxIterations)
+            return iterations;
+
+        // Predict the required count with some headroom, but
+        // don't trust timings of very short runs too far
+        double multiplier = elapsed > 0 ? minNs * 1.2 / elapsed : 100;
+        multiplier = std::min(std::max(multiplier, 2.0), 100.0);
+        iterations = std::min(kMaxIterations,
+            static_cast<uint64_t>(static_cast<double>(iterations) * multiplier));
+    }
+}
+
+
+void printUsage(const char* name)
+{
+    cout << "Usage: " << name << " [options]\n"
+         << "  --filter <text>      run benchmarks whose name contains text\n"
+         << "  --json <file>        write JSON results to file, or - for stdout\n"
+         << "  --min-time <secs>    minimum time per calibrated repetition (0.2)\n"
+         << "  --repetitions <n>    timed repetitions per benchmark (5)\n"
+         << "  --list               list benchmarks and exit\n";
+}
+
+
+} // namespace
+
+
+void Runner::add(const std::string& name, Function func, uint64_t bytesPerOp)
+{
+    benchmarks.push_back(Benchmark{name, func, bytesPerOp, 0});
+}
+
+
+void Runner::addFixed(const std::string& name, uint64_t iterations,
+                      Function func, uint64_t bytesPerOp)
+{
+    benchmarks.push_back(Benchmark{name, func, bytesPerOp, iterations});
+}
+
+
+Result Runner::run(const Benchmark& bench, const Options& options)
+{
+    Result res;
+    res.name = bench.name;
+    res.repetitions = std::max(1, options.repetitions);
+
+    if (bench.iterations) {
+        res.iterations = bench.iterations;
+        timeRun(bench, res.iterations); // warm up
+    } else
+        res.iterations = calibrate(bench, options.minTime);
+
+    std::vector<double> samples;
+    for (int i = 0; i < res.repetitions; i++)
+        samples.push_back(timeRun(bench, res.iterations) / res.iterations);
+    std::sort(samples.begin(), samples.end());
+
+    size_t mid = samples.size() / 2;
+    res.nsPerOp = samples.size() % 2
+        ? samples[mid]
+        : (samples[mid - 1] + samples[mid]) / 2;
+    res.minNsPerOp = samples.front();
+    res.maxNsPerOp = samples.back();
+    res.opsPerSec = res.nsPerOp > 0 ? 1e9 / res.nsPerOp : 0;
+    res.bytesPerSec = res.opsPerSec * bench.bytesPerOp;
+    return res;
+}
+
+
+void Runner::writeJSON(std::ostream& os, const std::vector<Result>& results)
+{
+    json::value doc;
+    doc["version"] = SCY_VERSION;
+    doc["date"] = time::printUTC();
+    doc["host"] = {
+        {"name", getHostname()},
+        {"cpus", numCpuCores()},
+        {"memory", getTotalMemory()},
+#ifdef NDEBUG
+        {"build", "release"},
+#else
+        {"build", "debug"},
+#endif
+#if defined(__clang__)
+        {"compiler", "clang " __clang_version__}
+#elif defined(__GNUC__)
+        {"compiler", "gcc " __VERSION__}
+#else
+        {"compiler", "unknown"}
+#endif
+    };
+
+    doc["results"] = json::value::array();
+    for (auto& res : results) {
+        json::value entry;
+        entry["name"] = res.name;
+        entry["iterations"] = res.iterations;
+        entry["repetitions"] = res.repetitions;
+        entry["ns_per_op"] = res.nsPerOp;
+        entry["min_ns_per_op"] = res.minNsPerOp;
+        entry["max_ns_per_op"] = res.maxNsPerOp;
+        entry["ops_per_sec"] = res.opsPerSec;
+        if (res.bytesPerSec > 0)
+            entry["bytes_per_sec"] = res.bytesPerSec;
+        doc["results"].push_back(entry);
+    }
+
+    os << doc.dump(2) << endl;
+}
+
+
+int Runner::main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue)
+            options.filter = argv[++i];
+        else if (arg == "--json" && hasValue)
+            options.jsonPath = argv[++i];
+        else if (arg == "--min-time" && hasValue)
+            options.minTime = std::atof(argv[++i]);
+        else if (arg == "--repetitions" && hasValue)
+            options.repetitions = std::atoi(argv[++i]);
+        else if (arg == "--list")
+            options.list = true;
+        else {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    std::vector<Result> results;
+    bool tableOutput = options.jsonPath != "-";
+    if (tableOutput && !options.list)
+        cout << std::left << std::setw(44) << "benchmark"
+             << std::right << std::setw(12) << "iterations"
+             << std::setw(14) << "ns/op"
+             << std::setw(14) << "ops/s"
+             << std::setw(12) << "MB/s" << endl;
+
+    for (auto& bench : benchmarks) {
+        if (!options.filter.empty() &&
+            bench.name.find(options.filter) == std::string::npos)
+            continue;
+        if (options.list) {
+            cout << bench.name << endl;
+            continue;
+        }
+
+        Result res;
+        try {
+            res = run(bench, options);
+        } catch (std::exception& exc) {
+            cerr << bench.name << " failed: " << exc.what() << endl;
+            return 1;
+        }
+        results.push_back(res);
+
+        if (tableOutput) {
+            cout << std::left << std::setw(44) << res.name
+                 << std::right << std::setw(12) << res.iterations
+                 << std::fixed << std::setprecision(1)
+                 << std::setw(14) << res.nsPerOp
+                 << std::setprecision(0)
+                 << std::setw(14) << res.opsPerSec;
+            if (res.bytesPerSec > 0)
+                cout << std::setprecision(1) << std::setw(12)
+                     << res.bytesPerSec / (1024 * 1024);
+            cout << endl;
+        }
+    }
+
+    if (!options.jsonPath.empty() && !options.list) {
+        if (options.jsonPath == "-")
+            writeJSON(cout, results);
+        else {
+            std::ofstream ofs(options.jsonPath);
+            if (!ofs.is_open()) {
+                cerr << "Cannot open " << options.jsonPath << endl;
+                return 1;
+            }
+            writeJSON(ofs, results);
+        }
+    }
+    return 0;
+}
+
+
+} // namespace bench
+} // namespace scy
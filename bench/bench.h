@@ -0,0 +1,122 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#ifndef SCY_Bench_H
+#define SCY_Bench_H
+
+
+#include "scy/base.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace scy {
+namespace bench {
+
+
+/// Benchmark body. Must perform the measured operation `iterations` times.
+typedef std::function<void(uint64_t iterations)> Function;
+
+
+/// Benchmark definition.
+struct Benchmark
+{
+    std::string name;    ///< unique name, prefixed by the module: "base/signal emit"
+    Function func;       ///< the benchmark body
+    uint64_t bytesPerOp; ///< bytes processed per operation, or zero
+    uint64_t iterations; ///< fixed iteration count, or zero to calibrate
+};
+
+
+/// Measured benchmark result.
+struct Result
+{
+    std::string name;
+    uint64_t iterations = 0; ///< iterations per repetition
+    int repetitions = 0;     ///< number of timed repetitions
+    double nsPerOp = 0;      ///< median time per operation
+    double minNsPerOp = 0;   ///< fastest repetition
+    double maxNsPerOp = 0;   ///< slowest repetition
+    double opsPerSec = 0;    ///< operations per second at the median
+    double bytesPerSec = 0;  ///< throughput at the median, or zero
+};
+
+
+/// Run options, parsed from the command line.
+struct Options
+{
+    std::string filter;     ///< run benchmarks whose name contains this string
+    std::string jsonPath;   ///< write JSON results to this file, or "-" for stdout
+    double minTime = 0.2;   ///< minimum seconds per calibrated repetition
+    int repetitions = 5;    ///< timed repetitions per benchmark
+    bool list = false;      ///< list benchmark names and exit
+};
+
+
+/// Registers, runs and reports benchmarks.
+///
+/// Microbenchmarks are calibrated so each repetition runs for at least
+/// `Options::minTime`, and loopback benchmarks run a fixed number of
+/// round trips. Each benchmark is repeated and the median time per
+/// operation is reported, which keeps results stable between runs.
+class Runner
+{
+public:
+    /// Add a microbenchmark which is calibrated to the minimum run time.
+    void add(const std::string& name, Function func, uint64_t bytesPerOp = 0);
+
+    /// Add a benchmark which always runs a fixed number of iterations.
+    void addFixed(const std::string& name, uint64_t iterations,
+                  Function func, uint64_t bytesPerOp = 0);
+
+    /// Parse the command line, run the matching benchmarks, print a
+    /// table of results and optionally write them as JSON.
+    /// Returns the process exit code.
+    int main(int argc, char** argv);
+
+    /// Run a single benchmark.
+    Result run(const Benchmark& bench, const Options& options);
+
+    /// Write results as a JSON document.
+    void writeJSON(std::ostream& os, const std::vector<Result>& results);
+
+    std::vector<Benchmark> benchmarks;
+};
+
+
+/// Prevent the compiler from optimizing away a value or the
+/// computation which produced it.
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+
+/// Module benchmark registration.
+void registerBase(Runner& runner);
+void registerNet(Runner& runner);
+void registerHTTP(Runner& runner);
+void registerSTUN(Runner& runner);
+void registerAV(Runner& runner);
+
+
+} // namespace bench
+} // namespace scy
+
+
+#endif // SCY_Bench_H
@@ -0,0 +1,29 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/logger.h"
+
+
+using namespace scy;
+
+
+int main(int argc, char** argv)
+{
+    bench::Runner runner;
+    bench::registerBase(runner);
+    bench::registerSTUN(runner);
+    bench::registerHTTP(runner);
+    bench::registerAV(runner);
+    bench::registerNet(runner);
+
+    int status = runner.main(argc, argv);
+    Logger::destroy();
+    return status;
+}
@@ -0,0 +1,201 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/http/client.h"
+#include "scy/http/parser.h"
+#include "scy/http/server.h"
+#include "scy/http/websocket.h"
+#include "scy/net/tcpsocket.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+
+const char kRequest[] =
+    "GET /api/v1/streams/12345?format=json HTTP/1.1\r\n"
+    "Host: media.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Cookie: session=0123456789abcdef; theme=dark\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+const char kResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Server: LibSourcey\r\n"
+    "Date: Mon, 19 Oct 2026 12:00:00 GMT\r\n"
+    "Content-Type: application/json\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Content-Length: 27\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "{\"id\":12345,\"state\":\"live\"}";
+
+
+// Perform the opening handshake between a client and server framer
+void handshake(http::ws::WebSocketFramer& client, http::ws::WebSocketFramer& server)
+{
+    http::Request request;
+    http::Response response;
+    client.createClientHandshakeRequest(request);
+    server.acceptServerRequest(request, response);
+    client.completeClientHandshake(response);
+}
+
+
+// Responds to each request with an empty body and closes
+class EmptyResponder : public http::ServerResponder
+{
+public:
+    EmptyResponder(http::ServerConnection& connection)
+        : http::ServerResponder(connection)
+    {
+    }
+
+    void onRequest(http::Request&, http::Response& response) override
+    {
+        response.setContentLength(0);
+        response.set("Connection", "close");
+        connection().sendHeader();
+        connection().close();
+    }
+};
+
+
+class EmptyResponderFactory : public http::ServerConnectionFactory
+{
+public:
+    http::ServerResponder* createResponder(http::ServerConnection& connection) override
+    {
+        return new EmptyResponder(connection);
+    }
+};
+
+
+// Issue sequential requests to a loopback server until the wanted
+// number of responses have been received.
+void runRequests(uint64_t n)
+{
+    auto loop = uv::defaultLoop();
+    auto socket = net::makeSocket<net::TCPSocket>(loop);
+    http::Server server(net::Address("127.0.0.1", 0), socket, new EmptyResponderFactory);
+    server.start();
+
+    std::ostringstream url;
+    url << "http://127.0.0.1:" << socket->address().port() << "/";
+
+    uint64_t completed = 0;
+    std::vector<http::ClientConnection::Ptr> conns;
+    std::function<void()> next = [&]() {
+        auto conn = http::createConnection(url.str(), nullptr, loop);
+        conn->Complete += [&](const http::Response&) {
+            if (++completed == n)
+                server.shutdown();
+            else
+                next();
+        };
+        conns.push_back(conn);
+        conn->send();
+    };
+    next();
+
+    uv::runLoop(loop);
+    if (completed != n)
+        throw std::runtime_error("HTTP requests did not complete");
+}
+
+
+} // namespace
+
+
+void registerHTTP(Runner& runner)
+{
+    //
+    // Parser
+    //
+
+    runner.add("http/parse request", [](uint64_t n) {
+        http::Request request;
+        http::Parser parser(&request);
+        for (uint64_t i = 0; i < n; i++) {
+            request.clear();
+            parser.reset();
+            parser.parse(kRequest, sizeof(kRequest) - 1);
+        }
+        doNotOptimize(request);
+    }, sizeof(kRequest) - 1);
+
+    runner.add("http/parse response", [](uint64_t n) {
+        http::Response response;
+        http::Parser parser(&response);
+        for (uint64_t i = 0; i < n; i++) {
+            response.clear();
+            parser.reset();
+            parser.parse(kResponse, sizeof(kResponse) - 1);
+        }
+        doNotOptimize(response);
+    }, sizeof(kResponse) - 1);
+
+    //
+    // WebSocket Framing
+    //
+
+    const size_t frameSize = 1024;
+    runner.add("http/websocket write masked frame 1KB", [frameSize](uint64_t n) {
+        http::ws::WebSocketFramer client(http::ws::ClientSide);
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        handshake(client, server);
+        std::string payload(frameSize, 'x');
+        Buffer buffer(frameSize + 14);
+        for (uint64_t i = 0; i < n; i++) {
+            BitWriter writer(buffer);
+            client.writeFrame(payload.data(), payload.size(), http::ws::SendFlags::Binary, writer);
+            doNotOptimize(writer.position());
+        }
+    }, frameSize);
+
+    runner.add("http/websocket read masked frame 1KB", [frameSize](uint64_t n) {
+        http::ws::WebSocketFramer client(http::ws::ClientSide);
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        handshake(client, server);
+        std::string payload(frameSize, 'x');
+        Buffer buffer(frameSize + 14);
+        BitWriter writer(buffer);
+        client.writeFrame(payload.data(), payload.size(), http::ws::SendFlags::Binary, writer);
+        size_t frameLength = writer.position();
+        for (uint64_t i = 0; i < n; i++) {
+            // The payload is unmasked in place, which leaves the frame valid
+            BitReader reader(buffer.data(), frameLength);
+            char* data = nullptr;
+            doNotOptimize(server.readFrame(reader, data));
+        }
+    }, frameSize);
+
+    //
+    // Loopback
+    //
+
+    runner.addFixed("http/loopback requests", 1000, runRequests);
+}
+
+
+} // namespace bench
+} // namespace scy
@@ -0,0 +1,169 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/net/tcpsocket.h"
+#include "scy/net/udpsocket.h"
+#include "scy/timer.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+
+const size_t kMessageSize = 1024;
+
+
+// Echoes received data back to the sender
+struct EchoAdapter : public net::SocketAdapter
+{
+    void onSocketRecv(net::Socket& socket, const MutableBuffer& buffer,
+                      const net::Address& peerAddress) override
+    {
+        socket.send(bufferCast<const char*>(buffer), buffer.size(), peerAddress);
+    }
+};
+
+
+// Sends a message and waits for it to be echoed in full
+// before sending the next, until `wanted` round trips.
+struct PingAdapter : public net::SocketAdapter
+{
+    net::Socket& socket;
+    net::Address peerAddress;
+    std::string message;
+    uint64_t wanted;
+    uint64_t completed = 0;
+    size_t received = 0;
+    std::function<void()> done;
+
+    PingAdapter(net::Socket& socket, uint64_t wanted)
+        : socket(socket)
+        , message(kMessageSize, 'x')
+        , wanted(wanted)
+    {
+    }
+
+    void ping()
+    {
+        received = 0;
+        socket.send(message.data(), message.size(), peerAddress);
+    }
+
+    void onSocketConnect(net::Socket&) override
+    {
+        ping();
+    }
+
+    void onSocketRecv(net::Socket&, const MutableBuffer& buffer,
+                      const net::Address&) override
+    {
+        // TCP may split or coalesce the echoed message
+        received += buffer.size();
+        if (received < message.size())
+            return;
+        if (++completed == wanted)
+            done();
+        else
+            ping();
+    }
+};
+
+
+void runTCPEcho(uint64_t n)
+{
+    auto loop = uv::defaultLoop();
+    EchoAdapter echo;
+    std::vector<net::TCPSocket::Ptr> accepted;
+    net::TCPSocket server(loop);
+    server.bind(net::Address("127.0.0.1", 0));
+    server.listen();
+    server.AcceptConnection += [&](const net::TCPSocket::Ptr& socket) {
+        socket->addReceiver(&echo);
+        accepted.push_back(socket);
+    };
+
+    net::TCPSocket client(loop);
+    PingAdapter ping(client, n);
+    ping.peerAddress = server.address();
+    ping.done = [&]() {
+        client.close();
+        for (auto& socket : accepted)
+            socket->close();
+        server.close();
+    };
+    client.addReceiver(&ping);
+    client.connect(server.address());
+
+    uv::runLoop(loop);
+    client.removeReceiver(&ping);
+    for (auto& socket : accepted)
+        socket->removeReceiver(&echo);
+    if (ping.completed != n)
+        throw std::runtime_error("TCP echo did not complete");
+}
+
+
+void runUDPEcho(uint64_t n)
+{
+    auto loop = uv::defaultLoop();
+    EchoAdapter echo;
+    net::UDPSocket server(loop);
+    server.bind(net::Address("127.0.0.1", 0));
+    server.addReceiver(&echo);
+
+    net::UDPSocket client(loop);
+    client.bind(net::Address("127.0.0.1", 0));
+    PingAdapter ping(client, n);
+    ping.peerAddress = server.address();
+    client.addReceiver(&ping);
+
+    // Resend if a datagram was dropped, so the run can't stall
+    uint64_t last = 0;
+    Timer resend(100, 100, loop, [&]() {
+        if (ping.completed == last)
+            ping.ping();
+        last = ping.completed;
+    });
+    resend.handle().ref();
+
+    ping.done = [&]() {
+        resend.stop();
+        client.close();
+        server.close();
+    };
+    ping.ping();
+
+    uv::runLoop(loop);
+    client.removeReceiver(&ping);
+    server.removeReceiver(&echo);
+    if (ping.completed != n)
+        throw std::runtime_error("UDP echo did not complete");
+}
+
+
+} // namespace
+
+
+void registerNet(Runner& runner)
+{
+    runner.addFixed("net/tcp echo 1KB", 10000, runTCPEcho, kMessageSize);
+    runner.addFixed("net/udp echo 1KB", 10000, runUDPEcho, kMessageSize);
+}
+
+
+} // namespace bench
+} // namespace scy
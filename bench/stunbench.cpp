@@ -0,0 +1,86 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+
+
+#include "bench.h"
+#include "scy/stun/message.h"
+
+#include <string>
+
+
+namespace scy {
+namespace bench {
+
+
+namespace {
+
+
+// Build a typical authenticated TURN allocate request
+void createRequest(stun::Message& request)
+{
+    request.setClass(stun::Message::Request);
+    request.setMethod(stun::Message::Allocate);
+    request.setTransactionID("0123456789ab");
+
+    auto username = new stun::Username;
+    username->copyBytes("someuser", 8);
+    request.add(username);
+
+    auto realm = new stun::Realm;
+    realm->copyBytes("sourcey.com", 11);
+    request.add(realm);
+
+    auto transport = new stun::RequestedTransport;
+    transport->setValue(17 << 24);
+    request.add(transport);
+
+    auto address = new stun::XorMappedAddress;
+    address->setAddress(net::Address("192.168.1.1", 5555));
+    request.add(address);
+
+    auto integrity = new stun::MessageIntegrity;
+    integrity->setKey("somepass");
+    request.add(integrity);
+}
+
+
+} // namespace
+
+
+void registerSTUN(Runner& runner)
+{
+    Buffer encoded;
+    {
+        stun::Message request;
+        createRequest(request);
+        request.write(encoded);
+    }
+
+    runner.add("stun/write allocate request", [](uint64_t n) {
+        stun::Message request;
+        createRequest(request);
+        Buffer buf;
+        buf.reserve(256);
+        for (uint64_t i = 0; i < n; i++) {
+            buf.clear();
+            request.write(buf);
+        }
+        doNotOptimize(buf.size());
+    }, encoded.size());
+
+    runner.add("stun/read allocate request", [encoded](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            stun::Message message;
+            doNotOptimize(message.read(constBuffer(encoded)));
+        }
+    }, encoded.size());
+}
+
+
+} // namespace bench
+} // namespace scy
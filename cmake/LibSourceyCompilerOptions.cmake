@@ -21,8 +21,16 @@ if(CMAKE_COMPILER_IS_GNUCXX OR CMAKE_CXX_COMPILER_ID MATCHES "Clang")
     message(FATAL_ERROR "GCC version must be at least 4.9!")
   endif()
 
-  # Using c++14 (CMAKE_CXX_FLAGS only, not for CMAKE_C_FLAGS)
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++1y")
+  # Using c++14 (CMAKE_CXX_FLAGS only, not for CMAKE_C_FLAGS), or c++20
+  # when the coroutine adapters are enabled
+  if(ENABLE_COROUTINES)
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++2a")
+    if(CMAKE_COMPILER_IS_GNUCXX AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 11)
+      set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fcoroutines")
+    endif()
+  else()
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++1y")
+  endif()
 
   # High level of warnings.
   set(LibSourcey_EXTRA_C_FLAGS "${LibSourcey_EXTRA_C_FLAGS} -Wall")
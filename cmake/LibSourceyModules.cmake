@@ -238,6 +238,43 @@ macro(define_libsourcey_test name)
 endmacro()
 
 
+#
+### Macro: define_libsourcey_benchmark
+#
+# Defines a LibSourcey benchmark application.
+# Benchmarks are not registered with ctest since their
+# results depend on the host.
+#
+macro(define_libsourcey_benchmark name)
+
+  project(${name})
+
+  # Add source files
+  file(GLOB lib_hdrs "*.h*")
+  file(GLOB lib_srcs "*.cpp")
+
+  source_group("Src" FILES ${lib_srcs})
+  source_group("Include" FILES ${lib_hdrs})
+
+  add_executable(${name} ${lib_srcs} ${lib_hdrs})
+
+  # Include library and header directories
+  set_default_project_directories(${name} ${ARGN})
+
+  # Include linker dependencies
+  set_default_project_dependencies(${name} ${ARGN})
+
+  message(STATUS "Including benchmark ${name}")
+
+  if(ENABLE_SOLUTION_FOLDERS)
+    set_target_properties(${name} PROPERTIES FOLDER "benchmarks")
+  endif()
+  set_target_properties(${name} PROPERTIES DEBUG_POSTFIX "")
+
+  install(TARGETS ${name} RUNTIME DESTINATION "${LibSourcey_SHARED_INSTALL_DIR}/benchmarks/${name}" COMPONENT benchmarks)
+endmacro()
+
+
 #
 ### Macro: define_libsourcey_library
 #
@@ -0,0 +1,104 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#ifndef SCY_AV_AudioFramePool_H
+#define SCY_AV_AudioFramePool_H
+
+
+#include "scy/av/av.h"
+
+#ifdef HAVE_FFMPEG
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace scy {
+namespace av {
+
+
+/// Allocation counters for the AudioFramePool.
+struct AudioFramePoolStats
+{
+    uint64_t acquired = 0;  ///< frames handed out
+    uint64_t allocated = 0; ///< frames allocated because the pool was empty
+    uint64_t released = 0;  ///< frames returned to the pool
+    uint64_t freed = 0;     ///< frames freed because the pool was full
+};
+
+
+/// Pool of audio frames with allocated sample planes.
+///
+/// Frames are keyed by sample format, channel count and number of samples,
+/// and are recycled with their sample buffers intact, so pipelines which
+/// process frames of a stable size stop allocating once warmed up.
+///
+/// Frames must be returned with release() rather than freed, and must keep
+/// their format, channel count and number of samples. Frames which are
+/// still referenced elsewhere when released are freed rather than pooled.
+/// The pool is thread-safe.
+class AV_API AudioFramePool
+{
+public:
+    /// Create a pool which keeps up to `maxFrames` idle frames per key.
+    AudioFramePool(size_t maxFrames = 32);
+    ~AudioFramePool();
+
+    /// Return a writable frame with sample planes for
+    /// at least `numSamples` samples per channel.
+    AVFrame* acquire(AVSampleFormat format, int channels, int numSamples);
+
+    /// Return a frame to the pool.
+    void release(AVFrame* frame);
+
+    /// Free all idle frames.
+    void clear();
+
+    /// Return the number of idle frames.
+    size_t size() const;
+
+    /// Return a copy of the allocation counters.
+    AudioFramePoolStats stats() const;
+
+    /// Return the shared pool used by the audio codec
+    /// contexts, resamplers and packets.
+    static AudioFramePool& instance();
+
+protected:
+    AudioFramePool(const AudioFramePool&) = delete;
+    AudioFramePool& operator=(const AudioFramePool&) = delete;
+
+    static uint64_t key(int format, int channels, int numSamples);
+
+    mutable std::mutex _mutex;
+    std::unordered_map<uint64_t, std::vector<AVFrame*>> _frames;
+    AudioFramePoolStats _stats;
+    size_t _maxFrames;
+    size_t _size;
+};
+
+
+} // namespace av
+} // namespace scy
+
+
+#endif
+#endif // SCY_AV_AudioFramePool_H
+
+
+/// @\}
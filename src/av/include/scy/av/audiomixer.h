@@ -0,0 +1,189 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#ifndef SCY_AV_AudioMixer_H
+#define SCY_AV_AudioMixer_H
+
+
+#include "scy/av/av.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace scy {
+namespace av {
+
+
+//
+// Mixing Kernels
+//
+// The mixer sums inputs into a float accumulator and only saturates once
+// when the mixed frame is stored, so the result does not depend on the
+// order in which inputs are added. The kernels are vectorized with SSE2
+// where available and fall back to scalar code otherwise.
+//
+
+
+/// Add `n` s16 samples scaled by `gain` to the accumulator.
+/// Accumulated values are in s16 scale.
+AV_API void mixSamples(float* acc, const int16_t* src, size_t n, float gain);
+
+/// Add `n` float samples scaled by `gain` to the accumulator.
+AV_API void mixSamples(float* acc, const float* src, size_t n, float gain);
+
+/// Store `n` accumulated samples as s16, saturating to the s16 range.
+AV_API void storeSamples(int16_t* dst, const float* acc, size_t n);
+
+/// Store `n` accumulated samples as float, clamping to [-1, 1].
+AV_API void storeSamples(float* dst, const float* acc, size_t n);
+
+
+} // namespace av
+} // namespace scy
+
+
+#ifdef HAVE_FFMPEG
+
+#include "scy/av/audiobuffer.h"
+#include "scy/av/audioresampler.h"
+#include "scy/av/format.h"
+#include "scy/av/packet.h"
+#include "scy/packetstream.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace scy {
+namespace av {
+
+
+/// Mixes any number of audio sources into a single stream.
+///
+/// Each input is registered with its own format and gain, and is
+/// resampled to the output format on write if required. Samples are
+/// queued in a per-input FIFO which is positioned on the output timeline
+/// by the `MediaPacket::time` of incoming packets: gaps are filled with
+/// silence and samples which precede the current output position are
+/// discarded.
+///
+/// Frames of exactly `frameSize` samples are emitted once every input
+/// has buffered the frame, or once any input is more than `maxDelay`
+/// microseconds ahead in which case lagging inputs contribute silence.
+/// Inputs which fall more than `maxDelay` behind the leading input are
+/// idle: they are mixed as silence and not waited on until they write
+/// again, so a silent input only delays the mix once.
+///
+/// The output sample format must be one of s16, s16p, flt or fltp.
+/// When used as a PacketProcessor incoming packets are routed to inputs
+/// by their `IPacket::source` pointer.
+///
+/// The mixer is thread-safe. Frames are mixed under the lock and emitted
+/// in order after it is released, so subscribers may call back into the
+/// mixer. If several threads write at once, the frames may be emitted by
+/// the thread which is already emitting.
+class AV_API AudioMixer : public PacketProcessor
+{
+public:
+    AudioMixer(const AudioCodec& oparams, int frameSize = 1024,
+               int64_t maxDelay = 200000);
+    virtual ~AudioMixer();
+
+    /// Add an input and return its ID.
+    /// Packets from `source` are routed to the input by process().
+    int addInput(const AudioCodec& iparams, float gain = 1.0f,
+                 void* source = nullptr);
+
+    /// Remove an input and discard its buffered samples.
+    void removeInput(int id);
+
+    /// Set the linear gain of an input.
+    void setGain(int id, float gain);
+
+    /// Write samples to an input and emit any completed frames.
+    void write(int id, AudioPacket& packet);
+
+    /// Emit all buffered samples, padding the last frame with silence.
+    void flush();
+
+    /// Return the output parameters.
+    const AudioCodec& oparams() const;
+
+    /// Return the output frame size in samples per channel.
+    int frameSize() const;
+
+    /// Return the time of the next output frame in microseconds.
+    int64_t time() const;
+
+    virtual bool accepts(IPacket* packet) override;
+    virtual void process(IPacket& packet) override;
+
+    PacketSignal emitter;
+
+protected:
+    struct Input
+    {
+        int id;
+        void* source;
+        float gain;
+        AudioCodec iparams;
+        AudioBuffer fifo;
+        std::unique_ptr<AudioResampler> resampler;
+        int64_t head; ///< time of the first buffered sample, or -1
+        int64_t tail; ///< time after the last written sample, or -1
+    };
+
+    Input* get(int id) const;
+    void write(Input& input, uint8_t** samples, int numSamples, int64_t time);
+    void pad(Input& input, int numSamples);
+    void mix(bool flush);
+    void mixFrame();
+    void queueFrame();
+    void emitFrames();
+    int64_t bufferedUntil(const Input& input) const;
+    int64_t timeAt(int64_t position) const;
+    int64_t duration(int64_t numSamples) const;
+    int samplesFor(int64_t duration) const;
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<Input>> _inputs;
+    AudioCodec _oparams;
+    AVSampleFormat _format;
+    bool _planar;
+    int _planes;
+    int _planeSize;  ///< samples per plane in one frame
+    int _frameSize;
+    int _bytesPerSample;
+    int64_t _maxDelay;
+    int64_t _start;    ///< time of the first output sample, or -1
+    int64_t _position; ///< number of samples emitted per channel
+    int _nextID;
+    std::vector<std::vector<float>> _acc;   ///< per plane accumulators
+    std::vector<std::vector<uint8_t>> _scratch; ///< per plane input samples
+    std::vector<void*> _scratchPlanes; ///< plane pointers into _scratch
+    std::vector<std::vector<uint8_t>> _out; ///< per plane output samples
+    std::deque<std::unique_ptr<AudioPacket>> _ready; ///< mixed frames to emit
+    bool _emitting;
+};
+
+
+} // namespace av
+} // namespace scy
+
+
+#endif
+#endif // SCY_AV_AudioMixer_H
+
+
+/// @\}
@@ -66,10 +66,11 @@ struct AudioResampler
 
     AudioCodec iparams;     ///< input audio parameters
     AudioCodec oparams;     ///< output audio parameters
+    AVFrame* outFrame;      ///< the pooled frame which owns the output samples
     uint8_t** outSamples;   ///< the output samples buffer
     int outNumSamples;      ///< the number of samples currently in the output buffer
     int outBufferSize;      ///< the number of bytes currently in the buffer
-    int maxNumSamples;      ///< the maximum number of samples that can be stored in
+    int maxNumSamples;      ///< the maximum number of samples that can be stored in the output buffer
     enum AVSampleFormat inSampleFmt;  ///< input sample format
     enum AVSampleFormat outSampleFmt; ///< output sample format
 };
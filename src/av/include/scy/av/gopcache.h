@@ -0,0 +1,166 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#ifndef SCY_AV_GOPCache_H
+#define SCY_AV_GOPCache_H
+
+
+#include "scy/av/av.h"
+#include "scy/av/packet.h"
+#include "scy/packetstream.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace scy {
+namespace av {
+
+
+/// Counters for the GOPCache.
+struct GOPCacheStats
+{
+    uint64_t keyframes = 0;  ///< keyframes which started a new GOP
+    uint64_t replayed = 0;   ///< packets replayed to new subscribers
+    uint64_t overflows = 0;  ///< GOPs dropped for exceeding the limits
+};
+
+
+/// Keyframe aware cache which lets clients join a live stream instantly.
+///
+/// The cache retains the latest container header and every packet since
+/// the last keyframe. New subscribers are sent the header and cached
+/// packets straight away, so they can start decoding without waiting for
+/// the encoder's next keyframe, and then receive the live output.
+///
+/// Headers are packets flagged with HeaderPacket, as emitted by the
+/// MultiplexEncoder in streaming mode. Keyframes are VideoPackets with
+/// `iframe` set, or packets flagged with KeyframePacket. Packets which
+/// arrive before the first keyframe are not cached.
+///
+/// Memory is bounded per stream by `maxBytes` and `maxPackets`. If the
+/// current GOP grows past either limit it is dropped, and caching resumes
+/// from the next keyframe.
+///
+/// Packets are emitted as is, so the cache can sit anywhere after the
+/// encoder in a PacketStream. Attach it to a single shared stream and
+/// subscribe each client, rather than building a pipeline per client.
+///
+/// The cache is thread-safe. Packets are cached under the lock and sent
+/// to subscribers after it is released, so subscribers may call back
+/// into the cache. Each processed packet advances a generation counter,
+/// and a subscriber which is still being replayed the cache queues live
+/// packets from later generations until the replay is done.
+class AV_API GOPCache : public PacketProcessor
+{
+public:
+    typedef std::function<void(IPacket&)> Subscriber;
+
+    GOPCache(size_t maxBytes = 8 * 1024 * 1024, size_t maxPackets = 1024);
+    virtual ~GOPCache();
+
+    /// Sends the cached header and GOP to the subscriber, then attaches
+    /// it to the live output. No packets are lost or repeated between
+    /// the two. The replay runs on the calling thread without blocking
+    /// process(). If no GOP is cached the subscriber is sent only
+    /// headers until the next keyframe arrives, rather than packets it
+    /// can't decode. Returns an ID for unsubscribe().
+    int subscribe(const Subscriber& subscriber);
+
+    /// Detaches a subscriber from the live output, waiting for calls
+    /// in progress on other threads to return. Once it returns the
+    /// subscriber won't be called again, so its state can be freed.
+    void unsubscribe(int id);
+
+    /// Sets the memory limits for the cached GOP, including the header.
+    void setLimits(size_t maxBytes, size_t maxPackets);
+
+    /// Drops the cached header and GOP.
+    void clear();
+
+    /// Returns the number of cached packets, including the header.
+    size_t size() const;
+
+    /// Returns the number of cached bytes, including the header.
+    size_t bytes() const;
+
+    /// Returns true if a GOP is cached.
+    bool hasKeyframe() const;
+
+    /// Returns a copy of the counters.
+    GOPCacheStats stats() const;
+
+    /// Returns true if the packet starts with a keyframe.
+    static bool isKeyframe(const IPacket& packet);
+
+    virtual void process(IPacket& packet) override;
+
+    PacketSignal emitter;
+
+protected:
+    GOPCache(const GOPCache&) = delete;
+    GOPCache& operator=(const GOPCache&) = delete;
+
+    /// Subscriber state.
+    struct Subscription
+    {
+        int id;
+        Subscriber subscriber;
+        uint64_t generation; ///< last generation included in the replay
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::vector<std::unique_ptr<IPacket>> pending; ///< live packets held during the replay
+        int busy = 0; ///< live calls in progress
+        bool keyframe = false; ///< a keyframe has been sent
+        bool live = false;
+        bool removed = false;
+
+        /// Sends a live packet, or queues it while replaying.
+        void send(IPacket& packet, uint64_t generation);
+
+        /// Ends a live call started by send().
+        void done();
+    };
+
+    void cache(IPacket& packet);
+    void dropGOP();
+    static IPacket* copy(IPacket& packet);
+
+    typedef std::vector<std::shared_ptr<IPacket>> PacketList;
+
+    mutable std::mutex _mutex;
+    std::vector<std::shared_ptr<Subscription>> _subscriptions;
+    uint64_t _generation;
+    int _nextID;
+    PacketList _header;
+    PacketList _gop;
+    size_t _headerBytes;
+    size_t _gopBytes;
+    size_t _maxBytes;
+    size_t _maxPackets;
+    bool _inHeader;
+    bool _caching;
+    GOPCacheStats _stats;
+};
+
+
+} // namespace av
+} // namespace scy
+
+
+#endif // SCY_AV_GOPCache_H
+
+
+/// @\}
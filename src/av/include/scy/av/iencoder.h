@@ -60,6 +60,7 @@ struct EncoderOptions
     std::string ifile; ///< input file path.
     std::string ofile; ///< output file path.
     long duration;     ///< duration of time to record in nanoseconds.
+    long chunkDuration; ///< fragmented MP4 chunk duration in microseconds.
     EncoderOptions(const Format& iformat = Format(),
                    const Format& oformat = Format(),
                    const std::string& ifile = "",
@@ -70,6 +71,7 @@ struct EncoderOptions
         , ifile(ifile)
         , ofile(ofile)
         , duration(duration)
+        , chunkDuration(500000)
     {
     }
 
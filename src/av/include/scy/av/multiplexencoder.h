@@ -22,6 +22,7 @@
 #include "scy/av/iencoder.h"
 #include "scy/av/packet.h"
 #include "scy/av/videoencoder.h"
+#include "scy/buffer.h"
 #include "scy/packetstream.h"
 #include <mutex>
 #include <fstream>
@@ -39,6 +40,15 @@ namespace av {
 
 
 /// This class implements a multiplex audio and video encoder.
+///
+/// In streaming mode muxed output is emitted as MediaPackets, with the
+/// stream header flagged HeaderPacket. When the output format is MP4 the
+/// stream is fragmented for low latency playback: the header is the
+/// init segment (ftyp+moov), and each following packet is a single
+/// moof+mdat chunk of around `EncoderOptions::chunkDuration`, which can
+/// be fed straight to a browser MediaSource buffer. Chunks are cut at
+/// every video keyframe, and those starting with one are flagged
+/// KeyframePacket.
 class AV_API MultiplexEncoder : public IEncoder
 {
 public:
@@ -82,11 +92,23 @@ public:
     VideoEncoder* video();
     AudioEncoder* audio();
 
+    /// Returns true if output is emitted as fragmented MP4 chunks.
+    bool fragmented() const;
+
     PacketSignal emitter;
 
 protected:
     bool writeOutputPacket(AVPacket& packet);
 
+    /// AVIO write callback which emits muxed output in streaming mode.
+    static int dispatchOutputPacket(void* opaque, uint8_t* buffer, int bufferSize);
+
+    /// Flush the current fragment and emit it as a single packet.
+    void flushChunk();
+
+    /// Emit buffered fragmented output with the given flags.
+    void emitChunk(unsigned flags);
+
     /// Convert input microseconds to the stream time base.
     bool updateStreamPts(AVStream* stream, int64_t* pts);
 
@@ -99,6 +121,12 @@ protected:
     AudioEncoder* _audio;
     AVIOContext* _ioCtx;
     uint8_t* _ioBuffer;
+    unsigned _outputFlags;
+    bool _fragmented;
+    Buffer _chunk;
+    int64_t _chunkStart; ///< time of the first timed packet in the chunk
+    unsigned _chunkFlags;
+    bool _chunkOpen;
     int64_t _pts;
     mutable std::mutex _mutex;
 };
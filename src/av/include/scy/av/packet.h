@@ -18,10 +18,22 @@
 #include "scy/time.h"
 
 
+struct AVFrame;
+
+
 namespace scy {
 namespace av {
 
 
+/// Flags which describe the contents of encoded media packets.
+/// They share IPacket::flags with the PacketStream's PacketFlags.
+enum MediaPacketFlags
+{
+    HeaderPacket = 0x100,  ///< Container header which must precede all other data
+    KeyframePacket = 0x200 ///< Starts with a keyframe which can be decoded on its own
+};
+
+
 struct MediaPacket : public RawPacket
 {
     int64_t time; // microseconds
@@ -51,7 +63,7 @@ struct VideoPacket : public MediaPacket
 {
     int width;
     int height;
-    bool iframe;
+    bool iframe; // keyframe (AV_PKT_FLAG_KEY)
 
     VideoPacket(uint8_t* data = nullptr, size_t size = 0,
                 int width = 0, int height = 0, int64_t time = 0)
@@ -123,12 +135,15 @@ struct AudioPacket : public MediaPacket
 
 
 /// Audio packet for planar formats
+///
+/// Copies draw their sample planes from the AudioFramePool.
 struct PlanarAudioPacket : public AudioPacket
 {
     uint8_t* buffer[4] = { nullptr };
     int linesize;
     int channels;
     std::string sampleFmt;
+    AVFrame* frame = nullptr; ///< pooled frame which owns copied samples
 
     PlanarAudioPacket(uint8_t* data[4], int channels = 0, size_t numSamples = 0, //, size_t size = 0
                       const std::string& sampleFmt = "", int64_t time = 0);
@@ -15,77 +15,332 @@
 
 #include "scy/av/packet.h"
 #include "scy/base.h"
-#include "scy/packetqueue.h"
+#include "scy/logger.h"
+#include "scy/packetstream.h"
+#include "scy/thread.h"
+#include "scy/time.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 
 namespace scy {
 namespace av {
 
 
+/// Playout statistics for the RealtimePacketQueue.
+struct RealtimeQueueStats
+{
+    uint64_t pushed = 0;     ///< packets accepted for playout
+    uint64_t dispatched = 0; ///< packets emitted
+    uint64_t late = 0;       ///< packets received after their playout deadline
+    uint64_t dropped = 0;    ///< late packets dropped by the jitter buffer
+    uint64_t overflow = 0;   ///< packets purged because the queue was full
+    int64_t maxLateness = 0; ///< maximum lateness in microseconds
+};
+
+
 /// This class emits media packets based on their realtime pts value.
+///
+/// Packets are kept in a min-heap ordered by their `time` value, and the
+/// dispatch thread sleeps on a monotonic clock until the next playout
+/// deadline. Pushing a packet which is due earlier than the current head
+/// wakes the thread so it can reschedule.
+///
+/// In jitter buffer mode each packet is delayed by a fixed target delay
+/// which absorbs network jitter, and packets which arrive after their
+/// playout deadline are dropped rather than emitted out of order.
+///
+/// API change: the queue used to derive from AsyncPacketQueue, but now
+/// derives from PacketProcessor directly, since the base class thread
+/// polled and re-sorted the whole queue on every push. Code which holds
+/// the queue as an AsyncPacketQueue or PacketQueue no longer compiles.
+/// The commonly used queue methods (`flush()`, `clear()`, `cancel()`,
+/// `cancelled()` and `empty()`) are still provided, but subclasses
+/// overriding `popNext()` or `dispatch()` must be ported.
 template <class PacketT>
-class RealtimePacketQueue : public AsyncPacketQueue<PacketT>
+class RealtimePacketQueue : public PacketProcessor
 {
 public:
-    typedef AsyncPacketQueue<PacketT> BaseQueue;
-
     RealtimePacketQueue(int maxSize = 1024)
-        : BaseQueue(maxSize)
+        : PacketProcessor(this->emitter)
+        , _maxSize(maxSize)
+        , _delay(0)
+        , _jitterBuffer(false)
+        , _closed(false)
+        , _seq(0)
+        , _startTime(time::hrtime())
     {
+        _thread.start(std::bind(&RealtimePacketQueue::run, this));
     }
 
     virtual ~RealtimePacketQueue()
     {
+        close();
+
+        // close() can't join the dispatch thread from the thread itself,
+        // such as when the stream is closed from a packet callback
+        if (_thread.joinable()) {
+            if (_thread.tid() == Thread::currentID())
+                _thread.detach();
+            else
+                _thread.join();
+        }
+    }
+
+    /// Add an item to the queue.
+    /// The queue takes ownership of the item pointer.
+    virtual void push(PacketT* item)
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_closed) {
+            delete item;
+            return;
+        }
+
+        int64_t deadline = item->time + _delay;
+        int64_t lateness = realTime() - deadline;
+        if (lateness > 0) {
+            _stats.late++;
+            _stats.maxLateness = std::max(_stats.maxLateness, lateness);
+            if (_jitterBuffer) {
+                _stats.dropped++;
+                delete item;
+                return;
+            }
+        }
+
+        // Purge the earliest packets if the queue is full
+        while (_maxSize > 0 && static_cast<int>(_heap.size()) >= _maxSize) {
+            LWarn("Purging: ", _heap.size())
+            std::pop_heap(_heap.begin(), _heap.end(), Compare());
+            delete _heap.back().packet;
+            _heap.pop_back();
+            _stats.overflow++;
+        }
+
+        _stats.pushed++;
+        _heap.push_back(Entry{deadline, _seq++, item});
+        std::push_heap(_heap.begin(), _heap.end(), Compare());
+
+        // Wake the dispatch thread if the new packet is due first
+        if (_heap.front().packet == item)
+            _cond.notify_one();
+    }
+
+    /// Enable jitter buffer mode with the given target playout delay in
+    /// microseconds. Passing a zero delay disables jitter buffer mode.
+    void setJitterBuffer(int64_t delay)
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        assert(_heap.empty() && "queue must not be active");
+        _delay = delay;
+        _jitterBuffer = delay > 0;
+    }
+
+    /// Return the jitter buffer target delay in microseconds.
+    int64_t jitterBufferDelay() const
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _delay;
+    }
+
+    /// Stop the dispatch thread and flush queued packets in playout order.
+    virtual void close()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            if (_closed)
+                return;
+            _closed = true;
+        }
+        _cond.notify_one();
+        if (_thread.tid() != Thread::currentID())
+            _thread.join();
+
+        // Flush queued items, some protocols can't afford dropped packets
+        flush();
+    }
+
+    /// Emit all queued packets in playout order without waiting
+    /// for their deadlines.
+    void flush()
+    {
+        PacketT* next;
+        while ((next = popNext(true))) {
+            emit(*next);
+            delete next;
+        }
+    }
+
+    /// Drop all queued packets.
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (auto& entry : _heap)
+            delete entry.packet;
+        _heap.clear();
+    }
+
+    /// Drop queued packets and stop the dispatch thread.
+    void cancel()
+    {
+        clear();
+        close();
+    }
+
+    /// Return true if the queue has been closed.
+    bool cancelled() const
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _closed;
     }
 
-    // Add an item to the queue
-    virtual void push(PacketT* item) override
+    /// Return true if no packets are queued.
+    bool empty() const
     {
-        BaseQueue::push(item);
-        BaseQueue::template sort<MediaPacketTimeCompare>();
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _heap.empty();
     }
 
-    // Return the current duration from stream start in microseconds
-    int64_t realTime()
+    /// Return a copy of the playout statistics.
+    RealtimeQueueStats stats() const
     {
-        return (time::hrtime() - _startTime) / 1000;
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _stats;
     }
 
+    /// Return the number of queued packets.
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _heap.size();
+    }
+
+    /// Return the current duration from stream start in microseconds.
+    int64_t realTime() const
+    {
+        return static_cast<int64_t>(time::hrtime() - _startTime) / 1000;
+    }
+
+    virtual void process(IPacket& packet) override
+    {
+        push(reinterpret_cast<PacketT*>(packet.clone()));
+    }
+
+    virtual bool accepts(IPacket* packet) override
+    {
+        return dynamic_cast<PacketT*>(packet) != 0;
+    }
+
+    PacketSignal emitter;
+
 protected:
-    virtual PacketT* popNext() override
+    RealtimePacketQueue(const RealtimePacketQueue&) = delete;
+    RealtimePacketQueue& operator=(const RealtimePacketQueue&) = delete;
+
+    struct Entry
     {
-        if (BaseQueue::empty())
-            return nullptr;
+        int64_t deadline;
+        uint64_t seq;
+        PacketT* packet;
+    };
 
-        auto next = BaseQueue::front();
-        if (next->time > realTime())
-            return nullptr;
-        BaseQueue::pop();
+    /// Orders the heap by deadline, and by arrival for equal deadlines.
+    struct Compare
+    {
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            return a.deadline != b.deadline ? a.deadline > b.deadline
+                                             : a.seq > b.seq;
+        }
+    };
+
+    /// Set the stream start time (hrtime), and wake the dispatch
+    /// thread since the head deadline has moved.
+    void setStartTime(uint64_t startTime)
+    {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _startTime = startTime;
+        }
+        _cond.notify_one();
+    }
 
-        STrace << "Pop next: " << BaseQueue::size() << ": "
-            << realTime() << " > " << next->time << std::endl;
+    /// Pop the next packet which is due for playout, or any
+    /// queued packet if `force` is set.
+    PacketT* popNext(bool force = false)
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_heap.empty() || (!force && _heap.front().deadline > realTime()))
+            return nullptr;
+        std::pop_heap(_heap.begin(), _heap.end(), Compare());
+        auto next = _heap.back().packet;
+        _heap.pop_back();
+        _stats.dispatched++;
         return next;
     }
 
-    virtual void onStreamStateChange(const PacketStreamState& state) override
+    /// Dispatch packets as their deadlines expire until closed.
+    void run()
     {
-        LTrace("Stream state changed: ", state)
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_closed) {
+            if (_heap.empty()) {
+                _cond.wait(lock);
+                continue;
+            }
 
-        if (state.equals(PacketStreamState::Active)) {
-            _startTime = time::hrtime();
-        }
+            int64_t delay = _heap.front().deadline - realTime();
+            if (delay > 0) {
+                _cond.wait_for(lock, std::chrono::microseconds(delay));
+                continue;
+            }
+
+            std::pop_heap(_heap.begin(), _heap.end(), Compare());
+            auto next = _heap.back().packet;
+            _heap.pop_back();
+            _stats.dispatched++;
 
-        BaseQueue::onStreamStateChange(state);
+            lock.unlock();
+            emit(*next);
+            delete next;
+            lock.lock();
+        }
     }
 
-    struct MediaPacketTimeCompare
+    virtual void onStreamStateChange(const PacketStreamState& state) override
     {
-        bool operator()(const MediaPacket* a, const MediaPacket* b) {
-            return a->time < b->time;
+        LTrace("Stream state changed: ", state)
+
+        switch (state.id()) {
+            case PacketStreamState::Active:
+                setStartTime(time::hrtime());
+                break;
+
+            case PacketStreamState::Error:
+            case PacketStreamState::Closed:
+                close();
+                break;
         }
-    };
+    }
 
-    int64_t _startTime;
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    std::vector<Entry> _heap;
+    RealtimeQueueStats _stats;
+    int _maxSize;
+    int64_t _delay;
+    bool _jitterBuffer;
+    bool _closed;
+    uint64_t _seq;
+    std::atomic<uint64_t> _startTime;
+    Thread _thread;
 };
 
 
@@ -12,6 +12,8 @@
 #include "scy/http/util.h"
 #include "scy/util/base64packetencoder.h"
 
+#include <sstream>
+
 
 using namespace std;
 using namespace scy;
@@ -56,7 +58,11 @@ MediaServer::MediaServer(uint16_t port)
     formats.registerFormat(av::Format("MJPEG", "mjpeg",
         av::VideoCodec("MJPEG", "mjpeg", 480, 320, 20)));
 
-    // TODO: Add h264 and newer audio formats
+    // Fragmented MP4 for browser MediaSource playback
+    formats.registerFormat(av::Format("MP4", "mp4",
+        av::VideoCodec("H264", "libx264", 640, 480, 25)));
+
+    // TODO: Add newer audio formats
 }
 
 
@@ -71,6 +77,13 @@ void MediaServer::setupPacketStream(PacketStream& stream, const StreamingOptions
 {
     LDebug("Setup Packet Stream")
 
+    setupEncoderStream(stream, options);
+    setupFramingStream(stream, options);
+}
+
+
+void MediaServer::setupEncoderStream(PacketStream& stream, const StreamingOptions& options)
+{
     // Attach capture sources
 
     assert(options.oformat.video.enabled || options.oformat.audio.enabled);
@@ -122,17 +135,28 @@ void MediaServer::setupPacketStream(PacketStream& stream, const StreamingOptions
         // auto injector = new FLVMetadataInjector(options.oformat);
         // stream.attach(injector, 10);
     }
+}
+
+
+void MediaServer::setupFramingStream(PacketStream& stream, const StreamingOptions& options)
+{
     // Attach the HTTP output framing
+    std::string contentType("image/jpeg");
+    if (options.oformat.id == "mp4")
+        contentType = "video/mp4";
+    else if (options.oformat.id == "flv")
+        contentType = "video/x-flv";
+
     IPacketizer* framing = nullptr;
     if (options.framing.empty() || options.framing == "none")
         ;
         // framing = new http::StreamingAdapter("image/jpeg");
 
     else if (options.framing == "chunked")
-        framing = new http::ChunkedAdapter("image/jpeg");
+        framing = new http::ChunkedAdapter(contentType);
 
     else if (options.framing == "multipart")
-        framing = new http::MultipartAdapter("image/jpeg", options.encoding == "Base64"); // false,
+        framing = new http::MultipartAdapter(contentType, options.encoding == "Base64"); // false,
 
     else
         throw std::runtime_error("Unsupported framing method: " + options.framing);
@@ -146,6 +170,86 @@ void MediaServer::setupPacketStream(PacketStream& stream, const StreamingOptions
 }
 
 
+void MediaServer::openCaptures(StreamingOptions& options)
+{
+    av::Device dev;
+    av::DeviceManager devman;
+    if (options.oformat.video.enabled) {
+        devman.getDefaultCamera(dev);
+        LInfo("Default video capture ", dev.id)
+        options.videoCapture = std::make_shared<av::VideoCapture>(dev.id, options.oformat.video);
+        // options.videoCapture->openVideo(dev.id, options.oformat.video.width,
+        //                                   options.oformat.video.height,
+        //                                   options.oformat.video.fps);
+        options.videoCapture->getEncoderFormat(options.iformat);
+    }
+    if (options.oformat.audio.enabled) {
+        devman.getDefaultMicrophone(dev);
+        LInfo("Default audio capture ", dev.id)
+        options.audioCapture = std::make_shared<av::AudioCapture>(dev.id, options.oformat.audio);
+        // options.audioCapture->open(dev.id, options.oformat.audio.channels,
+        //                                   options.oformat.audio.sampleRate);
+        options.audioCapture->getEncoderFormat(options.iformat);
+    }
+
+    if (!options.videoCapture && !options.audioCapture) {
+        throw std::runtime_error("No audio or video devices are available for capture");
+    }
+}
+
+
+std::string MediaServer::liveStreamKey(const StreamingOptions& options)
+{
+    // Clients requesting the same output share one encoder
+    std::ostringstream key;
+    key << options.oformat.name << ':' << options.oformat.video.width << 'x'
+        << options.oformat.video.height << ':' << options.oformat.video.fps << ':'
+        << options.oformat.video.quality << ':' << options.chunkDuration << ':'
+        << options.encoding;
+    return key.str();
+}
+
+
+av::GOPCache& MediaServer::liveStream(const StreamingOptions& options)
+{
+    std::string key(liveStreamKey(options));
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto& live = _liveStreams[key];
+    if (!live) {
+        LDebug("Start live stream: ", key)
+        StreamingOptions liveOptions(options);
+        openCaptures(liveOptions);
+
+        std::unique_ptr<LiveStream> created(new LiveStream);
+        setupEncoderStream(created->stream, liveOptions);
+        created->cache = new av::GOPCache;
+        created->stream.attach(created->cache, 12, true);
+        created->stream.start();
+        live = std::move(created);
+    }
+    live->clients++;
+    return *live->cache;
+}
+
+
+void MediaServer::releaseLiveStream(const StreamingOptions& options)
+{
+    std::string key(liveStreamKey(options));
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _liveStreams.find(key);
+    if (it == _liveStreams.end()) {
+        LWarn("Release of unknown live stream: ", key)
+        return;
+    }
+    if (--it->second->clients > 0)
+        return;
+
+    LDebug("Stop live stream: ", key)
+    it->second->stream.stop();
+    _liveStreams.erase(it);
+}
+
+
 //
 // HTTP Streaming Connection Factory
 //
@@ -162,7 +266,8 @@ HTTPStreamingConnectionFactory:: ~HTTPStreamingConnectionFactory()
 }
 
 
-StreamingOptions HTTPStreamingConnectionFactory::createStreamingOptions(http::ServerConnection& conn)
+StreamingOptions HTTPStreamingConnectionFactory::createStreamingOptions(http::ServerConnection& conn,
+                                                                        bool openCaptures)
 {
     auto& request = conn.request();
 
@@ -182,35 +287,18 @@ StreamingOptions HTTPStreamingConnectionFactory::createStreamingOptions(http::Se
         options.oformat.video.fps = util::strtoi<uint32_t>(params.get("fps"));
     if (params.has("quality"))
         options.oformat.video.quality = util::strtoi<uint32_t>(params.get("quality"));
+    if (params.has("chunkDuration")) // milliseconds
+        options.chunkDuration = util::strtoi<long>(params.get("chunkDuration")) * 1000;
 
     // Response encoding and framing options
     options.encoding = params.get("encoding", "");
-    options.framing = params.get("framing", "");
-
-    // Open video and audio captures.
-    av::Device dev;
-    av::DeviceManager devman;
-    if (options.oformat.video.enabled) {
-        devman.getDefaultCamera(dev);
-        LInfo("Default video capture ", dev.id)
-        options.videoCapture = std::make_shared<av::VideoCapture>(dev.id, options.oformat.video);
-        // options.videoCapture->openVideo(dev.id, options.oformat.video.width,
-        //                                   options.oformat.video.height,
-        //                                   options.oformat.video.fps);
-        options.videoCapture->getEncoderFormat(options.iformat);
-    }
-    if (options.oformat.audio.enabled) {
-        devman.getDefaultMicrophone(dev);
-        LInfo("Default audio capture ", dev.id)
-        options.audioCapture = std::make_shared<av::AudioCapture>(dev.id, options.oformat.audio);
-        // options.audioCapture->open(dev.id, options.oformat.audio.channels,
-        //                                   options.oformat.audio.sampleRate);
-        options.audioCapture->getEncoderFormat(options.iformat);
-    }
+    // MP4 chunks are sent as HTTP chunks by default, so each one
+    // can be appended to a MediaSource buffer as it arrives
+    options.framing = params.get("framing", options.oformat.id == "mp4" ? "chunked" : "");
 
-    if (!options.videoCapture && !options.audioCapture) {
-        throw std::runtime_error("No audio or video devices are available for capture");
-    }
+    // Open video and audio captures
+    if (openCaptures)
+        MediaServer::openCaptures(options);
 
     return options;
 }
@@ -233,7 +321,8 @@ http::ServerResponder* HTTPStreamingConnectionFactory::createResponder(http::Ser
 
         // Handle HTTP streaming
         if (request.getURI().find("/streaming") == 0) {
-            return new StreamingRequestHandler(conn, createStreamingOptions(conn));
+            // Captures are opened by the shared live stream
+            return new StreamingRequestHandler(conn, createStreamingOptions(conn, false));
         }
 
         // Handle relayed media requests
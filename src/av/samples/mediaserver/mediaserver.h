@@ -9,10 +9,14 @@
 #include "scy/av/multiplexencoder.h"
 #include "scy/av/devicemanager.h"
 #include "scy/av/formatregistry.h"
+#include "scy/av/gopcache.h"
 #include "scy/http/server.h"
 #include "scy/logger.h"
 #include "scy/packetstream.h"
 #include "scy/util.h"
+#include <map>
+#include <memory>
+#include <mutex>
 
 
 namespace scy {
@@ -55,7 +59,42 @@ public:
                                   bool freeCaptures = true,
                                   bool attachPacketizers = false);
 
+    /// Attach the capture sources, encoder and content encoding.
+    static void setupEncoderStream(PacketStream& stream,
+                                   const StreamingOptions& options);
+
+    /// Attach the HTTP output framing and event loop synchronization.
+    static void setupFramingStream(PacketStream& stream,
+                                   const StreamingOptions& options);
+
+    /// Open the default video and audio captures for the output format.
+    static void openCaptures(StreamingOptions& options);
+
+    /// Return the GOP cache of the shared live stream for the given
+    /// output options, starting the stream on first use. Clients which
+    /// subscribe to it start playback from the cached keyframe.
+    /// Each call must be paired with releaseLiveStream().
+    av::GOPCache& liveStream(const StreamingOptions& options);
+
+    /// Release a live stream acquired with liveStream(). The stream
+    /// and its captures are stopped once the last client releases it.
+    /// Clients must unsubscribe from the cache first.
+    void releaseLiveStream(const StreamingOptions& options);
+
     av::FormatRegistry formats;
+
+protected:
+    struct LiveStream
+    {
+        PacketStream stream;
+        av::GOPCache* cache; // owned by the stream
+        int clients = 0;
+    };
+
+    static std::string liveStreamKey(const StreamingOptions& options);
+
+    std::map<std::string, std::unique_ptr<LiveStream>> _liveStreams;
+    std::mutex _mutex;
 };
 
 
@@ -72,7 +111,8 @@ public:
     //virtual http::ServerConnection::Ptr createConnection(http::Server& server, const net::TCPSocket::Ptr& socket);
 
     //http::ServerResponder* createResponder(http::ServerConnection& conn);
-    StreamingOptions createStreamingOptions(http::ServerConnection& conn);
+    StreamingOptions createStreamingOptions(http::ServerConnection& conn,
+                                            bool openCaptures = true);
     MediaServer* _server;
 };
 
@@ -10,6 +10,8 @@ public:
     StreamingRequestHandler(http::ServerConnection& connection, const StreamingOptions& options)
         : http::ServerResponder(connection)
         , options(options)
+        , cache(nullptr)
+        , subscription(0)
     {
         LDebug("Create")
     }
@@ -30,17 +32,31 @@ public:
         // We will be sending our own headers
         connection().shouldSendHeader(false);
 
-        // Create the packet stream
-        MediaServer::setupPacketStream(stream, options, true, true);
+        // Create the packet stream which frames the shared live
+        // stream output for this connection
+        MediaServer::setupFramingStream(stream, options);
+        stream.attachSource(source);
 
         // Start the stream
         stream.emitter += packetSlot(this, &StreamingRequestHandler::onVideoEncoded);
         stream.start();
+
+        // Subscribe to the live stream, which replays the cached header
+        // and GOP so playback starts without waiting for a keyframe
+        cache = &options.server->liveStream(options);
+        subscription = cache->subscribe([this](IPacket& packet) {
+            source.emit(packet);
+        });
     }
 
     virtual void onClose()
     {
         LDebug("On close")
+        if (cache) {
+            cache->unsubscribe(subscription);
+            options.server->releaseLiveStream(options);
+            cache = nullptr;
+        }
         stream.emitter -= packetSlot(this, &StreamingRequestHandler::onVideoEncoded);
         stream.stop();
     }
@@ -60,8 +76,11 @@ public:
         }
     }
 
+    PacketSignal source;
     PacketStream stream;
     StreamingOptions options;
+    av::GOPCache* cache;
+    int subscription;
     av::FPSCounter fpsCounter;
 };
 
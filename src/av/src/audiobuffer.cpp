@@ -16,6 +16,8 @@
 #include "scy/av/ffmpeg.h"
 #include "scy/logger.h"
 
+#include <algorithm>
+
 
 using std::endl;
 
@@ -87,10 +89,13 @@ void AudioBuffer::write(void** samples, int numSamples)
     assert(samples);
     assert(samples[0]);
 
-    // Make the FIFO as large as it needs to be to hold both
-    // the old and the new samples.
-    if ((error = av_audio_fifo_realloc(fifo, av_audio_fifo_size(fifo) + numSamples)) < 0) {
-        throw std::runtime_error("Cannot reallocate FIFO: " + averror(error));
+    // Grow the FIFO geometrically when it can't hold the new samples,
+    // so steady state writes never reallocate.
+    if (av_audio_fifo_space(fifo) < numSamples) {
+        int size = av_audio_fifo_size(fifo) + numSamples;
+        if ((error = av_audio_fifo_realloc(fifo, std::max(size, size * 3 / 2))) < 0) {
+            throw std::runtime_error("Cannot reallocate FIFO: " + averror(error));
+        }
     }
 
     // Store the new samples in the FIFO buffer.
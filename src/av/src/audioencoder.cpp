@@ -10,6 +10,7 @@
 
 
 #include "scy/av/audioencoder.h"
+#include "scy/av/audioframepool.h"
 #include "scy/av/audioresampler.h"
 
 #ifdef HAVE_FFMPEG
@@ -39,39 +40,6 @@ AudioEncoder::~AudioEncoder()
 }
 
 
-// Initialize one input frame for writing to the output file.
-// The frame will be exactly frame_size samples large.
-static AVFrame* initOutputFrame(AVCodecContext* ctx)
-{
-    AVFrame* frame;
-    int error;
-
-    // Create a new frame to store the audio samples.
-    if (!(frame = av_frame_alloc())) {
-        throw std::runtime_error("Cannot allocate output frame");
-    }
-
-    // Set the frame's parameters, especially its size and format.
-    // av_frame_get_buffer needs this to allocate memory for the
-    // audio samples of the frame.
-    // Default channel layouts based on the number of channels
-    // are assumed for simplicity.
-    frame->nb_samples = ctx->frame_size;
-    frame->channel_layout = ctx->channel_layout;
-    frame->format = ctx->sample_fmt;
-    frame->sample_rate = ctx->sample_rate;
-
-    // Allocate the samples of the created frame. This call will make
-    // sure that the audio frame can hold as many samples as specified.
-    if ((error = av_frame_get_buffer(frame, 0)) < 0) {
-        av_frame_free(&frame);
-        throw std::runtime_error("Could allocate output frame samples: " + averror(error));
-    }
-
-    return frame;
-}
-
-
 void AudioEncoder::create()
 {
     LTrace("Create")
@@ -145,8 +113,11 @@ void AudioEncoder::create()
     outputFrameSize = ctx->frame_size;
     assert(outputFrameSize);
 
-    // Create the encode frame
-    frame = initOutputFrame(ctx);
+    // Create the encode frame. The frame will be exactly frame_size
+    // samples large, and is recycled through the frame pool.
+    frame = AudioFramePool::instance().acquire(
+        ctx->sample_fmt, ctx->channels, ctx->frame_size);
+    frame->sample_rate = ctx->sample_rate;
 
     // Create the FIFO buffer based on the specified output sample format.
     // NOTE: We read from a FIFO buffer as many codecs require a FULL
@@ -175,6 +146,12 @@ void AudioEncoder::close()
 {
     LTrace("Closing")
 
+    // Return the encode frame to the pool rather than freeing it
+    if (frame) {
+        AudioFramePool::instance().release(frame);
+        frame = nullptr;
+    }
+
     AudioContext::close();
 
     if (resampler) {
@@ -0,0 +1,154 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#include "scy/av/audioframepool.h"
+
+#ifdef HAVE_FFMPEG
+
+#include "scy/av/ffmpeg.h"
+#include "scy/logger.h"
+#include "scy/singleton.h"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+
+using std::endl;
+
+
+namespace scy {
+namespace av {
+
+
+AudioFramePool::AudioFramePool(size_t maxFrames)
+    : _maxFrames(maxFrames)
+    , _size(0)
+{
+}
+
+
+AudioFramePool::~AudioFramePool()
+{
+    clear();
+}
+
+
+AudioFramePool& AudioFramePool::instance()
+{
+    static Singleton<AudioFramePool> sh;
+    return *sh.get();
+}
+
+
+AVFrame* AudioFramePool::acquire(AVSampleFormat format, int channels, int numSamples)
+{
+    assert(format != AV_SAMPLE_FMT_NONE);
+    assert(channels > 0);
+    assert(numSamples > 0);
+
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _stats.acquired++;
+        auto it = _frames.find(key(format, channels, numSamples));
+        if (it != _frames.end() && !it->second.empty()) {
+            AVFrame* frame = it->second.back();
+            it->second.pop_back();
+            _size--;
+            frame->pts = AV_NOPTS_VALUE;
+            return frame;
+        }
+        _stats.allocated++;
+    }
+
+    AVFrame* frame = av_frame_alloc();
+    if (!frame)
+        throw std::runtime_error("Cannot allocate audio frame: Out of memory");
+
+    frame->format = format;
+    frame->channels = channels;
+    frame->channel_layout = av_get_default_channel_layout(channels);
+    frame->nb_samples = numSamples;
+
+    int ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        throw std::runtime_error("Cannot allocate audio frame samples: " + averror(ret));
+    }
+
+    return frame;
+}
+
+
+void AudioFramePool::release(AVFrame* frame)
+{
+    if (!frame)
+        return;
+
+    // Frames which are still referenced elsewhere can't be recycled
+    if (av_frame_is_writable(frame)) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _stats.released++;
+        auto& frames = _frames[key(frame->format, frame->channels, frame->nb_samples)];
+        if (frames.size() < _maxFrames) {
+            frames.push_back(frame);
+            _size++;
+            return;
+        }
+        _stats.freed++;
+    }
+
+    av_frame_free(&frame);
+}
+
+
+void AudioFramePool::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    for (auto& kv : _frames) {
+        for (auto frame : kv.second)
+            av_frame_free(&frame);
+    }
+    _frames.clear();
+    _size = 0;
+}
+
+
+size_t AudioFramePool::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _size;
+}
+
+
+AudioFramePoolStats AudioFramePool::stats() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _stats;
+}
+
+
+uint64_t AudioFramePool::key(int format, int channels, int numSamples)
+{
+    return (static_cast<uint64_t>(format & 0xff) << 56) |
+           (static_cast<uint64_t>(channels & 0xffffff) << 32) |
+           static_cast<uint32_t>(numSamples);
+}
+
+
+} // namespace av
+} // namespace scy
+
+
+#endif
+
+
+/// @\}
@@ -0,0 +1,546 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#include "scy/av/audiomixer.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCY_AV_MIX_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace scy {
+namespace av {
+
+
+//
+// Mixing Kernels
+//
+
+
+void mixSamples(float* acc, const int16_t* src, size_t n, float gain)
+{
+    size_t i = 0;
+#ifdef SCY_AV_MIX_SSE2
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        // Sign extend to 32 bits by unpacking into the high halves
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        __m128 a0 = _mm_loadu_ps(acc + i);
+        __m128 a1 = _mm_loadu_ps(acc + i + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_cvtepi32_ps(lo), g));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_cvtepi32_ps(hi), g));
+        _mm_storeu_ps(acc + i, a0);
+        _mm_storeu_ps(acc + i + 4, a1);
+    }
+#endif
+    for (; i < n; i++)
+        acc[i] += src[i] * gain;
+}
+
+
+void mixSamples(float* acc, const float* src, size_t n, float gain)
+{
+    size_t i = 0;
+#ifdef SCY_AV_MIX_SSE2
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+        __m128 a0 = _mm_loadu_ps(acc + i);
+        __m128 a1 = _mm_loadu_ps(acc + i + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(acc + i, a0);
+        _mm_storeu_ps(acc + i + 4, a1);
+    }
+#endif
+    for (; i < n; i++)
+        acc[i] += src[i] * gain;
+}
+
+
+void storeSamples(int16_t* dst, const float* acc, size_t n)
+{
+    size_t i = 0;
+#ifdef SCY_AV_MIX_SSE2
+    // Clamp before converting since out of range conversions
+    // yield INT_MIN, then pack with signed saturation.
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m128 a0 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i), lo), hi);
+        __m128 a1 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i + 4), lo), hi);
+        __m128i s = _mm_packs_epi32(_mm_cvtps_epi32(a0), _mm_cvtps_epi32(a1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+    }
+#endif
+    for (; i < n; i++) {
+        float v = std::min(std::max(acc[i], -32768.0f), 32767.0f);
+        dst[i] = static_cast<int16_t>(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+}
+
+
+void storeSamples(float* dst, const float* acc, size_t n)
+{
+    size_t i = 0;
+#ifdef SCY_AV_MIX_SSE2
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i), lo), hi));
+        _mm_storeu_ps(dst + i + 4, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i + 4), lo), hi));
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = std::min(std::max(acc[i], -1.0f), 1.0f);
+}
+
+
+} // namespace av
+} // namespace scy
+
+
+#ifdef HAVE_FFMPEG
+
+#include "scy/logger.h"
+
+
+using std::endl;
+
+
+namespace scy {
+namespace av {
+
+
+//
+// Audio Mixer
+//
+
+
+AudioMixer::AudioMixer(const AudioCodec& oparams, int frameSize, int64_t maxDelay)
+    : PacketProcessor(this->emitter)
+    , _oparams(oparams)
+    , _format(av_get_sample_fmt(oparams.sampleFmt.c_str()))
+    , _planar(false)
+    , _planes(1)
+    , _planeSize(0)
+    , _frameSize(frameSize)
+    , _bytesPerSample(0)
+    , _maxDelay(maxDelay)
+    , _start(-1)
+    , _position(0)
+    , _nextID(0)
+    , _emitting(false)
+{
+    switch (_format) {
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_FLT:
+            break;
+        case AV_SAMPLE_FMT_S16P:
+        case AV_SAMPLE_FMT_FLTP:
+            _planar = true;
+            break;
+        default:
+            throw std::runtime_error("Unsupported mixer sample format: " + oparams.sampleFmt);
+    }
+
+    assert(oparams.channels > 0);
+    assert(oparams.sampleRate > 0);
+    assert(frameSize > 0);
+
+    // Planar frames are emitted as a PlanarAudioPacket which
+    // only carries up to 4 planes.
+    if (_planar && oparams.channels > 4)
+        throw std::runtime_error("Planar mixer output is limited to 4 channels");
+
+    _planes = _planar ? oparams.channels : 1;
+    _planeSize = _planar ? frameSize : frameSize * oparams.channels;
+    _bytesPerSample = av_get_bytes_per_sample(_format);
+    _acc.assign(_planes, std::vector<float>(_planeSize));
+    _scratch.assign(_planes, std::vector<uint8_t>(_planeSize * _bytesPerSample));
+    _out.assign(_planes, std::vector<uint8_t>(_planeSize * _bytesPerSample));
+    for (auto& plane : _scratch)
+        _scratchPlanes.push_back(plane.data());
+
+    STrace << "Create audio mixer:"
+           << "\n\tChannels: " << oparams.channels
+           << "\n\tSample Rate: " << oparams.sampleRate
+           << "\n\tSample Fmt: " << oparams.sampleFmt
+           << "\n\tFrame Size: " << frameSize
+           << endl;
+}
+
+
+AudioMixer::~AudioMixer()
+{
+}
+
+
+int AudioMixer::addInput(const AudioCodec& iparams, float gain, void* source)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+
+    std::unique_ptr<Input> input(new Input);
+    input->id = _nextID++;
+    input->source = source;
+    input->gain = gain;
+    input->iparams = iparams;
+    input->head = -1;
+    input->tail = -1;
+    input->fifo.alloc(_oparams.sampleFmt, _oparams.channels, _frameSize * 2);
+
+    // Inputs which don't match the output format are
+    // converted before they are buffered.
+    if (iparams.channels != _oparams.channels ||
+        iparams.sampleRate != _oparams.sampleRate ||
+        iparams.sampleFmt != _oparams.sampleFmt) {
+        input->resampler.reset(new AudioResampler(iparams, _oparams));
+        input->resampler->open();
+    }
+
+    LDebug("Add input: ", input->id, ": ", iparams.toString())
+    _inputs.push_back(std::move(input));
+    return _inputs.back()->id;
+}
+
+
+void AudioMixer::removeInput(int id)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = std::find_if(_inputs.begin(), _inputs.end(),
+        [id](const std::unique_ptr<Input>& input) { return input->id == id; });
+    if (it != _inputs.end()) {
+        LDebug("Remove input: ", id)
+        _inputs.erase(it);
+    }
+}
+
+
+void AudioMixer::setGain(int id, float gain)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto input = get(id);
+    if (!input)
+        throw std::runtime_error("Unknown mixer input");
+    input->gain = gain;
+}
+
+
+void AudioMixer::write(int id, AudioPacket& packet)
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto input = get(id);
+        if (!input)
+            throw std::runtime_error("Unknown mixer input");
+
+        auto planar = dynamic_cast<PlanarAudioPacket*>(&packet);
+        uint8_t* data = packet.samples();
+        write(*input, planar ? planar->buffer : &data,
+              static_cast<int>(packet.numSamples), packet.time);
+        mix(false);
+    }
+    emitFrames();
+}
+
+
+void AudioMixer::flush()
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        mix(true);
+    }
+    emitFrames();
+}
+
+
+const AudioCodec& AudioMixer::oparams() const
+{
+    return _oparams;
+}
+
+
+int AudioMixer::frameSize() const
+{
+    return _frameSize;
+}
+
+
+int64_t AudioMixer::time() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return timeAt(_position);
+}
+
+
+bool AudioMixer::accepts(IPacket* packet)
+{
+    return dynamic_cast<AudioPacket*>(packet) != 0;
+}
+
+
+void AudioMixer::process(IPacket& packet)
+{
+    int id = -1;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (auto& input : _inputs) {
+            if (input->source == packet.source) {
+                id = input->id;
+                break;
+            }
+        }
+    }
+    if (id < 0) {
+        LDebug("Dropping packet from unknown source: ", packet.source)
+        return;
+    }
+    write(id, static_cast<AudioPacket&>(packet));
+}
+
+
+AudioMixer::Input* AudioMixer::get(int id) const
+{
+    for (auto& input : _inputs) {
+        if (input->id == id)
+            return input.get();
+    }
+    return nullptr;
+}
+
+
+void AudioMixer::write(Input& input, uint8_t** samples, int numSamples, int64_t time)
+{
+    if (input.resampler) {
+        numSamples = input.resampler->resample(samples, numSamples);
+        samples = input.resampler->outSamples;
+    }
+    if (numSamples <= 0)
+        return;
+
+    if (input.head < 0) {
+        input.head = time;
+    } else {
+        // Fill timestamp gaps larger than half a frame with silence
+        int64_t gap = time - bufferedUntil(input);
+        if (gap > duration(_frameSize) / 2)
+            pad(input, samplesFor(gap));
+    }
+
+    input.fifo.write(reinterpret_cast<void**>(samples), numSamples);
+    input.tail = bufferedUntil(input);
+}
+
+
+void AudioMixer::pad(Input& input, int numSamples)
+{
+    LTrace("Padding input: ", input.id, ": ", numSamples)
+
+    for (auto& plane : _scratch)
+        std::fill(plane.begin(), plane.end(), 0);
+
+    while (numSamples > 0) {
+        int n = std::min(numSamples, _frameSize);
+        input.fifo.write(_scratchPlanes.data(), n);
+        numSamples -= n;
+    }
+}
+
+
+void AudioMixer::mix(bool flush)
+{
+    while (!_inputs.empty()) {
+        if (_start < 0) {
+            for (auto& input : _inputs) {
+                if (input->head >= 0 && (_start < 0 || input->head < _start))
+                    _start = input->head;
+            }
+            if (_start < 0)
+                return;
+        }
+
+        // Emit once every active input has buffered the frame, or once
+        // any input is too far ahead to wait for the others.
+        int64_t now = timeAt(_position);
+        int64_t end = timeAt(_position + _frameSize);
+        int64_t lead = -1;
+        for (auto& input : _inputs)
+            lead = std::max(lead, bufferedUntil(*input));
+        if (lead <= now)
+            return;
+
+        // Inputs which fall more than maxDelay behind the leading input
+        // are idle and mixed as silence rather than waited on. Inputs
+        // which never wrote are timed from the stream start.
+        bool complete = true;
+        for (auto& input : _inputs) {
+            int64_t until = bufferedUntil(*input);
+            int64_t tail = input->tail >= 0 ? input->tail : _start;
+            if (until < end && tail + _maxDelay <= lead)
+                continue;
+            complete = complete && until >= end;
+        }
+        bool overrun = lead >= end + _maxDelay;
+        if (!complete && !overrun && !flush)
+            return;
+
+        mixFrame();
+        queueFrame();
+        _position += _frameSize;
+    }
+}
+
+
+void AudioMixer::mixFrame()
+{
+    void** planes = _scratchPlanes.data();
+    for (auto& plane : _acc)
+        std::fill(plane.begin(), plane.end(), 0.0f);
+
+    int64_t now = timeAt(_position);
+    int channels = _planar ? 1 : _oparams.channels;
+    for (auto& ptr : _inputs) {
+        auto& input = *ptr;
+        if (input.head < 0)
+            continue;
+
+        // Discard samples which precede the frame
+        if (input.head < now) {
+            int skip = std::min(samplesFor(now - input.head), input.fifo.available());
+            while (skip > 0) {
+                int n = std::min(skip, _frameSize);
+                input.fifo.read(planes, n);
+                skip -= n;
+            }
+            input.head = now;
+        }
+
+        int available = input.fifo.available();
+        int offset = samplesFor(input.head - now);
+        if (available == 0) {
+            input.head = -1;
+            continue;
+        }
+        if (offset >= _frameSize)
+            continue;
+
+        int count = std::min(_frameSize - offset, available);
+        input.fifo.read(planes, count);
+        for (int i = 0; i < _planes; i++) {
+            float* acc = _acc[i].data() + offset * channels;
+            size_t n = static_cast<size_t>(count) * channels;
+            if (_format == AV_SAMPLE_FMT_S16 || _format == AV_SAMPLE_FMT_S16P)
+                mixSamples(acc, reinterpret_cast<const int16_t*>(planes[i]), n, input.gain);
+            else
+                mixSamples(acc, reinterpret_cast<const float*>(planes[i]), n, input.gain);
+        }
+
+        input.head = available > count ? timeAt(_position + offset + count) : -1;
+    }
+}
+
+
+void AudioMixer::queueFrame()
+{
+    uint8_t* planes[4] = { nullptr }; // planar output has at most 4 planes
+    for (int i = 0; i < _planes; i++) {
+        if (_format == AV_SAMPLE_FMT_S16 || _format == AV_SAMPLE_FMT_S16P)
+            storeSamples(reinterpret_cast<int16_t*>(_out[i].data()), _acc[i].data(), _planeSize);
+        else
+            storeSamples(reinterpret_cast<float*>(_out[i].data()), _acc[i].data(), _planeSize);
+        planes[i] = _out[i].data();
+    }
+
+    // Queue a copy, since the output buffers are reused by the next frame
+    int64_t time = timeAt(_position);
+    if (_planar) {
+        PlanarAudioPacket packet(planes, _oparams.channels, _frameSize,
+                                 _oparams.sampleFmt, time);
+        _ready.emplace_back(static_cast<AudioPacket*>(packet.clone()));
+    } else {
+        AudioPacket packet(planes[0], _out[0].size(), _frameSize, time);
+        _ready.emplace_back(static_cast<AudioPacket*>(packet.clone()));
+    }
+}
+
+
+void AudioMixer::emitFrames()
+{
+    // Only one thread emits at a time so frames stay in order. Frames
+    // queued by other threads meanwhile are emitted by this one.
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_emitting)
+            return;
+        _emitting = true;
+    }
+
+    try {
+        while (true) {
+            std::unique_ptr<AudioPacket> frame;
+            {
+                std::lock_guard<std::mutex> guard(_mutex);
+                if (_ready.empty()) {
+                    _emitting = false;
+                    return;
+                }
+                frame = std::move(_ready.front());
+                _ready.pop_front();
+            }
+            emit(*frame);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _emitting = false;
+        throw;
+    }
+}
+
+
+int64_t AudioMixer::bufferedUntil(const Input& input) const
+{
+    if (input.head < 0)
+        return -1;
+    return input.head + duration(input.fifo.available());
+}
+
+
+int64_t AudioMixer::timeAt(int64_t position) const
+{
+    return std::max<int64_t>(_start, 0) + duration(position);
+}
+
+
+int64_t AudioMixer::duration(int64_t numSamples) const
+{
+    return numSamples * 1000000 / _oparams.sampleRate;
+}
+
+
+int AudioMixer::samplesFor(int64_t duration) const
+{
+    return static_cast<int>((duration * _oparams.sampleRate + 500000) / 1000000);
+}
+
+
+} // namespace av
+} // namespace scy
+
+
+#endif
+
+
+/// @\}
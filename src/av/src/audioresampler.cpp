@@ -13,6 +13,7 @@
 
 #ifdef HAVE_FFMPEG
 
+#include "scy/av/audioframepool.h"
 #include "scy/logger.h"
 #include "scy/util.h"
 
@@ -29,6 +30,7 @@ AudioResampler::AudioResampler(const AudioCodec& iparams,
     : ctx(nullptr)
     , iparams(iparams)
     , oparams(oparams)
+    , outFrame(nullptr)
     , outSamples(nullptr)
     , outNumSamples(0)
     , outBufferSize(0)
@@ -125,9 +127,9 @@ void AudioResampler::close()
         ctx = nullptr;
     }
 
-    if (outSamples) {
-        av_freep(&(outSamples)[0]);
-        //av_free(outSamples);
+    if (outFrame) {
+        AudioFramePool::instance().release(outFrame);
+        outFrame = nullptr;
         outSamples = nullptr;
     }
 
@@ -155,17 +157,21 @@ int AudioResampler::resample(uint8_t** inSamples, int inNumSamples)
             (int64_t)inNumSamples, (int64_t)oparams.sampleRate,
             (int64_t)iparams.sampleRate, AV_ROUND_UP);
 
-    // Resize the output buffer if required
+    // Resize the output buffer if required. The capacity is rounded up
+    // so that small variations in the resampler delay reuse the same
+    // pooled frame size.
     if (requiredNumSamples > maxNumSamples) {
-        ret = av_samples_alloc_array_and_samples(
-            &outSamples, nullptr, oparams.channels, requiredNumSamples,
-            outSampleFmt, 0);
-        if (ret < 0) {
-            throw std::runtime_error("Cannot allocate buffer for converted output samples: " + averror(ret));
-        }
+        auto& pool = AudioFramePool::instance();
+        pool.release(outFrame);
+        outFrame = nullptr;
+        outSamples = nullptr;
+        maxNumSamples = 0;
 
-        LTrace("Resizing resampler buffer: ", outBufferSize)
-        maxNumSamples = requiredNumSamples;
+        int capacity = (requiredNumSamples + 255) & ~255;
+        outFrame = pool.acquire(outSampleFmt, oparams.channels, capacity);
+        outSamples = outFrame->extended_data;
+        maxNumSamples = capacity;
+        LTrace("Resizing resampler buffer: ", maxNumSamples)
     }
 
     assert(requiredNumSamples);
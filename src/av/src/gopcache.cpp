@@ -0,0 +1,305 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup av
+/// @{
+
+
+#include "scy/av/gopcache.h"
+#include "scy/logger.h"
+
+
+namespace scy {
+namespace av {
+
+
+// The subscription being called on this thread, so a subscriber can
+// unsubscribe itself without waiting for its own call to return.
+static thread_local const void* sending = nullptr;
+
+
+GOPCache::GOPCache(size_t maxBytes, size_t maxPackets)
+    : PacketProcessor(this->emitter)
+    , _generation(0)
+    , _nextID(0)
+    , _headerBytes(0)
+    , _gopBytes(0)
+    , _maxBytes(maxBytes)
+    , _maxPackets(maxPackets)
+    , _inHeader(false)
+    , _caching(false)
+{
+}
+
+
+GOPCache::~GOPCache()
+{
+}
+
+
+int GOPCache::subscribe(const Subscriber& subscriber)
+{
+    auto sub = std::make_shared<Subscription>();
+    sub->subscriber = subscriber;
+
+    // Snapshot the cache and attach in the same generation, so live
+    // packets from later generations follow the replay exactly
+    PacketList replay;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        replay.reserve(_header.size() + _gop.size());
+        replay.insert(replay.end(), _header.begin(), _header.end());
+        replay.insert(replay.end(), _gop.begin(), _gop.end());
+        sub->id = _nextID++;
+        sub->generation = _generation;
+        sub->keyframe = !_gop.empty();
+        _subscriptions.push_back(sub);
+        _stats.replayed += replay.size();
+    }
+
+    for (auto& packet : replay)
+        subscriber(*packet);
+
+    // Send live packets which arrived during the replay, then go live.
+    // The last of them are sent under the subscription lock, so a
+    // subscriber which is slower than the producer can't be held in
+    // the replay indefinitely.
+    std::vector<std::unique_ptr<IPacket>> pending;
+    {
+        std::lock_guard<std::mutex> guard(sub->mutex);
+        pending.swap(sub->pending);
+    }
+    for (auto& packet : pending)
+        subscriber(*packet);
+
+    std::lock_guard<std::mutex> guard(sub->mutex);
+    for (auto& packet : sub->pending)
+        subscriber(*packet);
+    sub->pending.clear();
+    sub->live = true;
+    return sub->id;
+}
+
+
+void GOPCache::unsubscribe(int id)
+{
+    std::shared_ptr<Subscription> sub;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (auto it = _subscriptions.begin(); it != _subscriptions.end(); ++it) {
+            if ((*it)->id == id) {
+                sub = *it;
+                _subscriptions.erase(it);
+                break;
+            }
+        }
+    }
+    if (sub) {
+        std::unique_lock<std::mutex> lock(sub->mutex);
+        sub->removed = true;
+        sub->pending.clear();
+        int self = sending == sub.get() ? 1 : 0;
+        sub->idle.wait(lock, [&]() { return sub->busy <= self; });
+    }
+}
+
+
+void GOPCache::setLimits(size_t maxBytes, size_t maxPackets)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _maxBytes = maxBytes;
+    _maxPackets = maxPackets;
+    if (_headerBytes + _gopBytes > _maxBytes ||
+        _header.size() + _gop.size() > _maxPackets)
+        dropGOP();
+}
+
+
+void GOPCache::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _header.clear();
+    _headerBytes = 0;
+    _inHeader = false;
+    dropGOP();
+}
+
+
+size_t GOPCache::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _header.size() + _gop.size();
+}
+
+
+size_t GOPCache::bytes() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _headerBytes + _gopBytes;
+}
+
+
+bool GOPCache::hasKeyframe() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return !_gop.empty();
+}
+
+
+GOPCacheStats GOPCache::stats() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _stats;
+}
+
+
+bool GOPCache::isKeyframe(const IPacket& packet)
+{
+    if (packet.flags.has(KeyframePacket))
+        return true;
+    auto video = dynamic_cast<const VideoPacket*>(&packet);
+    return video && video->iframe;
+}
+
+
+void GOPCache::process(IPacket& packet)
+{
+    uint64_t generation;
+    std::vector<std::shared_ptr<Subscription>> subscriptions;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        cache(packet);
+        generation = ++_generation;
+        subscriptions = _subscriptions;
+    }
+
+    for (auto& sub : subscriptions)
+        sub->send(packet, generation);
+    emit(packet);
+}
+
+
+void GOPCache::Subscription::send(IPacket& packet, uint64_t generation)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        // Packets up to our generation were replayed, or were emitted
+        // before we subscribed
+        if (removed || generation <= this->generation)
+            return;
+
+        // Without a cached GOP the subscriber can't decode anything
+        // until the next keyframe, so only headers are sent until then
+        if (!keyframe) {
+            if (isKeyframe(packet))
+                keyframe = true;
+            else if (!packet.flags.has(HeaderPacket))
+                return;
+        }
+        if (!live) {
+            pending.emplace_back(copy(packet));
+            return;
+        }
+        busy++;
+    }
+
+    // Ends the call even if the subscriber throws
+    struct Call
+    {
+        Subscription* sub;
+        const void* previous;
+
+        Call(Subscription* sub)
+            : sub(sub)
+            , previous(sending)
+        {
+            sending = sub;
+        }
+
+        ~Call()
+        {
+            sending = previous;
+            sub->done();
+        }
+    } call(this);
+
+    subscriber(packet);
+}
+
+
+void GOPCache::Subscription::done()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (--busy == 0)
+        idle.notify_all();
+}
+
+
+void GOPCache::cache(IPacket& packet)
+{
+    if (packet.flags.has(HeaderPacket)) {
+
+        // A header after other data means the encoder was restarted,
+        // so the old header and GOP no longer apply
+        if (!_inHeader) {
+            _header.clear();
+            _headerBytes = 0;
+            dropGOP();
+            _inHeader = true;
+        }
+        _headerBytes += packet.size();
+        _header.emplace_back(copy(packet));
+        return;
+    }
+    _inHeader = false;
+
+    if (isKeyframe(packet)) {
+        dropGOP();
+        _caching = true;
+        _stats.keyframes++;
+    }
+    if (!_caching)
+        return;
+
+    if (_headerBytes + _gopBytes + packet.size() > _maxBytes ||
+        _header.size() + _gop.size() + 1 > _maxPackets) {
+        LWarn("GOP exceeds the cache limits, waiting for the next keyframe: ",
+              _gop.size() + 1, " packets, ", _gopBytes + packet.size(), " bytes")
+        dropGOP();
+        _stats.overflows++;
+        return;
+    }
+
+    _gopBytes += packet.size();
+    _gop.emplace_back(copy(packet));
+}
+
+
+IPacket* GOPCache::copy(IPacket& packet)
+{
+    // The source refers to the producer's state, such as an
+    // AVPacket, which won't outlive the process() call
+    IPacket* copy = packet.clone();
+    copy->source = nullptr;
+    return copy;
+}
+
+
+void GOPCache::dropGOP()
+{
+    _gop.clear();
+    _gopBytes = 0;
+    _caching = false;
+}
+
+
+} // namespace av
+} // namespace scy
+
+
+/// @\}
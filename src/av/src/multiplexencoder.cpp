@@ -16,6 +16,7 @@
 #include "assert.h"
 
 extern "C" {
+#include "libavutil/avstring.h"
 #include "libavutil/time.h" // av_gettime (deprecated)
 }
 
@@ -38,6 +39,11 @@ MultiplexEncoder::MultiplexEncoder(const EncoderOptions& options)
     , _audio(nullptr)
     , _ioCtx(nullptr)
     , _ioBuffer(nullptr)
+    , _outputFlags(0)
+    , _fragmented(false)
+    , _chunkStart(AV_NOPTS_VALUE)
+    , _chunkFlags(0)
+    , _chunkOpen(false)
     , _pts(0)
 {
     LTrace("Create")
@@ -53,7 +59,7 @@ MultiplexEncoder::~MultiplexEncoder()
 }
 
 
-static int dispatchOutputPacket(void* opaque, uint8_t* buffer, int bufferSize)
+int MultiplexEncoder::dispatchOutputPacket(void* opaque, uint8_t* buffer, int bufferSize)
 {
     // Callback example at:
     // http://lists.mplayerhq.hu/pipermail/libav-client/2009-May/003034.html
@@ -64,7 +70,19 @@ static int dispatchOutputPacket(void* opaque, uint8_t* buffer, int bufferSize)
             LWarn("Dropping packet: " ,  bufferSize,  ": ", klass->state())
             return bufferSize;
         }
+
+        // Fragments may span several writes, so buffer them
+        // until the whole chunk has been muxed
+        if (klass->_fragmented) {
+            klass->_chunk.insert(klass->_chunk.end(), buffer, buffer + bufferSize);
+            return bufferSize;
+        }
+
         MediaPacket packet(buffer, bufferSize);
+        packet.flags.add(klass->_outputFlags);
+
+        // Only the first write of a keyframe starts with it
+        klass->_outputFlags &= ~KeyframePacket;
         klass->emitter.emit(packet);
         LTrace("Dispatching packet: OK: ", bufferSize)
     }
@@ -126,6 +144,10 @@ void MultiplexEncoder::init()
                 throw std::runtime_error("Out of memory: Cannot allocate avio buffer.");
             _ioCtx->seekable = 0;
             _formatCtx->pb = _ioCtx;
+
+            // MP4 can't be streamed unless it's fragmented
+            _fragmented = _options.chunkDuration > 0 &&
+                av_match_name(_formatCtx->oformat->name, "mp4,mov,ismv");
         } else {
 
             // Operating in file mode.
@@ -140,7 +162,14 @@ void MultiplexEncoder::init()
 
         // Write the stream header (if any)
         // TODO: After Ready state
-        avformat_write_header(_formatCtx, nullptr);
+        AVDictionary* opts = nullptr;
+        if (_fragmented) {
+            // Write an empty moov as the init segment, and only cut
+            // fragments when we flush them, so each one is a chunk
+            av_dict_set(&opts, "movflags", "frag_custom+empty_moov+default_base_moof", 0);
+        }
+        avformat_write_header(_formatCtx, &opts);
+        av_dict_free(&opts);
 
         // Send the format information to sdout
         av_dump_format(_formatCtx, 0, _options.ofile.c_str(), 1);
@@ -149,6 +178,16 @@ void MultiplexEncoder::init()
         _formatCtx->start_time_realtime = av_gettime();
 
         setState(this, EncoderState::Ready);
+
+        // Emit the stream header on its own so it can be cached
+        // and replayed to clients which join mid-stream
+        if (_ioCtx) {
+            _outputFlags = HeaderPacket;
+            avio_flush(_ioCtx);
+            _outputFlags = 0;
+            if (_fragmented)
+                emitChunk(HeaderPacket);
+        }
     } catch (std::exception& exc) {
         LError("Error: ", exc.what())
         setState(this, EncoderState::Error); //, exc.what()
@@ -165,9 +204,16 @@ void MultiplexEncoder::uninit()
     LTrace("Uninitialize")
 
     // Write the trailer and dispatch the tail packet if any
-    if (_formatCtx && _formatCtx->pb)
+    if (_formatCtx && _formatCtx->pb) {
         av_write_trailer(_formatCtx);
 
+        // The trailer flushes the last fragment
+        if (_fragmented) {
+            avio_flush(_ioCtx);
+            emitChunk(_chunkFlags);
+        }
+    }
+
     LTrace("Uninitializing: Wrote trailer")
 
     // Free memory
@@ -206,10 +252,21 @@ void MultiplexEncoder::cleanup()
         _formatCtx = nullptr;
     }
 
+    if (_ioCtx) {
+        av_free(_ioCtx);
+        _ioCtx = nullptr;
+    }
+
     if (_ioBuffer) {
         delete _ioBuffer;
         _ioBuffer = nullptr;
     }
+    _outputFlags = 0;
+    _fragmented = false;
+    _chunk.clear();
+    _chunkStart = AV_NOPTS_VALUE;
+    _chunkFlags = 0;
+    _chunkOpen = false;
 
     LTrace("Cleanup: OK")
 }
@@ -246,6 +303,12 @@ AudioEncoder* MultiplexEncoder::audio()
 }
 
 
+bool MultiplexEncoder::fragmented() const
+{
+    return _fragmented;
+}
+
+
 //
 // Helpers
 //
@@ -266,6 +329,41 @@ bool MultiplexEncoder::writeOutputPacket(AVPacket& packet)
            << "\n\tDuration: " << packet.duration
            << endl;
 
+    bool keyframe = (packet.flags & AV_PKT_FLAG_KEY) && _video &&
+        _video->stream && packet.stream_index == _video->stream->index;
+
+    if (_fragmented) {
+        // Time the packet by its pts, or its dts if the pts is unset.
+        // Packets with neither can only cut a chunk on a keyframe.
+        int64_t ts = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+        int64_t time = AV_NOPTS_VALUE;
+        if (ts != AV_NOPTS_VALUE)
+            time = av_rescale_q(ts, _formatCtx->streams[packet.stream_index]->time_base,
+                                AV_TIME_BASE_Q);
+
+        // Cut a chunk when it's long enough, or before a video keyframe
+        // so new clients can start decoding from a chunk boundary
+        if (_chunkOpen &&
+            (keyframe || (time != AV_NOPTS_VALUE && _chunkStart != AV_NOPTS_VALUE &&
+                          time - _chunkStart >= _options.chunkDuration)))
+            flushChunk();
+        if (!_chunkOpen) {
+            _chunkOpen = true;
+            _chunkFlags = keyframe ? KeyframePacket : 0;
+        }
+        if (_chunkStart == AV_NOPTS_VALUE)
+            _chunkStart = time;
+    }
+
+    // In streaming mode flush buffered output before a video keyframe,
+    // so the next output packet starts with it and can be flagged.
+    // This is exact as long as the muxer does not delay the keyframe
+    // to interleave it with other streams.
+    else if (_ioCtx && keyframe) {
+        avio_flush(_ioCtx);
+        _outputFlags |= KeyframePacket;
+    }
+
     // Write the encoded frame to the output file
     if (av_interleaved_write_frame(_formatCtx, &packet) != 0) {
         LWarn("Cannot write packet")
@@ -275,6 +373,36 @@ bool MultiplexEncoder::writeOutputPacket(AVPacket& packet)
 }
 
 
+void MultiplexEncoder::flushChunk()
+{
+    LTrace("Flushing chunk: ", _chunkStart)
+
+    // Drain the interleaving queue, then have the muxer write
+    // everything it holds as a single moof+mdat fragment
+    av_interleaved_write_frame(_formatCtx, nullptr);
+    av_write_frame(_formatCtx, nullptr);
+    avio_flush(_ioCtx);
+    emitChunk(_chunkFlags);
+    _chunkStart = AV_NOPTS_VALUE;
+    _chunkFlags = 0;
+    _chunkOpen = false;
+}
+
+
+void MultiplexEncoder::emitChunk(unsigned flags)
+{
+    if (_chunk.empty())
+        return;
+
+    MediaPacket packet(reinterpret_cast<uint8_t*>(_chunk.data()), _chunk.size());
+    packet.flags.add(flags);
+    emitter.emit(packet);
+
+    // Keep the capacity for the next chunk
+    _chunk.clear();
+}
+
+
 bool MultiplexEncoder::updateStreamPts(AVStream* stream, int64_t* pts)
 {
     LTrace("Update PTS: last=",  _pts,  ", input=", *pts)
@@ -13,6 +13,8 @@
 
 #ifdef HAVE_FFMPEG
 
+#include "scy/av/audioframepool.h"
+
 extern "C" {
 #include <libavutil/imgutils.h>
 #include <libavformat/avformat.h>
@@ -102,33 +104,35 @@ PlanarAudioPacket::PlanarAudioPacket(uint8_t* data[4], int channels, size_t numS
 
 
 PlanarAudioPacket::PlanarAudioPacket(const PlanarAudioPacket& r)
-    : AudioPacket(r)
+    : AudioPacket(nullptr, 0, r.numSamples, r.time)
+    , linesize(r.linesize)
     , channels(r.channels)
     , sampleFmt(r.sampleFmt)
 {
     assert(!sampleFmt.empty() && "sample format required to copy");
     auto fmt = av_get_sample_fmt(sampleFmt.c_str());
 
-    // Allocate image where the data image will copied
-    int ret = av_samples_alloc_array_and_samples((uint8_t***)&buffer,
-        nullptr, channels, (int)numSamples, fmt, 0);
-    if (ret < 0) {
-        LError("Could not allocate raw audio buffer");
-        assert(0);
-    }
+    source = r.source;
+    opaque = r.opaque;
+    info = r.info ? r.info->clone() : nullptr;
+    flags = r.flags;
 
-    // Copy image data from other frame
-    av_samples_copy(buffer, (uint8_t* const*)r.buffer, 0, 0,
-        channels, (int)numSamples, fmt);
+    // Copy the samples into a pooled frame
+    frame = AudioFramePool::instance().acquire(fmt, channels, (int)numSamples);
+    av_samples_copy(frame->extended_data, (uint8_t* const*)r.buffer, 0, 0,
+        (int)numSamples, channels, fmt);
+    for (int i = 0; i < 4; ++i) {
+        buffer[i] = frame->data[i];
+    }
+    linesize = frame->linesize[0];
+    _data = reinterpret_cast<char*>(buffer[0]);
+    _size = r._size;
 }
 
 
 PlanarAudioPacket::~PlanarAudioPacket()
 {
-    if (_free) {
-        av_freep(&buffer[0]);
-        av_freep(buffer);
-    }
+    AudioFramePool::instance().release(frame);
 }
 
 
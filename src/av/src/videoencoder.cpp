@@ -237,6 +237,7 @@ void emitPacket(VideoEncoder* enc, AVPacket& opacket)
 
     VideoPacket video(opacket.data, opacket.size, enc->ctx->coded_frame->width,
                       enc->ctx->coded_frame->height, enc->time);
+    video.iframe = (opacket.flags & AV_PKT_FLAG_KEY) != 0;
     video.source = &opacket;
     video.opaque = enc;
     enc->emitter.emit(video);
@@ -18,8 +18,13 @@ int main(int argc, char** argv)
     describe("audio encoder", new AudioEncoderTest);
     describe("audio resampler", new AudioResamplerTest);
     describe("audio fifo buffer", new AudioBufferTest);
+    describe("audio frame pool", new AudioFramePoolTest);
+    describe("audio mixer", new AudioMixerTest);
+    describe("audio mixer idle input", new AudioMixerIdleInputTest);
+    describe("audio mixer planar", new AudioMixerPlanarTest);
     describe("h264 video file transcoder", new VideoFileTranscoderTest);
     describe("h264 multiplex capture encoder", new MultiplexCaptureEncoderTest);
+    describe("fragmented mp4 encoder", new FragmentedMP4EncoderTest);
     // describe("realtime encoder media queue", new RealtimeMediaQueueEncoderTest);
     // describe("audio capture", new AudioCaptureTest);
     // describe("audio capture encoder", new AudioCaptureEncoderTest);
@@ -27,7 +32,9 @@ int main(int argc, char** argv)
     // describe("device capture multiplex encoder", new DeviceCaptureMultiplexEncoderTest);
 #endif
 
+    describe("audio mix kernels", new AudioMixKernelTest);
     describe("realtime media queue", new RealtimeMediaQueueTest);
+    describe("gop cache", new GOPCacheTest);
 
     test::runAll();
 
@@ -13,10 +13,13 @@
 
 #include "scy/av/audiobuffer.h"
 #include "scy/av/audiocapture.h"
+#include "scy/av/audiomixer.h"
 #include "scy/av/audiodecoder.h"
+#include "scy/av/audioframepool.h"
 #include "scy/av/audioencoder.h"
 #include "scy/av/audioresampler.h"
 #include "scy/av/devicemanager.h"
+#include "scy/av/gopcache.h"
 #include "scy/av/mediacapture.h"
 #include "scy/av/multiplexpacketencoder.h"
 #include "scy/av/realtimepacketqueue.h"
@@ -26,7 +29,10 @@
 #include "scy/logger.h"
 #include "scy/test.h"
 #include "scy/util.h"
+#include <algorithm>
+#include <cmath>
 #include <random>
+#include <vector>
 
 
 using std::cout;
@@ -309,6 +315,65 @@ class MultiplexCaptureEncoderTest : public Test
     }
 };
 
+// =============================================================================
+// Fragmented MP4 Encoder
+//
+
+class FragmentedMP4EncoderTest : public Test
+{
+    // Returns the type of the first box in the given output
+    static std::string boxType(const std::string& data)
+    {
+        return data.size() >= 8 ? data.substr(4, 4) : "";
+    }
+
+    void run()
+    {
+        av::EncoderOptions options;
+        options.oformat = MP4_H264_AAC_REALTIME_FORMAT;
+        options.iformat.video = av::VideoCodec(400, 300, 25, "yuv420p");
+        options.iformat.audio.enabled = false;
+        options.chunkDuration = 200000; // 200ms
+
+        std::vector<std::string> chunks;
+        std::vector<bool> headers;
+        std::vector<bool> keyframes;
+        av::MultiplexEncoder encoder(options);
+        encoder.emitter += [&](IPacket& packet) {
+            chunks.emplace_back(packet.data(), packet.size());
+            headers.push_back(packet.flags.has(av::HeaderPacket));
+            keyframes.push_back(packet.flags.has(av::KeyframePacket));
+        };
+        encoder.init();
+        expect(encoder.fragmented());
+
+        // Encode two seconds of video
+        AVFrame* frame = av::createVideoFrame(AV_PIX_FMT_YUV420P, 400, 300);
+        for (int i = 0; i < 50; i++) {
+            for (int y = 0; y < frame->height; y++)
+                std::fill_n(frame->data[0] + y * frame->linesize[0], frame->width, uint8_t(y + i * 4));
+            encoder.encodeVideo(frame->data, frame->linesize, 400, 300, (i + 1) * 40000);
+        }
+        encoder.flush();
+        encoder.uninit();
+        av_frame_free(&frame);
+
+        // The init segment comes first, then a moof+mdat per chunk
+        expect(chunks.size() > 5);
+        expect(headers[0]);
+        expect(boxType(chunks[0]) == "ftyp");
+        expect(chunks[0].find("moov") != std::string::npos);
+        for (size_t i = 1; i < chunks.size() - 1; i++) {
+            expect(!headers[i]);
+            expect(boxType(chunks[i]) == "moof");
+            expect(chunks[i].find("mdat") != std::string::npos);
+        }
+
+        // The first chunk starts with a keyframe
+        expect(keyframes[1]);
+    }
+};
+
 // =============================================================================
 // Audio Encoder
 //
@@ -676,9 +741,258 @@ class AudioCaptureResamplerTest : public Test
 // };
 
 
+// =============================================================================
+// Audio Frame Pool
+//
+class AudioFramePoolTest : public Test
+{
+    void run()
+    {
+        av::AudioFramePool pool(4);
+
+        // Released frames are recycled for the same format and size
+        AVFrame* frame = pool.acquire(AV_SAMPLE_FMT_FLTP, 2, 1024);
+        expect(frame->nb_samples == 1024);
+        pool.release(frame);
+        expect(pool.size() == 1);
+        expect(pool.acquire(AV_SAMPLE_FMT_FLTP, 2, 1024) == frame);
+        expect(pool.stats().allocated == 1);
+        pool.release(frame);
+
+        // Other sizes get their own frames
+        AVFrame* other = pool.acquire(AV_SAMPLE_FMT_FLTP, 2, 512);
+        expect(other != frame);
+        pool.release(other);
+        expect(pool.size() == 2);
+
+        // Copies of planar packets draw from the shared pool
+        float left[64] = { 0 }, right[64] = { 0 };
+        right[10] = 0.5f;
+        uint8_t* planes[4] = { (uint8_t*)left, (uint8_t*)right, nullptr, nullptr };
+        av::PlanarAudioPacket packet(planes, 2, 64, "fltp", 0);
+        auto allocated = av::AudioFramePool::instance().stats().allocated;
+        for (int i = 0; i < 10; i++) {
+            std::unique_ptr<IPacket> copy(packet.clone());
+            auto planar = static_cast<av::PlanarAudioPacket*>(copy.get());
+            expect(reinterpret_cast<float*>(planar->buffer[1])[10] == 0.5f);
+        }
+        expect(av::AudioFramePool::instance().stats().allocated <= allocated + 1);
+    }
+};
+
+
+// =============================================================================
+// Audio Mixer
+//
+class AudioMixerTest : public Test
+{
+    std::vector<int64_t> times;
+    std::vector<int16_t> mixed;
+
+    void run()
+    {
+        av::AudioCodec oparams(2, 48000, "s16");
+        av::AudioMixer mixer(oparams, 480);
+        mixer.emitter += packetSlot(this, &AudioMixerTest::onMixedPacket);
+
+        int a = mixer.addInput(oparams, 1.0f);
+        int b = mixer.addInput(oparams, 0.5f);
+
+        // Input b starts 10ms after input a
+        std::vector<int16_t> quiet(960 * 2, 1000), loud(960 * 2, 30000);
+        for (int i = 0; i < 5; i++) {
+            av::AudioPacket pa((uint8_t*)quiet.data(), quiet.size() * 2, 960, 1000000 + i * 20000);
+            mixer.write(a, pa);
+            av::AudioPacket pb((uint8_t*)loud.data(), loud.size() * 2, 960, 1010000 + i * 20000);
+            mixer.write(b, pb);
+        }
+
+        expect(times.size() == 10);
+        expect(times[0] == 1000000);
+        expect(times[1] == 1010000);
+        expect(mixed[0] == 1000);
+        expect(mixed[959] == 1000);
+        expect(mixed[960] == 16000);
+
+        // Subscribers are called without the lock held, so they
+        // may call back into the mixer
+        int64_t next = 0;
+        mixer.emitter += [&](IPacket&) { next = mixer.time(); };
+        mixer.flush();
+        expect(next == times.back() + 10000);
+        expect(times.size() == 11);
+        expect(mixed.back() == 15000);
+    }
+
+    void onMixedPacket(av::AudioPacket& packet)
+    {
+        auto samples = reinterpret_cast<int16_t*>(packet.samples());
+        times.push_back(packet.time);
+        mixed.insert(mixed.end(), samples, samples + packet.numSamples * 2);
+    }
+};
+
+
+class AudioMixerIdleInputTest : public Test
+{
+    std::vector<int64_t> times;
+    std::vector<int16_t> mixed;
+
+    void run()
+    {
+        av::AudioCodec oparams(1, 48000, "s16");
+        av::AudioMixer mixer(oparams, 480, 50000);
+        mixer.emitter += packetSlot(this, &AudioMixerIdleInputTest::onMixedPacket);
+
+        int a = mixer.addInput(oparams);
+        int b = mixer.addInput(oparams);
+
+        std::vector<int16_t> sa(960, 1000), sb(960, 2000);
+        auto writeA = [&](int64_t time) {
+            av::AudioPacket packet((uint8_t*)sa.data(), sa.size() * 2, 960, time);
+            mixer.write(a, packet);
+        };
+        auto writeB = [&](int64_t time) {
+            av::AudioPacket packet((uint8_t*)sb.data(), sb.size() * 2, 960, time);
+            mixer.write(b, packet);
+        };
+
+        // Input b is waited on before it writes
+        writeA(1000000);
+        expect(times.empty());
+        writeB(1000000);
+        expect(times.size() == 2);
+        expect(mixed[0] == 3000);
+
+        // Input b goes silent and is waited on for up to maxDelay
+        writeA(1020000);
+        writeA(1040000);
+        expect(times.size() == 2);
+
+        // Once input a leads by maxDelay input b is idle and all
+        // buffered frames are mixed without it
+        writeA(1060000);
+        expect(times.size() == 8);
+        expect(times.back() == 1070000);
+        expect(mixed[480 * 2] == 1000);
+        expect(mixed.back() == 1000);
+
+        // Frames are no longer held back by the idle input
+        writeA(1080000);
+        expect(times.size() == 10);
+
+        // Input b is waited on again once it resumes
+        writeB(1100000);
+        expect(times.size() == 10);
+        writeA(1100000);
+        expect(times.size() == 12);
+        expect(mixed[480 * 10] == 3000);
+        expect(mixed.back() == 3000);
+    }
+
+    void onMixedPacket(av::AudioPacket& packet)
+    {
+        auto samples = reinterpret_cast<int16_t*>(packet.samples());
+        times.push_back(packet.time);
+        mixed.insert(mixed.end(), samples, samples + packet.numSamples);
+    }
+};
+
+
+class AudioMixerPlanarTest : public Test
+{
+    std::vector<float> left, right;
+
+    void run()
+    {
+        av::AudioCodec oparams(2, 48000, "fltp");
+        av::AudioMixer mixer(oparams, 480);
+        mixer.emitter += packetSlot(this, &AudioMixerPlanarTest::onMixedPacket);
+
+        int a = mixer.addInput(oparams, 1.0f);
+        int b = mixer.addInput(oparams, 2.0f);
+
+        std::vector<float> l(480, 0.25f), r(480, -0.25f);
+        uint8_t* planes[4] = { (uint8_t*)l.data(), (uint8_t*)r.data(), nullptr, nullptr };
+        av::PlanarAudioPacket pa(planes, 2, 480, "fltp", 1000000);
+        mixer.write(a, pa);
+        av::PlanarAudioPacket pb(planes, 2, 480, "fltp", 1000000);
+        mixer.write(b, pb);
+
+        expect(left.size() == 480);
+        expect(right.size() == 480);
+        expect(left[0] == 0.75f);
+        expect(right[479] == -0.75f);
+
+        // Planar packets carry at most 4 planes
+        bool threw = false;
+        try {
+            av::AudioMixer wide(av::AudioCodec(5, 48000, "fltp"));
+        } catch (std::exception&) {
+            threw = true;
+        }
+        expect(threw);
+    }
+
+    void onMixedPacket(av::AudioPacket& packet)
+    {
+        auto planar = dynamic_cast<av::PlanarAudioPacket*>(&packet);
+        expect(planar != nullptr);
+        if (!planar)
+            return;
+        auto l = reinterpret_cast<float*>(planar->buffer[0]);
+        auto r = reinterpret_cast<float*>(planar->buffer[1]);
+        left.insert(left.end(), l, l + packet.numSamples);
+        right.insert(right.end(), r, r + packet.numSamples);
+    }
+};
+
+
 #endif // HAVE_FFMPEG
 
 
+// =============================================================================
+// Audio Mix Kernels
+//
+class AudioMixKernelTest : public Test
+{
+    void run()
+    {
+        // Odd lengths exercise both the vector and scalar paths
+        const size_t n = 19;
+        int16_t s16[n], s16out[n];
+        float flt[n], fltout[n];
+        for (size_t i = 0; i < n; i++) {
+            s16[i] = static_cast<int16_t>(i * 3000 - 20000);
+            flt[i] = i * 0.1f - 0.9f;
+        }
+
+        // Sums saturate to the s16 range
+        std::vector<float> acc(n, 0.0f);
+        for (int i = 0; i < 3; i++)
+            av::mixSamples(acc.data(), s16, n, 1.0f);
+        av::storeSamples(s16out, acc.data(), n);
+        for (size_t i = 0; i < n; i++)
+            expect(s16out[i] == std::max(-32768, std::min(32767, 3 * s16[i])));
+
+        // Gain is applied per input
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        av::mixSamples(acc.data(), s16, n, 0.5f);
+        av::storeSamples(s16out, acc.data(), n);
+        for (size_t i = 0; i < n; i++)
+            expect(s16out[i] == s16[i] / 2);
+
+        // Float output is clamped to [-1, 1]
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        av::mixSamples(acc.data(), flt, n, 0.5f);
+        av::mixSamples(acc.data(), flt, n, 2.0f);
+        av::storeSamples(fltout, acc.data(), n);
+        for (size_t i = 0; i < n; i++)
+            expect(std::abs(fltout[i] - std::max(-1.0f, std::min(1.0f, flt[i] * 2.5f))) < 1e-6f);
+    }
+};
+
+
 // =============================================================================
 // Realtime Media Queue Test
 //
@@ -734,6 +1048,209 @@ struct MockMediaPacketSource : public PacketSource, public basic::Startable
 };
 
 
+//
+// GOP Cache
+//
+class GOPCacheTest : public Test
+{
+    std::vector<std::unique_ptr<av::MediaPacket>> packets;
+    std::vector<std::unique_ptr<char[]>> buffers;
+
+    av::MediaPacket& header(char tag)
+    {
+        buffers.emplace_back(new char[1]{tag});
+        auto packet = new av::MediaPacket(reinterpret_cast<uint8_t*>(buffers.back().get()), 1);
+        packet->flags.add(av::HeaderPacket);
+        packets.emplace_back(packet);
+        return *packet;
+    }
+
+    av::MediaPacket& video(char tag, bool iframe, size_t size = 1)
+    {
+        auto data = new char[size];
+        std::fill(data, data + size, tag);
+        buffers.emplace_back(data);
+        auto packet = new av::VideoPacket(reinterpret_cast<uint8_t*>(data), size, 640, 480);
+        packet->iframe = iframe;
+        packets.emplace_back(packet);
+        return *packet;
+    }
+
+    static std::string received(const std::vector<char>& tags)
+    {
+        return std::string(tags.begin(), tags.end());
+    }
+
+    void run()
+    {
+        av::GOPCache cache;
+        std::vector<char> live;
+        cache.emitter += [&](IPacket& packet) { live.push_back(packet.data()[0]); };
+
+        // Deltas before the first keyframe can't be decoded
+        cache.process(header('h'));
+        cache.process(header('i'));
+        cache.process(video('x', false));
+        expect(!cache.hasKeyframe());
+        expect(cache.size() == 2);
+
+        cache.process(video('K', true));
+        cache.process(video('a', false));
+        cache.process(video('b', false));
+        expect(cache.hasKeyframe());
+        expect(cache.size() == 5);
+        expect(received(live) == "hixKab");
+
+        // New subscribers get the header and GOP, then go live
+        std::vector<char> first;
+        int id = cache.subscribe([&](IPacket& packet) { first.push_back(packet.data()[0]); });
+        expect(received(first) == "hiKab");
+        cache.process(video('c', false));
+        expect(received(first) == "hiKabc");
+
+        // A keyframe starts a new GOP
+        cache.process(video('L', true));
+        cache.process(video('d', false));
+        expect(cache.size() == 4);
+        std::vector<char> second;
+        cache.subscribe([&](IPacket& packet) { second.push_back(packet.data()[0]); });
+        expect(received(second) == "hiLd");
+
+        cache.unsubscribe(id);
+        cache.process(video('e', false));
+        expect(received(first) == "hiKabcLd");
+        expect(received(second) == "hiLde");
+
+        // Keyframes can also be flagged on muxed output
+        av::MediaPacket& muxed = header('M');
+        muxed.flags.remove(av::HeaderPacket);
+        muxed.flags.add(av::KeyframePacket);
+        expect(av::GOPCache::isKeyframe(muxed));
+        cache.process(muxed);
+        expect(cache.size() == 3);
+
+        // A GOP over the limits is dropped until the next keyframe
+        cache.setLimits(64, 16);
+        cache.process(video('f', false, 100));
+        expect(!cache.hasKeyframe());
+        expect(cache.bytes() == 2);
+        cache.process(video('g', false));
+        expect(cache.size() == 2);
+        cache.process(video('N', true));
+        expect(cache.size() == 3);
+        expect(cache.stats().overflows == 1);
+        expect(cache.stats().keyframes == 4);
+
+        // A new header means the encoder restarted
+        cache.process(header('j'));
+        expect(cache.size() == 1);
+        std::vector<char> third;
+        cache.subscribe([&](IPacket& packet) { third.push_back(packet.data()[0]); });
+        expect(received(third) == "j");
+
+        // Without a cached GOP, deltas are held back until a keyframe
+        cache.process(video('k', false));
+        expect(received(third) == "j");
+
+        // Subscribers are called without the lock held, so they
+        // may call back into the cache during replay and live output
+        size_t sizes = 0;
+        cache.subscribe([&](IPacket&) { sizes += cache.size() + cache.stats().replayed; });
+        cache.process(video('O', true));
+        cache.process(video('p', false));
+        expect(sizes > 0);
+        expect(received(third) == "jOp");
+
+        runConcurrent();
+        runUnsubscribe();
+    }
+
+    // Unsubscribe while another thread is processing, and check the
+    // subscriber is never called once unsubscribe() has returned
+    void runUnsubscribe()
+    {
+        av::GOPCache cache;
+        std::atomic<bool> done(false);
+        std::atomic<int> calls(0);
+        std::atomic<int> late(0);
+
+        Thread producer([&]() {
+            uint32_t i = 0;
+            while (!done) {
+                av::VideoPacket packet(reinterpret_cast<uint8_t*>(&i), sizeof(i), 640, 480);
+                packet.iframe = i++ % 10 == 0;
+                cache.process(packet);
+                scy::sleep(1);
+            }
+        });
+        for (int n = 0; n < 20; n++) {
+            std::atomic<bool> released(false);
+            int id = cache.subscribe([&](IPacket&) {
+                calls++;
+                scy::sleep(2);
+                if (released)
+                    late++;
+            });
+            scy::sleep(5);
+            cache.unsubscribe(id);
+            released = true;
+        }
+
+        // A subscriber may also unsubscribe itself
+        int self = -1;
+        std::atomic<bool> unsubscribed(false);
+        self = cache.subscribe([&](IPacket&) {
+            if (!unsubscribed.exchange(true))
+                cache.unsubscribe(self);
+        });
+        while (!unsubscribed)
+            scy::sleep(1);
+
+        done = true;
+        producer.join();
+        expect(calls > 0);
+        expect(late == 0);
+    }
+
+    // Subscribe while another thread is processing, and check each
+    // subscriber sees a whole GOP followed by every later packet
+    void runConcurrent()
+    {
+        const uint32_t numPackets = 20000;
+        av::GOPCache cache;
+        std::vector<std::unique_ptr<std::vector<uint32_t>>> results;
+        std::atomic<bool> done(false);
+
+        Thread producer([&]() {
+            for (uint32_t i = 0; i < numPackets; i++) {
+                av::VideoPacket packet(reinterpret_cast<uint8_t*>(&i), sizeof(i), 640, 480);
+                packet.iframe = i % 10 == 0;
+                cache.process(packet);
+            }
+            done = true;
+        });
+        while (!done && results.size() < 100) {
+            results.emplace_back(new std::vector<uint32_t>);
+            auto indices = results.back().get();
+            cache.subscribe([indices](IPacket& packet) {
+                indices->push_back(*reinterpret_cast<const uint32_t*>(packet.data()));
+            });
+            scy::sleep(1);
+        }
+        producer.join();
+
+        for (auto& indices : results) {
+            if (indices->empty())
+                continue;
+            expect(indices->front() % 10 == 0);
+            expect(indices->back() == numPackets - 1);
+            for (size_t i = 1; i < indices->size(); i++)
+                expect((*indices)[i] == (*indices)[i - 1] + 1);
+        }
+    }
+};
+
+
 class RealtimeMediaQueueTest : public Test
 {
     PacketStream stream;
@@ -64,6 +64,18 @@ Base_API ssize_t encode_blockend(char* code_out, internal::encodestate* state_in
 } // namespace internal
 
 
+/// Returns the maximum number of characters `encode()` writes for
+/// `len` input bytes, including line feeds.
+Base_API size_t encodedSize(size_t len, int lineLength = LINE_LENGTH);
+
+/// Encodes `len` bytes into the caller provided `out` buffer, which
+/// must hold at least `encodedSize(len, lineLength)` characters.
+/// A line feed is inserted every `lineLength` characters, or none if 0.
+/// Returns the number of characters written.
+Base_API size_t encode(const char* in, size_t len, char* out,
+                       int lineLength = LINE_LENGTH);
+
+
 /// Base64 encoder.
 struct Encoder : public basic::Encoder
 {
@@ -99,16 +111,16 @@ struct Encoder : public basic::Encoder
 
     void encode(const std::string& in, std::string& out)
     {
-        char* encbuf = new char[in.length() * 2];
-        ssize_t enclen = encode(in.c_str(), in.length(), encbuf);
-        out.append(encbuf, enclen);
+        // Allow for up to two bytes left over from a previous call,
+        // a line feed and the trailing padding
+        size_t pos = out.size();
+        out.resize(pos + encodedSize(in.length() + 2, _state.linelength) + 2);
 
-        enclen = finalize(encbuf);
-        out.append(encbuf, enclen);
+        ssize_t enclen = encode(in.data(), in.length(), &out[pos]);
+        enclen += finalize(&out[pos + enclen]);
+        out.resize(pos + enclen);
 
         internal::init_encodestate(&_state);
-
-        delete[] encbuf;
     }
 
     ssize_t encode(const char* inbuf, size_t nread, char* outbuf) override
@@ -132,20 +144,12 @@ struct Encoder : public basic::Encoder
 template <typename T>
 inline std::string encode(const T& bytes, int lineLength = LINE_LENGTH)
 {
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    std::unique_ptr<char[]> encbuf(new char[bytes.size() * 2]);
-
-    internal::encodestate state;
-    internal::init_encodestate(&state);
-    state.linelength = lineLength;
+    if (bytes.size() == 0)
+        return std::string();
 
-    ssize_t enclen = internal::encode_block(reinterpret_cast<const char*>(&bytes[0]),
-                                            bytes.size(), encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
-
-    enclen = internal::encode_blockend(encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
+    std::string res(encodedSize(bytes.size(), lineLength), '\0');
+    res.resize(encode(reinterpret_cast<const char*>(&bytes[0]), bytes.size(),
+                      &res[0], lineLength));
     return res;
 }
 
@@ -177,6 +181,17 @@ Base_API ssize_t decode_block(const char* inbuf, const size_t nread, char* outbu
 } // namespace internal
 
 
+/// Returns the maximum number of bytes `decode()` writes for
+/// `len` input characters.
+Base_API size_t decodedSize(size_t len);
+
+/// Decodes `len` characters into the caller provided `out` buffer,
+/// which must hold at least `decodedSize(len)` bytes. Characters
+/// outside the Base64 alphabet, such as line feeds and padding,
+/// are skipped. Returns the number of bytes written.
+Base_API size_t decode(const char* in, size_t len, char* out);
+
+
 /// Base64 decoder.
 struct Decoder : public basic::Decoder
 {
@@ -223,17 +238,12 @@ struct Decoder : public basic::Decoder
 template <typename T>
 inline std::string decode(const T& bytes)
 {
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    std::unique_ptr<char[]> encbuf(new char[bytes.size() * 2]);
-
-    internal::decodestate state;
-    internal::init_decodestate(&state);
-
-    size_t enclen = internal::decode_block(reinterpret_cast<const char*>(&bytes[0]),
-                                           bytes.size(), encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
+    if (bytes.size() == 0)
+        return std::string();
 
+    std::string res(decodedSize(bytes.size()), '\0');
+    res.resize(decode(reinterpret_cast<const char*>(&bytes[0]), bytes.size(),
+                      &res[0]));
     return res;
 }
 
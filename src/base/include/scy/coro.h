@@ -0,0 +1,470 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_Coro_H
+#define SCY_Coro_H
+
+
+#include "scy/base.h"
+
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+
+#include "scy/logger.h"
+#include "scy/loop.h"
+#include "scy/packettransaction.h"
+#include "scy/signal.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace scy {
+namespace coro {
+
+
+/// Awaitable adapters for writing asynchronous flows as C++20 coroutines.
+///
+/// The adapters are thin wrappers over the existing callback and signal
+/// APIs, and are only built when LibSourcey is configured with
+/// `ENABLE_COROUTINES`. Coroutines are always resumed from the thread of
+/// the loop which completed the operation, so code written with them has
+/// the same threading rules as the equivalent callbacks.
+///
+/// Awaiter state such as timer handles and socket requests is stored in
+/// the awaiter itself, which lives in the coroutine frame, so awaiting
+/// does not allocate. Signal based awaiters attach one slot per await.
+///
+/// A coroutine must not be destroyed while it is suspended on an
+/// operation, since the operation would resume a dead frame.
+
+template <typename T = void> class Task;
+
+
+namespace internal {
+
+
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    bool detached = false;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            PromiseBase& promise = handle.promise();
+            if (promise.continuation)
+                return promise.continuation;
+            if (promise.detached) {
+                if (promise.exception) {
+                    try {
+                        std::rethrow_exception(promise.exception);
+                    } catch (std::exception& exc) {
+                        LError("Detached coroutine failed: ", exc.what())
+                    } catch (...) {
+                        LError("Detached coroutine failed")
+                    }
+                }
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+
+template <typename T>
+struct Promise : public PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& result)
+    {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T result()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+
+template <>
+struct Promise<void> : public PromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+
+} // namespace internal
+
+
+//
+// Task
+//
+
+
+/// Lazily started coroutine which produces a value of type T.
+///
+/// The coroutine body runs when the task is awaited, and the awaiting
+/// coroutine is resumed by symmetric transfer when it completes, so long
+/// chains of tasks don't grow the stack. Exceptions thrown by the body are
+/// rethrown to the awaiter.
+///
+/// Top level tasks are started with spawn(), which detaches them so
+/// they free themselves when they complete.
+template <typename T>
+class Task
+{
+public:
+    typedef internal::Promise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    explicit Task(Handle handle) noexcept
+        : _handle(handle)
+    {
+    }
+
+    Task(Task&& other) noexcept
+        : _handle(std::exchange(other._handle, nullptr))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (_handle)
+                _handle.destroy();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return !_handle || _handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        _handle.promise().continuation = awaiter;
+        return _handle;
+    }
+
+    T await_resume() { return _handle.promise().result(); }
+
+    /// Start the coroutine without an awaiter.
+    /// The coroutine frame is freed when the body completes, and
+    /// exceptions which escape the body are logged.
+    void detach()
+    {
+        Handle handle = std::exchange(_handle, nullptr);
+        handle.promise().detached = true;
+        handle.resume();
+    }
+
+    /// Return true if the task holds a coroutine which has completed.
+    bool done() const { return _handle && _handle.done(); }
+
+protected:
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Handle _handle;
+};
+
+
+namespace internal {
+
+
+template <typename T>
+inline Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+
+} // namespace internal
+
+
+/// Start a task and let it run to completion on its own.
+/// The task runs synchronously until its first suspension point.
+template <typename T>
+inline void spawn(Task<T>&& task)
+{
+    task.detach();
+}
+
+
+//
+// Sleep
+//
+
+
+/// Awaiter which suspends the coroutine for a number of milliseconds.
+///
+/// The timer handle is embedded in the awaiter and closed before the
+/// coroutine is resumed, so nothing outlives the await.
+class SleepAwaiter
+{
+public:
+    SleepAwaiter(uv::Loop* loop, int64_t timeout)
+        : _loop(loop)
+        , _timeout(timeout < 0 ? 0 : timeout)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiter)
+    {
+        _awaiter = awaiter;
+        uv_timer_init(_loop, &_timer);
+        _timer.data = this;
+        uv_timer_start(&_timer, [](uv_timer_t* timer) {
+            uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+                static_cast<SleepAwaiter*>(handle->data)->_awaiter.resume();
+            });
+        }, static_cast<uint64_t>(_timeout), 0);
+    }
+
+    void await_resume() const noexcept {}
+
+protected:
+    uv::Loop* _loop;
+    int64_t _timeout;
+    uv_timer_t _timer;
+    std::coroutine_handle<> _awaiter;
+};
+
+
+/// Suspend the coroutine for the given number of milliseconds.
+/// A zero timeout resumes on the next loop iteration.
+inline SleepAwaiter sleep(uv::Loop* loop, int64_t timeout)
+{
+    return SleepAwaiter(loop, timeout);
+}
+
+
+/// Suspend the coroutine for the given number of
+/// milliseconds on the default loop.
+inline SleepAwaiter sleep(int64_t timeout)
+{
+    return SleepAwaiter(uv::defaultLoop(), timeout);
+}
+
+
+//
+// Signal
+//
+
+
+namespace internal {
+
+
+template <typename... Args>
+struct SignalResult
+{
+    typedef std::tuple<typename std::decay<Args>::type...> Type;
+    static Type make(Args... args) { return Type(args...); }
+};
+
+template <typename Arg>
+struct SignalResult<Arg>
+{
+    typedef typename std::decay<Arg>::type Type;
+    static Type make(Arg arg) { return Type(arg); }
+};
+
+template <>
+struct SignalResult<>
+{
+    typedef bool Type;
+    static Type make() { return true; }
+};
+
+
+} // namespace internal
+
+
+/// Awaiter which suspends the coroutine until a signal is next emitted.
+///
+/// The coroutine is resumed from inside the signal emission, and the
+/// await returns a copy of the signal arguments: the argument itself for
+/// single argument signals, a tuple for several and true for none.
+template <typename... Args>
+class SignalAwaiter
+{
+public:
+    typedef internal::SignalResult<Args...> Result;
+
+    SignalAwaiter(const Signal<void(Args...)>& signal)
+        : _signal(signal)
+        , _slot(-1)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiter)
+    {
+        _awaiter = awaiter;
+        _slot = _signal.attach([this](Args... args) {
+            _signal.detach(_slot);
+            _result.emplace(Result::make(args...));
+            _awaiter.resume();
+        });
+    }
+
+    typename Result::Type await_resume() { return std::move(*_result); }
+
+protected:
+    const Signal<void(Args...)>& _signal;
+    int _slot;
+    std::optional<typename Result::Type> _result;
+    std::coroutine_handle<> _awaiter;
+};
+
+
+/// Suspend the coroutine until the signal is next emitted.
+template <typename... Args>
+inline SignalAwaiter<Args...> next(const Signal<void(Args...)>& signal)
+{
+    return SignalAwaiter<Args...>(signal);
+}
+
+
+//
+// Packet Transaction
+//
+
+
+/// Awaiter which sends a transaction and suspends the coroutine until it
+/// succeeds or fails.
+///
+/// The await returns true on success, in which case the response may be
+/// read from the transaction. The transaction deletes itself once complete,
+/// so it must not be used after the coroutine next suspends.
+template <class PacketT>
+class TransactionAwaiter
+{
+public:
+    TransactionAwaiter(PacketTransaction<PacketT>& transaction)
+        : _transaction(transaction)
+        , _slot(-1)
+        , _sending(false)
+        , _done(false)
+        , _success(false)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiter)
+    {
+        _awaiter = awaiter;
+        _slot = _transaction.StateChange.attach(
+            [this](void*, TransactionState& state, const TransactionState&) {
+                if (!state.equals(TransactionState::Success) &&
+                    !state.equals(TransactionState::Failed))
+                    return;
+                _transaction.StateChange.detach(_slot);
+                _done = true;
+                _success = state.equals(TransactionState::Success);
+                if (!_sending)
+                    _awaiter.resume();
+            });
+
+        // Don't suspend if the transaction failed while sending
+        _sending = true;
+        bool sent = _transaction.send();
+        _sending = false;
+        if (_done)
+            return false;
+        if (!sent) {
+            _transaction.StateChange.detach(_slot);
+            return false;
+        }
+        return true;
+    }
+
+    bool await_resume() const noexcept { return _success; }
+
+protected:
+    PacketTransaction<PacketT>& _transaction;
+    int _slot;
+    bool _sending;
+    bool _done;
+    bool _success;
+    std::coroutine_handle<> _awaiter;
+};
+
+
+} // namespace coro
+
+
+/// Send a transaction and wait for it to complete.
+/// See coro::TransactionAwaiter.
+template <class PacketT>
+inline coro::TransactionAwaiter<PacketT> operator co_await(PacketTransaction<PacketT>& transaction)
+{
+    return coro::TransactionAwaiter<PacketT>(transaction);
+}
+
+
+} // namespace scy
+
+
+#endif
+#endif // SCY_Coro_H
+
+
+/// @\}
@@ -0,0 +1,294 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_Executor_H
+#define SCY_Executor_H
+
+
+#include "scy/base.h"
+#include "scy/handle.h"
+#include "scy/loop.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+
+namespace scy {
+namespace uv {
+
+
+//
+// Multi-Producer Single-Consumer Queue
+//
+
+
+/// Intrusive lock-free multi-producer single-consumer queue.
+///
+/// Nodes must expose a `std::atomic<Node*> next` member and be default
+/// constructible, since the queue embeds a stub node. Any thread may push
+/// nodes, but only a single consumer thread may pop them.
+///
+/// pop() may return nullptr while a concurrent push() is half way through
+/// linking its node, in which case empty() returns false and the consumer
+/// should try again later.
+template <typename Node>
+class MPSCQueue
+{
+public:
+    MPSCQueue()
+        : _head(&_stub)
+        , _tail(&_stub)
+    {
+        _stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    /// Push a node onto the queue. May be called from any thread.
+    void push(Node* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /// Pop the oldest node, or return nullptr.
+    /// Must only be called from the consumer thread.
+    Node* pop()
+    {
+        Node* tail = _tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &_stub) {
+            if (!next)
+                return nullptr;
+            _tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        if (tail != _head.load(std::memory_order_acquire))
+            return nullptr; // a producer is linking its node
+        push(&_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    /// Return true if the queue holds no nodes.
+    /// Must only be called from the consumer thread.
+    bool empty() const
+    {
+        return _tail == &_stub &&
+               _head.load(std::memory_order_acquire) == &_stub;
+    }
+
+protected:
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    std::atomic<Node*> _head;
+    Node* _tail;
+    Node _stub;
+};
+
+
+//
+// Executor
+//
+
+
+/// Executor is the cross-thread task inbox of an event loop.
+///
+/// Each loop has a single executor, obtained with `Executor::get()`, which
+/// owns one `uv_async_t` handle and an intrusive lock-free queue of tasks.
+/// Any thread may post tasks, which are run in FIFO order by the loop
+/// thread. Wakeups are coalesced so a burst of posts costs a single
+/// `uv_async_send()`, and posting never takes a lock.
+///
+/// Callables of up to `InlineSize` bytes are stored inside the task node,
+/// so posting a small lambda costs a single allocation.
+///
+/// The executor handle does not keep the loop alive on its own. Components
+/// which expect posted tasks while the loop is otherwise idle should hold a
+/// reference with ref() and unref() for as long as they need it.
+///
+/// The loop thread is the thread which runs the loop, and is bound on the
+/// first loop iteration after the executor is created. Until then no thread
+/// is considered to be the loop thread, so dispatch() always posts.
+class Base_API Executor
+{
+public:
+    enum
+    {
+        InlineSize = 48, ///< inline callable storage in bytes
+        MaxBatch = 1024  ///< maximum tasks run per loop iteration
+    };
+
+    /// Task node. Holds the callable inline or a pointer to it.
+    struct Task
+    {
+        std::atomic<Task*> next;
+        void (*call)(Task*, bool run);
+        typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type storage;
+
+        Task()
+            : next(nullptr)
+            , call(nullptr)
+        {
+        }
+    };
+
+    /// Create the executor for the given loop.
+    /// Must be called before the loop is running or from the
+    /// loop thread, so prefer get().
+    Executor(uv::Loop* loop);
+
+    /// Destroy the executor.
+    /// Tasks which have not been run yet are discarded.
+    ~Executor();
+
+    /// Return the executor of the given loop, creating it on first use.
+    /// The first call for each loop must be made before the loop is
+    /// running or from the loop thread.
+    static Executor& get(uv::Loop* loop = uv::defaultLoop());
+
+    /// Queue a callable to be run by the loop thread.
+    /// May be called from any thread.
+    template <typename Function>
+    void post(Function&& func)
+    {
+        enqueue(makeTask(std::forward<Function>(func)));
+    }
+
+    /// Run the callable immediately when called from the loop
+    /// thread, otherwise queue it with post().
+    template <typename Function>
+    void dispatch(Function&& func)
+    {
+        if (inLoopThread())
+            func();
+        else
+            post(std::forward<Function>(func));
+    }
+
+    /// Return true when called from the loop thread.
+    /// Returns false until the loop has started running.
+    bool inLoopThread() const;
+
+    /// Keep the loop alive while tasks are expected.
+    /// May be called from any thread.
+    void ref();
+
+    /// Release a reference taken with ref().
+    /// May be called from any thread.
+    void unref();
+
+    /// Run queued tasks. Called by the async handle.
+    void run();
+
+    /// Return the event loop.
+    uv::Loop* loop() const;
+
+protected:
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    template <typename Function>
+    static Task* makeTask(Function&& func)
+    {
+        typedef typename std::decay<Function>::type Fn;
+        Task* task = new Task;
+        storeCallable<Fn>(task, std::forward<Function>(func),
+            std::integral_constant<bool,
+                sizeof(Fn) <= InlineSize &&
+                alignof(Fn) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible<Fn>::value>());
+        return task;
+    }
+
+    template <typename Fn, typename Function>
+    static void storeCallable(Task* task, Function&& func, std::true_type)
+    {
+        new (&task->storage) Fn(std::forward<Function>(func));
+        task->call = [](Task* t, bool run) {
+            Fn* fn = reinterpret_cast<Fn*>(&t->storage);
+            if (run)
+                (*fn)();
+            fn->~Fn();
+        };
+    }
+
+    template <typename Fn, typename Function>
+    static void storeCallable(Task* task, Function&& func, std::false_type)
+    {
+        new (&task->storage) Fn*(new Fn(std::forward<Function>(func)));
+        task->call = [](Task* t, bool run) {
+            Fn* fn = *reinterpret_cast<Fn**>(&t->storage);
+            if (run)
+                (*fn)();
+            delete fn;
+        };
+    }
+
+    void enqueue(Task* task);
+    void wakeup();
+    void discard();
+    void bind();
+    void updateRef();
+
+    uv::Loop* _loop;
+    uv::Handle<uv_async_t> _handle;
+    uv::Handle<uv_prepare_t> _prepare;
+    uv_async_t* _async;
+    MPSCQueue<Task> _queue;
+    std::atomic<bool> _pending;
+    std::atomic<uint64_t> _posted;
+    std::atomic<std::thread::id> _tid; ///< loop thread, bound when the loop runs
+    std::atomic<int> _refs;
+};
+
+
+/// Queue a callable to be run by the thread of the given loop.
+/// The executor lookup is synchronized, so callers on the hot path
+/// should cache the result of `Executor::get()` instead.
+template <typename Function>
+inline void post(uv::Loop* loop, Function&& func)
+{
+    Executor::get(loop).post(std::forward<Function>(func));
+}
+
+
+/// Run a callable immediately when called from the thread of the
+/// given loop, otherwise queue it to be run by the loop thread.
+template <typename Function>
+inline void dispatch(uv::Loop* loop, Function&& func)
+{
+    Executor::get(loop).dispatch(std::forward<Function>(func));
+}
+
+
+} // namespace uv
+} // namespace scy
+
+
+#endif // SCY_Executor_H
+
+
+/// @\}
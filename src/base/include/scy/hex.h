@@ -16,9 +16,11 @@
 #include "scy/error.h"
 #include "scy/interface.h"
 #include "scy/logger.h"
+#include <algorithm>
 #include <assert.h>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 
 namespace scy {
@@ -30,6 +32,13 @@ namespace hex {
 //
 
 
+/// Encodes `len` bytes into the caller provided `out` buffer, which
+/// must hold at least `len * 2` characters. Returns the number of
+/// characters written.
+Base_API size_t encode(const char* in, size_t len, char* out,
+                       bool uppercase = false);
+
+
 /// Hex encoder.
 struct Encoder : public basic::Encoder
 {
@@ -42,19 +51,19 @@ struct Encoder : public basic::Encoder
 
     virtual ssize_t encode(const char* inbuf, size_t nread, char* outbuf) override
     {
-        // static const int eof = std::char_traits<char>::eof();
-        static const char digits[] = "0123456789abcdef0123456789ABCDEF";
+        if (_lineLength <= 0)
+            return hex::encode(inbuf, nread, outbuf, _uppercase != 0);
 
-        char c;
+        // Encode a line at a time
         size_t nwrite = 0;
-        for (unsigned i = 0; i < nread; i++) {
-            c = inbuf[i];
-            std::memcpy(outbuf + nwrite++, &digits[_uppercase + ((c >> 4) & 0xF)], 1);
-            std::memcpy(outbuf + nwrite++, &digits[_uppercase + (c & 0xF)], 1);
-            if (_lineLength > 0 &&
-                (_linePos += 2) >= _lineLength) { //++_linePos;
+        while (nread > 0) {
+            size_t n = std::min<size_t>(nread, std::max(1, (_lineLength - _linePos + 1) / 2));
+            nwrite += hex::encode(inbuf, n, outbuf + nwrite, _uppercase != 0);
+            inbuf += n;
+            nread -= n;
+            if ((_linePos += static_cast<int>(n * 2)) >= _lineLength) {
                 _linePos = 0;
-                std::memcpy(outbuf + nwrite++, "\n", 1);
+                outbuf[nwrite++] = '\n';
             }
         }
 
@@ -77,15 +86,11 @@ struct Encoder : public basic::Encoder
 template <typename T>
 inline std::string encode(const T& bytes)
 {
-    static const char digits[] = "0123456789abcdef";
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    for (typename T::const_iterator it = bytes.begin(); it != bytes.end();
-         ++it) {
-        const unsigned char c = static_cast<const unsigned char>(*it);
-        res += digits[(c >> 4) & 0xF];
-        res += digits[c & 0xF];
-    }
+    if (bytes.size() == 0)
+        return std::string();
+
+    std::string res(bytes.size() * 2, '\0');
+    encode(reinterpret_cast<const char*>(&bytes[0]), bytes.size(), &res[0]);
     return res;
 }
 
@@ -95,6 +100,15 @@ inline std::string encode(const T& bytes)
 //
 
 
+/// Decodes `len` characters into the caller provided `out` buffer,
+/// which must hold at least `len / 2` bytes. Whitespace is skipped.
+/// Returns the number of bytes written.
+///
+/// Throws if the input contains any other non hex character or
+/// an odd number of digits.
+Base_API size_t decode(const char* in, size_t len, char* out);
+
+
 /// Hex decoder.
 struct Decoder : public basic::Decoder
 {
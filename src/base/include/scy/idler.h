@@ -16,6 +16,7 @@
 #include "scy/base.h"
 #include "scy/runner.h"
 #include "scy/handle.h"
+#include "scy/loopmetrics.h"
 
 #include <functional>
 
@@ -75,6 +76,7 @@ public:
             [](uv_idle_t* req) {
                 auto wrap = reinterpret_cast<Callback*>(req->data);
                 if (!wrap->ctx->cancelled) {
+                    uv::CallbackTimer timing(req->loop, UV_IDLE);
                     wrap->invoke();
                 }
                 else {
@@ -14,10 +14,13 @@
 
 
 #include "scy/base.h"
+#include "scy/executor.h"
 #include "scy/synchronizer.h"
 
-#include <mutex>
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 
 
@@ -112,25 +115,75 @@ protected:
 /// actions between threads and the event loop we are
 /// synchronizing with.
 ///
+/// Actions are run by a task posted to the loop's `uv::Executor`, so the
+/// queue does not own an async handle. The queue keeps the loop alive
+/// until it is closed.
 template <typename TAction = ipc::Action>
 class SyncQueue : public Queue<TAction>
 {
 public:
     SyncQueue(uv::Loop* loop = uv::defaultLoop())
-        : _sync(std::bind(&Queue<TAction>::runSync, this), loop)
+        : _executor(uv::Executor::get(loop))
+        , _state(std::make_shared<State>(this))
     {
+        _executor.ref();
     }
 
-    virtual ~SyncQueue() {}
+    virtual ~SyncQueue() { close(); }
 
-    virtual void close() { _sync.close(); }
+    /// Stop running actions and release the event loop.
+    virtual void close()
+    {
+        if (_state->queue.exchange(nullptr))
+            _executor.unref();
+        if (_sync)
+            _sync->close();
+    }
 
-    virtual void post() { _sync.post(); }
+    /// Post a task to run queued actions on the event
+    /// loop unless one is already pending.
+    virtual void post()
+    {
+        if (!_state->scheduled.exchange(true)) {
+            std::shared_ptr<State> state(_state);
+            _executor.post([state]() {
+                state->scheduled.store(false);
+                if (SyncQueue* queue = state->queue.load())
+                    queue->runSync();
+            });
+        }
+    }
 
-    virtual Synchronizer& sync() { return _sync; }
+    virtual uv::Executor& executor() { return _executor; }
+
+    /// Return a Synchronizer which runs queued actions when posted.
+    /// It is created on first use, which must be on the event loop thread.
+    /// @deprecated The queue no longer owns a Synchronizer, use executor()
+    virtual Synchronizer& sync()
+    {
+        if (!_sync)
+            _sync.reset(new Synchronizer(
+                std::bind(&Queue<TAction>::runSync, this), _executor.loop()));
+        return *_sync;
+    }
 
 protected:
-    Synchronizer _sync;
+    /// State shared with the pending task.
+    struct State
+    {
+        std::atomic<SyncQueue*> queue;
+        std::atomic<bool> scheduled;
+
+        State(SyncQueue* queue)
+            : queue(queue)
+            , scheduled(false)
+        {
+        }
+    };
+
+    uv::Executor& _executor;
+    std::shared_ptr<State> _state;
+    std::unique_ptr<Synchronizer> _sync;
 };
 
 
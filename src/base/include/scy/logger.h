@@ -19,6 +19,7 @@
 #include "scy/singleton.h"
 #include "scy/thread.h"
 
+#include <atomic>
 #include <ctime>
 #include <deque>
 #include <fstream>
@@ -32,6 +33,16 @@
 namespace scy {
 
 
+/// Minimum log level which is compiled into the binary.
+///
+/// Log statements below this level compile to nothing, and their arguments
+/// are never evaluated. The value corresponds to the `Level` enumeration,
+/// ie. a value of 2 elides all Trace and Debug statements.
+#ifndef SCY_MIN_LOG_LEVEL
+#define SCY_MIN_LOG_LEVEL 0
+#endif
+
+
 enum class Level
 {
     Trace = 0,
@@ -178,6 +189,24 @@ public:
     /// if no default channel has been set.
     LogChannel* getDefault() const;
 
+    /// Returns true if the default logger has a channel which accepts
+    /// messages of the given level.
+    ///
+    /// This check is lock free, and is used by the logging macros to
+    /// avoid constructing a LogStream for messages which would be dropped.
+    static bool enabled(Level level)
+    {
+#ifdef SCY_ENABLE_LOGGING
+        return static_cast<int>(level) >= _threshold.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    /// Recomputes the minimum level accepted by the log channels.
+    /// Called when channels are added, removed or their level changes.
+    void updateThreshold();
+
     /// Writes the given message to the default log channel.
     /// The message will be copied.
     void write(const LogStream& stream);
@@ -206,6 +235,10 @@ protected:
     LogChannelMap _channels;
     LogChannel* _defaultChannel;
     LogWriter* _writer;
+    int _minLevel;
+
+    /// The minimum level accepted by the default logger instance.
+    static std::atomic<int> _threshold;
 };
 
 
@@ -341,7 +374,7 @@ public:
     Level level() const { return _level; };
     std::string timeFormat() const { return _timeFormat; };
 
-    void setLevel(Level level) { _level = level; };
+    void setLevel(Level level);
     void setTimeFormat(std::string format) { _timeFormat = std::move(format); };
     void setFilter(std::string filter) { _filter = std::move(filter); }
 
@@ -350,6 +383,9 @@ protected:
     Level _level;
     std::string _timeFormat;
     std::string _filter;
+    Logger* _logger;
+
+    friend class Logger;
 };
 
 
@@ -511,17 +547,49 @@ inline std::string _methodName(const std::string& fsig)
 #endif
 
 
-#define STrace LogStream(Level::Trace, _fileName(__FILE__), __LINE__)
-#define SDebug LogStream(Level::Debug, _fileName(__FILE__), __LINE__)
-#define SInfo  LogStream(Level::Info, _fileName(__FILE__), __LINE__)
-#define SWarn  LogStream(Level::Warn, _fileName(__FILE__), __LINE__)
-#define SError LogStream(Level::Error, _fileName(__FILE__), __LINE__)
-
-#define LTrace(...) { LogStream(Level::Trace, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
-#define LDebug(...) { LogStream(Level::Debug, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
-#define LInfo(...)  { LogStream(Level::Info, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
-#define LWarn(...)  { LogStream(Level::Warn, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
-#define LError(...) { LogStream(Level::Error, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
+// Stream and variadic logging macros.
+//
+// Statements below SCY_MIN_LOG_LEVEL are eliminated at compile time. Above
+// the threshold the LogStream is only constructed if a log channel accepts
+// the message level, so disabled statements cost a single atomic load.
+#define SCY_LOG_STREAM(level) \
+    if (!(static_cast<int>(level) >= SCY_MIN_LOG_LEVEL && scy::Logger::enabled(level))) {} \
+    else LogStream(level, _fileName(__FILE__), __LINE__)
+#define SCY_LOG_WRITE(level, ...) \
+    { if (static_cast<int>(level) >= SCY_MIN_LOG_LEVEL && scy::Logger::enabled(level)) \
+        LogStream(level, _fileName(__FILE__), __LINE__).write(__VA_ARGS__); }
+
+#define STrace SCY_LOG_STREAM(Level::Trace)
+#define SDebug SCY_LOG_STREAM(Level::Debug)
+#define SInfo  SCY_LOG_STREAM(Level::Info)
+#define SWarn  SCY_LOG_STREAM(Level::Warn)
+#define SError SCY_LOG_STREAM(Level::Error)
+
+#if SCY_MIN_LOG_LEVEL <= 0
+#define LTrace(...) SCY_LOG_WRITE(Level::Trace, __VA_ARGS__)
+#else
+#define LTrace(...) {}
+#endif
+#if SCY_MIN_LOG_LEVEL <= 1
+#define LDebug(...) SCY_LOG_WRITE(Level::Debug, __VA_ARGS__)
+#else
+#define LDebug(...) {}
+#endif
+#if SCY_MIN_LOG_LEVEL <= 2
+#define LInfo(...)  SCY_LOG_WRITE(Level::Info, __VA_ARGS__)
+#else
+#define LInfo(...)  {}
+#endif
+#if SCY_MIN_LOG_LEVEL <= 3
+#define LWarn(...)  SCY_LOG_WRITE(Level::Warn, __VA_ARGS__)
+#else
+#define LWarn(...)  {}
+#endif
+#if SCY_MIN_LOG_LEVEL <= 4
+#define LError(...) SCY_LOG_WRITE(Level::Error, __VA_ARGS__)
+#else
+#define LError(...) {}
+#endif
 
 // #define TraceS(self) LogStream(Level::Trace, _fileName(__FILE__), __LINE__, self)
 // #define DebugS(self) LogStream(Level::Debug, _fileName(__FILE__), __LINE__, self)
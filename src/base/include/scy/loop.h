@@ -21,6 +21,10 @@
 
 #include "uv.h"
 
+#include <functional>
+#include <memory>
+#include <typeinfo>
+
 
 namespace scy {
 namespace uv {
@@ -51,9 +55,71 @@ inline Loop* createLoop()
     return loop;
 }
 
+namespace internal {
+
+/// Return the loop-local instance registered for the given type,
+/// creating it with `factory` on first use.
+Base_API void* getLoopLocal(Loop* loop, const std::type_info& type,
+                            const std::function<std::shared_ptr<void>()>& factory);
+
+/// Return the loop-local instance registered for the given type,
+/// or nullptr if none has been created.
+Base_API void* findLoopLocal(Loop* loop, const std::type_info& type);
+
+/// Destroy all loop-local instances bound to the given loop.
+Base_API void clearLoopLocals(Loop* loop);
+
+} // namespace internal
+
+
+/// Return the instance of `T` which is bound to the given event loop,
+/// creating it on first use. `T` must be constructible from a `Loop*`.
+///
+/// Loop-local instances are intended for shared facilities such as buffer
+/// slabs and request pools which must only be accessed from the loop thread.
+/// The lookup itself is synchronized, so callers on the hot path should cache
+/// the returned reference. Instances are destroyed by `closeLoop()`.
+/// The default loop is never closed, so its instances are destroyed by
+/// `Application::finalize()` once the loop has run dry, or otherwise at
+/// process exit.
+template <typename T>
+inline T& loopLocal(Loop* loop)
+{
+    return *static_cast<T*>(internal::getLoopLocal(loop, typeid(T), [loop]() {
+        return std::static_pointer_cast<void>(std::make_shared<T>(loop));
+    }));
+}
+
+/// Return the instance of `T` which is bound to the given event loop,
+/// or nullptr if it has not been created yet.
+template <typename T>
+inline T* findLoopLocal(Loop* loop)
+{
+    return static_cast<T*>(internal::findLoopLocal(loop, typeid(T)));
+}
+
+/// Destroy the loop-local instances bound to the given loop and close it.
+///
+/// Pending callbacks are run once with `UV_RUN_NOWAIT` first, so requests
+/// which have already completed or been cancelled are returned to their
+/// pools. Requests still in flight after that pass, such as resolver
+/// lookups on the thread pool, would be released into destroyed pools,
+/// so all handles must be closed and the loop run dry before calling.
+/// Returns false if the loop is still busy and could not be closed.
 inline bool closeLoop(Loop* loop)
 {
-    return uv_loop_close(loop) == 0;
+    // Run pending callbacks first, since cancelled writes and sends
+    // return their requests to the loop-local pools.
+    uv_run(loop, UV_RUN_NOWAIT);
+    internal::clearLoopLocals(loop);
+    int err = uv_loop_close(loop);
+    if (err == UV_EBUSY) {
+        // Run the close callbacks of any handles owned
+        // by the released loop-local instances.
+        uv_run(loop, UV_RUN_NOWAIT);
+        err = uv_loop_close(loop);
+    }
+    return err == 0;
 }
 
 
@@ -0,0 +1,240 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#ifndef SCY_UV_LoopMetrics_H
+#define SCY_UV_LoopMetrics_H
+
+
+#include "scy/base.h"
+#include "scy/handle.h"
+#include "scy/loop.h"
+
+#include "uv.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace scy {
+namespace uv {
+
+
+/// Fixed size latency histogram with power of two buckets.
+///
+/// Bucket `i` counts samples below `2^i` microseconds, and the last bucket
+/// counts everything above. All values are in nanoseconds.
+struct Base_API LatencyHistogram
+{
+    enum { NumBuckets = 24 };
+
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+    uint64_t buckets[NumBuckets] = {};
+
+    /// Record a sample in nanoseconds.
+    void record(uint64_t nanos);
+
+    /// Return the mean sample value.
+    uint64_t mean() const;
+
+    /// Return the upper bound of the bucket containing the given
+    /// percentile (0 - 100).
+    uint64_t percentile(double p) const;
+
+    /// Clear all samples.
+    void reset();
+};
+
+
+/// Callback timing totals for a single handle type.
+struct Base_API CallbackStats
+{
+    uint64_t count = 0;
+    uint64_t total = 0; ///< nanoseconds
+    uint64_t max = 0;   ///< nanoseconds
+};
+
+
+/// Write queue state of a single stream or UDP socket.
+struct Base_API SocketWriteQueue
+{
+    const void* handle = nullptr;
+    uv_handle_type type = UV_UNKNOWN_HANDLE;
+    size_t pending = 0; ///< bytes queued for writing
+    std::string local;
+    std::string peer;
+};
+
+
+/// Per-loop event loop health collector.
+///
+/// Once started the collector installs unreferenced prepare and check
+/// handles on the loop in order to measure how long each iteration keeps the
+/// loop busy. Callbacks dispatched by the `libuv` wrappers in this library
+/// (streams, UDP sockets, timers, idlers, synchronizers and executors) are
+/// timed and attributed to their handle type, and `Synchronizer` and
+/// `Executor` post-to-run latency is recorded. Handle, request and write
+/// queue state is sampled on demand by `snapshot()`.
+///
+/// Iteration lag is the time the loop spent running callbacks rather than
+/// waiting for events, which is the time an incoming event may have to wait
+/// before being serviced.
+///
+/// The collector must only be used from the loop thread, and should be
+/// stopped before the loop is closed. Started collectors are tracked in a
+/// global registry keyed by loop, so a collector destroyed on another
+/// thread, such as by `uv::closeLoop()`, is never looked up afterwards.
+class Base_API LoopMetrics
+{
+public:
+    /// Point in time view of the collected metrics.
+    struct Base_API Snapshot
+    {
+        uint64_t time = 0;     ///< time of the snapshot (uv_hrtime)
+        uint64_t uptime = 0;   ///< nanoseconds since the collector was started
+        uint64_t busy = 0;     ///< total iteration lag in nanoseconds
+        uint64_t iterations = 0;
+        LatencyHistogram lag;
+        LatencyHistogram syncLatency;
+        CallbackStats callbacks[UV_HANDLE_TYPE_MAX];
+        size_t handles[UV_HANDLE_TYPE_MAX] = {};
+        size_t totalHandles = 0;
+        size_t activeHandles = 0;
+        size_t activeRequests = 0;
+        size_t pendingWriteBytes = 0;
+        std::vector<SocketWriteQueue> sockets; ///< sockets with pending writes
+
+        /// Serialize the snapshot as a JSON object.
+        std::string toJSON() const;
+    };
+
+    LoopMetrics(uv::Loop* loop = uv::defaultLoop());
+    ~LoopMetrics();
+
+    /// Return the collector bound to the given event loop.
+    static LoopMetrics& get(uv::Loop* loop = uv::defaultLoop());
+
+    /// Return the started collector bound to the given event loop, or nullptr
+    /// if metrics are not being collected for the loop.
+    ///
+    /// This method takes no lock while no collector is running on any loop.
+    /// Otherwise the registry lock is taken for the lookup.
+    static LoopMetrics* find(uv::Loop* loop)
+    {
+        if (_numStarted.load(std::memory_order_relaxed) == 0)
+            return nullptr;
+        return findStarted(loop);
+    }
+
+    /// Return true if a collector is running on any loop.
+    static bool enabled()
+    {
+        return _numStarted.load(std::memory_order_relaxed) != 0;
+    }
+
+    /// Start collecting metrics.
+    void start();
+
+    /// Stop collecting metrics and close the loop handles.
+    void stop();
+
+    /// Return true if metrics are being collected.
+    bool started() const;
+
+    /// Clear all collected samples.
+    void reset();
+
+    /// Record the time spent in a callback for the given handle type.
+    void recordCallback(uv_handle_type type, uint64_t nanos);
+
+    /// Record the time between a `Synchronizer` or `Executor` post and the
+    /// callback run.
+    void recordSyncLatency(uint64_t nanos);
+
+    /// Sample the loop state and return a copy of the collected metrics.
+    Snapshot snapshot() const;
+
+    /// Return the current snapshot serialized as JSON.
+    std::string toJSON() const;
+
+    /// Return the loop this collector is bound to.
+    uv::Loop* loop() const;
+
+protected:
+    LoopMetrics(const LoopMetrics&) = delete;
+    LoopMetrics& operator=(const LoopMetrics&) = delete;
+
+    static LoopMetrics* findStarted(uv::Loop* loop);
+
+    void onPrepare();
+    void onCheck();
+
+    static std::atomic<int> _numStarted;
+
+    uv::Loop* _loop;
+    uv::Handle<uv_prepare_t> _prepare;
+    uv::Handle<uv_check_t> _check;
+    bool _started;
+    bool _polling;
+    uint64_t _startTime;
+    uint64_t _checkTime;
+    uint64_t _pollBusy;
+    uint64_t _busy;
+    uint64_t _iterations;
+    LatencyHistogram _lag;
+    LatencyHistogram _syncLatency;
+    CallbackStats _callbacks[UV_HANDLE_TYPE_MAX];
+};
+
+
+/// Scoped timer which attributes the enclosed callback to a handle type
+/// when metrics are being collected for the loop.
+class Base_API CallbackTimer
+{
+public:
+    CallbackTimer(uv::Loop* loop, uv_handle_type type)
+        : _metrics(LoopMetrics::find(loop))
+        , _type(type)
+        , _start(_metrics ? uv_hrtime() : 0)
+    {
+    }
+
+    ~CallbackTimer()
+    {
+        if (_metrics)
+            _metrics->recordCallback(_type, uv_hrtime() - _start);
+    }
+
+protected:
+    CallbackTimer(const CallbackTimer&) = delete;
+    CallbackTimer& operator=(const CallbackTimer&) = delete;
+
+    LoopMetrics* _metrics;
+    uv_handle_type _type;
+    uint64_t _start;
+};
+
+
+/// Return the printable name of the given handle type.
+Base_API const char* handleTypeName(uv_handle_type type);
+
+
+} // namespace uv
+} // namespace scy
+
+
+#endif // SCY_UV_LoopMetrics_H
+
+
+/// @\}
@@ -61,6 +61,12 @@ public:
     /// while the event loop is inactive.
     void finalize();
 
+    /// Frees all pointers scheduled on the given loop and
+    /// removes its cleaner context.
+    /// This method must be called from the loop thread before
+    /// a secondary event loop is closed with `uv::closeLoop()`.
+    void finalize(uv::Loop* loop);
+
     /// Returns the TID of the main garbage collector thread.
     std::thread::id tid();
 
@@ -0,0 +1,246 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_PacketPipeline_H
+#define SCY_PacketPipeline_H
+
+
+#include "scy/base.h"
+#include "scy/packetstream.h"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace scy {
+namespace internal {
+
+
+/// Statically linked chain of packet processors.
+///
+/// Each link owns one processor and a direct reference to the next link,
+/// so packets are handed from one processor to the next with a plain
+/// function call rather than a signal emission.
+template <class Sink, class... Ps>
+class PipelineLink;
+
+
+/// Terminal link which forwards packets to the pipeline output.
+template <class Sink>
+class PipelineLink<Sink>
+{
+public:
+    PipelineLink(Sink& sink)
+        : _sink(sink)
+    {
+    }
+
+    void process(IPacket& packet)
+    {
+        _sink.emitOutput(packet);
+    }
+
+    void onStreamStateChange(const PacketStreamState&)
+    {
+    }
+
+protected:
+    Sink& _sink;
+};
+
+
+template <class Sink, class P, class... Rest>
+class PipelineLink<Sink, P, Rest...>
+{
+public:
+    typedef PipelineLink<Sink, Rest...> Next;
+
+    /// Wraps the processor so that packets emitted with `emit()` are handed
+    /// directly to the next link. Packets emitted on the processor's signal
+    /// (ie. by encoders with internal callbacks) are forwarded as well.
+    class Stage final : public P
+    {
+    public:
+        template <class Tuple, std::size_t... I>
+        Stage(Next& next, Tuple&& args, std::index_sequence<I...>)
+            : P(std::get<I>(std::forward<Tuple>(args))...)
+            , _next(next)
+        {
+            P::getEmitter() += slot(this, &Stage::forward);
+        }
+
+        using P::emit;
+
+        virtual void emit(IPacket& packet) override
+        {
+            _next.process(packet);
+        }
+
+        void forward(IPacket& packet)
+        {
+            _next.process(packet);
+        }
+
+    protected:
+        Next& _next;
+    };
+
+    PipelineLink(Sink& sink)
+        : _next(sink)
+        , _stage(_next, std::tuple<>(), std::index_sequence<>())
+    {
+    }
+
+    template <class Tuple, class... Tuples>
+    PipelineLink(Sink& sink, Tuple&& args, Tuples&&... rest)
+        : _next(sink, std::forward<Tuples>(rest)...)
+        , _stage(_next, std::forward<Tuple>(args),
+                 std::make_index_sequence<std::tuple_size<std::decay_t<Tuple>>::value>())
+    {
+    }
+
+    void process(IPacket& packet)
+    {
+        // Packets which are rejected by the processor are passed
+        // through to the next link unmodified.
+        if (_stage.P::accepts(&packet))
+            _stage.P::process(packet);
+        else
+            _next.process(packet);
+    }
+
+    void onStreamStateChange(const PacketStreamState& state)
+    {
+        _stage.onStreamStateChange(state);
+        _next.onStreamStateChange(state);
+    }
+
+    P& get(std::integral_constant<std::size_t, 0>)
+    {
+        return _stage;
+    }
+
+    template <std::size_t I>
+    auto& get(std::integral_constant<std::size_t, I>)
+    {
+        return _next.get(std::integral_constant<std::size_t, I - 1>());
+    }
+
+protected:
+    Next _next;
+    Stage _stage;
+};
+
+
+} // namespace internal
+
+
+/// Statically typed chain of packet processors.
+///
+/// The processor chain is composed at compile time, so packets are passed
+/// between processors with direct (and inlinable) calls instead of the
+/// dynamic signal hops, mutex locking and state synchronization performed
+/// by the PacketStream for each attached processor. This suits fixed
+/// processing chains such as encode, packetize and send.
+///
+/// The pipeline is itself a PacketProcessor, so it can be attached to any
+/// existing PacketStream:
+///
+///     auto pipeline = makePipeline<Base64PacketEncoder, http::ChunkedAdapter>(
+///         std::make_tuple(), std::make_tuple("text/plain"));
+///     stream.attach(pipeline);
+///
+/// Processors are constructed from the given argument tuples, one tuple per
+/// processor, or default constructed if no arguments are given.
+template <class... Ps>
+class PacketPipeline : public PacketProcessor
+{
+public:
+    static_assert(sizeof...(Ps) > 0, "pipeline requires a processor");
+
+    typedef PacketPipeline<Ps...> Self;
+
+    PacketPipeline()
+        : PacketProcessor(this->emitter)
+        , _chain(*this)
+    {
+    }
+
+    template <class Tuple, class... Tuples>
+    explicit PacketPipeline(Tuple&& args, Tuples&&... rest)
+        : PacketProcessor(this->emitter)
+        , _chain(*this, std::forward<Tuple>(args), std::forward<Tuples>(rest)...)
+    {
+        static_assert(sizeof...(Tuples) + 1 == sizeof...(Ps),
+                      "one argument tuple is required per processor");
+    }
+
+    virtual ~PacketPipeline()
+    {
+    }
+
+    /// Process the packet through the processor chain.
+    virtual void process(IPacket& packet) override
+    {
+        _chain.process(packet);
+    }
+
+    /// Forward stream state changes to all processors.
+    virtual void onStreamStateChange(const PacketStreamState& state) override
+    {
+        _chain.onStreamStateChange(state);
+    }
+
+    /// Return the processor at the given index.
+    template <std::size_t I>
+    typename std::tuple_element<I, std::tuple<Ps...>>::type& get()
+    {
+        return _chain.get(std::integral_constant<std::size_t, I>());
+    }
+
+    /// Return the number of processors in the chain.
+    static constexpr std::size_t size()
+    {
+        return sizeof...(Ps);
+    }
+
+    /// Emit the final packet to the pipeline output.
+    void emitOutput(IPacket& packet)
+    {
+        emitter.emit(packet);
+    }
+
+    PacketSignal emitter;
+
+protected:
+    internal::PipelineLink<Self, Ps...> _chain;
+};
+
+
+/// Create a shared statically typed packet pipeline which can be attached
+/// to a PacketStream.
+template <class... Ps, class... Tuples>
+inline std::shared_ptr<PacketPipeline<Ps...>> makePipeline(Tuples&&... args)
+{
+    return std::make_shared<PacketPipeline<Ps...>>(std::forward<Tuples>(args)...);
+}
+
+
+} // namespace scy
+
+
+#endif // SCY_PacketPipeline_H
+
+
+/// @\}
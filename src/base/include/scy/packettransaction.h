@@ -18,7 +18,7 @@
 #include "scy/packet.h"
 #include "scy/memory.h"
 #include "scy/stateful.h"
-#include "scy/timer.h"
+#include "scy/timeoutscheduler.h"
 
 
 namespace scy {
@@ -58,6 +58,11 @@ struct TransactionState : public State
 ///
 /// PacketTransactions are fire and forget. The object will be deleted
 /// after a successful response or a timeout.
+///
+/// Request timeouts are scheduled on the shared per-loop TimeoutScheduler
+/// rather than a dedicated timer handle. When backoff is enabled the timeout
+/// is doubled for each retransmission as per RFC 5389 section 7.2.1.
+/// Backoff is disabled by default.
 template <class PacketT>
 class PacketTransaction : public basic::Sendable,
                           public Stateful<TransactionState>
@@ -65,9 +70,14 @@ class PacketTransaction : public basic::Sendable,
 public:
     PacketTransaction(long timeout = 10000, int retries = 0,
                       uv::Loop* loop = uv::defaultLoop())
-        : _timer(timeout, loop)
+        : _scheduler(TimeoutScheduler::get(loop))
+        , _timeoutID(0)
+        , _timeout(timeout)
+        , _rto(timeout)
         , _retries(retries)
         , _attempts(0)
+        , _maxRto(0)
+        , _backoff(false)
         , _destroyed(false)
     {
     }
@@ -75,9 +85,14 @@ public:
     PacketTransaction(const PacketT& request, long timeout = 10000,
                       int retries = 0, uv::Loop* loop = uv::defaultLoop())
         : _request(request)
-        , _timer(timeout, loop)
+        , _scheduler(TimeoutScheduler::get(loop))
+        , _timeoutID(0)
+        , _timeout(timeout)
+        , _rto(timeout)
         , _retries(retries)
         , _attempts(0)
+        , _maxRto(0)
+        , _backoff(false)
         , _destroyed(false)
     {
     }
@@ -89,15 +104,29 @@ public:
         if (!canResend())
             return false;
 
+        // Double the retransmission timeout for each
+        // retransmission if backoff is enabled.
         _attempts++;
-        if (_timer.active())
-            _timer.stop();
-        _timer.Timeout += slot(this, &PacketTransaction::onTimeout);
-        _timer.start();
+        _rto = (_backoff && _attempts > 1) ? _rto * 2 : _timeout;
+        if (_maxRto > 0 && _rto > _maxRto)
+            _rto = _maxRto;
+        _scheduler.cancel(_timeoutID);
+        _timeoutID = _scheduler.schedule(_rto, std::bind(&PacketTransaction::onTimeout, this));
 
         return setState(this, TransactionState::Running);
     }
 
+    /// Enable exponential retransmission backoff.
+    ///
+    /// The initial request waits for the transaction timeout, and each
+    /// retransmission waits twice as long as the previous one, up to
+    /// `maxRto` milliseconds if it is set.
+    void setBackoff(bool flag, long maxRto = 0)
+    {
+        _backoff = flag;
+        _maxRto = maxRto;
+    }
+
     /// Cancellation means that the agent will not retransmit
     /// the request, will not treat the lack of response to be
     /// a failure, but will wait the duration of the transaction
@@ -119,10 +148,9 @@ public:
 
         if (!_destroyed) {
             _destroyed = true;
-            _timer.Timeout -= slot(this, &PacketTransaction::onTimeout);
-            _timer.stop();
+            _scheduler.cancel(_timeoutID);
 
-            deleteLater<PacketTransaction>(this);
+            deleteLater<PacketTransaction>(this, _scheduler.loop());
         }
     }
 
@@ -130,6 +158,9 @@ public:
     int attempts() const;
     int retries() const;
 
+    /// Return the current retransmission timeout in milliseconds.
+    long rto() const;
+
     PacketT& request();
     PacketT request() const;
 
@@ -193,9 +224,14 @@ protected:
 
     PacketT _request;
     PacketT _response;
-    Timer _timer;  ///< The request timeout callback.
+    TimeoutScheduler& _scheduler;   ///< The shared request timeout scheduler.
+    TimeoutScheduler::ID _timeoutID; ///< The pending request timeout.
+    long _timeout; ///< The initial request timeout.
+    long _rto;     ///< The current retransmission timeout.
+    long _maxRto;  ///< The retransmission timeout cap, or 0 for none.
     int _retries;  ///< The maximum number of attempts before the transaction is considered failed.
     int _attempts; ///< The number of times the transaction has been sent.
+    bool _backoff; ///< Double the timeout for each retransmission.
     bool _destroyed;
 };
 
@@ -225,6 +261,11 @@ template <class T> inline int PacketTransaction<T>::retries() const
     return _retries;
 }
 
+template <class T> inline long PacketTransaction<T>::rto() const
+{
+    return _rto;
+}
+
 template <class T> inline T& PacketTransaction<T>::request()
 {
     return _request;
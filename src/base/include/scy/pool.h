@@ -0,0 +1,156 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#ifndef SCY_UV_Pool_H
+#define SCY_UV_Pool_H
+
+
+#include "scy/base.h"
+#include "scy/loop.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+
+namespace scy {
+namespace uv {
+
+
+/// Per-loop free-list pool for `libuv` request objects.
+///
+/// Requests such as `uv_write_t` and `uv_udp_send_t` are allocated on every
+/// send and freed in the completion callback. The pool recycles the request
+/// storage instead of returning it to the global allocator, so steady state
+/// sends do not allocate at all.
+///
+/// Each pooled object carries a pointer to its owning pool, so completion
+/// callbacks can recycle the request with the static `release()` method
+/// without any lookup.
+///
+/// The pool is not thread-safe and must only be used from the loop thread.
+/// All pooled requests must be completed before the owning loop is closed.
+template <typename T>
+class RequestPool
+{
+public:
+    RequestPool(uv::Loop* /* loop */ = uv::defaultLoop())
+    {
+    }
+
+    ~RequestPool()
+    {
+        while (_free) {
+            auto slot = _free;
+            _free = slot->next;
+            delete slot;
+        }
+    }
+
+    /// Return the pool bound to the given event loop.
+    static RequestPool& get(uv::Loop* loop)
+    {
+        return uv::loopLocal<RequestPool>(loop);
+    }
+
+    /// Construct a new object from pooled storage.
+    template <typename... Args>
+    T* acquire(Args&&... args)
+    {
+        Slot* slot = _free;
+        if (slot) {
+            _free = slot->next;
+            _idle--;
+            _hits++;
+        }
+        else {
+            slot = new Slot;
+            _misses++;
+        }
+        slot->pool = this;
+        slot->next = nullptr;
+        _active++;
+        return new (&slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    /// Destroy the given object and return its storage to the owning pool.
+    static void release(T* ptr)
+    {
+        assert(ptr);
+        ptr->~T();
+        auto slot = reinterpret_cast<Slot*>(
+            reinterpret_cast<char*>(ptr) - offsetof(Slot, storage));
+        slot->pool->recycle(slot);
+    }
+
+    /// Set the maximum number of idle objects retained for reuse.
+    void setMaxIdle(size_t max)
+    {
+        _maxIdle = max;
+    }
+
+    /// Return the number of acquisitions served from the free list.
+    uint64_t hits() const { return _hits; }
+
+    /// Return the number of acquisitions which required an allocation.
+    uint64_t misses() const { return _misses; }
+
+    /// Return the number of objects currently in use.
+    size_t active() const { return _active; }
+
+    /// Return the number of idle objects retained for reuse.
+    size_t idle() const { return _idle; }
+
+protected:
+    struct Slot
+    {
+        RequestPool* pool;
+        Slot* next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    void recycle(Slot* slot)
+    {
+        assert(_active > 0);
+        _active--;
+        if (_idle < _maxIdle) {
+            slot->next = _free;
+            _free = slot;
+            _idle++;
+        }
+        else {
+            delete slot;
+        }
+    }
+
+    RequestPool(const RequestPool&) = delete;
+    RequestPool& operator=(const RequestPool&) = delete;
+
+    Slot* _free{nullptr};
+    size_t _idle{0};
+    size_t _active{0};
+    size_t _maxIdle{1024};
+    uint64_t _hits{0};
+    uint64_t _misses{0};
+};
+
+
+} // namespace uv
+} // namespace scy
+
+
+#endif // SCY_UV_Pool_H
+
+
+/// @\}
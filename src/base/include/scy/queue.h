@@ -15,10 +15,13 @@
 
 #include "scy/base.h"
 #include "scy/datetime.h"
+#include "scy/executor.h"
 #include "scy/interface.h"
 #include "scy/platform.h"
 #include "scy/synchronizer.h"
 #include "scy/thread.h"
+#include <atomic>
+#include <memory>
 #include <queue>
 
 
@@ -246,9 +249,20 @@ protected:
 //
 
 
-/// SyncQueue extends Synchronizer to implement a synchronized FIFO
-/// queue which receives T objects from any thread and synchronizes
-/// them for safe consumption by the associated event loop.
+/// SyncQueue is a synchronized FIFO queue which receives T objects from
+/// any thread and dispatches them on the associated event loop.
+///
+/// Items are pushed onto a lock-free queue which is drained by a task
+/// posted to the loop's `uv::Executor`, so pushing never takes a lock and
+/// the queue does not own an async handle. At most one drain task is
+/// pending at a time, and each run dispatches items until the queue is
+/// empty or the timeout expires. When the limit is exceeded the oldest
+/// items are purged before dispatch.
+///
+/// The queue keeps the loop alive until it is cancelled.
+///
+/// The RunnableQueue base provides the dispatch interface and settings,
+/// but its own storage is unused.
 template <class T>
 class SyncQueue : public RunnableQueue<T>
 {
@@ -257,37 +271,236 @@ public:
 
     SyncQueue(uv::Loop* loop, int limit = 2048, int timeout = 20)
         : Queue(limit, timeout)
-        , _sync(std::bind(&SyncQueue::run, this), loop)
+        , _executor(uv::Executor::get(loop))
+        , _state(std::make_shared<State>(this))
+        , _referenced(true)
     {
+        _executor.ref();
     }
 
     /// Destruction is deferred to allow enough
     /// time for all callbacks to return.
     virtual ~SyncQueue()
     {
+        // Items still queued are freed with the state
+        // once any pending drain task has returned.
+        _state->queue.store(nullptr);
+        release();
     }
 
     /// Pushes an item onto the queue.
     /// Item pointers are now managed by the SyncQueue.
-    virtual void push(T* item)
+    virtual void push(T* item) override
     {
-        Queue::push(item);
-        _sync.post();
+        _state->items.push(new Node(item));
+        _state->size.fetch_add(1, std::memory_order_relaxed);
+        schedule();
     }
 
-    virtual void cancel()
+    /// Cancels the queue and releases the event loop.
+    /// Items which have not been dispatched yet are discarded.
+    virtual void cancel(bool flag = true) override
     {
-        Queue::cancel();
-        _sync.cancel(); // Call uv_close on the handle if calling from
-                        // the event loop thread or we deadlock.
-        if (_sync.tid() == Thread::currentID())
-            _sync.close();
+        Queue::cancel(flag);
+        if (flag) {
+            release();
+            schedule();
+            if (_sync && _executor.inLoopThread())
+                _sync->close();
+        }
+    }
+
+    /// Dispatches queued items until the queue is empty or the
+    /// timeout expires. Must be called from the event loop thread.
+    virtual void run() override
+    {
+        int timeout = Queue::timeout();
+        Stopwatch sw;
+        sw.start();
+        while (!Queue::cancelled() &&
+               (!timeout || sw.elapsedMilliseconds() < timeout) &&
+               dispatchNext())
+            ;
+    }
+
+    virtual void runTimeout() override
+    {
+        run();
+    }
+
+    /// Flush all outgoing items.
+    /// Must be called from the event loop thread.
+    virtual void flush() override
+    {
+        while (dispatchNext())
+            ;
+    }
+
+    /// Clear all queued items.
+    /// Must be called from the event loop thread.
+    void clear()
+    {
+        _state->clear();
     }
 
-    Synchronizer& sync() { return _sync; }
+    /// Return the approximate number of queued items.
+    size_t size() const
+    {
+        return _state->size.load(std::memory_order_relaxed);
+    }
+
+    /// Return true if no items are queued.
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    uv::Executor& executor() { return _executor; }
+
+    /// Return a Synchronizer which dispatches queued items when posted.
+    /// It is created on first use, which must be on the event loop thread.
+    /// @deprecated The queue no longer owns a Synchronizer, use executor()
+    Synchronizer& sync()
+    {
+        if (!_sync)
+            _sync.reset(new Synchronizer(
+                std::bind(&SyncQueue::run, this), _executor.loop()));
+        return *_sync;
+    }
 
 protected:
-    Synchronizer _sync;
+    SyncQueue(const SyncQueue&) = delete;
+    SyncQueue& operator=(const SyncQueue&) = delete;
+
+    struct Node
+    {
+        std::atomic<Node*> next;
+        T* item;
+
+        Node(T* item = nullptr)
+            : next(nullptr)
+            , item(item)
+        {
+        }
+    };
+
+    /// Queue state shared with the pending drain task.
+    struct State
+    {
+        uv::MPSCQueue<Node> items;
+        std::atomic<SyncQueue*> queue;
+        std::atomic<size_t> size;
+        std::atomic<bool> scheduled;
+
+        State(SyncQueue* queue)
+            : queue(queue)
+            , size(0)
+            , scheduled(false)
+        {
+        }
+
+        ~State()
+        {
+            clear();
+        }
+
+        T* pop()
+        {
+            Node* node = items.pop();
+            if (!node)
+                return nullptr;
+            size.fetch_sub(1, std::memory_order_relaxed);
+            T* item = node->item;
+            delete node;
+            return item;
+        }
+
+        void clear()
+        {
+            while (T* item = pop())
+                delete item;
+        }
+    };
+
+    /// Drain queued items from the event loop thread.
+    static void drain(const std::shared_ptr<State>& state)
+    {
+        state->scheduled.exchange(false, std::memory_order_acq_rel);
+
+        // The queue may be freed by the items it dispatches,
+        // so only access it through the shared state.
+        Stopwatch sw;
+        sw.start();
+        SyncQueue* queue;
+        int timeout = -1;
+        while ((queue = state->queue.load()) && !queue->cancelled()) {
+            if (timeout < 0)
+                timeout = queue->timeout();
+            if (timeout && sw.elapsedMilliseconds() >= timeout)
+                break;
+            T* next = queue->popNext();
+            if (!next)
+                break;
+            queue->dispatch(*next);
+            delete next;
+        }
+
+        if (!queue)
+            return;
+        if (queue->cancelled())
+            state->clear();
+        else if (!state->items.empty())
+            queue->schedule();
+    }
+
+    /// Post a drain task unless one is already pending.
+    void schedule()
+    {
+        if (!_state->scheduled.exchange(true, std::memory_order_acq_rel)) {
+            std::shared_ptr<State> state(_state);
+            _executor.post([state]() { drain(state); });
+        }
+    }
+
+    /// Release the event loop reference.
+    void release()
+    {
+        if (_referenced.exchange(false))
+            _executor.unref();
+    }
+
+    /// Pops the next waiting item, purging
+    /// the oldest items if the limit is exceeded.
+    virtual T* popNext() override
+    {
+        int limit = Queue::_limit;
+        while (limit > 0 && _state->size.load(std::memory_order_relaxed) >
+                                static_cast<size_t>(limit)) {
+            LWarn("Purging: ", size())
+            T* item = _state->pop();
+            if (!item)
+                break;
+            delete item;
+        }
+        return _state->pop();
+    }
+
+    /// Pops and dispatches the next waiting item.
+    virtual bool dispatchNext() override
+    {
+        T* next = popNext();
+        if (next) {
+            this->dispatch(*next);
+            delete next;
+            return true;
+        }
+        return false;
+    }
+
+    uv::Executor& _executor;
+    std::shared_ptr<State> _state;
+    std::atomic<bool> _referenced;
+    std::unique_ptr<Synchronizer> _sync;
 };
 
 
@@ -15,6 +15,7 @@
 
 #include "scy/base.h"
 #include "scy/loop.h"
+#include "scy/pool.h"
 #include "scy/util.h"
 
 #include "uv.h"
@@ -51,17 +52,30 @@ struct Request
     T req;
     std::function<void(const E&)> callback;
 
+    /// Frees the request once complete.
+    /// Requests created with `createRequest()` are returned to the loop's
+    /// request pool, otherwise the request is deleted.
+    void (*deleter)(Request*) = nullptr;
+
     Request()
     {
         req.data = this;
     }
 
+    static void destroy(Request* wrap)
+    {
+        if (wrap->deleter)
+            wrap->deleter(wrap);
+        else
+            delete wrap;
+    }
+
     static void defaultCallback(T* req, int status)
     {
         auto wrap = static_cast<Request*>(req->data);
         if (wrap->callback)
             wrap->callback(E{status});
-        delete wrap;
+        destroy(wrap);
     }
 
     template<typename F, typename... Args>
@@ -69,7 +83,12 @@ struct Request
     -> std::enable_if_t<!std::is_void<std::result_of_t<F(Args...)>>::value, int>
     {
         auto err = std::forward<F>(f)(std::forward<Args>(args)...);
-        if (err && callback) callback(E{err});
+        if (err) {
+            // The completion callback will never be called,
+            // so the request is freed here.
+            if (callback) callback(E{err});
+            destroy(this);
+        }
         return !err;
     }
 
@@ -83,15 +102,33 @@ struct Request
 
 
 /// Generic helper for instantiating requests.
+///
+/// The request is constructed from the given loop's request pool and
+/// recycled once complete. The pool is not thread-safe, so the loop
+/// must be the one the request will run on.
 template<typename T>
-inline T& createRequest(std::function<void(const typename T::Event&)> callback)
+inline T& createRequest(std::function<void(const typename T::Event&)> callback,
+                        uv::Loop* loop)
 {
-    auto req = new T();
+    auto req = RequestPool<T>::get(loop).acquire();
     req->callback = callback;
+    req->deleter = [](typename T::Request* wrap) {
+        RequestPool<T>::release(static_cast<T*>(wrap));
+    };
     return *req;
 }
 
 
+/// Instantiate a request from the default loop's request pool.
+///
+/// This overload must only be called from the default loop thread.
+template<typename T>
+inline T& createRequest(std::function<void(const typename T::Event&)> callback)
+{
+    return createRequest<T>(callback, uv::defaultLoop());
+}
+
+
 /// Stream connection request for sockets and pipes.
 struct ConnectReq : public uv::Request<uv_connect_t>
 {
@@ -136,7 +173,7 @@ struct GetAddrInfoReq : public uv::Request<uv_getaddrinfo_t, GetAddrInfoEvent>
         if (wrap->callback)
             wrap->callback(GetAddrInfoEvent{status, res});
         uv_freeaddrinfo(res);
-        delete wrap;
+        destroy(wrap);
     }
 
     auto resolve(const std::string& host, int port, uv::Loop* loop = uv::defaultLoop())
@@ -88,12 +88,17 @@ public:
         std::atomic<bool> cancelled;
         bool repeating = false;
 
+        // Time of the earliest unhandled post request (uv_hrtime),
+        // used for measuring dispatch latency when metrics are enabled.
+        std::atomic<uint64_t> posted;
+
         // The implementation is responsible for resetting
         // the context if it is to be reused.
         void reset()
         {
             running = false;
             cancelled = false;
+            posted = 0;
         }
 
         Context()
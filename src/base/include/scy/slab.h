@@ -0,0 +1,91 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#ifndef SCY_UV_Slab_H
+#define SCY_UV_Slab_H
+
+
+#include "scy/base.h"
+#include "scy/buffer.h"
+#include "scy/loop.h"
+
+#include "uv.h"
+
+#include <vector>
+
+
+namespace scy {
+namespace uv {
+
+
+/// Default size of the read buffers lent to streams and UDP sockets.
+const size_t DEFAULT_READ_BUFFER_SIZE = 65536;
+
+
+/// Per-loop slab of read buffers.
+///
+/// Streams and UDP sockets borrow a buffer from the slab only while a read
+/// callback is in flight, and return it once the callback completes, so idle
+/// connections do not pin any read memory. Receivers which need to retain the
+/// data beyond the callback scope may take ownership of the borrowed buffer
+/// with `take()`, in which case it is not returned to the slab.
+///
+/// The slab is not thread-safe and must only be used from the loop thread.
+class Base_API BufferSlab
+{
+public:
+    BufferSlab(uv::Loop* loop = uv::defaultLoop());
+    ~BufferSlab();
+
+    /// Return the slab bound to the given event loop.
+    static BufferSlab& get(uv::Loop* loop = uv::defaultLoop());
+
+    /// Lend a buffer of `size` bytes to libuv for an in-flight read.
+    void lend(size_t size, uv_buf_t* buf);
+
+    /// Return the lent buffer containing `data` to the slab.
+    /// This method has no effect if ownership of the buffer has been taken.
+    void reclaim(const char* data);
+
+    /// Take ownership of `len` bytes starting at `data`.
+    ///
+    /// If `data` points to the start of a lent buffer the buffer is moved
+    /// out of the slab without copying. Otherwise the given range is copied,
+    /// and a lent buffer containing it is returned to the slab.
+    Buffer take(const char* data, size_t len);
+
+    /// Set the maximum number of idle buffers retained for reuse.
+    void setMaxIdle(size_t max);
+
+    /// Return the number of buffers currently lent out.
+    size_t lent() const;
+
+    /// Return the number of idle buffers retained for reuse.
+    size_t idle() const;
+
+protected:
+    BufferSlab(const BufferSlab&) = delete;
+    BufferSlab& operator=(const BufferSlab&) = delete;
+
+    std::vector<Buffer> _lent;
+    std::vector<Buffer> _idle;
+    size_t _maxIdle;
+};
+
+
+} // namespace uv
+} // namespace scy
+
+
+#endif // SCY_UV_Slab_H
+
+
+/// @\}
@@ -17,8 +17,11 @@
 #include "scy/handle.h"
 #include "scy/request.h"
 #include "scy/buffer.h"
+#include "scy/slab.h"
+#include "scy/pool.h"
 #include "scy/signal.h"
 #include "scy/logger.h"
+#include "scy/loopmetrics.h"
 
 #include <stdexcept>
 
@@ -35,7 +38,8 @@ public:
 
     Stream(uv::Loop* loop = uv::defaultLoop())
         : uv::Handle<T>(loop)
-        , _buffer(65536)
+        , _slab(&uv::BufferSlab::get(loop))
+        , _writeReqs(&uv::RequestPool<uv_write_t>::get(loop))
     {
     }
 
@@ -67,10 +71,13 @@ public:
         // XXX: Sending shutdown causes an eof error to be returned via
         // handleRead() which sets the stream to error state. This is not
         // really an error, perhaps it should be handled differently?
-        return uv_shutdown(new uv_shutdown_t, stream(),
-            [](uv_shutdown_t* req, int) {
-                delete req;
-            }) == 0;
+        auto req = uv::RequestPool<uv_shutdown_t>::get(Handle::loop()).acquire();
+        if (uv_shutdown(req, stream(), [](uv_shutdown_t* req, int) {
+                uv::RequestPool<uv_shutdown_t>::release(req);
+            }) == 0)
+            return true;
+        uv::RequestPool<uv_shutdown_t>::release(req);
+        return false;
     }
 
     /// Writes data to the stream.
@@ -84,10 +91,14 @@ public:
 
         assert(_started);
 
+        auto req = _writeReqs->acquire();
         auto buf = uv_buf_init((char*)data, (int)len);
-        return Handle::invoke(&uv_write, new uv_write_t, stream(), &buf, 1, [](uv_write_t* req, int) {
-            delete req;
-        });
+        if (Handle::invoke(&uv_write, req, stream(), &buf, 1, [](uv_write_t* req, int) {
+                uv::RequestPool<uv_write_t>::release(req);
+            }))
+            return true;
+        uv::RequestPool<uv_write_t>::release(req);
+        return false;
     }
 
     /// Write data to the target stream.
@@ -101,10 +112,39 @@ public:
         assert(_started);
         assert(stream()->type == UV_NAMED_PIPE && this->template get<uv_pipe_t>()->ipc);
 
+        auto req = _writeReqs->acquire();
         auto buf = uv_buf_init((char*)data, (int)len);
-        return Handle::invoke(&uv_write2, new uv_write_t, stream(), &buf, 1, send, [](uv_write_t* req, int) {
-            delete req;
-        });
+        if (Handle::invoke(&uv_write2, req, stream(), &buf, 1, send, [](uv_write_t* req, int) {
+                uv::RequestPool<uv_write_t>::release(req);
+            }))
+            return true;
+        uv::RequestPool<uv_write_t>::release(req);
+        return false;
+    }
+
+    /// Set the size of the read buffer which is borrowed from the loop's
+    /// buffer slab for each read.
+    void setReadBufferSize(size_t size)
+    {
+        assert(size > 0);
+        _readBufferSize = size;
+    }
+
+    /// Return the size of the read buffer.
+    size_t readBufferSize() const
+    {
+        return _readBufferSize;
+    }
+
+    /// Take ownership of the current read buffer.
+    ///
+    /// The read buffer is only borrowed for the duration of the read
+    /// callback, so this method must be called from inside the `Read` signal
+    /// or `onRead()` if the data is to be retained without copying.
+    Buffer takeReadBuffer()
+    {
+        assert(_reading);
+        return _slab->take(_reading, _readLength);
     }
 
     /// Return the uv_stream_t pointer.
@@ -153,10 +193,18 @@ protected:
     {
         // LTrace("Handle read: ", nread)
         auto self = reinterpret_cast<Stream*>(handle->data);
+
+        // Keep a reference to the slab and handle context since the
+        // stream may be destroyed inside the read callback.
+        auto slab = self->_slab;
+        auto context = self->context();
+        uv::CallbackTimer timing(handle->loop, handle->type);
 #ifdef SCY_EXCEPTION_RECOVERY
         try {
 #endif
             if (nread >= 0) {
+                self->_reading = buf->base;
+                self->_readLength = nread;
                 self->onRead(buf->base, nread);
             }
             else {
@@ -171,21 +219,23 @@ protected:
             self->setUVError(UV_UNKNOWN, exc.what());
         }
 #endif
+        if (context && !context->deleted)
+            self->_reading = nullptr;
+        slab->reclaim(buf->base);
     }
 
-    static void allocReadBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf)
+    static void allocReadBuffer(uv_handle_t* handle, size_t /* suggested_size */, uv_buf_t* buf)
     {
-        auto& buffer = reinterpret_cast<Stream*>(handle->data)->_buffer;
-        assert(buffer.size() >= suggested_size);
-        // if (suggested_size > buffer.capacity())
-        //     buffer.capacity(suggested_size);
-
-        buf->base = buffer.data();
-        buf->len = buffer.size();
+        auto self = reinterpret_cast<Stream*>(handle->data);
+        self->_slab->lend(self->_readBufferSize, buf);
     }
 
 protected:
-    Buffer _buffer;
+    uv::BufferSlab* _slab;
+    uv::RequestPool<uv_write_t>* _writeReqs;
+    size_t _readBufferSize{uv::DEFAULT_READ_BUFFER_SIZE};
+    const char* _reading{nullptr};
+    size_t _readLength{0};
     bool _started{false};
 };
 
@@ -18,6 +18,7 @@
 #include "scy/logger.h"
 #include "scy/platform.h"
 #include "scy/handle.h"
+#include "scy/loopmetrics.h"
 
 #include <deque>
 
@@ -87,6 +88,12 @@ public:
         _handle.init(&uv_async_init, [](uv_async_t* req) {
             auto wrap = reinterpret_cast<Callback*>(req->data);
             if (!wrap->ctx->cancelled) {
+                uv::CallbackTimer timing(req->loop, UV_ASYNC);
+                uint64_t posted = wrap->ctx->posted.exchange(0);
+                if (posted) {
+                    if (auto metrics = uv::LoopMetrics::find(req->loop))
+                        metrics->recordSyncLatency(uv_hrtime() - posted);
+                }
                 wrap->invoke();
             }
             else {
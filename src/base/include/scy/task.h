@@ -16,7 +16,11 @@
 #include "scy/base.h"
 #include "scy/runner.h"
 #include "scy/signal.h"
-#include "scy/task.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 
 namespace scy {
@@ -72,10 +76,11 @@ protected:
 
     /// Tasks belong to a TaskRunner instance.
     friend class TaskRunner;
+    friend class TaskPool;
 
     uint32_t _id;
     bool _repeating;
-    bool _destroyed;
+    std::atomic<bool> _destroyed;
 };
 
 
@@ -87,6 +92,8 @@ protected:
 /// The `TaskRunner` is powered by an abstract `Runner` instance, which means
 /// that tasks can be executed in a thread or event loop context.
 ///
+/// Use a `TaskPool` to run tasks across multiple threads without polling.
+///
 class Base_API TaskRunner : public basic::Runnable
 {
 public:
@@ -132,6 +139,12 @@ public:
     virtual const char* className() const { return "TaskRunner"; }
 
 protected:
+    /// Tag for runners which manage their own threads.
+    struct Unpowered {};
+
+    /// Create a runner without an asynchronous context.
+    TaskRunner(Unpowered);
+
     /// Called by the async context to run the next task.
     virtual void run();
 
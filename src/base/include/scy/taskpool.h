@@ -0,0 +1,143 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_TaskPool_H
+#define SCY_TaskPool_H
+
+
+#include "scy/base.h"
+#include "scy/task.h"
+#include "scy/thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace scy {
+
+
+/// Work-stealing thread pool runner for tasks that inherit the `Task`
+/// interface.
+///
+/// Each worker thread owns a deque of runnable tasks. Workers run tasks
+/// from the front of their own deque and steal from the back of other
+/// workers' deques when their own is empty, and park on a condition
+/// variable when there is no work at all. Starting a task wakes a parked
+/// worker, so tasks are run as soon as a thread is free rather than on
+/// the next polling interval.
+///
+/// Repeating tasks are re-queued on the worker which ran them as soon as
+/// they return, and a task is never run by more than one thread at a time.
+/// Cancelled tasks are dropped from the deques and remain managed until
+/// they are destroyed.
+///
+/// Repeating tasks which poll for work should block or sleep in run(),
+/// since the pool does not throttle them. The pool keeps the `TaskRunner`
+/// interface, but owns its threads so setRunner() is not supported.
+///
+/// The pool can stand in for a plain TaskRunner. Runners which derive
+/// from TaskRunner to implement their own run loop, such as
+/// `sched::Scheduler` which runs tasks at their trigger deadlines,
+/// can't be switched over to the pool.
+class Base_API TaskPool : public TaskRunner
+{
+public:
+    /// Create a pool with the given number of worker threads,
+    /// or one per hardware thread if zero.
+    TaskPool(size_t numThreads = 0);
+    virtual ~TaskPool();
+
+    /// Starts a task, adding it if it doesn't exist.
+    virtual bool start(Task* task) override;
+
+    /// Queues a task for destruction.
+    /// Idle tasks are deleted immediately, and running
+    /// tasks once their current iteration returns.
+    virtual bool destroy(Task* task) override;
+
+    /// Returns weather or not a task exists.
+    virtual bool exists(Task* task) const override;
+
+    /// Returns the task pointer matching the given ID,
+    /// or nullptr if no task exists.
+    virtual Task* get(uint32_t id) const override;
+
+    /// Not supported, since the pool owns its threads.
+    virtual void setRunner(std::shared_ptr<Runner> runner) override;
+
+    /// Stops the worker threads and destroys all managed tasks.
+    virtual void shutdown();
+
+    /// Returns the number of worker threads.
+    size_t size() const;
+
+    virtual const char* className() const override { return "TaskPool"; }
+
+protected:
+    /// Scheduling state of a managed task.
+    enum class State
+    {
+        Idle,    ///< not queued or running
+        Queued,  ///< waiting in a worker deque
+        Running  ///< being run by a worker
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+        std::unique_ptr<Thread> thread;
+    };
+
+    /// Runs tasks until the pool is shut down.
+    void work(size_t index);
+
+    /// Pops a task from the given worker or steals one from another.
+    Task* take(size_t index);
+
+    /// Pushes a task onto a worker deque and wakes a parked worker.
+    /// Tasks are queued on the current worker when called from a
+    /// worker thread, otherwise the workers are used in turn.
+    void submit(Task* task);
+
+    /// Runs a single iteration of a task.
+    void runTask(Task* task);
+
+    virtual bool add(Task* task) override;
+    virtual bool remove(Task* task) override;
+
+    /// Destroys all managed tasks.
+    /// Must only be called once the workers have stopped.
+    virtual void clear() override;
+
+    std::unordered_map<Task*, State> _states;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::mutex _parkMutex;
+    std::condition_variable _parked;
+    std::atomic<size_t> _queued;
+    std::atomic<size_t> _idle;
+    std::atomic<size_t> _next;
+    std::atomic<bool> _stopping;
+};
+
+
+} // namespace scy
+
+
+#endif // SCY_TaskPool_H
+
+
+/// @\}
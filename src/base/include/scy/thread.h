@@ -70,6 +70,14 @@ public:
     /// Wait until the thread exits.
     void join();
 
+    /// Let the thread run on without a handle, so that it can be
+    /// released from its own context.
+    void detach();
+
+    /// Return true if the thread has been started and is not
+    /// yet joined or detached.
+    bool joinable() const;
+
     /// Return the native thread handle.
     std::thread::id id() const;
 
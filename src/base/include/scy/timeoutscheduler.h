@@ -0,0 +1,100 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_TimeoutScheduler_H
+#define SCY_TimeoutScheduler_H
+
+
+#include "scy/base.h"
+#include "scy/loop.h"
+#include "scy/timer.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+namespace scy {
+
+
+/// Per-loop scheduler which multiplexes any number of one-shot timeouts
+/// onto a single timer handle.
+///
+/// Pending deadlines are kept in a min-heap, and the timer is armed for the
+/// earliest one only. Cancelling a timeout is O(1): the callback is released
+/// immediately and the stale heap entry is skipped when it surfaces.
+///
+/// This is used by `PacketTransaction` so that protocols with thousands of
+/// requests in flight (ie. STUN/TURN) do not need to create and close a
+/// `libuv` timer handle per request.
+///
+/// The scheduler is not thread-safe and must only be used from the loop
+/// thread.
+class Base_API TimeoutScheduler
+{
+public:
+    typedef uint64_t ID;
+    typedef std::function<void()> Callback;
+
+    TimeoutScheduler(uv::Loop* loop = uv::defaultLoop());
+    ~TimeoutScheduler();
+
+    /// Return the scheduler bound to the given event loop.
+    static TimeoutScheduler& get(uv::Loop* loop = uv::defaultLoop());
+
+    /// Schedule the callback to be called once after `timeout` milliseconds.
+    /// Returns the timeout ID which can be used for cancellation.
+    ID schedule(std::int64_t timeout, Callback callback);
+
+    /// Cancel a pending timeout.
+    /// Returns false if the timeout has already expired or been cancelled.
+    bool cancel(ID id);
+
+    /// Return true if the given timeout is pending.
+    bool pending(ID id) const;
+
+    /// Return the number of pending timeouts.
+    size_t size() const;
+
+    /// Return the loop this scheduler is bound to.
+    uv::Loop* loop() const;
+
+protected:
+    TimeoutScheduler(const TimeoutScheduler&) = delete;
+    TimeoutScheduler& operator=(const TimeoutScheduler&) = delete;
+
+    struct Entry
+    {
+        std::uint64_t deadline;
+        ID id;
+    };
+
+    void onTimeout();
+    void arm();
+    void compact();
+
+    uv::Loop* _loop;
+    Timer _timer;
+    std::vector<Entry> _heap;
+    std::unordered_map<ID, Callback> _callbacks;
+    std::uint64_t _armed;
+    ID _nextID;
+};
+
+
+} // namespace scy
+
+
+#endif // SCY_TimeoutScheduler_H
+
+
+/// @\}
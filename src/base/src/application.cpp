@@ -78,6 +78,11 @@ void Application::finalize()
 
     // Run until handles are closed
     run();
+
+    // Release the loop-local pools now that all requests have completed,
+    // and run again to close any handles they own
+    uv::internal::clearLoopLocals(loop);
+    run();
     assert(loop->active_handles == 0);
     //assert(loop->active_reqs == 0);
 
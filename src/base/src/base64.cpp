@@ -14,9 +14,309 @@
 
 #include "scy/base64.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCY_BASE64_X86
+#include <immintrin.h>
+#endif
+
 
 namespace scy {
 namespace base64 {
+
+
+namespace {
+
+
+const char kEncoding[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/// Maps each character to its 6 bit value, or -1 if it is
+/// not part of the alphabet.
+struct DecodeTable
+{
+    signed char values[256];
+
+    DecodeTable()
+    {
+        std::memset(values, -1, sizeof(values));
+        for (int i = 0; i < 64; i++)
+            values[static_cast<unsigned char>(kEncoding[i])] = static_cast<signed char>(i);
+    }
+};
+
+const DecodeTable& decodeTable()
+{
+    static const DecodeTable table;
+    return table;
+}
+
+
+//
+// Scalar Kernels
+//
+
+
+/// Encodes whole groups of 3 bytes into 4 characters.
+void encodeGroupsScalar(const uint8_t* in, size_t groups, char* out)
+{
+    for (size_t i = 0; i < groups; i++, in += 3, out += 4) {
+        uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+        out[0] = kEncoding[(v >> 18) & 0x3f];
+        out[1] = kEncoding[(v >> 12) & 0x3f];
+        out[2] = kEncoding[(v >> 6) & 0x3f];
+        out[3] = kEncoding[v & 0x3f];
+    }
+}
+
+
+#ifdef SCY_BASE64_X86
+
+
+//
+// SSSE3 Kernels
+//
+// The encoder and decoder follow Wojciech Mula's vectorized Base64
+// algorithms: bytes are shuffled into place and split into 6 bit
+// values with multiplies, then translated to and from ASCII with
+// range dependent offsets looked up by PSHUFB.
+//
+
+
+__attribute__((target("ssse3")))
+inline __m128i encodeReshuffle(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                            7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+
+__attribute__((target("ssse3")))
+inline __m128i encodeTranslate(__m128i in)
+{
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    indices = _mm_sub_epi8(indices, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+
+/// Encodes 12 bytes per iteration. Each load reads 16 bytes,
+/// so the last few groups are left to the scalar kernel.
+__attribute__((target("ssse3")))
+size_t encodeGroupsSSSE3(const uint8_t* in, size_t groups, char* out)
+{
+    size_t done = 0;
+    for (; groups - done >= 6; done += 4, in += 12, out += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        v = encodeTranslate(encodeReshuffle(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+    }
+    return done;
+}
+
+
+/// Decodes 16 characters into 12 bytes per iteration, stopping at
+/// the first block which contains a character outside the alphabet.
+/// Each store writes 16 bytes, which the callers allow for.
+__attribute__((target("ssse3")))
+size_t decodeBlocksSSSE3(const char* in, size_t len, char* out, size_t& consumed)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2f);
+
+    size_t written = 0;
+    consumed = 0;
+    for (; len - consumed >= 32; consumed += 16, written += 12) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed));
+        const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+        const __m128i loNibbles = _mm_and_si128(str, mask2F);
+        const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
+            break;
+
+        const __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+        str = _mm_add_epi8(str, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles)));
+
+        // Pack four 6 bit values into each 24 bit group
+        const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        __m128i v = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                              8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), v);
+    }
+    return written;
+}
+
+
+//
+// AVX2 Kernels
+//
+// The same algorithms applied to both 128 bit lanes at once.
+//
+
+
+__attribute__((target("avx2")))
+size_t encodeGroupsAVX2(const uint8_t* in, size_t groups, char* out)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    // Each load reads 28 bytes to consume 24
+    size_t done = 0;
+    for (; groups - done >= 10; done += 8, in += 24, out += 32) {
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+
+        __m256i indices = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, indices));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+size_t decodeBlocksAVX2(const char* in, size_t len, char* out, size_t& consumed)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask2F = _mm256_set1_epi8(0x2f);
+
+    size_t written = 0;
+    consumed = 0;
+    for (; len - consumed >= 64; consumed += 32, written += 24) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + consumed));
+        const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+        const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+        const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())))
+            break;
+
+        const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+        str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles)));
+
+        const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i v = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, pack);
+
+        // Join the 12 bytes from each lane
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + written), v);
+    }
+    return written;
+}
+
+
+#endif // SCY_BASE64_X86
+
+
+//
+// Dispatch
+//
+
+
+enum class Kernel
+{
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+
+Kernel selectKernel()
+{
+#ifdef SCY_BASE64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Kernel::AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return Kernel::SSSE3;
+#endif
+    return Kernel::Scalar;
+}
+
+
+Kernel kernel()
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+
+
+/// Encodes whole groups using the best kernel for this CPU.
+void encodeGroups(const uint8_t* in, size_t groups, char* out)
+{
+    size_t done = 0;
+#ifdef SCY_BASE64_X86
+    const Kernel k = kernel();
+    if (k == Kernel::AVX2)
+        done = encodeGroupsAVX2(in, groups, out);
+    if (k != Kernel::Scalar)
+        done += encodeGroupsSSSE3(in + done * 3, groups - done, out + done * 4);
+#endif
+    encodeGroupsScalar(in + done * 3, groups - done, out + done * 4);
+}
+
+
+/// Decodes as many whole blocks as possible starting on a group
+/// boundary, and returns the number of bytes written.
+size_t decodeBlocks(const char* in, size_t len, char* out, size_t& consumed)
+{
+    consumed = 0;
+    size_t written = 0;
+#ifdef SCY_BASE64_X86
+    const Kernel k = kernel();
+    if (k == Kernel::AVX2)
+        written = decodeBlocksAVX2(in, len, out, consumed);
+    if (k != Kernel::Scalar) {
+        size_t n;
+        written += decodeBlocksSSSE3(in + consumed, len - consumed, out + written, n);
+        consumed += n;
+    }
+#endif
+    return written;
+}
+
+
+} // namespace
+
+
 namespace internal {
 
 
@@ -44,7 +344,12 @@ char encode_value(char value_in)
 }
 
 
-ssize_t encode_block(const char* plaintext_in, size_t length_in, char* code_out, encodestate* state_in)
+namespace {
+
+
+/// The libb64 state machine, used for the bytes either side
+/// of the whole groups.
+ssize_t encodeScalar(const char* plaintext_in, size_t length_in, char* code_out, encodestate* state_in)
 {
     const char* plainchar = plaintext_in;
     const char* const plaintextend = plaintext_in + length_in;
@@ -103,6 +408,49 @@ ssize_t encode_block(const char* plaintext_in, size_t length_in, char* code_out,
 }
 
 
+} // namespace
+
+
+ssize_t encode_block(const char* plaintext_in, size_t length_in, char* code_out, encodestate* state_in)
+{
+    const char* plainchar = plaintext_in;
+    const char* const plaintextend = plaintext_in + length_in;
+    char* codechar = code_out;
+
+    // Complete the group left over from the previous call
+    if (state_in->step != step_A) {
+        size_t n = std::min<size_t>(3 - state_in->step, length_in);
+        codechar += encodeScalar(plainchar, n, codechar, state_in);
+        plainchar += n;
+    }
+
+    // Encode whole groups a line at a time
+    if (state_in->step == step_A) {
+        size_t groups = (plaintextend - plainchar) / 3;
+        int perLine = state_in->linelength > 0 ? state_in->linelength / 4 : 0;
+        while (groups > 0) {
+            size_t n = groups;
+            bool feed = perLine > 0 && state_in->stepcount < perLine;
+            if (feed)
+                n = std::min<size_t>(n, perLine - state_in->stepcount);
+            encodeGroups(reinterpret_cast<const uint8_t*>(plainchar), n, codechar);
+            plainchar += n * 3;
+            codechar += n * 4;
+            groups -= n;
+            if (state_in->linelength)
+                state_in->stepcount += static_cast<int>(n);
+            if (feed && state_in->stepcount == perLine) {
+                *codechar++ = '\n';
+                state_in->stepcount = 0;
+            }
+        }
+    }
+
+    codechar += encodeScalar(plainchar, plaintextend - plainchar, codechar, state_in);
+    return codechar - code_out;
+}
+
+
 ssize_t encode_blockend(char* code_out, encodestate* state_in)
 {
     char* codechar = code_out;
@@ -157,65 +505,93 @@ void init_decodestate(decodestate* state_in)
 
 ssize_t decode_block(const char* code_in, const size_t length_in, char* plaintext_out, decodestate* state_in)
 {
+    const signed char* values = decodeTable().values;
     const char* codechar = code_in;
+    const char* const codeend = code_in + length_in;
     char* plainchar = plaintext_out;
-    char fragment;
-
-    *plainchar = state_in->plainchar;
+    int step = state_in->step;
+    char partial = state_in->plainchar;
+
+    while (codechar < codeend) {
+        // Decode whole blocks while on a group boundary, falling back
+        // to the state machine for line feeds, padding and the tail
+        if (step == step_a) {
+            size_t consumed;
+            plainchar += decodeBlocks(codechar, codeend - codechar, plainchar, consumed);
+            codechar += consumed;
+            if (codechar == codeend)
+                break;
+        }
 
-    switch (state_in->step) {
-        while (1) {
+        signed char fragment = values[static_cast<unsigned char>(*codechar++)];
+        if (fragment < 0)
+            continue;
+        switch (step) {
             case step_a:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_a;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
-                *plainchar = (fragment & 0x03f) << 2;
+                partial = static_cast<char>(fragment << 2);
+                step = step_b;
+                break;
             case step_b:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_b;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
-                *plainchar++ |= (fragment & 0x030) >> 4;
-                *plainchar = (fragment & 0x00f) << 4;
+                *plainchar++ = static_cast<char>(partial | (fragment >> 4));
+                partial = static_cast<char>((fragment & 0x00f) << 4);
+                step = step_c;
+                break;
             case step_c:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_c;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
-                *plainchar++ |= (fragment & 0x03c) >> 2;
-                *plainchar = (fragment & 0x003) << 6;
+                *plainchar++ = static_cast<char>(partial | (fragment >> 2));
+                partial = static_cast<char>((fragment & 0x003) << 6);
+                step = step_d;
+                break;
             case step_d:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_d;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
-                *plainchar++ |= (fragment & 0x03f);
+                *plainchar++ = static_cast<char>(partial | fragment);
+                step = step_a;
+                break;
         }
     }
 
-    // control should not reach here
+    state_in->step = static_cast<decodestep>(step);
+    state_in->plainchar = partial;
     return plainchar - plaintext_out;
 }
 
 
 } // namespace internal
+
+
+size_t encodedSize(size_t len, int lineLength)
+{
+    size_t size = (len + 2) / 3 * 4;
+    if (lineLength >= 4)
+        size += len / 3 / (lineLength / 4);
+    return size;
+}
+
+
+size_t encode(const char* in, size_t len, char* out, int lineLength)
+{
+    internal::encodestate state;
+    internal::init_encodestate(&state);
+    state.linelength = lineLength;
+
+    ssize_t enclen = internal::encode_block(in, len, out, &state);
+    enclen += internal::encode_blockend(out + enclen, &state);
+    return enclen;
+}
+
+
+size_t decodedSize(size_t len)
+{
+    return len / 4 * 3 + (len % 4) * 3 / 4;
+}
+
+
+size_t decode(const char* in, size_t len, char* out)
+{
+    internal::decodestate state;
+    internal::init_decodestate(&state);
+    return internal::decode_block(in, len, out, &state);
+}
+
+
 } // namespace base64
 } // namespace scy
 
@@ -0,0 +1,182 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/executor.h"
+#include "scy/loopmetrics.h"
+
+
+namespace scy {
+namespace uv {
+
+
+Executor::Executor(uv::Loop* loop)
+    : _loop(loop)
+    , _handle(loop)
+    , _prepare(loop)
+    , _async(nullptr)
+    , _pending(false)
+    , _posted(0)
+    , _tid(std::thread::id())
+    , _refs(0)
+{
+    _handle.get()->data = this;
+    _handle.init(&uv_async_init, [](uv_async_t* req) {
+        if (req->data)
+            reinterpret_cast<Executor*>(req->data)->run();
+    });
+    _handle.throwLastError("Cannot initialize async");
+
+    // Producers must not touch the handle wrapper from other threads
+    _async = _handle.get();
+    _handle.unref();
+
+    // Bind the loop thread once the loop runs, since the executor
+    // may be created by another thread before the loop is started.
+    _prepare.get()->data = this;
+    _prepare.init(&uv_prepare_init);
+    _prepare.invoke(&uv_prepare_start, _prepare.get(), [](uv_prepare_t* req) {
+        uv_prepare_stop(req);
+        if (req->data)
+            reinterpret_cast<Executor*>(req->data)->bind();
+    });
+    _prepare.throwLastError("Cannot initialize prepare");
+    _prepare.unref();
+}
+
+
+Executor::~Executor()
+{
+    discard();
+    if (_handle.initialized())
+        _handle.get()->data = nullptr;
+    if (_prepare.initialized())
+        _prepare.get()->data = nullptr;
+    _handle.close();
+    _prepare.close();
+}
+
+
+Executor& Executor::get(uv::Loop* loop)
+{
+    return uv::loopLocal<Executor>(loop);
+}
+
+
+void Executor::enqueue(Task* task)
+{
+    _queue.push(task);
+    wakeup();
+}
+
+
+void Executor::wakeup()
+{
+    // Only the first post since the last run sends a wakeup; the
+    // exchange also publishes the queued task to the loop thread.
+    if (!_pending.exchange(true, std::memory_order_acq_rel)) {
+        if (uv::LoopMetrics::enabled())
+            _posted.store(uv_hrtime(), std::memory_order_relaxed);
+        uv_async_send(_async);
+    }
+}
+
+
+void Executor::run()
+{
+    uv::CallbackTimer timing(_loop, UV_ASYNC);
+    _pending.exchange(false, std::memory_order_acq_rel);
+
+    uint64_t posted = _posted.exchange(0, std::memory_order_relaxed);
+    if (posted) {
+        if (auto metrics = uv::LoopMetrics::find(_loop))
+            metrics->recordSyncLatency(uv_hrtime() - posted);
+    }
+
+    // Run a bounded batch so a busy producer can't starve the loop
+    for (int i = 0; i < MaxBatch; i++) {
+        Task* task = _queue.pop();
+        if (!task)
+            break;
+        task->call(task, true);
+        delete task;
+    }
+
+    // Tasks remain or a producer is still linking one which
+    // may have missed its wakeup, so run again next iteration.
+    if (!_queue.empty())
+        wakeup();
+}
+
+
+void Executor::discard()
+{
+    while (Task* task = _queue.pop()) {
+        task->call(task, false);
+        delete task;
+    }
+}
+
+
+void Executor::bind()
+{
+    _tid.store(std::this_thread::get_id());
+}
+
+
+bool Executor::inLoopThread() const
+{
+    return std::this_thread::get_id() == _tid.load();
+}
+
+
+void Executor::ref()
+{
+    if (_refs.fetch_add(1) == 0)
+        updateRef();
+}
+
+
+void Executor::unref()
+{
+    int refs = _refs.fetch_sub(1);
+    assert(refs > 0);
+    if (refs == 1)
+        updateRef();
+}
+
+
+void Executor::updateRef()
+{
+    // The handle may only be touched by the loop thread, or by
+    // any thread before the loop has started running. Otherwise
+    // the loop thread applies the current count on our behalf.
+    if (inLoopThread() || _tid.load() == std::thread::id()) {
+        auto handle = reinterpret_cast<uv_handle_t*>(_async);
+        if (_refs.load() > 0)
+            uv_ref(handle);
+        else
+            uv_unref(handle);
+    } else
+        post([this]() { updateRef(); });
+}
+
+
+uv::Loop* Executor::loop() const
+{
+    return _loop;
+}
+
+
+} // namespace uv
+} // namespace scy
+
+
+/// @\}
@@ -0,0 +1,281 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/hex.h"
+
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCY_HEX_X86
+#include <immintrin.h>
+#endif
+
+
+namespace scy {
+namespace hex {
+
+
+namespace {
+
+
+const char kDigits[] = "0123456789abcdef0123456789ABCDEF";
+
+
+int nybble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    else if (c >= 'A' && c <= 'F')
+        return c - ('A' - 10);
+    else if (c >= 'a' && c <= 'f')
+        return c - ('a' - 10);
+    else
+        throw std::runtime_error("Invalid hex format");
+}
+
+
+bool isspace(char c)
+{
+    return c == ' ' || c == '\r' || c == '\t' || c == '\n';
+}
+
+
+#ifdef SCY_HEX_X86
+
+
+//
+// SSSE3 Kernels
+//
+
+
+/// Encodes 16 bytes into 32 characters per iteration by looking
+/// up both nybbles of each byte with PSHUFB.
+__attribute__((target("ssse3")))
+size_t encodeSSSE3(const uint8_t* in, size_t len, char* out, bool uppercase)
+{
+    const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits + (uppercase ? 16 : 0)));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t done = 0;
+    for (; len - done >= 16; done += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        const __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return done;
+}
+
+
+/// Converts hex digits to nybble values, setting `invalid` to a
+/// non zero mask if any character is not a hex digit.
+__attribute__((target("ssse3")))
+inline __m128i nybblesSSSE3(__m128i v, __m128i& invalid)
+{
+    // Digits, and letters folded to lower case
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+    invalid = _mm_or_si128(invalid, _mm_andnot_si128(_mm_or_si128(digit, alpha), _mm_set1_epi8(-1)));
+    return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+                        _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+}
+
+
+/// Decodes 32 characters into 16 bytes per iteration, stopping
+/// at the first block which contains whitespace or an invalid
+/// character.
+__attribute__((target("ssse3")))
+size_t decodeSSSE3(const char* in, size_t len, char* out, size_t& consumed)
+{
+    // Each pair of nybbles is combined as hi * 16 + lo
+    const __m128i weights = _mm_set1_epi16(0x0110);
+
+    consumed = 0;
+    for (; len - consumed >= 32; consumed += 32) {
+        __m128i invalid = _mm_setzero_si128();
+        const __m128i a = nybblesSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed)), invalid);
+        const __m128i b = nybblesSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed + 16)), invalid);
+        if (_mm_movemask_epi8(invalid))
+            break;
+        const __m128i v = _mm_packus_epi16(_mm_maddubs_epi16(a, weights),
+                                           _mm_maddubs_epi16(b, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + consumed / 2), v);
+    }
+    return consumed / 2;
+}
+
+
+//
+// AVX2 Kernels
+//
+
+
+__attribute__((target("avx2")))
+size_t encodeAVX2(const uint8_t* in, size_t len, char* out, bool uppercase)
+{
+    const __m256i lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits + (uppercase ? 16 : 0))));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t done = 0;
+    for (; len - done >= 32; done += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+        const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+
+        // Unpacking works within lanes, so swap the middle halves back
+        const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        const __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done * 2), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+inline __m256i nybblesAVX2(__m256i v, __m256i& invalid)
+{
+    const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    const __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    invalid = _mm256_or_si256(invalid, _mm256_andnot_si256(_mm256_or_si256(digit, alpha), _mm256_set1_epi8(-1)));
+    return _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(v, _mm256_set1_epi8('0'))),
+                           _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+}
+
+
+__attribute__((target("avx2")))
+size_t decodeAVX2(const char* in, size_t len, char* out, size_t& consumed)
+{
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+
+    consumed = 0;
+    for (; len - consumed >= 64; consumed += 64) {
+        __m256i invalid = _mm256_setzero_si256();
+        const __m256i a = nybblesAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + consumed)), invalid);
+        const __m256i b = nybblesAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + consumed + 32)), invalid);
+        if (_mm256_movemask_epi8(invalid))
+            break;
+
+        // Packing works within lanes, so restore the qword order
+        const __m256i v = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights),
+                                              _mm256_maddubs_epi16(b, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + consumed / 2),
+                            _mm256_permute4x64_epi64(v, 0xd8));
+    }
+    return consumed / 2;
+}
+
+
+#endif // SCY_HEX_X86
+
+
+//
+// Dispatch
+//
+
+
+enum class Kernel
+{
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+
+Kernel kernel()
+{
+    static const Kernel kernel = []() {
+#ifdef SCY_HEX_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Kernel::AVX2;
+        if (__builtin_cpu_supports("ssse3"))
+            return Kernel::SSSE3;
+#endif
+        return Kernel::Scalar;
+    }();
+    return kernel;
+}
+
+
+} // namespace
+
+
+size_t encode(const char* in, size_t len, char* out, bool uppercase)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(in);
+    size_t done = 0;
+#ifdef SCY_HEX_X86
+    const Kernel k = kernel();
+    if (k == Kernel::AVX2)
+        done = encodeAVX2(bytes, len, out, uppercase);
+    if (k != Kernel::Scalar)
+        done += encodeSSSE3(bytes + done, len - done, out + done * 2, uppercase);
+#endif
+
+    const char* digits = kDigits + (uppercase ? 16 : 0);
+    for (; done < len; done++) {
+        out[done * 2] = digits[bytes[done] >> 4];
+        out[done * 2 + 1] = digits[bytes[done] & 0xf];
+    }
+    return len * 2;
+}
+
+
+size_t decode(const char* in, size_t len, char* out)
+{
+    size_t rpos = 0;
+    size_t nwrite = 0;
+    while (rpos < len) {
+        // Decode whole blocks, falling back to the scalar loop
+        // for whitespace, invalid characters and the tail
+#ifdef SCY_HEX_X86
+        const Kernel k = kernel();
+        size_t consumed = 0;
+        if (k == Kernel::AVX2) {
+            nwrite += decodeAVX2(in + rpos, len - rpos, out + nwrite, consumed);
+            rpos += consumed;
+        }
+        if (k != Kernel::Scalar) {
+            nwrite += decodeSSSE3(in + rpos, len - rpos, out + nwrite, consumed);
+            rpos += consumed;
+        }
+#endif
+
+        // Skip whitespace and decode the next byte
+        while (rpos < len && isspace(in[rpos]))
+            rpos++;
+        if (rpos == len)
+            break;
+        int n = nybble(in[rpos++]) << 4;
+        while (rpos < len && isspace(in[rpos]))
+            rpos++;
+        if (rpos == len)
+            throw std::runtime_error("Invalid hex format: Odd number of digits");
+        out[nwrite++] = static_cast<char>(n | nybble(in[rpos++]));
+    }
+    return nwrite;
+}
+
+
+} // namespace hex
+} // namespace scy
+
+
+/// @\}
@@ -16,6 +16,7 @@
 #include "scy/time.h"
 #include "scy/util.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <iterator>
 
@@ -27,11 +28,16 @@ namespace scy {
 
 
 static Singleton<Logger> singleton;
+static const int DisabledLevel = static_cast<int>(Level::Fatal) + 1;
+
+
+std::atomic<int> Logger::_threshold(DisabledLevel);
 
 
 Logger::Logger()
     : _defaultChannel(nullptr)
     , _writer(new LogWriter)
+    , _minLevel(DisabledLevel)
 {
     // Decouple C and C++ streams for performance increase.
     // std::cout.sync_with_stdio(false);
@@ -56,6 +62,7 @@ Logger& Logger::instance()
 void Logger::setInstance(Logger* logger, bool freeExisting)
 {
     auto current = singleton.swap(logger);
+    _threshold = logger ? logger->_minLevel : DisabledLevel;
     if (current && freeExisting)
         delete current;
 }
@@ -63,32 +70,58 @@ void Logger::setInstance(Logger* logger, bool freeExisting)
 
 void Logger::destroy()
 {
+    _threshold = DisabledLevel;
     singleton.destroy();
 }
 
 
 void Logger::add(LogChannel* channel)
 {
-    std::lock_guard<std::mutex> guard(_mutex);
-    // The first channel added will be the default channel.
-    if (_defaultChannel == nullptr)
-        _defaultChannel = channel;
-    _channels[channel->name()] = channel;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        // The first channel added will be the default channel.
+        if (_defaultChannel == nullptr)
+            _defaultChannel = channel;
+        _channels[channel->name()] = channel;
+        channel->_logger = this;
+    }
+    updateThreshold();
 }
 
 
 void Logger::remove(const std::string& name, bool freePointer)
 {
-    std::lock_guard<std::mutex> guard(_mutex);
-    LogChannelMap::iterator it = _channels.find(name);
-    assert(it != _channels.end());
-    if (it != _channels.end()) {
-        if (_defaultChannel == it->second)
-            _defaultChannel = nullptr;
-        if (freePointer)
-            delete it->second;
-        _channels.erase(it);
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        LogChannelMap::iterator it = _channels.find(name);
+        assert(it != _channels.end());
+        if (it != _channels.end()) {
+            if (_defaultChannel == it->second)
+                _defaultChannel = nullptr;
+            if (freePointer)
+                delete it->second;
+            else
+                it->second->_logger = nullptr;
+            _channels.erase(it);
+        }
     }
+    updateThreshold();
+}
+
+
+void Logger::updateThreshold()
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _minLevel = DisabledLevel;
+        for (auto& kv : _channels)
+            _minLevel = std::min(_minLevel, static_cast<int>(kv.second->level()));
+    }
+
+    // Only the default logger instance receives messages from the
+    // logging macros.
+    if (this == singleton.get())
+        _threshold = _minLevel;
 }
 
 
@@ -325,7 +358,16 @@ LogChannel::LogChannel(std::string name, Level level,
     : _name(std::move(name))
     , _level(level)
     , _timeFormat(std::move(timeFormat))
+    , _logger(nullptr)
+{
+}
+
+
+void LogChannel::setLevel(Level level)
 {
+    _level = level;
+    if (_logger)
+        _logger->updateThreshold();
 }
 
 
@@ -0,0 +1,89 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#include "scy/loop.h"
+
+#include <map>
+#include <mutex>
+#include <typeindex>
+#include <vector>
+
+
+namespace scy {
+namespace uv {
+namespace internal {
+
+
+typedef std::pair<Loop*, std::type_index> LoopLocalKey;
+
+
+static std::mutex& loopLocalMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+
+static std::map<LoopLocalKey, std::shared_ptr<void>>& loopLocals()
+{
+    static std::map<LoopLocalKey, std::shared_ptr<void>> instances;
+    return instances;
+}
+
+
+void* getLoopLocal(Loop* loop, const std::type_info& type,
+                   const std::function<std::shared_ptr<void>()>& factory)
+{
+    std::lock_guard<std::mutex> guard(loopLocalMutex());
+    auto& instances = loopLocals();
+    LoopLocalKey key(loop, std::type_index(type));
+    auto it = instances.find(key);
+    if (it == instances.end())
+        it = instances.emplace(key, factory()).first;
+    return it->second.get();
+}
+
+
+void* findLoopLocal(Loop* loop, const std::type_info& type)
+{
+    std::lock_guard<std::mutex> guard(loopLocalMutex());
+    auto& instances = loopLocals();
+    auto it = instances.find(LoopLocalKey(loop, std::type_index(type)));
+    return it != instances.end() ? it->second.get() : nullptr;
+}
+
+
+void clearLoopLocals(Loop* loop)
+{
+    // Release instances outside the lock since destructors may
+    // access other loop-local instances.
+    std::vector<std::shared_ptr<void>> released;
+    {
+        std::lock_guard<std::mutex> guard(loopLocalMutex());
+        auto& instances = loopLocals();
+        for (auto it = instances.begin(); it != instances.end();) {
+            if (it->first.first == loop) {
+                released.push_back(std::move(it->second));
+                it = instances.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+}
+
+
+} // namespace internal
+} // namespace uv
+} // namespace scy
+
+
+/// @\}
@@ -0,0 +1,460 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#include "scy/loopmetrics.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <mutex>
+#include <sstream>
+
+
+namespace scy {
+namespace uv {
+
+
+//
+// Latency Histogram
+//
+
+
+void LatencyHistogram::record(uint64_t nanos)
+{
+    uint64_t micros = nanos / 1000;
+    int index = 0;
+    while (index < NumBuckets - 1 && micros >= (uint64_t(1) << index))
+        index++;
+    buckets[index]++;
+    count++;
+    total += nanos;
+    if (nanos > max)
+        max = nanos;
+}
+
+
+uint64_t LatencyHistogram::mean() const
+{
+    return count ? total / count : 0;
+}
+
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (!count)
+        return 0;
+    uint64_t target = static_cast<uint64_t>(count * (p / 100.0) + 0.5);
+    if (target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < NumBuckets - 1; i++) {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min<uint64_t>((uint64_t(1) << i) * 1000, max);
+    }
+    return max;
+}
+
+
+void LatencyHistogram::reset()
+{
+    *this = LatencyHistogram();
+}
+
+
+//
+// Loop Metrics
+//
+
+
+std::atomic<int> LoopMetrics::_numStarted(0);
+
+
+namespace {
+
+// Started collectors. The lock is only taken while a collector is
+// running, and lets a collector be stopped or destroyed on any thread.
+std::mutex startedMutex;
+std::vector<LoopMetrics*> startedMetrics;
+
+} // namespace
+
+
+LoopMetrics::LoopMetrics(uv::Loop* loop)
+    : _loop(loop)
+    , _prepare(loop)
+    , _check(loop)
+    , _started(false)
+    , _polling(false)
+    , _startTime(0)
+    , _checkTime(0)
+    , _pollBusy(0)
+    , _busy(0)
+    , _iterations(0)
+{
+}
+
+
+LoopMetrics::~LoopMetrics()
+{
+    stop();
+}
+
+
+LoopMetrics& LoopMetrics::get(uv::Loop* loop)
+{
+    return uv::loopLocal<LoopMetrics>(loop);
+}
+
+
+LoopMetrics* LoopMetrics::findStarted(uv::Loop* loop)
+{
+    std::lock_guard<std::mutex> guard(startedMutex);
+    for (auto metrics : startedMetrics) {
+        if (metrics->_loop == loop)
+            return metrics;
+    }
+    return nullptr;
+}
+
+
+void LoopMetrics::start()
+{
+    if (_started)
+        return;
+
+    if (_prepare.closed())
+        _prepare.reset();
+    if (_check.closed())
+        _check.reset();
+
+    _prepare.get()->data = this;
+    _prepare.init(&uv_prepare_init);
+    _prepare.invoke(&uv_prepare_start, _prepare.get(), [](uv_prepare_t* req) {
+        reinterpret_cast<LoopMetrics*>(req->data)->onPrepare();
+    });
+    _prepare.throwLastError("Cannot start loop metrics");
+    _prepare.unref();
+
+    _check.get()->data = this;
+    _check.init(&uv_check_init);
+    _check.invoke(&uv_check_start, _check.get(), [](uv_check_t* req) {
+        reinterpret_cast<LoopMetrics*>(req->data)->onCheck();
+    });
+    _check.throwLastError("Cannot start loop metrics");
+    _check.unref();
+
+    reset();
+    _started = true;
+    _numStarted++;
+    std::lock_guard<std::mutex> guard(startedMutex);
+    startedMetrics.push_back(this);
+}
+
+
+void LoopMetrics::stop()
+{
+    if (!_started)
+        return;
+
+    _started = false;
+    _numStarted--;
+    {
+        std::lock_guard<std::mutex> guard(startedMutex);
+        startedMetrics.erase(std::remove(startedMetrics.begin(),
+                                         startedMetrics.end(), this),
+                             startedMetrics.end());
+    }
+    _prepare.close();
+    _check.close();
+}
+
+
+bool LoopMetrics::started() const
+{
+    return _started;
+}
+
+
+void LoopMetrics::reset()
+{
+    _polling = false;
+    _startTime = uv_hrtime();
+    _checkTime = 0;
+    _pollBusy = 0;
+    _busy = 0;
+    _iterations = 0;
+    _lag.reset();
+    _syncLatency.reset();
+    std::fill(std::begin(_callbacks), std::end(_callbacks), CallbackStats());
+}
+
+
+void LoopMetrics::recordCallback(uv_handle_type type, uint64_t nanos)
+{
+    assert(type >= 0 && type < UV_HANDLE_TYPE_MAX);
+    auto& stats = _callbacks[type];
+    stats.count++;
+    stats.total += nanos;
+    if (nanos > stats.max)
+        stats.max = nanos;
+
+    // I/O callbacks run inside the poll phase, so their time is added
+    // to the iteration lag explicitly.
+    if (_polling)
+        _pollBusy += nanos;
+}
+
+
+void LoopMetrics::recordSyncLatency(uint64_t nanos)
+{
+    _syncLatency.record(nanos);
+}
+
+
+void LoopMetrics::onPrepare()
+{
+    // Everything between the last check phase and this prepare phase
+    // (close callbacks, timers, pending and idle callbacks) keeps the loop
+    // busy, as does the callback time recorded during the last poll phase.
+    uint64_t now = uv_hrtime();
+    if (_checkTime) {
+        uint64_t lag = (now - _checkTime) + _pollBusy;
+        _lag.record(lag);
+        _busy += lag;
+        _iterations++;
+    }
+    _pollBusy = 0;
+    _polling = true;
+}
+
+
+void LoopMetrics::onCheck()
+{
+    _checkTime = uv_hrtime();
+    _polling = false;
+}
+
+
+namespace {
+
+
+std::string formatAddress(const struct sockaddr_storage& addr)
+{
+    char host[64] = {0};
+    int port = 0;
+    if (addr.ss_family == AF_INET) {
+        auto in = reinterpret_cast<const struct sockaddr_in*>(&addr);
+        uv_ip4_name(in, host, sizeof(host));
+        port = ntohs(in->sin_port);
+    }
+    else if (addr.ss_family == AF_INET6) {
+        auto in6 = reinterpret_cast<const struct sockaddr_in6*>(&addr);
+        uv_ip6_name(in6, host, sizeof(host));
+        port = ntohs(in6->sin6_port);
+    }
+    else
+        return std::string();
+    std::ostringstream os;
+    os << host << ":" << port;
+    return os.str();
+}
+
+
+void walkHandle(uv_handle_t* handle, void* arg)
+{
+    auto snapshot = reinterpret_cast<LoopMetrics::Snapshot*>(arg);
+    snapshot->handles[handle->type]++;
+    snapshot->totalHandles++;
+
+    SocketWriteQueue queue;
+    switch (handle->type) {
+        case UV_TCP:
+        case UV_NAMED_PIPE:
+        case UV_TTY:
+            queue.pending = reinterpret_cast<uv_stream_t*>(handle)->write_queue_size;
+            break;
+        case UV_UDP:
+            queue.pending = reinterpret_cast<uv_udp_t*>(handle)->send_queue_size;
+            break;
+        default:
+            return;
+    }
+    if (!queue.pending)
+        return;
+
+    queue.handle = handle;
+    queue.type = handle->type;
+    struct sockaddr_storage addr;
+    int len = sizeof(addr);
+    if (handle->type == UV_TCP) {
+        auto tcp = reinterpret_cast<uv_tcp_t*>(handle);
+        if (uv_tcp_getsockname(tcp, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0)
+            queue.local = formatAddress(addr);
+        len = sizeof(addr);
+        if (uv_tcp_getpeername(tcp, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0)
+            queue.peer = formatAddress(addr);
+    }
+    else if (handle->type == UV_UDP) {
+        auto udp = reinterpret_cast<uv_udp_t*>(handle);
+        if (uv_udp_getsockname(udp, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0)
+            queue.local = formatAddress(addr);
+    }
+    snapshot->pendingWriteBytes += queue.pending;
+    snapshot->sockets.push_back(std::move(queue));
+}
+
+
+size_t countActiveRequests(uv::Loop* loop)
+{
+#if UV_VERSION_HEX >= ((1 << 16) | (19 << 8))
+    return loop->active_reqs.count;
+#else
+    // Older libuv versions keep active requests in an intrusive queue
+    // where the first element of each node points to the next node.
+    size_t count = 0;
+    void* head = &loop->active_reqs;
+    void* node = loop->active_reqs[0];
+    while (node && node != head) {
+        count++;
+        node = static_cast<void**>(node)[0];
+    }
+    return count;
+#endif
+}
+
+
+void writeHistogram(std::ostream& os, const LatencyHistogram& hist)
+{
+    os << "{\"count\":" << hist.count
+       << ",\"mean\":" << hist.mean() / 1000
+       << ",\"p50\":" << hist.percentile(50) / 1000
+       << ",\"p90\":" << hist.percentile(90) / 1000
+       << ",\"p99\":" << hist.percentile(99) / 1000
+       << ",\"max\":" << hist.max / 1000
+       << ",\"buckets\":[";
+    for (int i = 0; i < LatencyHistogram::NumBuckets; i++) {
+        if (i)
+            os << ",";
+        os << hist.buckets[i];
+    }
+    os << "]}";
+}
+
+
+} // namespace
+
+
+LoopMetrics::Snapshot LoopMetrics::snapshot() const
+{
+    Snapshot s;
+    s.time = uv_hrtime();
+    s.uptime = _started ? s.time - _startTime : 0;
+    s.busy = _busy;
+    s.iterations = _iterations;
+    s.lag = _lag;
+    s.syncLatency = _syncLatency;
+    std::copy(std::begin(_callbacks), std::end(_callbacks), std::begin(s.callbacks));
+    s.activeHandles = _loop->active_handles;
+    s.activeRequests = countActiveRequests(_loop);
+    uv_walk(_loop, walkHandle, &s);
+    return s;
+}
+
+
+std::string LoopMetrics::toJSON() const
+{
+    return snapshot().toJSON();
+}
+
+
+uv::Loop* LoopMetrics::loop() const
+{
+    return _loop;
+}
+
+
+std::string LoopMetrics::Snapshot::toJSON() const
+{
+    // Durations are expressed in microseconds.
+    std::ostringstream os;
+    os << "{\"uptime\":" << uptime / 1000
+       << ",\"busy\":" << busy / 1000
+       << ",\"utilization\":" << (uptime ? double(busy) / double(uptime) : 0.0)
+       << ",\"iterations\":" << iterations
+       << ",\"lag\":";
+    writeHistogram(os, lag);
+    os << ",\"syncLatency\":";
+    writeHistogram(os, syncLatency);
+
+    os << ",\"callbacks\":{";
+    bool first = true;
+    for (int i = 0; i < UV_HANDLE_TYPE_MAX; i++) {
+        if (!callbacks[i].count)
+            continue;
+        if (!first)
+            os << ",";
+        first = false;
+        os << "\"" << handleTypeName(static_cast<uv_handle_type>(i)) << "\":{"
+           << "\"count\":" << callbacks[i].count
+           << ",\"total\":" << callbacks[i].total / 1000
+           << ",\"max\":" << callbacks[i].max / 1000 << "}";
+    }
+
+    os << "},\"handles\":{\"total\":" << totalHandles
+       << ",\"active\":" << activeHandles;
+    for (int i = 0; i < UV_HANDLE_TYPE_MAX; i++) {
+        if (handles[i])
+            os << ",\"" << handleTypeName(static_cast<uv_handle_type>(i))
+               << "\":" << handles[i];
+    }
+
+    os << "},\"activeRequests\":" << activeRequests
+       << ",\"pendingWriteBytes\":" << pendingWriteBytes
+       << ",\"sockets\":[";
+    for (size_t i = 0; i < sockets.size(); i++) {
+        const auto& socket = sockets[i];
+        if (i)
+            os << ",";
+        os << "{\"handle\":\"" << socket.handle << "\""
+           << ",\"type\":\"" << handleTypeName(socket.type) << "\""
+           << ",\"pending\":" << socket.pending;
+        if (!socket.local.empty())
+            os << ",\"local\":\"" << socket.local << "\"";
+        if (!socket.peer.empty())
+            os << ",\"peer\":\"" << socket.peer << "\"";
+        os << "}";
+    }
+    os << "]}";
+    return os.str();
+}
+
+
+const char* handleTypeName(uv_handle_type type)
+{
+    switch (type) {
+#define XX(uc, lc)                                                             \
+    case UV_##uc:                                                              \
+        return #lc;
+        UV_HANDLE_TYPE_MAP(XX)
+#undef XX
+        case UV_FILE:
+            return "file";
+        default:
+            return "unknown";
+    }
+}
+
+
+} // namespace uv
+} // namespace scy
+
+
+/// @\}
@@ -86,6 +86,27 @@ void GarbageCollector::finalize()
 }
 
 
+void GarbageCollector::finalize(uv::Loop* loop)
+{
+    Cleaner* cleaner = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (auto it = _cleaners.begin(); it != _cleaners.end(); ++it) {
+            if ((*it)->_loop == loop) {
+                cleaner = *it;
+                _cleaners.erase(it);
+                break;
+            }
+        }
+    }
+    if (cleaner) {
+        if (!cleaner->_finalize)
+            cleaner->finalize();
+        delete cleaner;
+    }
+}
+
+
 std::thread::id GarbageCollector::tid()
 {
     return _tid;
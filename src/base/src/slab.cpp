@@ -0,0 +1,131 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup uv
+/// @{
+
+
+#include "scy/slab.h"
+
+#include <assert.h>
+
+
+namespace scy {
+namespace uv {
+
+
+BufferSlab::BufferSlab(uv::Loop* /* loop */)
+    : _maxIdle(4)
+{
+}
+
+
+BufferSlab::~BufferSlab()
+{
+}
+
+
+BufferSlab& BufferSlab::get(uv::Loop* loop)
+{
+    return uv::loopLocal<BufferSlab>(loop);
+}
+
+
+void BufferSlab::lend(size_t size, uv_buf_t* buf)
+{
+    assert(size > 0);
+
+    // Reuse the most recently returned buffer which is large enough,
+    // since it is the most likely to still be hot in the cache.
+    auto it = _idle.rbegin();
+    for (; it != _idle.rend(); ++it) {
+        if (it->size() >= size)
+            break;
+    }
+
+    if (it != _idle.rend()) {
+        _lent.push_back(std::move(*it));
+        _idle.erase(std::next(it).base());
+    }
+    else {
+        _lent.push_back(Buffer(size));
+    }
+
+    buf->base = _lent.back().data();
+    buf->len = size;
+}
+
+
+void BufferSlab::reclaim(const char* data)
+{
+    if (!data)
+        return;
+
+    for (size_t i = 0; i < _lent.size(); i++) {
+        if (_lent[i].data() == data) {
+            if (_idle.size() < _maxIdle)
+                _idle.push_back(std::move(_lent[i]));
+            if (i != _lent.size() - 1)
+                _lent[i] = std::move(_lent.back());
+            _lent.pop_back();
+            return;
+        }
+    }
+}
+
+
+Buffer BufferSlab::take(const char* data, size_t len)
+{
+    for (size_t i = 0; i < _lent.size(); i++) {
+        auto base = _lent[i].data();
+        if (data >= base && data + len <= base + _lent[i].size()) {
+            // Data which doesn't start the buffer can't be moved out
+            // without shifting it, so copy it and recycle the buffer.
+            if (data != base) {
+                Buffer buffer(data, data + len);
+                reclaim(base);
+                return buffer;
+            }
+
+            Buffer buffer(std::move(_lent[i]));
+            if (i != _lent.size() - 1)
+                _lent[i] = std::move(_lent.back());
+            _lent.pop_back();
+            buffer.resize(len);
+            return buffer;
+        }
+    }
+
+    return Buffer(data, data + len);
+}
+
+
+void BufferSlab::setMaxIdle(size_t max)
+{
+    _maxIdle = max;
+    if (_idle.size() > _maxIdle)
+        _idle.resize(_maxIdle);
+}
+
+
+size_t BufferSlab::lent() const
+{
+    return _lent.size();
+}
+
+
+size_t BufferSlab::idle() const
+{
+    return _idle.size();
+}
+
+
+} // namespace uv
+} // namespace scy
+
+
+/// @\}
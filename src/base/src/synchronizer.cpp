@@ -43,6 +43,14 @@ void Synchronizer::start(std::function<void()> target)
 void Synchronizer::post()
 {
     assert(_handle.initialized());
+
+    // Record the time of the first post which has not been handled yet,
+    // since multiple posts may be coalesced into a single callback.
+    if (uv::LoopMetrics::enabled()) {
+        uint64_t expected = 0;
+        _context->posted.compare_exchange_strong(expected, uv_hrtime());
+    }
+
     // NOTE: Cannot call `_handle.get()` as we're on different thread
     uv_async_send(_handle.context()->ptr);
 }
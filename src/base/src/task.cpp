@@ -83,6 +83,11 @@ TaskRunner::TaskRunner(std::shared_ptr<Runner> runner)
 }
 
 
+TaskRunner::TaskRunner(Unpowered)
+{
+}
+
+
 TaskRunner::~TaskRunner()
 {
     Shutdown.emit(/*this*/);
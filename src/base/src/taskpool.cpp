@@ -0,0 +1,338 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/taskpool.h"
+#include "scy/logger.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+using std::endl;
+
+
+namespace scy {
+
+
+namespace {
+
+// The pool and worker index of the current thread, so
+// tasks started by a running task stay on its worker.
+thread_local TaskPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+
+TaskPool::TaskPool(size_t numThreads)
+    : TaskRunner(TaskRunner::Unpowered())
+    , _queued(0)
+    , _idle(0)
+    , _next(0)
+    , _stopping(false)
+{
+    if (numThreads == 0)
+        numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    // Create all deques before any worker can try to steal from them
+    for (size_t i = 0; i < numThreads; i++)
+        _workers.emplace_back(new Worker);
+    for (size_t i = 0; i < numThreads; i++)
+        _workers[i]->thread.reset(new Thread([this, i]() { work(i); }));
+}
+
+
+TaskPool::~TaskPool()
+{
+    shutdown();
+}
+
+
+bool TaskPool::start(Task* task)
+{
+    LTrace("Start task: ", task)
+
+    add(task);
+
+    bool queue = false;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _states.find(task);
+        if (it != _states.end() && it->second == State::Idle) {
+            it->second = State::Queued;
+            queue = true;
+        }
+    }
+
+    onStart(task);
+    if (queue)
+        submit(task);
+    return true;
+}
+
+
+bool TaskPool::destroy(Task* task)
+{
+    LTrace("Abort task: ", task)
+
+    bool free = false;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _states.find(task);
+        if (it == _states.end()) {
+            LTrace("Delete unmanaged task: ", task)
+            free = true;
+        }
+        else {
+            // Queued and running tasks are deleted by their worker
+            task->_destroyed = true;
+            if (it->second == State::Idle) {
+                _states.erase(it);
+                onRemove(task);
+                free = true;
+            }
+        }
+    }
+
+    if (free)
+        delete task;
+    return true;
+}
+
+
+bool TaskPool::exists(Task* task) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _states.find(task) != _states.end();
+}
+
+
+Task* TaskPool::get(uint32_t id) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    for (auto& kv : _states) {
+        if (kv.first->id() == id)
+            return kv.first;
+    }
+    return nullptr;
+}
+
+
+void TaskPool::setRunner(std::shared_ptr<Runner>)
+{
+    throw std::logic_error("TaskPool owns its threads and cannot be powered by a runner");
+}
+
+
+void TaskPool::shutdown()
+{
+    if (_stopping.exchange(true))
+        return;
+
+    LTrace("Shutdown")
+    {
+        std::lock_guard<std::mutex> guard(_parkMutex);
+        _parked.notify_all();
+    }
+    for (auto& worker : _workers)
+        worker->thread->join();
+    clear();
+}
+
+
+size_t TaskPool::size() const
+{
+    return _workers.size();
+}
+
+
+void TaskPool::work(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (!_stopping.load()) {
+        Task* task = take(index);
+        if (task) {
+            runTask(task);
+            continue;
+        }
+
+        Idle.emit();
+
+        // Park until a task is submitted. The idle count is raised before
+        // the queued count is checked, and submit() raises the queued count
+        // before checking the idle count, so wakeups can't be lost.
+        std::unique_lock<std::mutex> lock(_parkMutex);
+        _idle++;
+        _parked.wait(lock, [this]() {
+            return _queued.load() > 0 || _stopping.load();
+        });
+        _idle--;
+    }
+
+    currentPool = nullptr;
+}
+
+
+Task* TaskPool::take(size_t index)
+{
+    // Run our own tasks in order, and steal the
+    // most recently queued tasks from other workers.
+    size_t count = _workers.size();
+    for (size_t i = 0; i < count; i++) {
+        Worker& worker = *_workers[(index + i) % count];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        if (worker.tasks.empty())
+            continue;
+        Task* task;
+        if (i == 0) {
+            task = worker.tasks.front();
+            worker.tasks.pop_front();
+        }
+        else {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+        }
+        _queued--;
+        return task;
+    }
+    return nullptr;
+}
+
+
+void TaskPool::submit(Task* task)
+{
+    size_t index = currentPool == this
+        ? currentWorker
+        : _next++ % _workers.size();
+    {
+        Worker& worker = *_workers[index];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        worker.tasks.push_back(task);
+    }
+    _queued++;
+
+    if (_idle.load() > 0) {
+        std::lock_guard<std::mutex> guard(_parkMutex);
+        _parked.notify_one();
+    }
+}
+
+
+void TaskPool::runTask(Task* task)
+{
+    bool free = false;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _states.find(task);
+        assert(it != _states.end() && it->second == State::Queued);
+        if (task->destroyed()) {
+            _states.erase(it);
+            onRemove(task);
+            free = true;
+        }
+        else if (task->cancelled()) {
+            it->second = State::Idle;
+            return;
+        }
+        else
+            it->second = State::Running;
+    }
+
+    if (free) {
+        LTrace("Destroy task: ", task)
+        delete task;
+        return;
+    }
+
+    LTrace("Run task: ", task)
+    task->run();
+    onRun(task);
+
+    // Cancel the task if not repeating
+    if (!task->repeating())
+        task->cancel();
+
+    bool requeue = false;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _states.find(task);
+        assert(it != _states.end() && it->second == State::Running);
+        if (task->destroyed()) {
+            _states.erase(it);
+            onRemove(task);
+            free = true;
+        }
+        else if (!task->cancelled()) {
+            it->second = State::Queued;
+            requeue = true;
+        }
+        else
+            it->second = State::Idle;
+    }
+
+    if (free) {
+        LTrace("Destroy task: ", task)
+        delete task;
+    }
+    else if (requeue)
+        submit(task);
+}
+
+
+bool TaskPool::add(Task* task)
+{
+    LTrace("Add task: ", task)
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_states.emplace(task, State::Idle).second) {
+        onAdd(task);
+        return true;
+    }
+    return false;
+}
+
+
+bool TaskPool::remove(Task* task)
+{
+    LTrace("Remove task: ", task)
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_states.erase(task)) {
+        onRemove(task);
+        return true;
+    }
+    return false;
+}
+
+
+void TaskPool::clear()
+{
+    for (auto& worker : _workers) {
+        std::lock_guard<std::mutex> guard(worker->mutex);
+        worker->tasks.clear();
+    }
+    _queued = 0;
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    for (auto& kv : _states) {
+        LTrace("Clear: Destroying task: ", kv.first)
+        delete kv.first;
+    }
+    _states.clear();
+}
+
+
+} // namespace scy
+
+
+/// @\}
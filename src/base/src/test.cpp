@@ -11,6 +11,7 @@
 
 #include "scy/test.h"
 #include "scy/logger.h"
+#include "scy/loop.h"
 #include "scy/memory.h"
 #include "scy/singleton.h"
 #include "scy/time.h"
@@ -54,6 +55,11 @@ int finalize()
     // Finalize the garbage collector to ensure memory if freed before exiting.
     GarbageCollector::instance().finalize();
 
+    // Release the default loop's pools and schedulers, and run once
+    // to close the handles they own.
+    uv::internal::clearLoopLocals(uv::defaultLoop());
+    uv::runLoop(uv::defaultLoop(), UV_RUN_NOWAIT);
+
     return passed ? 0 : 1;
 }
 
@@ -56,6 +56,18 @@ void Thread::join()
 }
 
 
+void Thread::detach()
+{
+    _thread.detach();
+}
+
+
+bool Thread::joinable() const
+{
+    return _thread.joinable();
+}
+
+
 std::thread::id Thread::currentID()
 {
     return std::this_thread::get_id(); //uv_thread_self();
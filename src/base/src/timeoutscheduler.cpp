@@ -0,0 +1,162 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/timeoutscheduler.h"
+
+#include <algorithm>
+#include <assert.h>
+
+
+namespace scy {
+
+
+namespace {
+
+struct EntryCompare
+{
+    template <typename Entry>
+    bool operator()(const Entry& a, const Entry& b) const
+    {
+        return a.deadline != b.deadline ? a.deadline > b.deadline : a.id > b.id;
+    }
+};
+
+} // namespace
+
+
+TimeoutScheduler::TimeoutScheduler(uv::Loop* loop)
+    : _loop(loop)
+    , _timer(loop)
+    , _armed(0)
+    , _nextID(1)
+{
+    _timer.Timeout += slot(this, &TimeoutScheduler::onTimeout);
+}
+
+
+TimeoutScheduler::~TimeoutScheduler()
+{
+    _timer.Timeout -= slot(this, &TimeoutScheduler::onTimeout);
+    _timer.stop();
+}
+
+
+TimeoutScheduler& TimeoutScheduler::get(uv::Loop* loop)
+{
+    return uv::loopLocal<TimeoutScheduler>(loop);
+}
+
+
+TimeoutScheduler::ID TimeoutScheduler::schedule(std::int64_t timeout, Callback callback)
+{
+    assert(callback);
+    ID id = _nextID++;
+    std::uint64_t deadline = uv_now(_loop) + std::max<std::int64_t>(timeout, 0);
+    _callbacks.emplace(id, std::move(callback));
+    _heap.push_back(Entry{deadline, id});
+    std::push_heap(_heap.begin(), _heap.end(), EntryCompare());
+
+    // Drop cancelled entries once they outnumber pending ones
+    if (_heap.size() > 64 && _heap.size() > _callbacks.size() * 2)
+        compact();
+
+    if (!_armed || deadline < _armed)
+        arm();
+    return id;
+}
+
+
+bool TimeoutScheduler::cancel(ID id)
+{
+    // The heap entry is left in place and skipped when it expires.
+    return _callbacks.erase(id) > 0;
+}
+
+
+bool TimeoutScheduler::pending(ID id) const
+{
+    return _callbacks.find(id) != _callbacks.end();
+}
+
+
+size_t TimeoutScheduler::size() const
+{
+    return _callbacks.size();
+}
+
+
+uv::Loop* TimeoutScheduler::loop() const
+{
+    return _loop;
+}
+
+
+void TimeoutScheduler::onTimeout()
+{
+    _armed = 0;
+
+    // Timeouts scheduled from inside callbacks are deferred until the
+    // next timer run so that zero timeouts can not starve the loop.
+    std::uint64_t now = uv_now(_loop);
+    ID last = _nextID;
+    while (!_heap.empty() && _heap.front().deadline <= now && _heap.front().id < last) {
+        ID id = _heap.front().id;
+        std::pop_heap(_heap.begin(), _heap.end(), EntryCompare());
+        _heap.pop_back();
+
+        auto it = _callbacks.find(id);
+        if (it == _callbacks.end())
+            continue; // cancelled
+
+        Callback callback(std::move(it->second));
+        _callbacks.erase(it);
+        callback();
+    }
+
+    arm();
+}
+
+
+void TimeoutScheduler::arm()
+{
+    // Skip cancelled entries at the head of the heap
+    while (!_heap.empty() && !pending(_heap.front().id)) {
+        std::pop_heap(_heap.begin(), _heap.end(), EntryCompare());
+        _heap.pop_back();
+    }
+
+    _timer.stop();
+    if (_heap.empty()) {
+        _armed = 0;
+        return;
+    }
+
+    std::uint64_t now = uv_now(_loop);
+    std::uint64_t deadline = _heap.front().deadline;
+    _armed = deadline;
+    _timer.setTimeout(deadline > now ? static_cast<std::int64_t>(deadline - now) : 1);
+    _timer.start();
+}
+
+
+void TimeoutScheduler::compact()
+{
+    _heap.erase(std::remove_if(_heap.begin(), _heap.end(), [this](const Entry& entry) {
+        return !pending(entry.id);
+    }), _heap.end());
+    std::make_heap(_heap.begin(), _heap.end(), EntryCompare());
+}
+
+
+} // namespace scy
+
+
+/// @\}
@@ -12,6 +12,7 @@
 #include "scy/timer.h"
 #include "assert.h"
 #include "scy/logger.h"
+#include "scy/loopmetrics.h"
 #include "scy/platform.h"
 
 
@@ -108,6 +109,7 @@ void Timer::start()
     _handle.invoke(&uv_timer_start, _handle.get(),
         [](uv_timer_t* req) {
             auto self = reinterpret_cast<Timer*>(req->data);
+            uv::CallbackTimer timing(req->loop, UV_TIMER);
             self->_count++;
             self->Timeout.emit();
         }, _timeout, _interval);
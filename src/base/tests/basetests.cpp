@@ -44,6 +44,21 @@ int main(int argc, char** argv)
         uv::closeLoop(loop1);
     });
 
+    describe("garbage collector loop finalize", []() {
+        GarbageCollector gc;
+        auto loop = uv::createLoop();
+
+        // pointers on a secondary loop are freed with its cleaner
+        auto idler = new Idler(loop, []() {});
+        idler->handle().ref();
+        gc.deleteLater(idler, loop);
+        gc.finalize(loop);
+        expect(loop->active_handles == 0);
+
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
 
     // =========================================================================
     // Signal Benchmarks
@@ -267,6 +282,314 @@ int main(int argc, char** argv)
     });
 
 
+    describe("buffer slab", []() {
+        auto loop = uv::createLoop();
+        auto& slab = uv::BufferSlab::get(loop);
+        expect(&slab == &uv::BufferSlab::get(loop));
+
+        // Buffers are reused once reclaimed
+        uv_buf_t buf;
+        slab.lend(1024, &buf);
+        expect(buf.len == 1024);
+        expect(slab.lent() == 1);
+        char* base = buf.base;
+        slab.reclaim(buf.base);
+        expect(slab.lent() == 0);
+        expect(slab.idle() == 1);
+        slab.lend(512, &buf);
+        expect(buf.base == base);
+        expect(buf.len == 512);
+
+        // Taking ownership removes the buffer from the slab
+        std::memcpy(buf.base, "hello", 5);
+        Buffer taken = slab.take(buf.base, 4);
+        expect(taken.data() == base);
+        expect(std::string(taken.begin(), taken.end()) == "hell");
+        expect(slab.lent() == 0);
+        slab.reclaim(buf.base); // no effect
+        expect(slab.idle() == 0);
+
+        // Data inside a lent buffer is copied, and the buffer recycled
+        slab.lend(512, &buf);
+        std::memcpy(buf.base, "hello", 5);
+        Buffer tail = slab.take(buf.base + 1, 4);
+        expect(std::string(tail.begin(), tail.end()) == "ello");
+        expect(slab.lent() == 0);
+        expect(slab.idle() == 1);
+
+        // Data which was not lent by the slab is copied
+        std::string data("world");
+        Buffer copied = slab.take(data.data(), data.size());
+        expect(std::string(copied.begin(), copied.end()) == data);
+
+        uv::closeLoop(loop);
+        delete loop;
+    });
+
+
+    describe("request pool", []() {
+        auto loop = uv::createLoop();
+        auto& pool = uv::RequestPool<uv_write_t>::get(loop);
+
+        auto req = pool.acquire();
+        expect(pool.misses() == 1);
+        expect(pool.active() == 1);
+        uv::RequestPool<uv_write_t>::release(req);
+        expect(pool.active() == 0);
+        expect(pool.idle() == 1);
+
+        // Released storage is recycled
+        auto req1 = pool.acquire();
+        expect(req1 == req);
+        expect(pool.hits() == 1);
+        uv::RequestPool<uv_write_t>::release(req1);
+
+        // Request wrappers are recycled on completion
+        bool called = false;
+        auto& wrap = uv::createRequest<uv::GetAddrInfoReq>([&](const uv::GetAddrInfoEvent& event) {
+            called = true;
+        }, loop);
+        uv::GetAddrInfoReq::defaultCallback(&wrap.req, 0);
+        expect(called);
+        expect(uv::RequestPool<uv::GetAddrInfoReq>::get(loop).active() == 0);
+        expect(uv::RequestPool<uv::GetAddrInfoReq>::get(loop).idle() == 1);
+
+        // The single argument overload draws from the default loop's pool
+        auto& defaultWrap = uv::createRequest<uv::GetAddrInfoReq>(nullptr);
+        expect(uv::RequestPool<uv::GetAddrInfoReq>::get(uv::defaultLoop()).active() == 1);
+        uv::GetAddrInfoReq::defaultCallback(&defaultWrap.req, 0);
+        expect(uv::RequestPool<uv::GetAddrInfoReq>::get(uv::defaultLoop()).active() == 0);
+
+        // Pending callbacks release their requests before the pools go
+        auto pending = uv::RequestPool<uv_write_t>::get(loop).acquire();
+        uv_async_t async;
+        async.data = pending;
+        uv_async_init(loop, &async, [](uv_async_t* handle) {
+            uv::RequestPool<uv_write_t>::release(static_cast<uv_write_t*>(handle->data));
+            uv_close(reinterpret_cast<uv_handle_t*>(handle), nullptr);
+        });
+        uv_async_send(&async);
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
+
+    // =========================================================================
+    // Timeout Scheduler
+    //
+    describe("timeout scheduler", []() {
+        auto loop = uv::createLoop();
+        auto& scheduler = TimeoutScheduler::get(loop);
+        expect(&scheduler == &TimeoutScheduler::get(loop));
+
+        std::vector<int> order;
+        {
+            // The scheduler timer does not reference the loop
+            Timer keepalive(50, loop, []() {});
+            keepalive.handle().ref();
+
+            scheduler.schedule(20, [&]() {
+                order.push_back(2);
+
+                // Timeouts scheduled inside callbacks run on the next pass
+                scheduler.schedule(0, [&]() { order.push_back(3); });
+            });
+            auto id = scheduler.schedule(10, [&]() { order.push_back(0); });
+            scheduler.schedule(5, [&]() { order.push_back(1); });
+            expect(scheduler.size() == 3);
+            expect(scheduler.pending(id));
+            expect(scheduler.cancel(id));
+            expect(!scheduler.cancel(id));
+            expect(scheduler.size() == 2);
+
+            uv::runLoop(loop);
+        }
+
+        expect(order.size() == 3);
+        expect(order[0] == 1);
+        expect(order[1] == 2);
+        expect(order[2] == 3);
+        expect(scheduler.size() == 0);
+
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
+
+    // =========================================================================
+    // Packet Transaction
+    //
+    describe("packet transaction backoff", []() {
+        struct Request
+        {
+            std::string toString() const { return "request"; }
+        };
+
+        // Records the retransmission timeout of each send, and the
+        // interval since the previous one
+        struct Transaction : public PacketTransaction<Request>
+        {
+            std::vector<long>& rtos;
+            std::vector<uint64_t>& intervals;
+            Timer& keepalive;
+            uint64_t last = 0;
+
+            Transaction(std::vector<long>& rtos, std::vector<uint64_t>& intervals,
+                        Timer& keepalive, long timeout, int retries)
+                : PacketTransaction<Request>(timeout, retries)
+                , rtos(rtos)
+                , intervals(intervals)
+                , keepalive(keepalive)
+            {
+            }
+
+            bool send() override
+            {
+                uint64_t now = uv_now(uv::defaultLoop());
+                if (last)
+                    intervals.push_back(now - last);
+                last = now;
+                int attempts = this->attempts();
+                bool ret = PacketTransaction<Request>::send();
+                if (this->attempts() > attempts)
+                    rtos.push_back(rto());
+                return ret;
+            }
+
+            bool checkResponse(const Request&) override { return false; }
+
+            // The transaction timeouts don't reference the loop
+            void onStateChange(TransactionState& state, const TransactionState& old) override
+            {
+                if (state.equals(TransactionState::Failed))
+                    keepalive.handle().unref();
+                PacketTransaction<Request>::onStateChange(state, old);
+            }
+        };
+
+        // Each retransmission waits twice as long, up to the cap
+        std::vector<long> rtos;
+        std::vector<uint64_t> intervals;
+        Timer keepalive(10000, uv::defaultLoop(), []() {});
+        keepalive.handle().ref();
+        auto transaction = new Transaction(rtos, intervals, keepalive, 10, 4);
+        transaction->setBackoff(true, 40);
+        transaction->send();
+        uv::runLoop();
+        expect(rtos == std::vector<long>({10, 20, 40, 40, 40}));
+        expect(intervals.size() == 4 && intervals[0] >= 10 && intervals[1] >= 20 &&
+               intervals[2] >= 40 && intervals[3] >= 40);
+
+        // Without backoff every attempt uses the transaction timeout
+        rtos.clear();
+        keepalive.handle().ref();
+        transaction = new Transaction(rtos, intervals, keepalive, 10, 2);
+        transaction->send();
+        uv::runLoop();
+        expect(rtos == std::vector<long>({10, 10, 10}));
+        keepalive.stop();
+    });
+
+
+    // =========================================================================
+    // Encoding
+    //
+    describe("base64", []() {
+        expect(base64::encode(std::string("f")) == "Zg==");
+        expect(base64::encode(std::string("fo")) == "Zm8=");
+        expect(base64::encode(std::string("foo")) == "Zm9v");
+        expect(base64::encode(std::string("foobar")) == "Zm9vYmFy");
+        expect(base64::encode(std::string()) == "");
+        expect(base64::decode(std::string("Zm9v\nYmE=")) == "fooba");
+
+        // Sizes either side of the vectorized block widths, checked
+        // against the byte at a time state machine
+        int lineLengths[] = { 0, 72, 76 };
+        for (size_t size = 0; size < 300; size++) {
+            std::string data = util::randomBinaryString(static_cast<int>(size));
+            for (int lineLength : lineLengths) {
+                base64::Encoder enc;
+                enc.setLineLength(lineLength);
+                std::string expected(base64::encodedSize(size, lineLength) + 4, '\0');
+                size_t len = 0;
+                for (size_t i = 0; i < size; i++)
+                    len += enc.encode(&data[i], 1, &expected[len]);
+                len += enc.finalize(&expected[len]);
+                expected.resize(len);
+
+                std::string out(base64::encodedSize(size, lineLength), '\0');
+                out.resize(base64::encode(data.data(), size, &out[0], lineLength));
+                expect(out == expected);
+                expect(base64::decode(out) == data);
+            }
+        }
+
+        // Characters outside the alphabet are skipped
+        std::string data = util::randomBinaryString(1000);
+        std::string encoded = base64::encode(data, 0);
+        for (size_t i = 7; i < encoded.size(); i += 29)
+            encoded.insert(i, i % 2 ? "\r\n" : " ");
+        expect(base64::decode(encoded) == data);
+
+        // Streaming decode in uneven chunks
+        base64::Decoder dec;
+        std::string decoded(base64::decodedSize(encoded.size()), '\0');
+        size_t len = 0;
+        for (size_t i = 0; i < encoded.size(); i += 37)
+            len += dec.decode(&encoded[i], std::min<size_t>(37, encoded.size() - i), &decoded[len]);
+        decoded.resize(len);
+        expect(decoded == data);
+    });
+
+    describe("hex", []() {
+        expect(hex::encode(std::string("\x01\xab\xff")) == "01abff");
+        char upper[6];
+        expect(hex::encode("\x01\xab\xff", 3, upper, true) == 6);
+        expect(std::string(upper, 6) == "01ABFF");
+
+        for (size_t size = 0; size < 200; size++) {
+            std::string data = util::randomBinaryString(static_cast<int>(size));
+            std::string expected;
+            for (unsigned char c : data) {
+                expected += "0123456789abcdef"[c >> 4];
+                expected += "0123456789abcdef"[c & 0xf];
+            }
+            std::string out = hex::encode(data);
+            expect(out == expected);
+
+            std::string decoded(size, '\0');
+            expect(hex::decode(out.data(), out.size(), &decoded[0]) == size);
+            expect(decoded == data);
+
+            // The stream encoder breaks lines every 72 characters
+            hex::Encoder enc;
+            std::string lines(size * 3, '\0');
+            lines.resize(enc.encode(data.data(), size, &lines[0]));
+            std::string wrapped;
+            for (size_t i = 0; i < expected.size(); i += 72)
+                wrapped += expected.substr(i, 72) + (i + 72 <= expected.size() ? "\n" : "");
+            expect(lines == wrapped);
+            decoded.assign(size, '\0');
+            expect(hex::decode(lines.data(), lines.size(), &decoded[0]) == size);
+            expect(decoded == data);
+        }
+
+        char out[4];
+        expect(hex::decode("0A bC", 5, out) == 2);
+        expect(out[0] == 0x0a && out[1] == '\xbc');
+        try {
+            hex::decode("0g", 2, out);
+            expect(0 && "must throw");
+        } catch (std::runtime_error&) {
+        }
+        try {
+            hex::decode("abc", 3, out);
+            expect(0 && "must throw");
+        } catch (std::runtime_error&) {
+        }
+    });
+
+
     // =========================================================================
     // Collection
     //
@@ -417,6 +740,30 @@ int main(int argc, char** argv)
     });
 
 
+    describe("logger level threshold", []() {
+        expect(!Logger::enabled(Level::Trace));
+
+        // Arguments of dropped messages are never evaluated
+        int evaluated = 0;
+        LTrace("dropped ", ++evaluated)
+        STrace << "dropped " << ++evaluated << endl;
+        expect(evaluated == 0);
+
+#ifdef SCY_ENABLE_LOGGING
+        Logger& logger = Logger::instance();
+        auto channel = new LogChannel("threshold", Level::Info);
+        logger.add(channel);
+        expect(!Logger::enabled(Level::Debug));
+        expect(Logger::enabled(Level::Info));
+        channel->setLevel(Level::Trace);
+        expect(Logger::enabled(Level::Trace));
+        logger.remove("threshold");
+        expect(!Logger::enabled(Level::Fatal));
+#endif
+        Logger::destroy();
+    });
+
+
     // =========================================================================
     // Platform
     //
@@ -496,6 +843,272 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // Loop Metrics
+    //
+    describe("loop metrics", []() {
+        auto loop = uv::defaultLoop();
+        auto& metrics = uv::LoopMetrics::get(loop);
+        expect(uv::LoopMetrics::find(loop) == nullptr);
+        metrics.start();
+        expect(uv::LoopMetrics::find(loop) == &metrics);
+
+        // Collectors are visible from any thread
+        uv::LoopMetrics* other = nullptr;
+        std::thread([&]() { other = uv::LoopMetrics::find(loop); }).join();
+        expect(other == &metrics);
+
+        // A collector destroyed on another thread is no longer found
+        auto closed = uv::createLoop();
+        uv::LoopMetrics::get(closed).start();
+        expect(uv::LoopMetrics::find(closed) != nullptr);
+        std::thread([&]() { uv::closeLoop(closed); }).join();
+        expect(uv::LoopMetrics::find(closed) == nullptr);
+        delete closed;
+
+        // Stall the loop inside a timer callback
+        uv_update_time(loop);
+        Timer timer(10, loop, []() {
+            uint64_t until = uv_hrtime() + 5000000;
+            while (uv_hrtime() < until) {
+            }
+        });
+        timer.handle().ref();
+
+        // Record synchronizer post-to-run latency
+        bool synced = false;
+        Synchronizer sync([&]() { synced = true; }, loop);
+        sync.handle().unref();
+        sync.post();
+
+        uv::runLoop(loop);
+        expect(synced);
+
+        auto snapshot = metrics.snapshot();
+        expect(snapshot.iterations > 0);
+        expect(snapshot.lag.max >= 5000000);
+        expect(snapshot.callbacks[UV_TIMER].count == 1);
+        expect(snapshot.callbacks[UV_TIMER].max >= 5000000);
+        expect(snapshot.syncLatency.count == 1);
+        expect(snapshot.handles[UV_TIMER] >= 1);
+        expect(snapshot.handles[UV_PREPARE] >= 1);
+
+        std::string json(snapshot.toJSON());
+        expect(json.find("\"timer\":{\"count\":1,") != std::string::npos);
+        expect(json.find("\"syncLatency\":{\"count\":1,") != std::string::npos);
+
+        metrics.stop();
+        expect(uv::LoopMetrics::find(loop) == nullptr);
+        sync.close();
+        uv::runLoop(loop);
+    });
+
+
+    // =========================================================================
+    // Executor
+    //
+    describe("executor", []() {
+        auto loop = uv::defaultLoop();
+        auto& executor = uv::Executor::get(loop);
+        expect(&uv::Executor::get(loop) == &executor);
+
+        // The loop thread is bound once the loop runs,
+        // and dispatch runs inline on the loop thread
+        bool inLoop = false;
+        bool ran = false;
+        executor.ref();
+        executor.post([&]() {
+            inLoop = executor.inLoopThread();
+            uv::dispatch(loop, [&]() { ran = true; });
+            expect(ran);
+            executor.unref();
+        });
+        uv::runLoop(loop);
+        expect(inLoop);
+
+        // Post from multiple threads, keeping the loop alive until done
+        const int numThreads = 4;
+        const int numTasks = 10000;
+        int total = 0;
+        bool ordered = true;
+        std::vector<int> last(numThreads, -1);
+        std::vector<std::unique_ptr<Thread>> threads;
+        executor.ref();
+        for (int t = 0; t < numThreads; t++) {
+            threads.emplace_back(new Thread([&, t]() {
+                for (int i = 0; i < numTasks; i++) {
+                    executor.post([&, t, i]() {
+                        ordered = ordered && last[t] == i - 1;
+                        last[t] = i;
+                        if (++total == numThreads * numTasks)
+                            executor.unref();
+                    });
+                }
+            }));
+        }
+        uv::runLoop(loop);
+        for (auto& thread : threads)
+            thread->join();
+        expect(total == numThreads * numTasks);
+        expect(ordered);
+
+        // Callables larger than the inline storage
+        char large[uv::Executor::InlineSize * 2] = "large";
+        std::string result;
+        executor.ref();
+        executor.post([&, large]() {
+            result = large;
+            executor.unref();
+        });
+        uv::runLoop(loop);
+        expect(result == "large");
+
+        // Synchronize items pushed from another thread
+        int numItems = 0;
+        SyncQueue<int> queue(loop, 0);
+        queue.ondispatch = [&](int& item) {
+            expect(item == numItems);
+            if (++numItems == numTasks)
+                queue.cancel();
+        };
+        Thread producer([&]() {
+            for (int i = 0; i < numTasks; i++)
+                queue.push(new int(i));
+        });
+        uv::runLoop(loop);
+        producer.join();
+        expect(numItems == numTasks);
+        expect(queue.size() == 0);
+
+        // Queues may be created by other threads while the loop
+        // is running, as SyncDelegate and PacketStream do
+        std::unique_ptr<SyncQueue<int>> remote;
+        int remoteItems = 0;
+        executor.ref();
+        Thread creator([&]() {
+            remote.reset(new SyncQueue<int>(loop));
+            remote->ondispatch = [&](int&) {
+                if (++remoteItems == 10) {
+                    remote->cancel();
+                    executor.unref();
+                }
+            };
+            for (int i = 0; i < 10; i++)
+                remote->push(new int(i));
+        });
+        uv::runLoop(loop);
+        creator.join();
+        expect(remoteItems == 10);
+    });
+
+
+    // =========================================================================
+    // Task Pool
+    //
+    describe("task pool", []() {
+        struct CountTask : public Task
+        {
+            std::atomic<int>& count;
+            int runs;
+            bool destroyOnLast;
+
+            CountTask(std::atomic<int>& count, int runs = 1, bool destroyOnLast = false)
+                : Task(runs > 1)
+                , count(count)
+                , runs(runs)
+                , destroyOnLast(destroyOnLast)
+            {
+            }
+
+            void run() override
+            {
+                count++;
+                if (--runs == 0) {
+                    if (destroyOnLast)
+                        destroy();
+                    else
+                        cancel();
+                }
+            }
+        };
+
+        const int numTasks = 1000;
+        std::atomic<int> count(0);
+        TaskPool pool(4);
+        expect(pool.size() == 4);
+
+        // One shot tasks remain managed until destroyed
+        std::vector<Task*> tasks;
+        for (int i = 0; i < numTasks; i++) {
+            tasks.push_back(new CountTask(count));
+            pool.start(tasks.back());
+        }
+        while (count.load() < numTasks)
+            scy::sleep(1);
+        for (auto task : tasks) {
+            expect(pool.exists(task));
+            expect(pool.get(task->id()) == task);
+            pool.destroy(task);
+        }
+        for (auto task : tasks) {
+            while (pool.exists(task))
+                scy::sleep(1);
+        }
+
+        // Repeating tasks which destroy themselves
+        count = 0;
+        for (int i = 0; i < 10; i++)
+            pool.start(new CountTask(count, 100, true));
+        while (count.load() < 1000)
+            scy::sleep(1);
+        scy::sleep(10);
+        expect(count.load() == 1000);
+
+        // Cancelled tasks are not run
+        auto task = new CountTask(count, 100);
+        task->cancel();
+        pool.start(task);
+        scy::sleep(10);
+        expect(count.load() == 1000);
+        expect(pool.exists(task));
+
+        pool.shutdown();
+        expect(!pool.exists(task));
+    });
+
+
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+    // =========================================================================
+    // Coroutines
+    //
+    describe("coroutines", []() {
+        auto loop = uv::defaultLoop();
+
+        // Nested tasks run in order and return values to their awaiter
+        std::vector<int> order;
+        Signal<void(int)> signal;
+        Timer timer(10, 10, loop, [&]() {
+            if (order.size() == 3)
+                signal.emit(7);
+            if (order.size() == 4)
+                timer.stop();
+        });
+        timer.handle().ref();
+        coro::spawn(coroSequence(loop, signal, order));
+        uv::runLoop(loop);
+        expect(order == std::vector<int>({20, 10, 32, 7}));
+
+        // Exceptions propagate to the awaiter
+        bool caught = false;
+        coro::spawn([](uv::Loop* loop, bool& caught) -> coro::Task<> {
+            caught = co_await coroCatch(loop);
+        }(loop, caught));
+        uv::runLoop(loop);
+        expect(caught);
+    });
+#endif
+
+
     // =========================================================================
     // Thread
     //
@@ -546,12 +1159,45 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // Packet Pipeline
+    //
+    describe("packet pipeline", []() {
+        PacketPipeline<MockPacketProcessor, MockSuffixProcessor, MockSuffixProcessor> pipeline(
+            std::make_tuple(), std::make_tuple("a"), std::make_tuple("b"));
+        expect(pipeline.size() == 3);
+        expect(pipeline.get<1>().suffix == "a");
+
+        std::string output;
+        pipeline.emitter += [&](IPacket& packet) {
+            output.assign(packet.data(), packet.size());
+        };
+        RawPacket packet("x", 1);
+        pipeline.process(packet);
+        expect(output == "xab");
+
+        // Attach the pipeline to a packet stream
+        int numPackets = 0;
+        PacketStream stream;
+        stream.attach(makePipeline<MockSuffixProcessor>(std::make_tuple("z")));
+        stream.emitter += [&](IPacket& packet) {
+            expect(std::string(packet.data(), packet.size()) == "yz");
+            numPackets++;
+        };
+        stream.start();
+        stream.write("y", 1);
+        stream.close();
+        expect(numPackets == 1);
+    });
+
+
     // Define class based tests
     describe("signal", new SignalTest);
     describe("ipc", new IpcTest);
     describe("timer", new TimerTest);
     describe("packet stream", new PacketStreamTest);
     describe("packet stream file io", new PacketStreamIOTest);
+    describe("realtime packet queue", new RealtimePacketQueueTest);
     // describe("multi packet stream", new MultiPacketStreamTest);
 
     test::runAll();
@@ -14,21 +14,35 @@
 #include "scy/base.h"
 #include "scy/test.h"
 #include "scy/application.h"
+#include "scy/av/realtimepacketqueue.h"
+#include "scy/base64.h"
 #include "scy/buffer.h"
 #include "scy/datetime.h"
 #include "scy/collection.h"
+#include "scy/coro.h"
+#include "scy/executor.h"
 #include "scy/filesystem.h"
+#include "scy/hex.h"
 #include "scy/idler.h"
 #include "scy/ipc.h"
 #include "scy/logger.h"
+#include "scy/loopmetrics.h"
 #include "scy/packetio.h"
+#include "scy/packetpipeline.h"
 #include "scy/packetqueue.h"
 #include "scy/packetstream.h"
+#include "scy/packettransaction.h"
 #include "scy/platform.h"
+#include "scy/pool.h"
+#include "scy/queue.h"
 #include "scy/process.h"
 #include "scy/sharedlibrary.h"
 #include "scy/signal.h"
+#include "scy/slab.h"
+#include "scy/synchronizer.h"
+#include "scy/taskpool.h"
 #include "scy/time.h"
+#include "scy/timeoutscheduler.h"
 #include "scy/timer.h"
 #include "scy/thread.h"
 #include "scy/util.h"
@@ -137,6 +151,46 @@ class TimerTest : public Test
 };
 
 
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+// =============================================================================
+// Coroutine Test
+//
+inline coro::Task<int> coroSleepAdd(uv::Loop* loop, int value, std::vector<int>& order)
+{
+    co_await coro::sleep(loop, value);
+    order.push_back(value);
+    co_return value + 1;
+}
+
+
+inline coro::Task<> coroSequence(uv::Loop* loop, Signal<void(int)>& signal, std::vector<int>& order)
+{
+    int a = co_await coroSleepAdd(loop, 20, order);
+    int b = co_await coroSleepAdd(loop, 10, order);
+    order.push_back(a + b);
+    order.push_back(co_await coro::next(signal));
+}
+
+
+inline coro::Task<> coroThrow(uv::Loop* loop)
+{
+    co_await coro::sleep(loop, 0);
+    throw std::runtime_error("failed");
+}
+
+
+inline coro::Task<bool> coroCatch(uv::Loop* loop)
+{
+    try {
+        co_await coroThrow(loop);
+    } catch (std::runtime_error&) {
+        co_return true;
+    }
+    co_return false;
+}
+#endif
+
+
 // =============================================================================
 // Idler Test
 //
@@ -400,6 +454,23 @@ struct MockPacketProcessor : public PacketProcessor
     }
 };
 
+struct MockSuffixProcessor : public PacketProcessor
+{
+    PacketSignal emitter;
+    std::string suffix;
+
+    MockSuffixProcessor(const std::string& suffix = "")
+        : PacketProcessor(emitter)
+        , suffix(suffix)
+    {
+    }
+
+    void process(IPacket& packet)
+    {
+        emit(std::string(packet.data(), packet.size()) + suffix);
+    }
+};
+
 class PacketStreamTest : public Test
 {
     int numPackets;
@@ -547,6 +618,112 @@ class MultiPacketStreamTest : public Test
 };
 
 
+
+// =============================================================================
+// Realtime Packet Queue
+//
+class RealtimePacketQueueTest : public Test
+{
+    // Exposes the playout clock so it can be moved
+    struct Queue : public av::RealtimePacketQueue<av::MediaPacket>
+    {
+        using av::RealtimePacketQueue<av::MediaPacket>::setStartTime;
+    };
+
+    std::mutex mutex;
+    std::vector<int64_t> played;
+
+    void listen(Queue& queue)
+    {
+        queue.emitter += [&](IPacket& packet) {
+            std::lock_guard<std::mutex> guard(mutex);
+            played.push_back(static_cast<av::MediaPacket&>(packet).time);
+        };
+    }
+
+    static void push(Queue& queue, int64_t time)
+    {
+        queue.push(new av::MediaPacket(nullptr, 0, time));
+    }
+
+    // Wait up to `timeout` milliseconds for `count` packets to play out
+    bool waitFor(size_t count, int timeout)
+    {
+        for (int elapsed = 0; elapsed < timeout; elapsed += 5) {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (played.size() >= count)
+                    return true;
+            }
+            scy::sleep(5);
+        }
+        return false;
+    }
+
+    void run()
+    {
+        {
+            // Packets play out in time order
+            Queue queue;
+            listen(queue);
+            int64_t now = queue.realTime();
+            push(queue, now + 30000);
+            push(queue, now + 10000);
+            push(queue, now + 20000);
+            expect(waitFor(3, 1000));
+            expect(played == std::vector<int64_t>({now + 10000, now + 20000, now + 30000}));
+
+            // Late packets play out at once without a jitter buffer
+            push(queue, now - 1000);
+            expect(waitFor(4, 1000));
+            expect(queue.stats().late == 1);
+            expect(queue.stats().dropped == 0);
+            expect(queue.stats().dispatched == 4);
+        }
+
+        {
+            // The jitter buffer drops packets which are past their deadline
+            played.clear();
+            Queue queue;
+            listen(queue);
+            queue.setJitterBuffer(20000);
+            int64_t now = queue.realTime();
+            push(queue, now - 50000);
+            push(queue, now);
+            expect(queue.stats().late == 1);
+            expect(queue.stats().dropped == 1);
+            expect(queue.stats().pushed == 1);
+            expect(waitFor(1, 1000));
+            expect(played == std::vector<int64_t>({now}));
+        }
+
+        {
+            // Moving the clock wakes a thread waiting on the old deadline
+            played.clear();
+            Queue queue;
+            listen(queue);
+            push(queue, queue.realTime() + 10000000);
+            expect(!waitFor(1, 20));
+            queue.setStartTime(time::hrtime() - 20000000000ULL);
+            expect(waitFor(1, 1000));
+        }
+
+        {
+            // A queue closed from its own dispatch thread is
+            // joined when it is destroyed
+            played.clear();
+            std::unique_ptr<Queue> queue(new Queue);
+            listen(*queue);
+            Queue* self = queue.get();
+            queue->emitter += [self](IPacket&) { self->close(); };
+            push(*queue, queue->realTime());
+            expect(waitFor(1, 1000));
+            queue.reset();
+            expect(played.size() == 1);
+        }
+    }
+};
+
 } // namespace scy
 
 
@@ -14,6 +14,7 @@
 
 
 #include "scy/crypto/crypto.h"
+#include <openssl/evp.h>
 #include <string>
 
 
@@ -28,6 +29,54 @@ namespace crypto {
 std::string computeHMAC(const std::string& input, const std::string& key);
 
 
+/// HMAC-SHA1 context with a precomputed key schedule.
+///
+/// The inner and outer pad digests are computed once when the key is set,
+/// so each subsequent MAC only hashes the input and the inner digest.
+/// This suits protocols such as STUN long-term credentials where many
+/// messages are signed or verified with the same key.
+///
+/// A context is not thread-safe, since the digest state is reused
+/// between calls.
+class Crypto_API HMACContext
+{
+public:
+    /// Size of the SHA1 MAC in bytes.
+    static const size_t Size = 20;
+
+    HMACContext();
+    HMACContext(const std::string& key);
+    ~HMACContext();
+
+    /// Set the key and precompute the pad digests.
+    void setKey(const char* key, size_t length);
+    void setKey(const std::string& key);
+
+    /// Return true if a key has been set.
+    bool valid() const;
+
+    /// Compute the MAC of the input into `mac`,
+    /// which must hold at least `Size` bytes.
+    void compute(const void* data, size_t length, unsigned char* mac) const;
+
+    /// Compute the MAC of the input string.
+    std::string compute(const std::string& input) const;
+
+    /// Return true if `mac` matches the MAC of the input.
+    /// The comparison is performed in constant time.
+    bool verify(const void* data, size_t length, const void* mac, size_t macLength) const;
+
+protected:
+    HMACContext(const HMACContext&) = delete;
+    HMACContext& operator=(const HMACContext&) = delete;
+
+    EVP_MD_CTX* _inner;
+    EVP_MD_CTX* _outer;
+    EVP_MD_CTX* _work;
+    bool _valid;
+};
+
+
 } // namespace crypto
 } // namespace scy
 
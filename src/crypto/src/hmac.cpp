@@ -20,8 +20,11 @@
 // continue to watch this issue for a real fix.
 #undef OCSP_RESPONSE
 #endif
+#include <openssl/crypto.h>
 #include <openssl/hmac.h>
 
+#include <cstring>
+
 
 namespace scy {
 namespace crypto {
@@ -42,6 +45,118 @@ std::string computeHMAC(const std::string& input, const std::string& key)
 }
 
 
+//
+// HMAC Context
+//
+
+
+namespace {
+
+const size_t kBlockSize = 64; // SHA1 block size
+
+} // namespace
+
+
+HMACContext::HMACContext()
+    : _inner(EVP_MD_CTX_new())
+    , _outer(EVP_MD_CTX_new())
+    , _work(EVP_MD_CTX_new())
+    , _valid(false)
+{
+    if (!_inner || !_outer || !_work)
+        internal::throwError();
+}
+
+
+HMACContext::HMACContext(const std::string& key)
+    : HMACContext()
+{
+    setKey(key);
+}
+
+
+HMACContext::~HMACContext()
+{
+    EVP_MD_CTX_free(_inner);
+    EVP_MD_CTX_free(_outer);
+    EVP_MD_CTX_free(_work);
+}
+
+
+void HMACContext::setKey(const char* key, size_t length)
+{
+    // Keys longer than the block size are hashed first (RFC 2104)
+    unsigned char block[kBlockSize] = {0};
+    if (length > kBlockSize) {
+        unsigned int len = 0;
+        internal::api(EVP_Digest(key, length, block, &len, EVP_sha1(), nullptr));
+    } else if (length > 0) {
+        std::memcpy(block, key, length);
+    }
+
+    unsigned char pad[kBlockSize];
+    for (size_t i = 0; i < kBlockSize; i++)
+        pad[i] = block[i] ^ 0x36;
+    internal::api(EVP_DigestInit_ex(_inner, EVP_sha1(), nullptr));
+    internal::api(EVP_DigestUpdate(_inner, pad, kBlockSize));
+
+    for (size_t i = 0; i < kBlockSize; i++)
+        pad[i] = block[i] ^ 0x5c;
+    internal::api(EVP_DigestInit_ex(_outer, EVP_sha1(), nullptr));
+    internal::api(EVP_DigestUpdate(_outer, pad, kBlockSize));
+
+    OPENSSL_cleanse(block, kBlockSize);
+    OPENSSL_cleanse(pad, kBlockSize);
+    _valid = true;
+}
+
+
+void HMACContext::setKey(const std::string& key)
+{
+    setKey(key.data(), key.length());
+}
+
+
+bool HMACContext::valid() const
+{
+    return _valid;
+}
+
+
+void HMACContext::compute(const void* data, size_t length, unsigned char* mac) const
+{
+    assert(_valid);
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    internal::api(EVP_MD_CTX_copy_ex(_work, _inner));
+    internal::api(EVP_DigestUpdate(_work, data, length));
+    internal::api(EVP_DigestFinal_ex(_work, digest, &len));
+
+    internal::api(EVP_MD_CTX_copy_ex(_work, _outer));
+    internal::api(EVP_DigestUpdate(_work, digest, len));
+    internal::api(EVP_DigestFinal_ex(_work, mac, &len));
+    assert(len == Size);
+}
+
+
+std::string HMACContext::compute(const std::string& input) const
+{
+    unsigned char mac[Size];
+    compute(input.data(), input.length(), mac);
+    return std::string(reinterpret_cast<char*>(mac), Size);
+}
+
+
+bool HMACContext::verify(const void* data, size_t length, const void* mac, size_t macLength) const
+{
+    if (macLength != Size)
+        return false;
+    unsigned char expected[Size];
+    compute(data, length, expected);
+    return CRYPTO_memcmp(expected, mac, Size) == 0;
+}
+
+
 } // namespace crypto
 } // namespace scy
 
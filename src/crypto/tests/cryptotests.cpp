@@ -1,6 +1,7 @@
 #include "scy/crypto/crypto.h"
 #include "scy/crypto/cipher.h"
 #include "scy/crypto/hash.h"
+#include "scy/crypto/hmac.h"
 #include "scy/crypto/rsa.h"
 #include "scy/test.h"
 #include "scy/logger.h"
@@ -159,6 +160,28 @@ int main(int argc, char** argv)
         expect(hex::encode(engine.digest()) == "57edf4a22be3c955ac49da2e2107b67a");
     });
 
+    // =========================================================================
+    // HMAC
+    //
+    describe("hmac", []() {
+        // test vectors from RFC 2202
+
+        crypto::HMACContext ctx(std::string(20, '\x0b'));
+        expect(hex::encode(ctx.compute("Hi There")) == "b617318655057264e28bc0b6fb378c8ef146be00");
+
+        ctx.setKey("Jefe");
+        std::string input("what do ya want for nothing?");
+        std::string mac(ctx.compute(input));
+        expect(hex::encode(mac) == "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79");
+        expect(mac == crypto::computeHMAC(input, "Jefe"));
+        expect(ctx.verify(input.data(), input.size(), mac.data(), mac.size()));
+        mac[0] ^= 1;
+        expect(!ctx.verify(input.data(), input.size(), mac.data(), mac.size()));
+
+        ctx.setKey(std::string(80, '\xaa'));
+        expect(hex::encode(ctx.compute("Test Using Larger Than Block-Size Key - Hash Key First")) == "aa4ae5e15272d00e95705637ce8a3b55ed402112");
+    });
+
     // =========================================================================
     // Hex
     //
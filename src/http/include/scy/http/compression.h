@@ -0,0 +1,205 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#ifndef SCY_HTTP_Compression_H
+#define SCY_HTTP_Compression_H
+
+
+#include "scy/http/http.h"
+#include "scy/base.h"
+#include "scy/buffer.h"
+
+#include <memory>
+#include <string>
+
+
+struct z_stream_s;
+
+
+namespace scy {
+namespace http {
+
+
+/// Stream formats supported by the zlib wrappers.
+enum class CompressionFormat
+{
+    Gzip,    ///< RFC 1952 gzip stream (Content-Encoding: gzip)
+    Deflate, ///< RFC 1950 zlib stream (Content-Encoding: deflate)
+    Raw      ///< RFC 1951 raw deflate stream (WebSocket permessage-deflate)
+};
+
+
+/// Response compression options for the HTTP server.
+struct CompressionOptions
+{
+    bool enabled = false; ///< Compress responses when the client accepts it
+    size_t minSize = 1024; ///< Bodies smaller than this are sent as is
+    int level = -1;       ///< zlib compression level, or -1 for the default
+};
+
+
+/// Returns the Content-Encoding token for the given format.
+HTTP_API const char* contentCodingName(CompressionFormat format);
+
+/// Selects the preferred content coding from an Accept-Encoding
+/// header value, favouring gzip over deflate.
+/// Returns false if neither is acceptable.
+HTTP_API bool negotiateContentCoding(const std::string& acceptEncoding,
+                                     CompressionFormat& format);
+
+
+//
+// Deflater
+//
+
+
+/// Streaming zlib compressor.
+class HTTP_API Deflater
+{
+public:
+    typedef std::shared_ptr<Deflater> Ptr;
+
+    enum Flush
+    {
+        NoFlush,   ///< Buffer input for better compression
+        SyncFlush, ///< Emit all pending output on a byte boundary
+        Finish     ///< Emit all pending output and end the stream
+    };
+
+    /// Creates a compressor. The window size is given in bits (9-15)
+    /// and memLevel (1-9) trades memory for speed.
+    Deflater(CompressionFormat format, int windowBits = 15,
+             int level = -1, int memLevel = 8);
+    ~Deflater();
+
+    /// Compresses `len` bytes and appends the output to `out`.
+    /// Returns the number of bytes appended.
+    size_t compress(const char* data, size_t len, Buffer& out,
+                    Flush flush = SyncFlush);
+
+    /// Resets the stream so it can be reused without reallocating.
+    void reset();
+
+    CompressionFormat format() const;
+    int windowBits() const;
+    int level() const;
+    int memLevel() const;
+
+protected:
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    std::unique_ptr<z_stream_s> _stream;
+    CompressionFormat _format;
+    int _windowBits;
+    int _level;
+    int _memLevel;
+};
+
+
+//
+// Inflater
+//
+
+
+/// Streaming zlib decompressor.
+class HTTP_API Inflater
+{
+public:
+    typedef std::shared_ptr<Inflater> Ptr;
+
+    /// Creates a decompressor. The window size must be at least
+    /// as large as the one used by the compressor.
+    Inflater(CompressionFormat format, int windowBits = 15);
+    ~Inflater();
+
+    /// Decompresses `len` bytes and appends the output to `out`.
+    /// Returns the number of bytes appended.
+    ///
+    /// Throws if the data is corrupt, or if more than `maxSize` bytes
+    /// would be appended when `maxSize` is not zero.
+    size_t decompress(const char* data, size_t len, Buffer& out,
+                      size_t maxSize = 0);
+
+    /// Resets the stream so it can be reused without reallocating.
+    void reset();
+
+    CompressionFormat format() const;
+    int windowBits() const;
+
+protected:
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    std::unique_ptr<z_stream_s> _stream;
+    CompressionFormat _format;
+    int _windowBits;
+};
+
+
+//
+// Compression Pool
+//
+
+
+/// Pool of idle zlib streams shared between connections.
+///
+/// Each stream holds up to a few hundred kilobytes of state, so
+/// rather than allocating one per connection, streams are borrowed
+/// from the pool and returned when the returned pointer is released.
+/// At most `maxIdle` streams of each configuration are kept, which
+/// bounds the idle memory regardless of how many connections come
+/// and go. This class is thread-safe.
+class HTTP_API CompressionPool
+{
+public:
+    CompressionPool(size_t maxIdle = 32);
+    ~CompressionPool();
+
+    /// Returns a reset compressor with the given configuration.
+    Deflater::Ptr deflater(CompressionFormat format, int windowBits = 15,
+                           int level = -1, int memLevel = 8);
+
+    /// Returns a reset decompressor with the given configuration.
+    Inflater::Ptr inflater(CompressionFormat format, int windowBits = 15);
+
+    /// Sets the number of idle streams kept per configuration.
+    void setMaxIdle(size_t maxIdle);
+
+    /// Returns the number of idle streams held by the pool.
+    size_t idle() const;
+
+    /// Frees all idle streams.
+    void clear();
+
+    /// Returns the default CompressionPool singleton.
+    static CompressionPool& instance();
+
+    /// Destroys the default CompressionPool singleton.
+    static void destroy();
+
+protected:
+    CompressionPool(const CompressionPool&) = delete;
+    CompressionPool& operator=(const CompressionPool&) = delete;
+
+    struct State;
+    std::shared_ptr<State> _state;
+};
+
+
+} // namespace http
+} // namespace scy
+
+
+#endif // SCY_HTTP_Compression_H
+
+
+/// @\}
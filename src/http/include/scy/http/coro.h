@@ -0,0 +1,128 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#ifndef SCY_HTTP_Coro_H
+#define SCY_HTTP_Coro_H
+
+
+#include "scy/coro.h"
+
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+
+#include "scy/http/client.h"
+
+#include <stdexcept>
+
+
+namespace scy {
+namespace coro {
+
+
+/// Awaiter which sends an HTTP request and suspends the coroutine
+/// until the response is complete.
+///
+/// The await returns the connection's response, and throws
+/// std::runtime_error if the connection closes first. The
+/// Complete and Close signals are attached once per await.
+class RequestAwaiter
+{
+public:
+    RequestAwaiter(http::ClientConnection& conn, http::Request* request)
+        : _conn(conn)
+        , _request(request)
+        , _complete(-1)
+        , _close(-1)
+        , _suspending(false)
+        , _done(false)
+        , _success(false)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiter)
+    {
+        _awaiter = awaiter;
+        _complete = _conn.Complete.attach([this](const http::Response&) {
+            finish(true);
+        });
+        _close = _conn.Close.attach([this](http::Connection&) {
+            finish(false);
+        });
+
+        _suspending = true;
+        if (_request)
+            _conn.send(*_request);
+        else
+            _conn.send();
+        _suspending = false;
+
+        // Don't suspend if the connection failed while sending
+        return !_done;
+    }
+
+    http::Response& await_resume()
+    {
+        if (!_success) {
+            auto error = _conn.error();
+            throw std::runtime_error(error.any() ? error.message
+                                                 : "HTTP connection closed");
+        }
+        return _conn.response();
+    }
+
+protected:
+    void finish(bool success)
+    {
+        if (_done)
+            return;
+        _done = true;
+        _success = success;
+        _conn.Complete.detach(_complete);
+        _conn.Close.detach(_close);
+        if (!_suspending)
+            _awaiter.resume();
+    }
+
+    http::ClientConnection& _conn;
+    http::Request* _request;
+    int _complete;
+    int _close;
+    bool _suspending;
+    bool _done;
+    bool _success;
+    std::coroutine_handle<> _awaiter;
+};
+
+
+/// Send the connection's request and wait for the response.
+inline RequestAwaiter request(http::ClientConnection& conn)
+{
+    return RequestAwaiter(conn, nullptr);
+}
+
+
+/// Send the given request and wait for the response.
+inline RequestAwaiter request(http::ClientConnection& conn, http::Request& request)
+{
+    return RequestAwaiter(conn, &request);
+}
+
+
+} // namespace coro
+} // namespace scy
+
+
+#endif
+#endif // SCY_HTTP_Coro_H
+
+
+/// @\}
@@ -13,6 +13,7 @@
 #define SCY_HTTP_Packetizers_H
 
 
+#include "scy/http/compression.h"
 #include "scy/http/connection.h"
 #include "scy/signal.h"
 #include <sstream>
@@ -40,7 +41,9 @@ public:
         : PacketProcessor(this->emitter)
         , connection(connection)
         , contentType(connection->outgoingHeader()->getContentType())
+        , frameSeparator(frameSeparator)
         , initial(true)
+        , nocopy(nocopy)
     {
     }
 
@@ -237,6 +240,106 @@ public:
 };
 
 
+//
+// HTTP Content Encoder
+//
+
+
+/// Compresses a streaming response body with gzip or deflate.
+///
+/// Each packet is flushed so the peer can decode it on arrival.
+/// Call finish() before stopping the stream to emit the stream
+/// trailer. When created with a connection the coding is negotiated
+/// from the request's Accept-Encoding header, and packets pass through
+/// unchanged if the client accepts neither coding or the response
+/// declares a Content-Length below `minSize`. The encoder must be
+/// attached before any adapter which sends the response headers.
+class HTTP_API ContentEncoder : public IPacketizer
+{
+public:
+    Connection::Ptr connection;
+    CompressionFormat format;
+    int level;
+
+    ContentEncoder(Connection::Ptr connection, size_t minSize = 0, int level = -1)
+        : IPacketizer(this->emitter)
+        , connection(connection)
+        , format(CompressionFormat::Gzip)
+        , level(level)
+        , _passthrough(!negotiateContentCoding(
+              connection->incomingHeader()->get("Accept-Encoding", ""), format))
+    {
+        auto header = connection->outgoingHeader();
+        if (!_passthrough && header->hasContentLength() &&
+            header->getContentLength() < minSize)
+            _passthrough = true;
+        if (!_passthrough) {
+            header->setContentLength(Message::UNKNOWN_CONTENT_LENGTH);
+            header->set("Content-Encoding", contentCodingName(format));
+            header->add("Vary", "Accept-Encoding");
+        }
+    }
+
+    ContentEncoder(CompressionFormat format = CompressionFormat::Gzip, int level = -1)
+        : IPacketizer(this->emitter)
+        , connection(nullptr)
+        , format(format)
+        , level(level)
+        , _passthrough(false)
+    {
+    }
+
+    virtual ~ContentEncoder() {}
+
+    virtual void process(IPacket& packet) override
+    {
+        if (!packet.hasData())
+            throw std::invalid_argument("Incompatible packet type");
+
+        if (_passthrough) {
+            emit(packet);
+            return;
+        }
+
+        compress(packet.data(), packet.size(), Deflater::SyncFlush);
+    }
+
+    /// Ends the compressed stream and emits the trailer.
+    virtual void finish()
+    {
+        if (!_passthrough && _deflater) {
+            compress(nullptr, 0, Deflater::Finish);
+            _deflater = nullptr;
+        }
+    }
+
+    virtual void onStreamStateChange(const PacketStreamState& state) override
+    {
+        // Return the compressor to the pool
+        if (state.equals(PacketStreamState::Stopped) ||
+            state.equals(PacketStreamState::Closed))
+            _deflater = nullptr;
+    }
+
+    PacketSignal emitter;
+
+protected:
+    void compress(const char* data, size_t len, Deflater::Flush flush)
+    {
+        if (!_deflater)
+            _deflater = CompressionPool::instance().deflater(format, 15, level);
+
+        _buffer.clear();
+        if (_deflater->compress(data, len, _buffer, flush) > 0)
+            emit(_buffer.data(), _buffer.size());
+    }
+
+    Deflater::Ptr _deflater;
+    Buffer _buffer;
+    bool _passthrough;
+};
+
+
 } // namespace http
 } // namespace scy
 
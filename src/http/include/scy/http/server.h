@@ -15,10 +15,12 @@
 
 #include "scy/base.h"
 #include "scy/datetime.h"
+#include "scy/http/compression.h"
 #include "scy/http/connection.h"
 #include "scy/http/parser.h"
 #include "scy/http/request.h"
 #include "scy/http/response.h"
+#include "scy/http/websocket.h"
 #include "scy/logger.h"
 #include "scy/net/socket.h"
 #include "scy/timer.h"
@@ -44,6 +46,13 @@ public:
 
     Server& server();
 
+    /// Send raw data to the peer.
+    ///
+    /// If response compression is enabled on the server and the data
+    /// is the complete response body, it is compressed with a coding
+    /// accepted by the client before being sent.
+    virtual ssize_t send(const char* data, size_t len, int flags = 0) override;
+
     Signal<void(ServerConnection&, const MutableBuffer&)> Payload; ///< Signals when raw data is received
     Signal<void(ServerConnection&)> Close; ///< Signals when the connection is closed
 
@@ -110,6 +119,20 @@ private:
 };
 
 
+/// ServerResponder which serves the metrics of the server event
+/// loop as JSON.
+///
+/// Metrics must be enabled with `uv::LoopMetrics::get(loop).start()`
+/// for iteration lag and callback timings to be recorded.
+class HTTP_API LoopMetricsResponder : public ServerResponder
+{
+public:
+    LoopMetricsResponder(ServerConnection& connection);
+
+    virtual void onRequest(Request& request, Response& response) override;
+};
+
+
 /// This implementation of a ServerConnectionFactory
 /// is used by HTTP Server to create ServerConnection objects.
 class HTTP_API ServerConnectionFactory
@@ -159,6 +182,18 @@ public:
     /// Return the server bind address.
     net::Address& address();
 
+    /// Set the response compression options.
+    void setCompression(const CompressionOptions& options);
+
+    /// Return the response compression options.
+    const CompressionOptions& compression() const;
+
+    /// Set the permessage-deflate options for WebSocket connections.
+    void setWebSocketDeflate(const ws::DeflateOptions& options);
+
+    /// Return the permessage-deflate options for WebSocket connections.
+    const ws::DeflateOptions& webSocketDeflate() const;
+
     /// Signals when a new connection has been created.
     /// A reference to the new connection object is provided.
     Signal<void(ServerConnection::Ptr)> Connection;
@@ -181,6 +216,8 @@ protected:
     Timer _timer;
     ServerConnectionFactory* _factory;
     std::vector<ServerConnection::Ptr> _connections;
+    CompressionOptions _compression;
+    ws::DeflateOptions _webSocketDeflate;
 
     friend class ServerConnection;
 };
@@ -15,6 +15,7 @@
 
 #include "scy/base.h"
 #include "scy/buffer.h"
+#include "scy/http/compression.h"
 #include "scy/http/parser.h"
 #include "scy/http/request.h"
 #include "scy/http/response.h"
@@ -105,6 +106,27 @@ enum ErrorCodes
 };
 
 
+/// Options for the permessage-deflate extension (RFC 7692).
+///
+/// Clients offer the extension and servers accept offers when
+/// `enabled` is set. Window sizes are in bits (9-15); smaller windows
+/// use less memory per connection at some cost in ratio. Without
+/// context takeover a compressor is only borrowed from the
+/// CompressionPool while a message is sent, so idle connections
+/// hold no compression state.
+struct DeflateOptions
+{
+    bool enabled = false;
+    bool serverNoContextTakeover = false; ///< Reset the server compressor after each message
+    bool clientNoContextTakeover = false; ///< Reset the client compressor after each message
+    int serverMaxWindowBits = 15;         ///< Server compressor window size
+    int clientMaxWindowBits = 15;         ///< Client compressor window size
+    int level = -1;                       ///< zlib compression level
+    int memLevel = 8;                     ///< zlib memory level (1-9)
+    size_t minSize = 64;                  ///< Smaller messages are sent uncompressed
+};
+
+
 static std::string ProtocolGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
 /// The WebSocket protocol version supported (13).
@@ -128,6 +150,14 @@ public:
     /// Writes a WebSocket protocol frame from the given data.
     virtual size_t writeFrame(const char* data, size_t len, int flags, BitWriter& frame);
 
+    /// Frames a payload of `len` bytes in place.
+    ///
+    /// The payload must be preceded by at least MAX_HEADER_LENGTH bytes
+    /// of headroom, into which the frame header is written. The payload
+    /// is masked in place if required. Returns a pointer to the start of
+    /// the frame, which ends at the end of the payload.
+    virtual char* writeFrameInPlace(char* payload, size_t len, int flags);
+
     /// Reads a single WebSocket frame from the given buffer (frame).
     ///
     /// The actual payload length is returned, and the beginning of the
@@ -140,6 +170,21 @@ public:
 
     bool handshakeComplete() const;
 
+    /// Sets the permessage-deflate options.
+    /// Must be called before the handshake.
+    void setDeflateOptions(const ws::DeflateOptions& options);
+
+    /// Returns the permessage-deflate options.
+    const ws::DeflateOptions& deflateOptions() const;
+
+    /// Returns true if permessage-deflate was negotiated
+    /// during the handshake.
+    bool deflateNegotiated() const;
+
+    /// Releases compression state and clears the negotiated
+    /// extension so the framer can be reused.
+    void resetDeflate();
+
     //
     /// Server side
 
@@ -173,6 +218,28 @@ protected:
 
     ws::Mode mode() const;
 
+    /// Writes the frame header and fills the masking key if the
+    /// payload must be masked.
+    void writeHeader(size_t len, int flags, BitWriter& frame, char mask[4]);
+
+    /// Returns the permessage-deflate extension offer.
+    std::string createDeflateOffer() const;
+
+    /// Accepts the first acceptable permessage-deflate offer from the
+    /// given Sec-WebSocket-Extensions header and sets the response.
+    /// Returns false if no offer was acceptable.
+    bool acceptDeflateOffer(const std::string& offers, std::string& response);
+
+    /// Applies the extension parameters accepted by the server,
+    /// or throws if they are not valid for our offer.
+    void completeDeflateOffer(const std::string& response);
+
+    /// Compresses a message payload into the deflate buffer.
+    void deflatePayload(const char* data, size_t len);
+
+    /// Decompresses a frame payload into the inflate buffer.
+    void inflatePayload(const char* data, size_t len, bool fin);
+
     enum
     {
         FRAME_FLAG_MASK = 0x80,
@@ -188,6 +255,16 @@ private:
     bool _maskPayload;
     Random _rnd;
     std::string _key; // client handshake key
+    ws::DeflateOptions _deflateOptions;
+    bool _deflate;                  // permessage-deflate negotiated
+    bool _deflateNoContextTakeover; // reset our compressor after each message
+    bool _inflateNoContextTakeover; // reset our decompressor after each message
+    bool _inflating;                // receiving a compressed message
+    int _deflateWindowBits;
+    Deflater::Ptr _deflater;
+    Inflater::Ptr _inflater;
+    Buffer _deflated;
+    Buffer _inflated;
 
     friend class WebSocketAdapter;
 };
@@ -207,8 +284,18 @@ public:
     virtual ssize_t send(const char* data, size_t len, int flags = 0) override; // flags = ws::Text || ws::Binary
     virtual ssize_t send(const char* data, size_t len, const net::Address& peerAddr, int flags = 0) override; // flags = ws::Text || ws::Binary
 
+    /// Sends a packet as a single frame.
+    /// The packet is written directly into the frame buffer.
+    virtual ssize_t sendPacket(const IPacket& packet, int flags = 0) override;
+    virtual ssize_t sendPacket(const IPacket& packet, const net::Address& peerAddr, int flags = 0) override;
+    using net::SocketEmitter::sendPacket;
+
     virtual bool shutdown(uint16_t statusCode, const std::string& statusMessage);
 
+    /// Sets the permessage-deflate options.
+    /// Must be called before the handshake.
+    void setDeflateOptions(const ws::DeflateOptions& options);
+
     /// Pointer to the underlying socket.
     /// Sent data will be proxied to this socket.
     net::Socket::Ptr socket;
@@ -0,0 +1,436 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#include "scy/http/compression.h"
+#include "scy/http/util.h"
+#include "scy/singleton.h"
+#include "scy/util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <zlib.h>
+
+
+namespace scy {
+namespace http {
+
+
+namespace {
+
+
+int zlibWindowBits(CompressionFormat format, int windowBits)
+{
+    switch (format) {
+        case CompressionFormat::Gzip:
+            return windowBits + 16;
+        case CompressionFormat::Deflate:
+            return windowBits;
+        case CompressionFormat::Raw:
+        default:
+            return -windowBits;
+    }
+}
+
+
+} // namespace
+
+
+const char* contentCodingName(CompressionFormat format)
+{
+    switch (format) {
+        case CompressionFormat::Gzip:
+            return "gzip";
+        case CompressionFormat::Deflate:
+            return "deflate";
+        case CompressionFormat::Raw:
+        default:
+            return "identity";
+    }
+}
+
+
+bool negotiateContentCoding(const std::string& acceptEncoding,
+                            CompressionFormat& format)
+{
+    // Quality values for each coding, or -1 if not listed
+    double gzip = -1;
+    double deflate = -1;
+    double any = -1;
+    for (auto& item : util::split(acceptEncoding, ',')) {
+        std::string coding;
+        NVCollection params;
+        splitParameters(item, coding, params);
+        double q = params.has("q") ? std::atof(params.get("q").c_str()) : 1.0;
+        if (util::icompare(coding, std::string("gzip")) == 0 ||
+            util::icompare(coding, std::string("x-gzip")) == 0)
+            gzip = q;
+        else if (util::icompare(coding, std::string("deflate")) == 0)
+            deflate = q;
+        else if (coding == "*")
+            any = q;
+    }
+    if (gzip < 0)
+        gzip = any;
+    if (deflate < 0)
+        deflate = any;
+    if (gzip <= 0 && deflate <= 0)
+        return false;
+
+    format = gzip >= deflate ? CompressionFormat::Gzip : CompressionFormat::Deflate;
+    return true;
+}
+
+
+//
+// Deflater
+//
+
+
+Deflater::Deflater(CompressionFormat format, int windowBits, int level, int memLevel)
+    : _stream(new z_stream_s())
+    , _format(format)
+    , _windowBits(windowBits)
+    , _level(level)
+    , _memLevel(memLevel)
+{
+    // zlib no longer accepts 8 bit windows for raw streams
+    if (windowBits < 9 || windowBits > 15)
+        throw std::invalid_argument("Invalid deflate window size");
+
+    int ret = deflateInit2(_stream.get(), level, Z_DEFLATED,
+                           zlibWindowBits(format, windowBits),
+                           memLevel, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK)
+        throw std::runtime_error("Cannot initialize deflate stream: " +
+                                 std::string(zError(ret)));
+}
+
+
+Deflater::~Deflater()
+{
+    deflateEnd(_stream.get());
+}
+
+
+size_t Deflater::compress(const char* data, size_t len, Buffer& out, Flush flush)
+{
+    auto strm = _stream.get();
+    strm->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm->avail_in = static_cast<uInt>(len);
+
+    int mode = flush == Finish ? Z_FINISH
+                               : flush == SyncFlush ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+    size_t start = out.size();
+    size_t pos = start;
+    for (;;) {
+        // Size the output for the whole input, plus room for
+        // the flush marker or stream trailer
+        size_t chunk = deflateBound(strm, static_cast<uLong>(strm->avail_in)) + 16;
+        out.resize(pos + chunk);
+        strm->next_out = reinterpret_cast<Bytef*>(out.data() + pos);
+        strm->avail_out = static_cast<uInt>(chunk);
+
+        int ret = deflate(strm, mode);
+        if (ret == Z_STREAM_ERROR) {
+            out.resize(start);
+            throw std::runtime_error("Cannot deflate: Invalid stream state");
+        }
+        pos += chunk - strm->avail_out;
+
+        // Output space left over means all output has been produced
+        if (strm->avail_out != 0)
+            break;
+    }
+
+    out.resize(pos);
+    return pos - start;
+}
+
+
+void Deflater::reset()
+{
+    if (deflateReset(_stream.get()) != Z_OK)
+        throw std::runtime_error("Cannot reset deflate stream");
+}
+
+
+CompressionFormat Deflater::format() const
+{
+    return _format;
+}
+
+
+int Deflater::windowBits() const
+{
+    return _windowBits;
+}
+
+
+int Deflater::level() const
+{
+    return _level;
+}
+
+
+int Deflater::memLevel() const
+{
+    return _memLevel;
+}
+
+
+//
+// Inflater
+//
+
+
+Inflater::Inflater(CompressionFormat format, int windowBits)
+    : _stream(new z_stream_s())
+    , _format(format)
+    , _windowBits(windowBits)
+{
+    if (windowBits < 8 || windowBits > 15)
+        throw std::invalid_argument("Invalid inflate window size");
+
+    int ret = inflateInit2(_stream.get(), zlibWindowBits(format, windowBits));
+    if (ret != Z_OK)
+        throw std::runtime_error("Cannot initialize inflate stream: " +
+                                 std::string(zError(ret)));
+}
+
+
+Inflater::~Inflater()
+{
+    inflateEnd(_stream.get());
+}
+
+
+size_t Inflater::decompress(const char* data, size_t len, Buffer& out, size_t maxSize)
+{
+    auto strm = _stream.get();
+    strm->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm->avail_in = static_cast<uInt>(len);
+
+    size_t start = out.size();
+    size_t pos = start;
+    for (;;) {
+        size_t chunk = std::max<size_t>(len * 4, 4096);
+        if (maxSize)
+            chunk = std::min(chunk, maxSize - (pos - start) + 1);
+        out.resize(pos + chunk);
+        strm->next_out = reinterpret_cast<Bytef*>(out.data() + pos);
+        strm->avail_out = static_cast<uInt>(chunk);
+
+        int ret = inflate(strm, Z_SYNC_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
+            ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+            out.resize(start);
+            throw std::runtime_error("Cannot inflate: Corrupt or invalid data");
+        }
+        pos += chunk - strm->avail_out;
+
+        // Guard against small inputs which expand without bound
+        if (maxSize && pos - start > maxSize) {
+            out.resize(start);
+            throw std::runtime_error("Cannot inflate: Maximum size exceeded");
+        }
+        if (ret == Z_STREAM_END || strm->avail_out != 0)
+            break;
+    }
+
+    out.resize(pos);
+    return pos - start;
+}
+
+
+void Inflater::reset()
+{
+    if (inflateReset(_stream.get()) != Z_OK)
+        throw std::runtime_error("Cannot reset inflate stream");
+}
+
+
+CompressionFormat Inflater::format() const
+{
+    return _format;
+}
+
+
+int Inflater::windowBits() const
+{
+    return _windowBits;
+}
+
+
+//
+// Compression Pool
+//
+
+
+struct CompressionPool::State
+{
+    typedef std::tuple<int, int, int, int> DeflaterKey;
+    typedef std::tuple<int, int> InflaterKey;
+
+    std::mutex mutex;
+    size_t maxIdle;
+    std::map<DeflaterKey, std::vector<std::unique_ptr<Deflater>>> deflaters;
+    std::map<InflaterKey, std::vector<std::unique_ptr<Inflater>>> inflaters;
+
+    /// Returns a stream to its idle list, or frees it if the list
+    /// is full or the stream cannot be reset.
+    template <class T, class K>
+    void release(std::map<K, std::vector<std::unique_ptr<T>>>& lists,
+                 const K& key, T* ptr)
+    {
+        std::unique_ptr<T> stream(ptr);
+        try {
+            stream->reset();
+        } catch (std::exception&) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        auto& idle = lists[key];
+        if (idle.size() < maxIdle)
+            idle.push_back(std::move(stream));
+    }
+
+    template <class T, class K>
+    std::unique_ptr<T> acquire(std::map<K, std::vector<std::unique_ptr<T>>>& lists,
+                               const K& key)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = lists.find(key);
+        if (it == lists.end() || it->second.empty())
+            return nullptr;
+        std::unique_ptr<T> stream(std::move(it->second.back()));
+        it->second.pop_back();
+        return stream;
+    }
+};
+
+
+CompressionPool::CompressionPool(size_t maxIdle)
+    : _state(std::make_shared<State>())
+{
+    _state->maxIdle = maxIdle;
+}
+
+
+CompressionPool::~CompressionPool()
+{
+}
+
+
+Deflater::Ptr CompressionPool::deflater(CompressionFormat format, int windowBits,
+                                        int level, int memLevel)
+{
+    State::DeflaterKey key(int(format), windowBits, level, memLevel);
+    auto stream = _state->acquire(_state->deflaters, key);
+    if (!stream)
+        stream.reset(new Deflater(format, windowBits, level, memLevel));
+
+    // Streams released after the pool is gone are simply freed
+    std::weak_ptr<State> weak(_state);
+    return Deflater::Ptr(stream.release(), [weak, key](Deflater* ptr) {
+        if (auto state = weak.lock())
+            state->release(state->deflaters, key, ptr);
+        else
+            delete ptr;
+    });
+}
+
+
+Inflater::Ptr CompressionPool::inflater(CompressionFormat format, int windowBits)
+{
+    State::InflaterKey key(int(format), windowBits);
+    auto stream = _state->acquire(_state->inflaters, key);
+    if (!stream)
+        stream.reset(new Inflater(format, windowBits));
+
+    std::weak_ptr<State> weak(_state);
+    return Inflater::Ptr(stream.release(), [weak, key](Inflater* ptr) {
+        if (auto state = weak.lock())
+            state->release(state->inflaters, key, ptr);
+        else
+            delete ptr;
+    });
+}
+
+
+void CompressionPool::setMaxIdle(size_t maxIdle)
+{
+    std::lock_guard<std::mutex> guard(_state->mutex);
+    _state->maxIdle = maxIdle;
+    for (auto& it : _state->deflaters)
+        if (it.second.size() > maxIdle)
+            it.second.resize(maxIdle);
+    for (auto& it : _state->inflaters)
+        if (it.second.size() > maxIdle)
+            it.second.resize(maxIdle);
+}
+
+
+size_t CompressionPool::idle() const
+{
+    std::lock_guard<std::mutex> guard(_state->mutex);
+    size_t count = 0;
+    for (auto& it : _state->deflaters)
+        count += it.second.size();
+    for (auto& it : _state->inflaters)
+        count += it.second.size();
+    return count;
+}
+
+
+void CompressionPool::clear()
+{
+    std::lock_guard<std::mutex> guard(_state->mutex);
+    _state->deflaters.clear();
+    _state->inflaters.clear();
+}
+
+
+namespace {
+
+
+Singleton<CompressionPool>& poolSingleton()
+{
+    static Singleton<CompressionPool> singleton;
+    return singleton;
+}
+
+
+} // namespace
+
+
+CompressionPool& CompressionPool::instance()
+{
+    return *poolSingleton().get();
+}
+
+
+void CompressionPool::destroy()
+{
+    poolSingleton().destroy();
+}
+
+
+} // namespace http
+} // namespace scy
+
+
+/// @\}
@@ -12,6 +12,7 @@
 #include "scy/http/server.h"
 #include "scy/http/websocket.h"
 #include "scy/logger.h"
+#include "scy/loopmetrics.h"
 #include "scy/util.h"
 
 
@@ -146,6 +147,30 @@ net::Address& Server::address()
 }
 
 
+void Server::setCompression(const CompressionOptions& options)
+{
+    _compression = options;
+}
+
+
+const CompressionOptions& Server::compression() const
+{
+    return _compression;
+}
+
+
+void Server::setWebSocketDeflate(const ws::DeflateOptions& options)
+{
+    _webSocketDeflate = options;
+}
+
+
+const ws::DeflateOptions& Server::webSocketDeflate() const
+{
+    return _webSocketDeflate;
+}
+
+
 //
 // Server Connection
 //
@@ -181,6 +206,34 @@ Server& ServerConnection::server()
 }
 
 
+ssize_t ServerConnection::send(const char* data, size_t len, int flags)
+{
+    // Compress the response body if it is sent in one piece
+    const CompressionOptions& options = _server.compression();
+    CompressionFormat format;
+    if (options.enabled && !_closed && shouldSendHeader() &&
+        len > 0 && len >= options.minSize &&
+        _response.hasContentLength() && _response.getContentLength() == len &&
+        !_response.has("Content-Encoding") &&
+        negotiateContentCoding(_request.get("Accept-Encoding", ""), format)) {
+        Buffer body;
+        body.reserve(len / 2);
+        CompressionPool::instance().deflater(format, 15, options.level)->compress(
+            data, len, body, Deflater::Finish);
+
+        // Incompressible bodies are sent as is
+        if (body.size() < len) {
+            _response.set("Content-Encoding", contentCodingName(format));
+            _response.add("Vary", "Accept-Encoding");
+            _response.setContentLength(body.size());
+            return Connection::send(body.data(), body.size(), flags);
+        }
+    }
+
+    return Connection::send(data, len, flags);
+}
+
+
 void ServerConnection::onHeaders()
 {
     // LTrace("On headers")
@@ -216,6 +269,7 @@ void ServerConnection::onHeaders()
         // a deferred delete on the old adapter. No more callbacks will be
         // received from the old adapter after replaceAdapter is called.
         auto wsAdapter = new ws::ConnectionAdapter(this, ws::ServerSide);
+        wsAdapter->setDeflateOptions(_server.webSocketDeflate());
         replaceAdapter(wsAdapter);
 
         // Send the handshake request to the WS adapter for handling.
@@ -305,6 +359,26 @@ http::Message* ServerConnection::outgoingHeader()
 }
 
 
+//
+// Loop Metrics Responder
+//
+
+
+LoopMetricsResponder::LoopMetricsResponder(ServerConnection& connection)
+    : ServerResponder(connection)
+{
+}
+
+
+void LoopMetricsResponder::onRequest(Request& /* request */, Response& response)
+{
+    std::string body(uv::LoopMetrics::get(connection().socket()->loop()).toJSON());
+    response.setContentType("application/json");
+    response.setContentLength(body.size());
+    connection().send(body.c_str(), body.size());
+}
+
+
 } // namespace http
 } // namespace scy
 
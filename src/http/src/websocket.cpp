@@ -14,9 +14,15 @@
 #include "scy/crypto/hash.h"
 #include "scy/http/client.h"
 #include "scy/http/server.h"
+#include "scy/http/util.h"
 #include "scy/logger.h"
 #include "scy/numeric.h"
 #include "scy/random.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <inttypes.h>
 
@@ -80,6 +86,12 @@ WebSocketAdapter::~WebSocketAdapter()
 }
 
 
+void WebSocketAdapter::setDeflateOptions(const ws::DeflateOptions& options)
+{
+    framer.setDeflateOptions(options);
+}
+
+
 bool WebSocketAdapter::shutdown(uint16_t statusCode, const std::string& statusMessage)
 {
     char buffer[256];
@@ -108,9 +120,11 @@ ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address&
     if (!flags)
         flags = ws::SendFlags::Text;
 
-    // Frame and send the data
+    // Frame and send the data, leaving room for compressed
+    // payloads which are slightly larger than the input
     Buffer buffer;
-    buffer.reserve(len + WebSocketFramer::MAX_HEADER_LENGTH);
+    buffer.reserve(len + WebSocketFramer::MAX_HEADER_LENGTH +
+                   (framer.deflateNegotiated() ? len / 1000 + 32 : 0));
     BitWriter writer(buffer);
     framer.writeFrame(data, len, flags, writer);
 
@@ -119,6 +133,46 @@ ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address&
 }
 
 
+ssize_t WebSocketAdapter::sendPacket(const IPacket& packet, int flags)
+{
+    return sendPacket(packet, socket->peerAddress(), flags);
+}
+
+
+ssize_t WebSocketAdapter::sendPacket(const IPacket& packet, const net::Address& peerAddr, int flags)
+{
+    // Raw packets can be framed without writing them first
+    auto raw = dynamic_cast<const RawPacket*>(&packet);
+    if (raw)
+        return send(raw->data(), raw->size(), peerAddr, flags);
+
+    // Compressed payloads change size so can't be framed in place
+    if (framer.deflateNegotiated()) {
+        Buffer buffer;
+        buffer.reserve(1024);
+        packet.write(buffer);
+        return send(buffer.data(), buffer.size(), peerAddr, flags);
+    }
+
+    assert(framer.handshakeComplete());
+    if (!flags)
+        flags = ws::SendFlags::Text;
+
+    // Write the packet after room for the frame header,
+    // so the payload is framed without being copied again.
+    const size_t headroom = WebSocketFramer::MAX_HEADER_LENGTH;
+    Buffer buffer(headroom);
+    buffer.reserve(1024);
+    packet.write(buffer);
+
+    size_t len = buffer.size() - headroom;
+    char* frame = framer.writeFrameInPlace(buffer.data() + headroom, len, flags);
+
+    assert(socket);
+    return SocketAdapter::send(frame, buffer.data() + buffer.size() - frame, peerAddr, 0);
+}
+
+
 void WebSocketAdapter::sendClientRequest()
 {
     framer.createClientHandshakeRequest(_request);
@@ -322,6 +376,7 @@ void WebSocketAdapter::onSocketClose(net::Socket&)
     _response.clear();
     framer._headerState = 0;
     framer._frameFlags = 0;
+    framer.resetDeflate();
 
     // Emit closed event
     net::SocketEmitter::onSocketClose(*socket.get());
@@ -364,6 +419,11 @@ WebSocketFramer::WebSocketFramer(ws::Mode mode)
     , _frameFlags(0)
     , _headerState(0)
     , _maskPayload(mode == ws::ClientSide)
+    , _deflate(false)
+    , _deflateNoContextTakeover(false)
+    , _inflateNoContextTakeover(false)
+    , _inflating(false)
+    , _deflateWindowBits(15)
 {
 }
 
@@ -403,6 +463,8 @@ void WebSocketFramer::createClientHandshakeRequest(http::Request& request)
     assert(request.has("Sec-WebSocket-Version"));
     request.set("Sec-WebSocket-Key", _key);
     assert(request.has("Sec-WebSocket-Key"));
+    if (_deflateOptions.enabled)
+        request.set("Sec-WebSocket-Extensions", createDeflateOffer());
     _headerState++;
 }
 
@@ -461,6 +523,11 @@ void WebSocketFramer::acceptServerRequest(http::Request& request, http::Response
         response.set("Connection", "Upgrade");
         response.set("Sec-WebSocket-Accept", computeAccept(key));
 
+        std::string extensions;
+        if (_deflateOptions.enabled &&
+            acceptDeflateOffer(request.get("Sec-WebSocket-Extensions", ""), extensions))
+            response.set("Sec-WebSocket-Extensions", extensions);
+
         // Set headerState 2 since the handshake was accepted.
         _headerState = 2;
     } else
@@ -475,29 +542,20 @@ size_t WebSocketFramer::writeFrame(const char* data, size_t len, int flags, BitW
     assert(frame.position() == 0);
     // assert(frame.limit() >= size_t(len + MAX_HEADER_LENGTH));
 
-    frame.putU8(static_cast<uint8_t>(flags));
-    uint8_t lenByte(0);
-    if (_maskPayload) {
-        lenByte |= FRAME_FLAG_MASK;
-    }
-    if (len < 126) {
-        lenByte |= static_cast<uint8_t>(len);
-        frame.putU8(lenByte);
-    } else if (len < 65536) {
-        lenByte |= 126;
-        frame.putU8(lenByte);
-        frame.putU16(static_cast<uint16_t>(len));
-    } else {
-        lenByte |= 127;
-        frame.putU8(lenByte);
-        frame.putU64(static_cast<uint16_t>(len));
+    // Compress data messages if permessage-deflate was negotiated
+    if (_deflate && len >= _deflateOptions.minSize &&
+        (flags == ws::SendFlags::Text || flags == ws::SendFlags::Binary)) {
+        deflatePayload(data, len);
+        data = _deflated.data();
+        len = _deflated.size();
+        flags |= unsigned(ws::FrameFlags::Rsv1);
     }
 
+    char m[4];
+    writeHeader(len, flags, frame, m);
+
     if (_maskPayload) {
-        auto mask = _rnd.next();
-        auto m = reinterpret_cast<const char*>(&mask);
         auto b = reinterpret_cast<const char*>(data);
-        frame.put(m, 4);
         // auto p = frame.current();
         for (unsigned i = 0; i < len; i++) {
             // p[i] = b[i] ^ m[i % 4];
@@ -522,6 +580,56 @@ size_t WebSocketFramer::writeFrame(const char* data, size_t len, int flags, BitW
 }
 
 
+char* WebSocketFramer::writeFrameInPlace(char* payload, size_t len, int flags)
+{
+    assert(flags == ws::SendFlags::Text || flags == ws::SendFlags::Binary ||
+        flags == ws::SendFlags::Ping || flags == ws::SendFlags::Pong);
+    assert(!_deflate && "compressed frames cannot be written in place");
+
+    char header[MAX_HEADER_LENGTH];
+    char m[4];
+    BitWriter writer(header, MAX_HEADER_LENGTH);
+    writeHeader(len, flags, writer, m);
+
+    if (_maskPayload) {
+        for (size_t i = 0; i < len; i++)
+            payload[i] ^= m[i % 4];
+    }
+
+    char* frame = payload - writer.position();
+    std::memcpy(frame, header, writer.position());
+    return frame;
+}
+
+
+void WebSocketFramer::writeHeader(size_t len, int flags, BitWriter& frame, char mask[4])
+{
+    frame.putU8(static_cast<uint8_t>(flags));
+    uint8_t lenByte(0);
+    if (_maskPayload) {
+        lenByte |= FRAME_FLAG_MASK;
+    }
+    if (len < 126) {
+        lenByte |= static_cast<uint8_t>(len);
+        frame.putU8(lenByte);
+    } else if (len < 65536) {
+        lenByte |= 126;
+        frame.putU8(lenByte);
+        frame.putU16(static_cast<uint16_t>(len));
+    } else {
+        lenByte |= 127;
+        frame.putU8(lenByte);
+        frame.putU64(static_cast<uint64_t>(len));
+    }
+
+    if (_maskPayload) {
+        auto key = _rnd.next();
+        std::memcpy(mask, &key, 4);
+        frame.put(mask, 4);
+    }
+}
+
+
 uint64_t WebSocketFramer::readFrame(BitReader& frame, char*& payload)
 {
     assert(handshakeComplete());
@@ -595,6 +703,33 @@ uint64_t WebSocketFramer::readFrame(BitReader& frame, char*& payload)
 
     // Update frame length to include payload plus header
     frame.seek(size_t(offset + payloadOffset + payloadLength));
+
+    // Inflate compressed messages. Only the first frame of a
+    // message carries the RSV1 bit, so continuation frames of
+    // a compressed message are inflated too.
+    unsigned opcode = flags & unsigned(ws::Opcode::Bitmask);
+    if (flags & unsigned(ws::FrameFlags::Rsv1)) {
+        if (!_deflate)
+            throw std::runtime_error(
+                "WebSocket error: Compressed frame without permessage-deflate");
+        if (opcode != unsigned(ws::Opcode::Text) &&
+            opcode != unsigned(ws::Opcode::Binary))
+            throw std::runtime_error(
+                "WebSocket error: Invalid compressed frame");
+        _inflating = true;
+        _frameFlags &= ~unsigned(ws::FrameFlags::Rsv1);
+    } else if (opcode != unsigned(ws::Opcode::Continuation) &&
+               opcode < unsigned(ws::Opcode::Close))
+        _inflating = false;
+
+    if (_inflating && opcode < unsigned(ws::Opcode::Close)) {
+        bool fin = (flags & unsigned(ws::FrameFlags::Fin)) != 0;
+        inflatePayload(payload, static_cast<size_t>(payloadLength), fin);
+        payload = _inflated.data();
+        payloadLength = _inflated.size();
+        if (fin)
+            _inflating = false;
+    }
     // frame.limit(offset + payloadOffset + payloadLength);
     // int frameLength = (offset + payloadOffset);
     // assert(frame.position() == (offset + payloadOffset));
@@ -617,6 +752,9 @@ void WebSocketFramer::completeClientHandshake(http::Response& response)
     std::string accept = response.get("Sec-WebSocket-Accept", "");
     if (accept != computeAccept(_key))
         throw std::runtime_error("WebSocket error: Invalid or missing Sec-WebSocket-Accept header in handshake esponse"); //, ws::ErrorNoHandshake
+    std::string extensions = response.get("Sec-WebSocket-Extensions", "");
+    if (!extensions.empty())
+        completeDeflateOffer(extensions);
 
     _headerState++;
     assert(handshakeComplete());
@@ -647,6 +785,243 @@ bool WebSocketFramer::mustMaskPayload() const
 }
 
 
+//
+// Permessage-deflate extension
+//
+
+
+namespace {
+
+
+const char* kDeflateExtension = "permessage-deflate";
+
+
+// Parses a window size parameter, returning 0 if invalid
+int parseWindowBits(const std::string& value)
+{
+    if (value.empty() || value.size() > 2 ||
+        !std::all_of(value.begin(), value.end(), ::isdigit))
+        return 0;
+    int bits = std::atoi(value.c_str());
+    return bits >= 8 && bits <= 15 ? bits : 0;
+}
+
+
+// zlib can't compress with 8 bit windows
+int clampWindowBits(int bits)
+{
+    return std::min(std::max(bits, 9), 15);
+}
+
+
+} // namespace
+
+
+void WebSocketFramer::setDeflateOptions(const ws::DeflateOptions& options)
+{
+    assert(_headerState == 0);
+    _deflateOptions = options;
+    _deflateOptions.serverMaxWindowBits = clampWindowBits(options.serverMaxWindowBits);
+    _deflateOptions.clientMaxWindowBits = clampWindowBits(options.clientMaxWindowBits);
+}
+
+
+const ws::DeflateOptions& WebSocketFramer::deflateOptions() const
+{
+    return _deflateOptions;
+}
+
+
+bool WebSocketFramer::deflateNegotiated() const
+{
+    return _deflate;
+}
+
+
+void WebSocketFramer::resetDeflate()
+{
+    _deflate = false;
+    _deflateNoContextTakeover = false;
+    _inflateNoContextTakeover = false;
+    _inflating = false;
+    _deflateWindowBits = 15;
+    _deflater = nullptr;
+    _inflater = nullptr;
+    Buffer().swap(_deflated);
+    Buffer().swap(_inflated);
+}
+
+
+std::string WebSocketFramer::createDeflateOffer() const
+{
+    std::ostringstream offer;
+    offer << kDeflateExtension << "; client_max_window_bits";
+    if (_deflateOptions.clientMaxWindowBits < 15)
+        offer << "=" << _deflateOptions.clientMaxWindowBits;
+    if (_deflateOptions.serverMaxWindowBits < 15)
+        offer << "; server_max_window_bits=" << _deflateOptions.serverMaxWindowBits;
+    if (_deflateOptions.serverNoContextTakeover)
+        offer << "; server_no_context_takeover";
+    if (_deflateOptions.clientNoContextTakeover)
+        offer << "; client_no_context_takeover";
+    return offer.str();
+}
+
+
+bool WebSocketFramer::acceptDeflateOffer(const std::string& offers, std::string& response)
+{
+    assert(_mode == ws::ServerSide);
+
+    // Offers are listed in order of preference
+    for (auto& offer : util::split(offers, ',')) {
+        std::string name;
+        NVCollection params;
+        splitParameters(offer, name, params);
+        if (name != kDeflateExtension)
+            continue;
+
+        bool serverNoContextTakeover = _deflateOptions.serverNoContextTakeover;
+        bool clientNoContextTakeover = _deflateOptions.clientNoContextTakeover;
+        int serverBits = _deflateOptions.serverMaxWindowBits;
+        int clientBits = 0; // not supported by the client unless offered
+        bool requestedServerBits = false;
+        bool valid = true;
+        std::set<std::string> seen;
+        for (auto& param : params) {
+            const std::string& key = param.first;
+            const std::string& value = param.second;
+            if (!seen.insert(key).second)
+                valid = false;
+            else if (key == "server_no_context_takeover" && value.empty())
+                serverNoContextTakeover = true;
+            else if (key == "client_no_context_takeover" && value.empty())
+                clientNoContextTakeover = true;
+            else if (key == "server_max_window_bits") {
+                int bits = parseWindowBits(value);
+                if (bits < 9) // zlib can't honour 8 bit windows
+                    valid = false;
+                else {
+                    serverBits = std::min(serverBits, bits);
+                    requestedServerBits = true;
+                }
+            } else if (key == "client_max_window_bits") {
+                clientBits = value.empty() ? 15 : parseWindowBits(value);
+                if (!clientBits)
+                    valid = false;
+            } else
+                valid = false;
+        }
+        if (!valid)
+            continue;
+
+        std::ostringstream accepted;
+        accepted << kDeflateExtension;
+        if (serverNoContextTakeover)
+            accepted << "; server_no_context_takeover";
+        if (clientNoContextTakeover)
+            accepted << "; client_no_context_takeover";
+        if (requestedServerBits || serverBits < 15)
+            accepted << "; server_max_window_bits=" << serverBits;
+        if (clientBits) {
+            clientBits = std::min(clientBits, _deflateOptions.clientMaxWindowBits);
+            if (clientBits < 15)
+                accepted << "; client_max_window_bits=" << clientBits;
+        }
+        response = accepted.str();
+
+        _deflate = true;
+        _deflateWindowBits = serverBits;
+        _deflateNoContextTakeover = serverNoContextTakeover;
+        _inflateNoContextTakeover = clientNoContextTakeover;
+        return true;
+    }
+    return false;
+}
+
+
+void WebSocketFramer::completeDeflateOffer(const std::string& response)
+{
+    assert(_mode == ws::ClientSide);
+
+    std::string name;
+    NVCollection params;
+    splitParameters(response, name, params);
+    if (!_deflateOptions.enabled || name != kDeflateExtension ||
+        response.find(',') != std::string::npos)
+        throw std::runtime_error("WebSocket error: Unsupported extension in handshake response: " + response);
+
+    _deflateNoContextTakeover = _deflateOptions.clientNoContextTakeover;
+    _inflateNoContextTakeover = false;
+    _deflateWindowBits = _deflateOptions.clientMaxWindowBits;
+    std::set<std::string> seen;
+    for (auto& param : params) {
+        const std::string& key = param.first;
+        const std::string& value = param.second;
+        bool valid = seen.insert(key).second;
+        if (key == "server_no_context_takeover" && value.empty())
+            _inflateNoContextTakeover = true;
+        else if (key == "client_no_context_takeover" && value.empty())
+            _deflateNoContextTakeover = true;
+        else if (key == "server_max_window_bits") {
+            int bits = parseWindowBits(value);
+            valid = valid && bits && bits <= _deflateOptions.serverMaxWindowBits;
+        } else if (key == "client_max_window_bits") {
+            // zlib can't honour 8 bit windows, so fail rather
+            // than send data the server can't inflate
+            int bits = parseWindowBits(value);
+            valid = valid && bits >= 9;
+            _deflateWindowBits = std::min(_deflateWindowBits, bits);
+        } else
+            valid = false;
+        if (!valid)
+            throw std::runtime_error("WebSocket error: Invalid extension parameter in handshake response: " + key);
+    }
+    _deflate = true;
+}
+
+
+void WebSocketFramer::deflatePayload(const char* data, size_t len)
+{
+    if (!_deflater)
+        _deflater = CompressionPool::instance().deflater(
+            CompressionFormat::Raw, _deflateWindowBits,
+            _deflateOptions.level, _deflateOptions.memLevel);
+
+    // Each message ends with an empty block which is not sent
+    _deflated.clear();
+    _deflater->compress(data, len, _deflated, Deflater::SyncFlush);
+    assert(_deflated.size() >= 4);
+    _deflated.resize(_deflated.size() - 4);
+
+    // Without context takeover the compressor goes back to the pool
+    if (_deflateNoContextTakeover)
+        _deflater = nullptr;
+}
+
+
+void WebSocketFramer::inflatePayload(const char* data, size_t len, bool fin)
+{
+    // The peer's window may be up to 15 bits regardless of what it
+    // advertised, so always inflate with the largest window.
+    if (!_inflater)
+        _inflater = CompressionPool::instance().inflater(CompressionFormat::Raw, 15);
+
+    _inflated.clear();
+    size_t maxSize = static_cast<size_t>(_maxPayloadLength);
+    _inflater->decompress(data, len, _inflated, maxSize);
+    if (fin) {
+        // Restore the empty block stripped by the sender
+        static const char tail[4] = { '\x00', '\x00', '\xff', '\xff' };
+        _inflater->decompress(tail, 4, _inflated);
+        if (maxSize && _inflated.size() > maxSize)
+            throw std::runtime_error("WebSocket error: Payload length exceeds maximum");
+
+        if (_inflateNoContextTakeover)
+            _inflater = nullptr;
+    }
+}
+
+
 } // namespace ws
 } // namespace http
 } // namespace scy
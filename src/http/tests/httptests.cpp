@@ -103,6 +103,207 @@ int main(int argc, char** argv)
         expect(params.get("0") == "streaming");
     });
 
+    //
+    /// Compression Tests
+    //
+
+    describe("compression round trip", []() {
+        std::string data;
+        for (int i = 0; i < 200; i++)
+            data += "{\"user\":\"peer" + std::to_string(i) + "\",\"online\":true},";
+
+        http::CompressionPool pool(2);
+        for (auto format : { http::CompressionFormat::Gzip,
+                             http::CompressionFormat::Deflate,
+                             http::CompressionFormat::Raw }) {
+            Buffer compressed;
+            pool.deflater(format)->compress(data.data(), data.size(), compressed, http::Deflater::Finish);
+            expect(compressed.size() > 0);
+            expect(compressed.size() < data.size() / 4);
+
+            Buffer inflated;
+            pool.inflater(format)->decompress(compressed.data(), compressed.size(), inflated);
+            expect(std::string(inflated.data(), inflated.size()) == data);
+
+            // Output beyond the maximum size is rejected
+            bool thrown = false;
+            try {
+                Buffer limited;
+                pool.inflater(format)->decompress(compressed.data(), compressed.size(), limited, 100);
+            } catch (std::exception&) {
+                thrown = true;
+            }
+            expect(thrown);
+        }
+
+        // Released streams are kept for reuse
+        expect(pool.idle() == 6);
+        pool.setMaxIdle(0);
+        expect(pool.idle() == 0);
+    });
+
+    describe("content coding negotiation", []() {
+        http::CompressionFormat format;
+        expect(http::negotiateContentCoding("gzip, deflate, br", format));
+        expect(format == http::CompressionFormat::Gzip);
+        expect(http::negotiateContentCoding("deflate", format));
+        expect(format == http::CompressionFormat::Deflate);
+        expect(http::negotiateContentCoding("gzip;q=0.5, deflate;q=0.8", format));
+        expect(format == http::CompressionFormat::Deflate);
+        expect(http::negotiateContentCoding("*", format));
+        expect(format == http::CompressionFormat::Gzip);
+        expect(!http::negotiateContentCoding("gzip;q=0, identity", format));
+        expect(!http::negotiateContentCoding("", format));
+    });
+
+    describe("websocket permessage-deflate framing", []() {
+        for (bool takeover : { true, false }) {
+            http::ws::DeflateOptions options;
+            options.enabled = true;
+            options.serverNoContextTakeover = !takeover;
+            options.clientMaxWindowBits = 10;
+
+            http::ws::WebSocketFramer client(http::ws::ClientSide);
+            http::ws::WebSocketFramer server(http::ws::ServerSide);
+            client.setDeflateOptions(options);
+            server.setDeflateOptions(options);
+
+            http::Request request;
+            http::Response response;
+            client.createClientHandshakeRequest(request);
+            server.acceptServerRequest(request, response);
+            client.completeClientHandshake(response);
+            expect(client.deflateNegotiated());
+            expect(server.deflateNegotiated());
+            expect(response.get("Sec-WebSocket-Extensions").find("client_max_window_bits=10") != std::string::npos);
+
+            std::string message(4096, 'x');
+            for (int i = 0; i < 3; i++) {
+                for (auto sender : { &client, &server }) {
+                    auto receiver = sender == &client ? &server : &client;
+                    Buffer buffer(message.size() + 64);
+                    BitWriter writer(buffer);
+                    size_t frameLength = sender->writeFrame(message.data(), message.size(), http::ws::SendFlags::Text, writer);
+                    expect(frameLength < message.size() / 10);
+
+                    BitReader reader(buffer.data(), frameLength);
+                    char* payload = nullptr;
+                    uint64_t payloadLength = receiver->readFrame(reader, payload);
+                    expect(std::string(payload, size_t(payloadLength)) == message);
+                }
+            }
+        }
+
+        // Offers the server can't honour are declined
+        http::ws::DeflateOptions options;
+        options.enabled = true;
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        server.setDeflateOptions(options);
+        http::Request request;
+        http::Response response;
+        request.set("Connection", "Upgrade");
+        request.set("Upgrade", "websocket");
+        request.set("Sec-WebSocket-Version", http::ws::ProtocolVersion);
+        request.set("Sec-WebSocket-Key", "dGhlIHNhbXBsZSBub25jZQ==");
+        request.set("Sec-WebSocket-Extensions", "permessage-deflate; server_max_window_bits=8");
+        server.acceptServerRequest(request, response);
+        expect(!server.deflateNegotiated());
+        expect(!response.has("Sec-WebSocket-Extensions"));
+    });
+
+    describe("websocket frame in place", []() {
+        http::ws::WebSocketFramer client(http::ws::ClientSide);
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        http::Request request;
+        http::Response response;
+        client.createClientHandshakeRequest(request);
+        server.acceptServerRequest(request, response);
+        client.completeClientHandshake(response);
+
+        // Room for the largest frame header
+        const size_t headroom = 14;
+
+        // Masked client frames with 7 and 16 bit lengths read back intact
+        for (size_t len : { 100, 1000, 60000 }) {
+            std::string message(len, 'x');
+            for (size_t i = 0; i < len; i++)
+                message[i] = char(i % 251);
+
+            Buffer buffer(headroom);
+            buffer.insert(buffer.end(), message.begin(), message.end());
+            char* frame = client.writeFrameInPlace(buffer.data() + headroom, len, http::ws::SendFlags::Binary);
+            size_t frameLength = buffer.data() + buffer.size() - frame;
+            expect(frameLength == len + (len < 126 ? 2 : 4) + 4);
+
+            BitReader reader(frame, frameLength);
+            char* payload = nullptr;
+            expect(server.readFrame(reader, payload) == len);
+            expect(std::string(payload, len) == message);
+        }
+
+        // Frames of 64 KiB or more use the full 64 bit length
+        for (bool inPlace : { true, false }) {
+            size_t len = 70000;
+            std::string message(len, 'y');
+            Buffer buffer(headroom + len + headroom);
+            char* frame;
+            if (inPlace) {
+                std::copy(message.begin(), message.end(), buffer.begin() + headroom);
+                frame = server.writeFrameInPlace(buffer.data() + headroom, len, http::ws::SendFlags::Binary);
+            } else {
+                BitWriter writer(buffer);
+                server.writeFrame(message.data(), len, http::ws::SendFlags::Binary, writer);
+                frame = buffer.data();
+            }
+            expect((frame[1] & 0x7F) == 127);
+            BitReader reader(frame + 2, 8);
+            uint64_t length = 0;
+            reader.getU64(length);
+            expect(length == len);
+            expect(std::string(frame + 10, len) == message);
+        }
+    });
+
+    describe("websocket send packet", []() {
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        TestWebSocketAdapter adapter(server);
+        FrameCapture capture;
+        adapter.setSender(&capture);
+
+        // Written packets and raw packets are each sent as a single frame
+        std::string message(70000, 'z');
+        StringPacket packet(message);
+        expect(adapter.sendPacket(packet, net::Address(), http::ws::SendFlags::Text) > 0);
+        RawPacket raw(message.data(), message.size());
+        expect(adapter.sendPacket(raw, net::Address(), http::ws::SendFlags::Text) > 0);
+        expect(capture.frames.size() == 2);
+
+        for (auto& frame : capture.frames) {
+            // The server only accepts payloads up to 64 KiB, so check the
+            // header length and unmask the payload by hand.
+            expect((frame[1] & 0x7F) == 127);
+            BitReader lengthReader(frame.data() + 2, 8);
+            uint64_t length = 0;
+            lengthReader.getU64(length);
+            expect(length == message.size());
+            const char* mask = frame.data() + 10;
+            const char* data = mask + 4;
+            bool intact = frame.size() == message.size() + 14;
+            for (size_t i = 0; intact && i < message.size(); i++)
+                intact = char(data[i] ^ mask[i % 4]) == message[i];
+            expect(intact);
+        }
+
+        // Small packets read back through the server framer
+        capture.frames.clear();
+        adapter.sendPacket(StringPacket("hello"), net::Address(), http::ws::SendFlags::Text);
+        expect(capture.frames.size() == 1);
+        BitReader reader(capture.frames[0].data(), capture.frames[0].size());
+        char* payload = nullptr;
+        expect(server.readFrame(reader, payload) == 5);
+        expect(std::string(payload, 5) == "hello");
+    });
+
     //
     /// Default HTTP Client Connection Test
     //
@@ -234,6 +435,67 @@ int main(int argc, char** argv)
         expect(!conn->error().any());
     });
 
+    describe("websocket client and server with permessage-deflate", []() {
+        http::ws::DeflateOptions options;
+        options.enabled = true;
+        options.minSize = 0;
+
+        HTTPEchoTest test(100);
+        test.server.setWebSocketDeflate(options);
+        test.raiseServer();
+        auto conn = test.createConnection("ws", "/websocket");
+        auto adapter = dynamic_cast<http::ws::ConnectionAdapter*>(conn->adapter());
+        expect(adapter != nullptr);
+        adapter->setDeflateOptions(options);
+        conn->send("PING", 4);
+
+        uv::runLoop();
+
+        expect(conn->closed());
+        expect(!conn->error().any());
+        expect(test.numSuccess == 100);
+    });
+
+    describe("server response compression", []() {
+        std::string body;
+        for (int i = 0; i < 100; i++)
+            body += "{\"user\":\"peer" + std::to_string(i) + "\",\"online\":true},";
+
+        http::CompressionOptions options;
+        options.enabled = true;
+        auto socket = net::makeSocket<net::TCPSocket>();
+        http::Server server(net::Address("127.0.0.1", 0), socket, new JSONResponderFactory(body));
+        server.setCompression(options);
+        server.start();
+
+        std::ostringstream url;
+        url << "http://127.0.0.1:" << socket->address().port() << "/";
+        auto conn = http::Client::instance().createConnection(url.str());
+        std::string encoding;
+        Buffer payload;
+        conn->Headers += [&](http::Response& response) {
+            encoding = response.get("Content-Encoding", "");
+        };
+        conn->Payload += [&](const MutableBuffer& buffer) {
+            payload.insert(payload.end(), buffer.cstr(), buffer.cstr() + buffer.size());
+        };
+        conn->Complete += [&](const http::Response&) {
+            conn->close();
+            server.shutdown();
+        };
+        conn->request().set("Accept-Encoding", "gzip, deflate");
+        conn->request().setKeepAlive(false);
+        conn->send();
+
+        uv::runLoop();
+
+        expect(encoding == "gzip");
+        expect(payload.size() < body.size());
+        Buffer inflated;
+        http::Inflater(http::CompressionFormat::Gzip).decompress(payload.data(), payload.size(), inflated);
+        expect(std::string(inflated.data(), inflated.size()) == body);
+    });
+
     //
     /// Google Drive Upload Test
     //
@@ -7,6 +7,7 @@
 #include "scy/crypto/hash.h"
 #include "scy/filesystem.h"
 #include "scy/http/client.h"
+#include "scy/http/compression.h"
 #include "scy/http/connection.h"
 #include "scy/http/form.h"
 #include "scy/http/packetizers.h"
@@ -36,6 +37,65 @@ using scy::test::Test;
 namespace scy {
 
 
+//
+/// WebSocket Framing Helpers
+//
+
+/// Packet which is written from a string, so that it
+/// is not sent as a RawPacket.
+class StringPacket : public IPacket
+{
+public:
+    StringPacket(const std::string& data)
+        : data(data)
+    {
+    }
+
+    IPacket* clone() const override { return new StringPacket(*this); }
+    ssize_t read(const ConstBuffer&) override { return 0; }
+    void write(Buffer& buf) const override { buf.insert(buf.end(), data.begin(), data.end()); }
+    size_t size() const override { return data.size(); }
+    const char* className() const override { return "StringPacket"; }
+
+    std::string data;
+};
+
+
+/// Captures the frames written by a WebSocketAdapter.
+struct FrameCapture : public net::SocketAdapter
+{
+    std::vector<std::string> frames;
+
+    ssize_t send(const char* data, size_t len, int flags = 0) override
+    {
+        frames.emplace_back(data, len);
+        return len;
+    }
+
+    ssize_t send(const char* data, size_t len, const net::Address&, int flags = 0) override
+    {
+        return send(data, len, flags);
+    }
+};
+
+
+/// WebSocketAdapter with a completed handshake.
+struct TestWebSocketAdapter : public http::ws::WebSocketAdapter
+{
+    http::Request request;
+    http::Response response;
+
+    TestWebSocketAdapter(http::ws::WebSocketFramer& server)
+        : http::ws::WebSocketAdapter(net::makeSocket<net::TCPSocket>(),
+                                     http::ws::ClientSide, request, response)
+    {
+        framer.createClientHandshakeRequest(request);
+        server.acceptServerRequest(request, response);
+        framer.completeClientHandshake(response);
+    }
+};
+
+
 //
 /// HTTP Client Tests
 //
@@ -135,6 +195,44 @@ struct HTTPEchoTest
 };
 
 
+/// Responds to each request with a fixed JSON body.
+class JSONResponder : public http::ServerResponder
+{
+public:
+    JSONResponder(http::ServerConnection& connection, const std::string& body)
+        : http::ServerResponder(connection)
+        , body(body)
+    {
+    }
+
+    void onRequest(http::Request&, http::Response& response) override
+    {
+        response.setContentType("application/json");
+        response.setContentLength(body.size());
+        connection().send(body.c_str(), body.size());
+    }
+
+    std::string body;
+};
+
+
+class JSONResponderFactory : public http::ServerConnectionFactory
+{
+public:
+    JSONResponderFactory(const std::string& body)
+        : body(body)
+    {
+    }
+
+    http::ServerResponder* createResponder(http::ServerConnection& connection) override
+    {
+        return new JSONResponder(connection, body);
+    }
+
+    std::string body;
+};
+
+
 } // namespace scy
 
 
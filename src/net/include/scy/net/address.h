@@ -14,8 +14,9 @@
 
 
 #include "scy/net/net.h"
+#include <cstddef>
+#include <functional>
 #include <string>
-#include <memory>
 
 
 namespace scy {
@@ -26,7 +27,11 @@ namespace net {
 /// address. The address can belong either to the
 /// IPv4 or the IPv6 address family and consists of a
 /// host address and a port number.
-class Net_API AddressBase;
+///
+/// Addresses are trivially copyable values which hold the native socket
+/// address inline, so they can be created per packet without allocating.
+/// Comparison and hashing operate on the address bytes, and the string
+/// representation is only formatted when requested.
 class Net_API Address
 {
 public:
@@ -47,7 +52,7 @@ public:
     Address(const std::string& host, uint16_t port);
 
     /// Creates a Address by copying another one.
-    Address(const Address& addr);
+    Address(const Address& addr) = default;
 
     /// Creates a Address from a native socket address.
     Address(const struct sockaddr* addr, socklen_t length);
@@ -74,10 +79,10 @@ public:
     explicit Address(const std::string& hostAndPort);
 
     /// Destroys the Address.
-    ~Address();
+    ~Address() = default;
 
     /// Assigns another Address.
-    Address& operator=(const Address& addr);
+    Address& operator=(const Address& addr) = default;
 
     /// Swaps the Address with another one.
     void swap(Address& addr);
@@ -107,10 +112,14 @@ public:
     /// ie. not wildcard.
     bool valid() const;
 
+    /// Returns a hash of the address bytes and port.
+    std::size_t hash() const;
+
     static uint16_t resolveService(const std::string& service);
 
     static bool validateIP(const std::string& address);
 
+    /// Orders addresses by family, host address bytes and port.
     bool operator<(const Address& addr) const;
     bool operator==(const Address& addr) const;
     bool operator!=(const Address& addr) const;
@@ -125,7 +134,12 @@ protected:
     void init(const std::string& host, uint16_t port);
 
 private:
-    std::shared_ptr<AddressBase> _base;
+    union
+    {
+        struct sockaddr sa;
+        struct sockaddr_in v4;
+        struct sockaddr_in6 v6;
+    } _addr;
 };
 
 
@@ -133,6 +147,22 @@ private:
 } // namespace scy
 
 
+namespace std {
+
+
+template <>
+struct hash<scy::net::Address>
+{
+    size_t operator()(const scy::net::Address& addr) const
+    {
+        return addr.hash();
+    }
+};
+
+
+} // namespace std
+
+
 #endif // SCY_Net_Address_H
 
 
@@ -0,0 +1,293 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup net
+/// @{
+
+
+#ifndef SCY_Net_Coro_H
+#define SCY_Net_Coro_H
+
+
+#include "scy/coro.h"
+
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+
+#include "scy/net/address.h"
+#include "scy/net/socket.h"
+#include "scy/net/socketadapter.h"
+
+#include <stdexcept>
+#include <string>
+
+
+namespace scy {
+namespace coro {
+
+
+//
+// DNS
+//
+
+
+/// Awaiter which resolves a host name to an address.
+///
+/// The getaddrinfo request is embedded in the awaiter, and the
+/// await throws std::runtime_error if the host cannot be resolved.
+class ResolveAwaiter
+{
+public:
+    ResolveAwaiter(const std::string& host, uint16_t port, uv::Loop* loop)
+        : _host(host)
+        , _service(std::to_string(port))
+        , _loop(loop)
+        , _status(0)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiter)
+    {
+        _awaiter = awaiter;
+        _req.data = this;
+
+        struct addrinfo hints = {};
+        hints.ai_family = PF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        _status = uv_getaddrinfo(_loop, &_req, [](uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+            auto self = static_cast<ResolveAwaiter*>(req->data);
+            self->_status = status;
+            if (!status)
+                self->_address = net::Address(res->ai_addr, static_cast<socklen_t>(res->ai_addrlen));
+            uv_freeaddrinfo(res);
+            self->_awaiter.resume();
+        }, _host.c_str(), _service.c_str(), &hints);
+
+        // Don't suspend if the request could not be started
+        return _status == 0;
+    }
+
+    net::Address await_resume()
+    {
+        if (_status)
+            throw std::runtime_error("Cannot resolve DNS for " + _host + ": " + uv_strerror(_status));
+        return _address;
+    }
+
+protected:
+    std::string _host;
+    std::string _service;
+    uv::Loop* _loop;
+    int _status;
+    uv_getaddrinfo_t _req;
+    net::Address _address;
+    std::coroutine_handle<> _awaiter;
+};
+
+
+/// Resolve a host name to an address.
+inline ResolveAwaiter resolve(const std::string& host, uint16_t port,
+                              uv::Loop* loop = uv::defaultLoop())
+{
+    return ResolveAwaiter(host, port, loop);
+}
+
+
+//
+// Socket
+//
+
+
+/// Awaitable wrapper for stream sockets.
+///
+/// The wrapper is attached to the socket as a receiver for its lifetime,
+/// so awaiting a connection or incoming data doesn't attach anything per
+/// call. Received data is buffered until read, and the buffers are reused
+/// so a warmed up connection reads without allocating. Only one coroutine
+/// may wait on each operation at a time.
+///
+/// The wrapper must be destroyed before the socket is closed by a
+/// coroutine which is still waiting on it.
+class Socket : public net::SocketAdapter
+{
+public:
+    /// Create the wrapper and attach it to the socket.
+    Socket(const net::Socket::Ptr& socket)
+        : net::SocketAdapter(socket.get())
+        , _socket(socket)
+        , _suspending(false)
+        , _connected(false)
+        , _closed(false)
+    {
+        _socket->addReceiver(this);
+    }
+
+    virtual ~Socket()
+    {
+        _socket->removeReceiver(this);
+    }
+
+    /// Awaiter for a connection to be established.
+    class ConnectAwaiter
+    {
+    public:
+        ConnectAwaiter(Socket& socket, const net::Address& address)
+            : _socket(socket)
+            , _address(address)
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> awaiter)
+        {
+            _socket._connecting = awaiter;
+            _socket._suspending = true;
+            _socket._socket->connect(_address);
+            _socket._suspending = false;
+
+            // Don't suspend if the connection failed immediately
+            return !!_socket._connecting;
+        }
+
+        void await_resume() { _socket.throwIfError(); }
+
+    protected:
+        Socket& _socket;
+        net::Address _address;
+    };
+
+    /// Awaiter for incoming data.
+    class ReadAwaiter
+    {
+    public:
+        ReadAwaiter(Socket& socket)
+            : _socket(socket)
+        {
+        }
+
+        bool await_ready() const noexcept { return _socket.readable(); }
+
+        void await_suspend(std::coroutine_handle<> awaiter)
+        {
+            _socket._reading = awaiter;
+        }
+
+        MutableBuffer await_resume() { return _socket.take(); }
+
+    protected:
+        Socket& _socket;
+    };
+
+    /// Connect to the given address.
+    /// The await throws std::runtime_error if the connection fails.
+    ConnectAwaiter connect(const net::Address& address)
+    {
+        return ConnectAwaiter(*this, address);
+    }
+
+    /// Wait for incoming data and return all data received since the
+    /// last read. The returned buffer remains valid until the next read.
+    /// An empty buffer is returned once the socket is closed, and the
+    /// await throws std::runtime_error if the socket failed.
+    ReadAwaiter read()
+    {
+        return ReadAwaiter(*this);
+    }
+
+    /// Return true if the socket is connected.
+    bool connected() const { return _connected; }
+
+    /// Return true if the socket has been closed.
+    bool closed() const { return _closed; }
+
+    /// Return the wrapped socket.
+    net::Socket& socket() { return *_socket; }
+
+protected:
+    virtual void onSocketConnect(net::Socket&) override
+    {
+        _connected = true;
+        resume(_connecting);
+    }
+
+    virtual void onSocketRecv(net::Socket&, const MutableBuffer& buffer, const net::Address&) override
+    {
+        const char* data = bufferCast<const char*>(buffer);
+        _buffer.insert(_buffer.end(), data, data + buffer.size());
+        resume(_reading);
+    }
+
+    virtual void onSocketError(net::Socket&, const Error& error) override
+    {
+        _error = error;
+        resume(_connecting);
+        resume(_reading);
+    }
+
+    virtual void onSocketClose(net::Socket&) override
+    {
+        _closed = true;
+        resume(_connecting);
+        resume(_reading);
+    }
+
+    /// Resume a waiting coroutine, unless the operation completed
+    /// before the awaiter suspended.
+    void resume(std::coroutine_handle<>& waiting)
+    {
+        std::coroutine_handle<> handle = std::exchange(waiting, nullptr);
+        if (handle && !_suspending)
+            handle.resume();
+    }
+
+    bool readable() const
+    {
+        return !_buffer.empty() || _closed || _error.any();
+    }
+
+    MutableBuffer take()
+    {
+        if (_buffer.empty())
+            throwIfError();
+
+        // Swap rather than copy so both buffers keep their capacity
+        _received.clear();
+        std::swap(_received, _buffer);
+        return mutableBuffer(_received);
+    }
+
+    void throwIfError()
+    {
+        if (_error.any())
+            throw std::runtime_error(_error.message);
+        if (_closed && !_connected)
+            throw std::runtime_error("Socket closed");
+    }
+
+    net::Socket::Ptr _socket;
+    Buffer _buffer;
+    Buffer _received;
+    Error _error;
+    std::coroutine_handle<> _connecting;
+    std::coroutine_handle<> _reading;
+    bool _suspending;
+    bool _connected;
+    bool _closed;
+};
+
+
+} // namespace coro
+} // namespace scy
+
+
+#endif
+#endif // SCY_Net_Coro_H
+
+
+/// @\}
@@ -38,7 +38,7 @@ inline auto resolve(const std::string& host, int port,
         }
         else
             callback(event.status, net::Address{event.addr->ai_addr, static_cast<socklen_t>(event.addr->ai_addrlen)});
-    }).resolve(host, port, loop);
+    }, loop).resolve(host, port, loop);
 }
 
 
@@ -17,6 +17,8 @@
 #include "scy/net/socket.h"
 #include "scy/net/net.h"
 #include "scy/handle.h"
+#include "scy/slab.h"
+#include "scy/pool.h"
 
 
 namespace scy {
@@ -43,6 +45,31 @@ public:
     virtual ssize_t send(const char* data, size_t len,
                          const net::Address& peerAddress, int flags = 0) override;
 
+    /// Set the size of the receive buffer which is borrowed from the
+    /// loop's buffer slab for each datagram.
+    ///
+    /// Datagrams larger than the buffer size are truncated by the system,
+    /// and are dropped.
+    void setReadBufferSize(size_t size);
+
+    /// Return the size of the receive buffer.
+    size_t readBufferSize() const;
+
+    /// Take ownership of the current receive buffer.
+    ///
+    /// The receive buffer is only borrowed for the duration of the receive
+    /// callback, so this method must be called from inside `onRecv()` if the
+    /// data is to be retained without copying.
+    Buffer takeReadBuffer();
+
+    /// Enable SO_REUSEPORT on the socket so that multiple sockets, usually
+    /// on different threads, can bind the same address and port. The kernel
+    /// distributes datagrams between them by hashing the source and
+    /// destination addresses, so each peer is served by a single socket.
+    ///
+    /// Must be called before bind(). Not supported on Windows.
+    void setReusePort(bool flag);
+
     bool setBroadcast(bool flag);
     bool setMulticastLoop(bool flag);
     bool setMulticastTTL(int ttl);
@@ -80,7 +107,12 @@ protected:
     static void allocRecvBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf);
 
     net::Address _peer;
-    Buffer _buffer;
+    uv::BufferSlab* _slab;
+    uv::RequestPool<uv_udp_send_t>* _sendReqs;
+    size_t _readBufferSize;
+    const char* _reading;
+    size_t _readLength;
+    bool _reusePort;
 };
 
 
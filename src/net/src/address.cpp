@@ -14,6 +14,8 @@
 #include "scy/memory.h"
 #include "scy/util.h"
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 
 using std::endl;
@@ -23,155 +25,32 @@ namespace scy {
 namespace net {
 
 
-//
-// AddressBase
-//
-
-
-class Net_API AddressBase
-{
-public:
-    virtual std::string host() const = 0;
-    virtual uint16_t port() const = 0;
-    virtual Address::Family family() const = 0;
-    virtual socklen_t length() const = 0;
-    virtual const struct sockaddr* addr() const = 0;
-    virtual int af() const = 0;
-
-protected:
-    AddressBase() {}
-    virtual ~AddressBase() {}
-
-private:
-    AddressBase(const AddressBase&) = delete;
-    AddressBase& operator=(const AddressBase&) = delete;
-};
-
-
-//
-// IPv4AddressBase
-//
-
-
-class Net_API IPv4AddressBase : public AddressBase
-{
-public:
-    IPv4AddressBase()
-    {
-        _addr.sin_family = AF_INET;
-        memset(&_addr, 0, sizeof(_addr));
-    }
-
-    IPv4AddressBase(const struct sockaddr_in* addr)
-    {
-        _addr.sin_family = AF_INET;
-        memcpy(&_addr, addr, sizeof(_addr));
-    }
-
-    IPv4AddressBase(const void* addr, uint16_t port)
-    {
-        memset(&_addr, 0, sizeof(_addr));
-        _addr.sin_family = AF_INET;
-        memcpy(&_addr.sin_addr, addr, sizeof(_addr.sin_addr));
-        _addr.sin_port = port;
-    }
-
-    std::string host() const
-    {
-        char dest[16];
-        if (uv_ip4_name(const_cast<sockaddr_in*>(&_addr), dest, 16) != 0)
-            throw std::runtime_error("Cannot parse IPv4 hostname");
-        return dest;
-    }
+static_assert(std::is_trivially_copyable<Address>::value,
+              "Address must be trivially copyable");
 
-    uint16_t port() const { return _addr.sin_port; }
 
-    Address::Family family() const { return Address::IPv4; }
+namespace {
 
-    socklen_t length() const { return sizeof(_addr); }
 
-    const struct sockaddr* addr() const
-    {
-        return reinterpret_cast<const struct sockaddr*>(&_addr);
-    }
-
-    int af() const { return _addr.sin_family; }
-
-private:
-    struct sockaddr_in _addr;
-};
-
-
-//
-// IPv6AddressBase
-//
-
-#if defined(SCY_HAVE_IPv6)
-
-
-class Net_API IPv6AddressBase : public AddressBase
+/// Mixes the bits of a 64-bit value (splitmix64 finalizer).
+inline uint64_t mix(uint64_t x)
 {
-public:
-    IPv6AddressBase(const struct sockaddr_in6* addr)
-    {
-        _addr.sin6_family = AF_INET6;
-        memcpy(&_addr, addr, sizeof(_addr));
-    }
-
-    IPv6AddressBase(const void* addr, uint16_t port)
-    {
-        _addr.sin6_family = AF_INET6;
-        memset(&_addr, 0, sizeof(_addr));
-        memcpy(&_addr.sin6_addr, addr, sizeof(_addr.sin6_addr));
-        _addr.sin6_port = port;
-    }
-
-    IPv6AddressBase(const void* addr, uint16_t port, uint32_t scope)
-    {
-        _addr.sin6_family = AF_INET6;
-        memset(&_addr, 0, sizeof(_addr));
-        memcpy(&_addr.sin6_addr, addr, sizeof(_addr.sin6_addr));
-        _addr.sin6_port = port;
-        _addr.sin6_scope_id = scope;
-    }
-
-    std::string host() const
-    {
-        char dest[46];
-        if (uv_ip6_name(const_cast<sockaddr_in6*>(&_addr), dest, 46) != 0)
-            throw std::runtime_error("Cannot parse IPv6 hostname");
-        return dest;
-    }
-
-    uint16_t port() const { return _addr.sin6_port; }
-
-    Address::Family family() const { return Address::IPv6; }
-
-    socklen_t length() const { return sizeof(_addr); }
-
-    const struct sockaddr* addr() const
-    {
-        return reinterpret_cast<const struct sockaddr*>(&_addr);
-    }
-
-    int af() const { return _addr.sin6_family; }
-
-private:
-    struct sockaddr_in6 _addr;
-};
-
-
-#endif // SCY_HAVE_IPv6
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
 
 
-//
-// Address
-//
+} // namespace
 
 
-Address::Address() :
-    _base(std::make_shared<IPv4AddressBase>())
+Address::Address()
 {
+    memset(&_addr, 0, sizeof(_addr));
+    _addr.v4.sin_family = AF_INET;
 }
 
 
@@ -218,46 +97,42 @@ Address::Address(const std::string& hostAndPort)
 
 Address::Address(const struct sockaddr* addr, socklen_t length)
 {
-    if (length == sizeof(struct sockaddr_in))
-        _base = std::make_shared<IPv4AddressBase>(
-                reinterpret_cast<const struct sockaddr_in*>(addr));
+    // Only the fields which identify the endpoint are copied so
+    // that addresses can be compared and hashed by their bytes.
+    memset(&_addr, 0, sizeof(_addr));
+    if (length == sizeof(struct sockaddr_in)) {
+        auto in = reinterpret_cast<const struct sockaddr_in*>(addr);
+        _addr.v4.sin_family = AF_INET;
+        _addr.v4.sin_port = in->sin_port;
+        _addr.v4.sin_addr = in->sin_addr;
+    }
 #if defined(SCY_HAVE_IPv6)
-    else if (length == sizeof(struct sockaddr_in6))
-        _base = std::make_shared<IPv6AddressBase>(
-                reinterpret_cast<const struct sockaddr_in6*>(addr));
+    else if (length == sizeof(struct sockaddr_in6)) {
+        auto in6 = reinterpret_cast<const struct sockaddr_in6*>(addr);
+        _addr.v6.sin6_family = AF_INET6;
+        _addr.v6.sin6_port = in6->sin6_port;
+        _addr.v6.sin6_addr = in6->sin6_addr;
+        _addr.v6.sin6_scope_id = in6->sin6_scope_id;
+    }
 #endif
     else
         throw std::runtime_error("Invalid address length passed to Address()");
 }
 
 
-Address::Address(const Address& addr)
-{
-    _base = addr._base;
-}
-
-
-Address::~Address()
-{
-}
-
-
-Address& Address::operator=(const Address& addr)
-{
-    if (&addr != this) {
-        _base = addr._base;
-    }
-    return *this;
-}
-
-
 void Address::init(const std::string& host, uint16_t port)
 {
-    char ia[sizeof(struct in6_addr)];
-    if (uv_inet_pton(AF_INET, host.c_str(), &ia) == 0)
-        _base = std::make_shared<IPv4AddressBase>(&ia, htons(port));
-    else if (uv_inet_pton(AF_INET6, host.c_str(), &ia) == 0)
-        _base = std::make_shared<IPv6AddressBase>(&ia, htons(port));
+    memset(&_addr, 0, sizeof(_addr));
+    if (uv_inet_pton(AF_INET, host.c_str(), &_addr.v4.sin_addr) == 0) {
+        _addr.v4.sin_family = AF_INET;
+        _addr.v4.sin_port = htons(port);
+    }
+#if defined(SCY_HAVE_IPv6)
+    else if (uv_inet_pton(AF_INET6, host.c_str(), &_addr.v6.sin6_addr) == 0) {
+        _addr.v6.sin6_family = AF_INET6;
+        _addr.v6.sin6_port = htons(port);
+    }
+#endif
     else
         throw std::runtime_error("Invalid IP address format: " + host);
 }
@@ -265,49 +140,61 @@ void Address::init(const std::string& host, uint16_t port)
 
 std::string Address::host() const
 {
-    return _base->host();
+    char dest[46];
+    if (_addr.sa.sa_family == AF_INET6) {
+        if (uv_ip6_name(&_addr.v6, dest, sizeof(dest)) != 0)
+            throw std::runtime_error("Cannot parse IPv6 hostname");
+    } else {
+        if (uv_ip4_name(&_addr.v4, dest, sizeof(dest)) != 0)
+            throw std::runtime_error("Cannot parse IPv4 hostname");
+    }
+    return dest;
 }
 
 
 uint16_t Address::port() const
 {
-    return ntohs(_base->port());
+    // The port field is at the same offset for both families
+    return ntohs(_addr.v4.sin_port);
 }
 
 
 Address::Family Address::family() const
 {
-    return _base->family();
+    return _addr.sa.sa_family == AF_INET6 ? Address::IPv6 : Address::IPv4;
 }
 
 
 socklen_t Address::length() const
 {
-    return _base->length();
+    return _addr.sa.sa_family == AF_INET6 ? sizeof(_addr.v6) : sizeof(_addr.v4);
 }
 
 
 const struct sockaddr* Address::addr() const
 {
-    return _base->addr();
+    return &_addr.sa;
 }
 
 
 int Address::af() const
 {
-    return _base->af();
+    return _addr.sa.sa_family;
 }
 
 
 bool Address::valid() const
 {
-    return host() != "0.0.0.0" && port() != 0;
+    if (_addr.sa.sa_family == AF_INET && _addr.v4.sin_addr.s_addr == 0)
+        return false;
+    return port() != 0;
 }
 
 
 std::string Address::toString() const
 {
     std::string result;
+    result.reserve(64);
     if (family() == Address::IPv6)
         result.append("[");
     result.append(host());
@@ -319,35 +206,57 @@ std::string Address::toString() const
 }
 
 
+std::size_t Address::hash() const
+{
+    uint64_t portBits = _addr.v4.sin_port;
+    if (_addr.sa.sa_family == AF_INET6) {
+        uint64_t words[2];
+        memcpy(words, &_addr.v6.sin6_addr, sizeof(words));
+        uint64_t h = mix(words[0] ^ (portBits << 48) ^ _addr.v6.sin6_scope_id);
+        return static_cast<std::size_t>(mix(h ^ words[1]));
+    }
+    return static_cast<std::size_t>(
+        mix((static_cast<uint64_t>(_addr.v4.sin_addr.s_addr) << 16) | portBits));
+}
+
+
 bool Address::operator<(const Address& addr) const
 {
-    if (family() < addr.family())
-        return true;
-    return (port() < addr.port());
+    if (_addr.sa.sa_family != addr._addr.sa.sa_family)
+        return family() < addr.family();
+
+    int cmp;
+    if (_addr.sa.sa_family == AF_INET6) {
+        cmp = memcmp(&_addr.v6.sin6_addr, &addr._addr.v6.sin6_addr, sizeof(_addr.v6.sin6_addr));
+        if (cmp == 0 && _addr.v6.sin6_scope_id != addr._addr.v6.sin6_scope_id)
+            return _addr.v6.sin6_scope_id < addr._addr.v6.sin6_scope_id;
+    } else {
+        cmp = memcmp(&_addr.v4.sin_addr, &addr._addr.v4.sin_addr, sizeof(_addr.v4.sin_addr));
+    }
+    if (cmp != 0)
+        return cmp < 0;
+    return port() < addr.port();
 }
 
 
 bool Address::operator==(const Address& addr) const
 {
-    return host() == addr.host() && port() == addr.port();
+    // Addresses are normalized on construction so the
+    // native address of the family can be compared directly.
+    return _addr.sa.sa_family == addr._addr.sa.sa_family &&
+           memcmp(&_addr, &addr._addr, length()) == 0;
 }
 
 
 bool Address::operator!=(const Address& addr) const
 {
-    return host() != addr.host() || port() != addr.port();
+    return !(*this == addr);
 }
 
 
-// void Address::swap(Address& a1, Address& a2)
-// {
-//     a1.swap(a2);
-// }
-
-
 void Address::swap(Address& addr)
 {
-    std::swap(_base, addr._base);
+    std::swap(_addr, addr._addr);
 }
 
 
@@ -69,7 +69,7 @@ void TCPSocket::connect(const net::Address& peerAddress)
             else
                 handle->onConnect();
         }
-    }).connect(get(), peerAddress.addr());
+    }, loop()).connect(get(), peerAddress.addr());
 
     // auto wrap = new ConnectReq();
     // wrap->callback = [ptr = context()](const uv::BasicEvent& event) {
@@ -339,8 +339,8 @@ void TCPSocket::onRead(const char* data, size_t len)
     // LTrace("On read:", len)
 
     // Note: The const_cast here is relatively safe since the given
-    // data pointer is the underlying _buffer.data() pointer, but
-    // a better way should be devised.
+    // data pointer is the read buffer lent by the loop's buffer slab,
+    // but a better way should be devised.
     onRecv(mutableBuffer(const_cast<char*>(data), len));
 }
 
@@ -11,8 +11,15 @@
 
 #include "scy/net/udpsocket.h"
 #include "scy/logger.h"
+#include "scy/loopmetrics.h"
 #include "scy/net/net.h"
 
+#include <cerrno>
+
+#ifndef SCY_WIN
+#include <unistd.h>
+#endif
+
 
 using namespace std;
 
@@ -23,7 +30,12 @@ namespace net {
 
 UDPSocket::UDPSocket(uv::Loop* loop)
     : uv::Handle<uv_udp_t>(loop)
-    , _buffer(65536)
+    , _slab(&uv::BufferSlab::get(loop))
+    , _sendReqs(&uv::RequestPool<uv_udp_send_t>::get(loop))
+    , _readBufferSize(uv::DEFAULT_READ_BUFFER_SIZE)
+    , _reading(nullptr)
+    , _readLength(0)
+    , _reusePort(false)
 {
     // LTrace("Create")
     init();
@@ -116,6 +128,30 @@ void UDPSocket::bind(const Address& address, unsigned flags)
     if (address.af() == AF_INET6)
         flags |= UV_UDP_IPV6ONLY;
 
+    if (_reusePort) {
+#if defined(SO_REUSEPORT)
+        // libuv does not expose SO_REUSEPORT on Linux, so create the
+        // socket manually and hand it over to the handle before binding.
+        int sock = ::socket(address.af(), SOCK_DGRAM, 0);
+        int on = 1;
+        if (sock < 0 ||
+            ::setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+            int err = -errno;
+            if (sock >= 0)
+                ::close(sock);
+            setUVError(err, "Cannot set SO_REUSEPORT");
+            return;
+        }
+        if (!invoke(&uv_udp_open, get(), sock)) {
+            ::close(sock);
+            return;
+        }
+#else
+        setUVError(UV_ENOTSUP, "SO_REUSEPORT is not supported");
+        return;
+#endif
+    }
+
     if (invoke(&uv_udp_bind, get(), address.addr(), flags))
         recvStart();
 }
@@ -146,13 +182,15 @@ ssize_t UDPSocket::send(const char* data, size_t len, const Address& peerAddress
         return -1;
     }
 
+    auto req = _sendReqs->acquire();
     auto buf = uv_buf_init((char*)data, (unsigned int)len); // TODO: memcpy data?
-    if (invoke(&uv_udp_send, new uv_udp_send_t, get(), &buf, 1, peerAddress.addr(),
+    if (invoke(&uv_udp_send, req, get(), &buf, 1, peerAddress.addr(),
         [](uv_udp_send_t* req, int) {
-            delete req;
+            uv::RequestPool<uv_udp_send_t>::release(req);
         })) {
         return len;
     }
+    uv::RequestPool<uv_udp_send_t>::release(req);
     return error().err;
 
     // typedef uv::Request<uv_udp_t, uv_udp_send_t> Request;
@@ -180,6 +218,32 @@ ssize_t UDPSocket::send(const char* data, size_t len, const Address& peerAddress
 }
 
 
+void UDPSocket::setReadBufferSize(size_t size)
+{
+    assert(size > 0);
+    _readBufferSize = size;
+}
+
+
+size_t UDPSocket::readBufferSize() const
+{
+    return _readBufferSize;
+}
+
+
+Buffer UDPSocket::takeReadBuffer()
+{
+    assert(_reading);
+    return _slab->take(_reading, _readLength);
+}
+
+
+void UDPSocket::setReusePort(bool flag)
+{
+    _reusePort = flag;
+}
+
+
 bool UDPSocket::setBroadcast(bool enable)
 {
     assert(initialized());
@@ -290,16 +354,23 @@ bool UDPSocket::closed() const
 // Callbacks
 
 void UDPSocket::onRecv(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf,
-                       const struct sockaddr* addr, unsigned /* flags */)
+                       const struct sockaddr* addr, unsigned flags)
 {
     auto socket = reinterpret_cast<UDPSocket*>(handle->data);
     assert(socket->initialized());
     assert(!socket->closed());
     // LTrace("On read:", nread)
 
+    // Keep a reference to the slab and handle context since the
+    // socket may be destroyed inside the receive callback.
+    auto slab = socket->_slab;
+    auto context = socket->context();
+    uv::CallbackTimer timing(handle->loop, UV_UDP);
+
     if (nread < 0) {
         // assert(0 && "unexpected error");
         LDebug("Recv error:", uv_err_name((int)nread))
+        slab->reclaim(buf->base);
         socket->setUVError((int)nread, "UDP recv error");
         return;
     }
@@ -308,32 +379,37 @@ void UDPSocket::onRecv(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf,
         // Returning unused buffer, this is not an error
         // 11/12/13: This happens on linux but not windows
         // socket->setUVError(UV_EOF, "End of file");
+        slab->reclaim(buf->base);
+        return;
+    }
+    else if (flags & UV_UDP_PARTIAL) {
+        // The rest of the datagram was discarded by the kernel, and
+        // datagram protocols can't parse a partial message.
+        LWarn("Dropping truncated datagram: ", nread, " of more than ",
+              socket->_readBufferSize, " bytes")
+        slab->reclaim(buf->base);
         return;
     }
 
+    socket->_reading = buf->base;
+    socket->_readLength = nread;
     socket->onRecv(mutableBuffer(buf->base, nread),
                    net::Address(addr, sizeof(*addr)));
+
+    if (!context->deleted)
+        socket->_reading = nullptr;
+    slab->reclaim(buf->base);
 }
 
 
-void UDPSocket::allocRecvBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf)
+void UDPSocket::allocRecvBuffer(uv_handle_t* handle, size_t /* suggested_size */, uv_buf_t* buf)
 {
-    auto& buffer = static_cast<UDPSocket*>(handle->data)->_buffer;
-    // // LTrace("Allocating buffer:", suggested_size)
-
-    // Reserve the recommended buffer size
-    // XXX: libuv wants us to allocate 65536 bytes for UDP .. hmmm
-    // if (suggested_size > self->_buffer.available())
-    //    self->_buffer.reserve(suggested_size);
-    // assert(self->_buffer.capacity() >= suggested_size);
-    assert(buffer.size() >= suggested_size);
-    assert(buffer.size() < suggested_size * 2);
+    auto socket = static_cast<UDPSocket*>(handle->data);
 
-    // Reset the buffer position on each read
-    // buffer.position(0);
-    // uv_buf_init(buffer.data(), buffer.size());
-    buf->base = buffer.data();
-    buf->len = buffer.size();
+    // NOTE: libuv suggests 64KB for UDP since the datagram size is not known
+    // in advance. Sockets which only receive small datagrams (ie. STUN/TURN)
+    // may configure a smaller buffer with setReadBufferSize().
+    socket->_slab->lend(socket->_readBufferSize, buf);
 }
 
 
@@ -1,6 +1,7 @@
  #include "scy/base.h"
 #include "scy/logger.h"
 #include "scy/net/address.h"
+#include "scy/net/coro.h"
 #include "scy/net/sslcontext.h"
 #include "scy/net/sslmanager.h"
 #include "scy/net/sslsocket.h"
@@ -14,6 +15,8 @@
 #include "../samples/echoserver/udpechoserver.h"
 #include "clientsockettest.h"
 
+#include <unordered_set>
+
 
 using std::endl;
 using namespace scy;
@@ -85,6 +88,37 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // Address Comparison Test
+    //
+    describe("address comparison", []() {
+        net::Address a1("192.168.1.100", 100);
+        net::Address a2("192.168.1.101", 100);
+        net::Address a3(a1.addr(), a1.length());
+        expect(a1 == a3);
+        expect(a1 != a2);
+        expect(std::hash<net::Address>()(a1) == std::hash<net::Address>()(a3));
+
+        // Ordering considers the host as well as the port
+        expect(a1 < a2 && !(a2 < a1));
+        expect(!(a1 < a3) && !(a3 < a1));
+        expect(net::Address("10.0.0.1", 200) < net::Address("10.0.0.2", 100));
+
+        net::Address v6("::1", 100);
+        expect(v6.family() == net::Address::IPv6);
+        expect(v6.toString() == "[::1]:100");
+        expect(v6 == net::Address(v6.addr(), v6.length()));
+        expect(v6 != a1);
+
+        std::unordered_set<net::Address> set{ a1, a2, a3, v6 };
+        expect(set.size() == 3);
+
+        expect(!net::Address().valid());
+        expect(!net::Address("0.0.0.0", 100).valid());
+        expect(a1.valid());
+    });
+
+
     // =========================================================================
     // TCP Socket Test
     //
@@ -291,6 +325,111 @@ int main(int argc, char** argv)
         expect(connected == 2);
     });
 
+    // =========================================================================
+    // UDP Socket Truncated Datagram Test
+    //
+    describe("udp socket truncated datagram test", []() {
+        net::UDPSocket sender;
+        sender.bind(net::Address("127.0.0.1", 0));
+
+        std::vector<size_t> received;
+        net::SocketEmitter receiver(std::make_shared<net::UDPSocket>());
+        receiver.as<net::UDPSocket>()->setReadBufferSize(16);
+        receiver.Recv += [&](net::Socket&, const MutableBuffer& buffer, const net::Address&) {
+            received.push_back(buffer.size());
+            receiver->close();
+            sender.close();
+        };
+        receiver->bind(net::Address("127.0.0.1", 1341));
+
+        // The oversized datagram is dropped rather than passed on truncated
+        std::string large(64, 'x'), small(8, 'y');
+        sender.send(large.c_str(), large.size(), net::Address("127.0.0.1", 1341));
+        sender.send(small.c_str(), small.size(), net::Address("127.0.0.1", 1341));
+
+        uv::runLoop();
+        expect(received == std::vector<size_t>{8});
+    });
+
+    // =========================================================================
+    // UDP Socket Reuse Port Test
+    //
+    describe("udp socket reuse port test", []() {
+#if defined(SO_REUSEPORT)
+        // Sockets bound with SO_REUSEPORT may share a port
+        net::UDPSocket first;
+        first.setReusePort(true);
+        first.bind(net::Address("127.0.0.1", 1340));
+        expect(!first.error().any());
+
+        net::UDPSocket second;
+        second.setReusePort(true);
+        second.bind(net::Address("127.0.0.1", 1340));
+        expect(!second.error().any());
+        expect(second.address().port() == 1340);
+
+        // A socket without it is refused
+        net::UDPSocket third;
+        third.bind(net::Address("127.0.0.1", 1340));
+        expect(third.error().any());
+
+        first.close();
+        second.close();
+        third.close();
+        uv::runLoop();
+#endif
+    });
+
+
+#if defined(SCY_ENABLE_COROUTINES) && defined(__cpp_impl_coroutine)
+    // =========================================================================
+    // Coroutine Socket Test
+    //
+    describe("coroutine socket test", []() {
+        net::TCPEchoServer srv;
+        srv.start("127.0.0.1", 1341);
+        srv.server->unref();
+
+        // Resolve, connect, write and read the echo back
+        std::string echoed;
+        coro::spawn([](std::string& echoed) -> coro::Task<> {
+            auto address = co_await coro::resolve("127.0.0.1", 1341);
+            auto socket = std::make_shared<net::TCPSocket>();
+            {
+                coro::Socket client(socket);
+                co_await client.connect(address);
+                client.socket().send("hello", 5);
+                while (echoed.size() < 5) {
+                    auto buffer = co_await client.read();
+                    if (!buffer.size())
+                        break;
+                    echoed.append(bufferCast<const char*>(buffer), buffer.size());
+                }
+            }
+            socket->close();
+        }(echoed));
+        uv::runLoop();
+        expect(echoed == "hello");
+    });
+
+
+    // =========================================================================
+    // Coroutine Resolve Error Test
+    //
+    describe("coroutine resolve error test", []() {
+        bool caught = false;
+        coro::spawn([](bool& caught) -> coro::Task<> {
+            try {
+                co_await coro::resolve("hostthatdoesntexist.what", 80);
+            } catch (std::runtime_error&) {
+                caught = true;
+            }
+        }(caught));
+        uv::runLoop();
+        expect(caught);
+    });
+#endif
+
     test::runAll();
 
     return test::finalize();
@@ -20,7 +20,11 @@
 #include "scy/logger.h"
 #include "scy/singleton.h"
 #include "scy/task.h"
+#include "scy/thread.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
 #include <vector>
 
 
@@ -30,15 +34,44 @@ namespace sched {
 
 /// The Scheduler manages and runs tasks
 /// that need to be executed at specific times.
+///
+/// Scheduled tasks are kept in a binary min-heap ordered by their next
+/// deadline, so scheduling, cancelling and rescheduling recurring tasks
+/// cost O(log n). The scheduler thread sleeps on a monotonic clock until
+/// the earliest deadline, or until a schedule or cancel call wakes it.
+///
+/// Deadlines are taken from the trigger's `scheduleAt` time when the task
+/// is scheduled or rescheduled, and tasks are run in deadline order.
 class Sched_API Scheduler : public TaskRunner, public json::ISerializable
 {
 public:
+    typedef std::chrono::steady_clock Clock;
+
     Scheduler();
     virtual ~Scheduler();
 
+    /// Schedules a task, or reschedules it if the
+    /// trigger's `scheduleAt` time has changed.
+    /// The task must have a trigger.
     virtual void schedule(sched::Task* task);
+
+    /// Schedules a task to run at the given time. The trigger's
+    /// `scheduleAt` time is updated under the scheduler lock, so
+    /// this is safe while the scheduler thread is running.
+    /// If the task is running the time is applied once it returns.
+    /// The task must have a trigger.
+    virtual void schedule(sched::Task* task, const DateTime& at);
     virtual void cancel(sched::Task* task);
-    virtual void clear();
+    virtual void clear() override;
+
+    virtual bool start(scy::Task* task) override;
+    virtual bool cancel(scy::Task* task) override;
+    virtual bool destroy(scy::Task* task) override;
+    virtual bool exists(scy::Task* task) const override;
+    virtual scy::Task* get(uint32_t id) const override;
+
+    /// Returns the number of managed tasks.
+    size_t size() const;
 
     virtual void serialize(json::value& root) override;
     virtual void deserialize(json::value& root) override;
@@ -54,8 +87,47 @@ public:
     static sched::TaskFactory& factory();
 
 protected:
+    /// Heap entry.
+    struct Entry
+    {
+        Clock::time_point deadline;
+        sched::Task* task;
+    };
+
+    /// Position value of tasks which are not in the heap,
+    /// either because they are cancelled or running.
+    static const size_t npos = static_cast<size_t>(-1);
+
+    /// Runs due tasks until the scheduler is destroyed.
     virtual void run() override;
-    virtual void update();
+
+    /// Runs a single due task.
+    virtual void runTask(sched::Task* task);
+
+    virtual bool add(scy::Task* task) override;
+    virtual bool remove(scy::Task* task) override;
+    virtual scy::Task* next() const override;
+
+    /// Returns the deadline of the task's trigger.
+    static Clock::time_point deadline(sched::Task* task);
+
+    /// Queues or repositions a task. Requires the lock.
+    void enqueue(sched::Task* task, Clock::time_point deadline);
+
+    /// Heap operations. Require the lock.
+    void push(sched::Task* task, Clock::time_point deadline);
+    void erase(size_t pos);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void place(size_t pos, const Entry& entry);
+
+    std::vector<Entry> _heap;
+    std::unordered_map<sched::Task*, size_t> _positions;
+    std::unordered_map<sched::Task*, DateTime> _deferred; ///< times for running tasks
+    std::condition_variable _wakeUp;
+    sched::Task* _running;
+    bool _stopping;
+    Thread _thread;
 };
 
 
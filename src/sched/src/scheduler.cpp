@@ -26,142 +26,382 @@ namespace scy {
 namespace sched {
 
 
+const size_t Scheduler::npos;
+
+
 Scheduler::Scheduler()
+    : TaskRunner(TaskRunner::Unpowered())
+    , _running(nullptr)
+    , _stopping(false)
 {
+    _thread.start([this]() { run(); });
 }
 
 
 Scheduler::~Scheduler()
 {
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+    _thread.join();
+    clear();
 }
 
 
 void Scheduler::schedule(sched::Task* task)
 {
-    TaskRunner::start(task);
+    // Throws if the task has no trigger
+    Clock::time_point when = deadline(task);
+
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        enqueue(task, when);
+    }
+
+    LTrace("Start task: ", task)
+    onStart(task);
+    _wakeUp.notify_one();
+}
+
+
+void Scheduler::schedule(sched::Task* task, const DateTime& at)
+{
+    // Throws if the task has no trigger
+    sched::Trigger& trigger = task->trigger();
+
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (task == _running)
+            _deferred[task] = at;
+        else {
+            trigger.scheduleAt = at;
+            enqueue(task, deadline(task));
+        }
+    }
+
+    LTrace("Start task: ", task)
+    onStart(task);
+    _wakeUp.notify_one();
+}
+
+
+void Scheduler::enqueue(sched::Task* task, Clock::time_point deadline)
+{
+    task->_scheduler = this;
+    auto it = _positions.find(task);
+    if (it == _positions.end()) {
+        LTrace("Add task: ", task)
+        it = _positions.emplace(task, npos).first;
+        onAdd(task);
+    }
+
+    // Reschedule queued tasks, and queue idle tasks unless they are
+    // cancelled. Running tasks are rescheduled once they return.
+    size_t pos = it->second;
+    if (pos != npos) {
+        _heap[pos].deadline = deadline;
+        siftUp(pos);
+        siftDown(_positions[task]);
+    }
+    else if (task != _running && !task->cancelled())
+        push(task, deadline);
 }
 
 
 void Scheduler::cancel(sched::Task* task)
 {
-    TaskRunner::cancel(task);
+    cancel(static_cast<scy::Task*>(task));
 }
 
 
-void Scheduler::clear()
+bool Scheduler::start(scy::Task* task)
 {
-    TaskRunner::clear();
+    schedule(static_cast<sched::Task*>(task));
+    return true;
 }
 
 
-void Scheduler::run()
+bool Scheduler::cancel(scy::Task* task)
 {
-    // Update and sort the task list bringing the
-    // next scheduled task to the front of the list.
-    // TODO: Call only after task run, and when the
-    // initial task is nullptr.
-    update();
+    if (task->cancelled())
+        return false;
+
+    task->cancel();
+    LTrace("Cancel task: ", task)
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _positions.find(static_cast<sched::Task*>(task));
+        if (it != _positions.end() && it->second != npos)
+            erase(it->second);
+    }
+    onCancel(task);
+    _wakeUp.notify_one();
+    return true;
+}
 
-    // TODO: Create a nextTask member so we don't
-    // need to call next() on each iteration
-    auto task = reinterpret_cast<sched::Task*>(next());
 
-    // Run the task
-    if (task && task->trigger().timeout()) {
-#if _DEBUG
-        {
-            DateTime now;
-            Timespan remaining = task->trigger().scheduleAt - now;
-            STrace << "Waiting: "
-                         << "\n\tPID: " << task
-                         << "\n\tDays: " << remaining.days()
-                         << "\n\tHours: " << remaining.totalHours()
-                         << "\n\tMinutes: " << remaining.totalMinutes()
-                         << "\n\tSeconds: " << remaining.totalSeconds()
-                         << "\n\tMilliseconds: "
-                         << remaining.totalMilliseconds() << "\n\tCurrentTime: "
-                         << DateTimeFormatter::format(
-                                now, DateTimeFormat::ISO8601_FORMAT)
-                         << "\n\tScheduledAt: "
-                         << DateTimeFormatter::format(
-                                task->trigger().scheduleAt,
-                                DateTimeFormat::ISO8601_FORMAT)
-                         << endl;
+bool Scheduler::destroy(scy::Task* task)
+{
+    LTrace("Abort task: ", task)
+
+    auto stask = static_cast<sched::Task*>(task);
+    bool free = true;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _positions.find(stask);
+        if (it != _positions.end()) {
+            // Running tasks are deleted by the scheduler thread
+            stask->_destroyed = true;
+            if (stask == _running)
+                free = false;
+            else {
+                if (it->second != npos)
+                    erase(it->second);
+                _positions.erase(it);
+                onRemove(task);
+            }
         }
-#endif
+    }
+
+    if (free)
+        delete stask;
+    return true;
+}
 
-        // Wait for the scheduled timeout
-        // if (!task->trigger().timeout())
-        //    _wakeUp.tryWait(static_cast<long>(task->trigger().remaining()));
 
-        // The task list may have changed during the timeout
-        // duration, or the current task deleted, so we need
-        // to ensure that the next pending task matches the
-        // current pending task.
-        if (task->beforeRun()) {
-#if _DEBUG
-            {
-                DateTime now;
-                STrace
-                    << "Running: "
-                    << "\n\tPID: " << task << "\n\tCurrentTime: "
-                    << DateTimeFormatter::format(now,
-                                                 DateTimeFormat::ISO8601_FORMAT)
-                    << "\n\tScheduledTime: "
-                    << DateTimeFormatter::format(task->trigger().scheduleAt,
-                                                 DateTimeFormat::ISO8601_FORMAT)
-                    << endl;
+bool Scheduler::exists(scy::Task* task) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _positions.find(static_cast<sched::Task*>(task)) != _positions.end();
+}
+
+
+scy::Task* Scheduler::get(uint32_t id) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    for (auto& kv : _positions) {
+        if (kv.first->id() == id)
+            return kv.first;
+    }
+    return nullptr;
+}
+
+
+size_t Scheduler::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _positions.size();
+}
+
+
+void Scheduler::clear()
+{
+    std::vector<sched::Task*> tasks;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (auto it = _positions.begin(); it != _positions.end();) {
+            if (it->first == _running) {
+                it->first->_destroyed = true;
+                it->second = npos;
+                ++it;
             }
-#else
-            LTrace("Running: ", task)
-#endif
-            task->run();
-            if (task->afterRun())
-                onRun(task);
             else {
-                LTrace("Destroy After Run: ", task)
-                task->_destroyed = true; // destroy();
+                tasks.push_back(it->first);
+                it = _positions.erase(it);
             }
-        } else
-            LTrace("Skipping Task: ", task)
-
-        // Destroy the task if needed
-        if (task->destroyed()) {
-            LTrace("Destroy Task: ", task)
-            assert(remove(task));
-            delete task;
         }
+        _heap.clear();
+    }
 
-        // LTrace("Running: OK: ", task)
+    for (auto task : tasks) {
+        LTrace("Clear: Destroying task: ", task)
+        delete task;
     }
+}
+
 
-    // Prevent 100% CPU
-    scy::sleep(3);
+bool Scheduler::add(scy::Task* task)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_positions.emplace(static_cast<sched::Task*>(task), npos).second) {
+        onAdd(task);
+        return true;
+    }
+    return false;
+}
+
+
+bool Scheduler::remove(scy::Task* task)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _positions.find(static_cast<sched::Task*>(task));
+    if (it == _positions.end())
+        return false;
+    if (it->second != npos)
+        erase(it->second);
+    _positions.erase(it);
+    onRemove(task);
+    return true;
 }
 
 
-void Scheduler::update()
+scy::Task* Scheduler::next() const
 {
     std::lock_guard<std::mutex> guard(_mutex);
+    return _heap.empty() ? nullptr : _heap.front().task;
+}
+
+
+void Scheduler::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stopping) {
+        if (_heap.empty()) {
+            _wakeUp.wait(lock);
+            continue;
+        }
+
+        // Sleep until the earliest deadline, or until the
+        // heap is changed by a schedule or cancel call.
+        Entry top = _heap.front();
+        if (Clock::now() < top.deadline) {
+            _wakeUp.wait_until(lock, top.deadline);
+            continue;
+        }
+
+        sched::Task* task = top.task;
+        erase(0);
+        _running = task;
+        lock.unlock();
 
-    // LTrace("Updating: ", _tasks.size())
+        runTask(task);
 
-    // Update and clean the task list
-    auto it = _tasks.begin();
-    while (it != _tasks.end()) {
-        sched::Task* task = reinterpret_cast<sched::Task*>(*it);
+        lock.lock();
+        _running = nullptr;
+        auto deferred = _deferred.find(task);
+        if (deferred != _deferred.end()) {
+            if (!task->destroyed())
+                task->trigger().scheduleAt = deferred->second;
+            _deferred.erase(deferred);
+        }
         if (task->destroyed()) {
-            it = _tasks.erase(it);
+            LTrace("Destroy task: ", task)
+            _positions.erase(task);
             onRemove(task);
-            LTrace("Destroy: ", task)
+            lock.unlock();
             delete task;
-        } else
-            ++it;
+            lock.lock();
+        }
+
+        // Reschedule recurring tasks from their updated trigger
+        else if (!task->cancelled())
+            push(task, deadline(task));
+    }
+}
+
+
+void Scheduler::runTask(sched::Task* task)
+{
+    // The trigger may not have timed out yet if the wall clock
+    // lags the monotonic clock, in which case the task is
+    // rescheduled from its trigger and retried.
+    if (task->beforeRun()) {
+#if _DEBUG
+        {
+            DateTime now;
+            STrace << "Running: "
+                   << "\n\tPID: " << task << "\n\tCurrentTime: "
+                   << DateTimeFormatter::format(now,
+                                                DateTimeFormat::ISO8601_FORMAT)
+                   << "\n\tScheduledTime: "
+                   << DateTimeFormatter::format(task->trigger().scheduleAt,
+                                                DateTimeFormat::ISO8601_FORMAT)
+                   << endl;
+        }
+#else
+        LTrace("Running: ", task)
+#endif
+        task->run();
+        if (task->afterRun())
+            onRun(task);
+        else {
+            LTrace("Destroy After Run: ", task)
+            task->_destroyed = true;
+        }
+    } else
+        LTrace("Skipping Task: ", task)
+}
+
+
+Scheduler::Clock::time_point Scheduler::deadline(sched::Task* task)
+{
+    DateTime now;
+    Timespan remaining = task->trigger().scheduleAt - now;
+    return Clock::now() + std::chrono::microseconds(remaining.totalMicroseconds());
+}
+
+
+void Scheduler::push(sched::Task* task, Clock::time_point deadline)
+{
+    size_t pos = _heap.size();
+    _heap.push_back(Entry{deadline, task});
+    _positions[task] = pos;
+    siftUp(pos);
+}
+
+
+void Scheduler::erase(size_t pos)
+{
+    _positions[_heap[pos].task] = npos;
+    Entry last = _heap.back();
+    _heap.pop_back();
+    if (pos < _heap.size()) {
+        place(pos, last);
+        siftUp(pos);
+        siftDown(_positions[last.task]);
+    }
+}
+
+
+void Scheduler::siftUp(size_t pos)
+{
+    Entry entry = _heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!(entry.deadline < _heap[parent].deadline))
+            break;
+        place(pos, _heap[parent]);
+        pos = parent;
     }
+    place(pos, entry);
+}
+
 
-    // Sort the task list to the next task to
-    // trigger is at the front of the queue.
-    sort(_tasks.begin(), _tasks.end(), sched::Task::CompareTimeout);
+void Scheduler::siftDown(size_t pos)
+{
+    Entry entry = _heap[pos];
+    size_t size = _heap.size();
+    while (true) {
+        size_t child = 2 * pos + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && _heap[child + 1].deadline < _heap[child].deadline)
+            child++;
+        if (!(_heap[child].deadline < entry.deadline))
+            break;
+        place(pos, _heap[child]);
+        pos = child;
+    }
+    place(pos, entry);
+}
+
+
+void Scheduler::place(size_t pos, const Entry& entry)
+{
+    _heap[pos] = entry;
+    _positions[entry.task] = pos;
 }
 
 
@@ -170,12 +410,24 @@ void Scheduler::serialize(json::value& root)
     LTrace("Serializing")
 
     std::lock_guard<std::mutex> guard(_mutex);
-    for (auto it = _tasks.begin(); it != _tasks.end(); ++it) {
-        sched::Task* task = reinterpret_cast<sched::Task*>(*it);
+
+    // Serialize scheduled tasks in deadline order
+    // followed by cancelled and running tasks.
+    std::vector<Entry> entries(_heap);
+    std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r) {
+        return l.deadline < r.deadline;
+    });
+    for (auto& kv : _positions) {
+        if (kv.second == npos)
+            entries.push_back(Entry{Clock::time_point(), kv.first});
+    }
+
+    for (auto& entry : entries) {
+        sched::Task* task = entry.task;
         LTrace("Serializing: ", task)
-        json::value& entry = root[root.size()];
-        task->serialize(entry);
-        task->trigger().serialize(entry["trigger"]);
+        json::value& item = root[root.size()];
+        task->serialize(item);
+        task->trigger().serialize(item["trigger"]);
     }
 }
 
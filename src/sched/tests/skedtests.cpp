@@ -4,6 +4,9 @@
 #include "scy/sched/scheduler.h"
 #include "scy/test.h"
 
+#include <atomic>
+#include <mutex>
+
 
 using namespace std;
 using namespace scy;
@@ -11,7 +14,38 @@ using namespace scy::test;
 
 
 static sched::Scheduler scheduler;
-static int taskRunTimes = 0;
+static std::atomic<int> taskRunTimes(0);
+static std::mutex taskRunMutex;
+static std::vector<int> taskRunOrder;
+
+
+// Return a copy of the task run order, which is written by the scheduler thread.
+static std::vector<int> runOrder()
+{
+    std::lock_guard<std::mutex> guard(taskRunMutex);
+    return taskRunOrder;
+}
+
+
+// =============================================================================
+// Test Ordered Task
+//
+struct OrderedTask : public sched::Task
+{
+    int index;
+
+    OrderedTask(int index)
+        : sched::Task("OrderedTask")
+        , index(index)
+    {
+    }
+
+    void run()
+    {
+        std::lock_guard<std::mutex> guard(taskRunMutex);
+        taskRunOrder.push_back(index);
+    }
+};
 
 
 // =============================================================================
@@ -57,7 +91,7 @@ int main(int argc, char** argv)
 
     describe("once only task serialization", []() {
         json::value json;
-        Timespan hundredMs(0, 1);
+        Timespan hundredMs(0, 100000);
 
         // Schedule a once only task to run in 100ms time.
         {
@@ -148,6 +182,54 @@ int main(int argc, char** argv)
         LDebug("Running Scheduled Task Test: END")
     });
 
+    describe("deadline order", []() {
+        taskRunOrder.clear();
+
+        // Schedule tasks in reverse deadline order
+        const int numTasks = 5;
+        std::vector<OrderedTask*> tasks;
+        for (int i = numTasks - 1; i >= 0; i--) {
+            auto task = new OrderedTask(i);
+            auto trigger = task->createTrigger<sched::OnceOnlyTrigger>();
+            trigger->scheduleAt += Timespan(0, 50000 + i * 20000);
+            scheduler.schedule(task);
+            tasks.push_back(task);
+        }
+        expect(scheduler.size() == numTasks);
+
+        // Cancel the last task before it runs
+        scheduler.cancel(tasks.front());
+
+        scy::sleep(500);
+        auto order = runOrder();
+        expect(order.size() == numTasks - 1);
+        for (int i = 0; i < numTasks - 1; i++)
+            expect(order[i] == i);
+
+        // The cancelled task remains managed until destroyed
+        expect(scheduler.size() == 1);
+        expect(scheduler.exists(tasks.front()));
+        scheduler.destroy(tasks.front());
+        expect(scheduler.size() == 0);
+    });
+
+    describe("reschedule", []() {
+        taskRunOrder.clear();
+
+        // Move a task scheduled far in the future to now
+        auto task = new OrderedTask(1);
+        auto trigger = task->createTrigger<sched::OnceOnlyTrigger>();
+        trigger->scheduleAt += Timespan(3600, 0);
+        scheduler.schedule(task);
+        scy::sleep(50);
+        expect(runOrder().empty());
+
+        scheduler.schedule(task, DateTime());
+        scy::sleep(50);
+        expect(runOrder().size() == 1);
+        expect(scheduler.size() == 0);
+    });
+
     // // Schedule to fire once now, and in two days time.
     // {
     //     auto task = new ScheduledTask();
@@ -17,11 +17,19 @@
 #include "scy/json/json.h"
 #include "scy/packet.h"
 
+#include <memory>
+
 
 namespace scy {
 namespace sockio {
 
 
+/// Socket.IO packet.
+///
+/// The JSON payload is parsed at most once: packets which are read from
+/// the wire keep the parsed DOM, and packets which are created from JSON
+/// are serialized directly into the output buffer when written. The DOM
+/// is immutable once cached and is shared between packet copies.
 class SocketIO_API Packet : public IPacket
 {
 public:
@@ -81,12 +89,19 @@ public:
     Type type() const;
     int id() const;
     std::string nsp() const;
+    std::string event() const;
+
+    /// Return the serialized JSON payload.
     std::string message() const;
-    json::value json() const;
+
+    /// Return the JSON payload.
+    /// The payload is parsed on first access and cached.
+    const json::value& json() const;
 
     void setID(int id);
     void setNamespace(const std::string& nsp);
     void setMessage(const std::string& message);
+    void setMessage(const json::value& message);
     void setAck(bool flag);
 
     ssize_t read(const ConstBuffer& buf) override;
@@ -109,7 +124,8 @@ protected:
     int _id;
     std::string _nsp;
     std::string _event;
-    std::string _message;
+    mutable std::string _message;
+    mutable std::shared_ptr<const json::value> _json;
     bool _ack;
     size_t _size;
 };
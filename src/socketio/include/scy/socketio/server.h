@@ -0,0 +1,154 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup socketio
+/// @{
+
+
+#ifndef SCY_SocketIO_Server_H
+#define SCY_SocketIO_Server_H
+
+
+#include "scy/http/server.h"
+#include "scy/json/json.h"
+#include "scy/socketio/packet.h"
+#include "scy/timer.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+
+namespace scy {
+namespace sockio {
+
+
+class SocketIO_API Server;
+
+
+/// Server side Socket.IO session bound to a WebSocket connection.
+///
+/// Sockets are created by the Server for each client which connects with
+/// the `websocket` transport, and are destroyed with the connection.
+class SocketIO_API ServerSocket : public http::ServerResponder
+{
+public:
+    ServerSocket(http::ServerConnection& connection, Server& server,
+                 const std::string& id);
+    virtual ~ServerSocket();
+
+    /// Send an event to the client.
+    ssize_t send(const std::string& event, const json::value& data);
+
+    /// Acknowledge the packet with the given ID.
+    ssize_t sendAck(int id, const json::value& data);
+
+    /// Send an encoded Socket.IO packet.
+    /// Used to fan out a single encoded packet to many sockets.
+    ssize_t sendRaw(const char* data, size_t len);
+
+    /// Close the connection.
+    /// The socket is destroyed once the connection has closed.
+    void close();
+
+    /// Return the session ID.
+    const std::string& id() const;
+
+    /// Return the owning server.
+    Server& server();
+
+    /// Return the loop time of the last packet received from the client.
+    std::uint64_t lastActivity() const;
+
+    virtual void onPayload(const MutableBuffer& body) override;
+    virtual void onClose() override;
+
+protected:
+    Server& _server;
+    std::string _id;
+    std::uint64_t _lastActivity;
+    bool _closed;
+};
+
+
+/// Socket.IO server for clients using the WebSocket transport.
+///
+/// Implements the subset of the Engine.IO and Socket.IO protocols which is
+/// spoken by `sockio::Client`: the open handshake, client initiated ping
+/// and pong, and event and ack packets on the default namespace. Other
+/// transports are rejected.
+///
+/// Derived classes implement the application protocol by overriding the
+/// `onConnect()`, `onPacket()` and `onDisconnect()` callbacks, which are
+/// all called from the server's event loop.
+class SocketIO_API Server
+{
+public:
+    struct Options
+    {
+        int pingInterval = 25000; ///< Client ping interval in milliseconds
+        int pingTimeout = 60000;  ///< Time to wait for a ping before closing
+
+        Options() {
+            // Required on gcc 6
+            // https://gcc.gnu.org/bugzilla/show_bug.cgi?id=70528
+        }
+    };
+
+    Server(const net::Address& address, uv::Loop* loop = uv::defaultLoop(),
+           const Options& options = Options());
+    virtual ~Server();
+
+    /// Start listening for connections.
+    virtual void start();
+
+    /// Close all sockets and stop listening.
+    virtual void shutdown();
+
+    /// Return the socket with the given session ID, or nullptr.
+    ServerSocket* get(const std::string& id) const;
+
+    /// Return the number of connected sockets.
+    size_t numSockets() const;
+
+    Options& options();
+    http::Server& http();
+    uv::Loop* loop() const;
+
+protected:
+    /// Called when a client has completed the handshake.
+    virtual void onConnect(ServerSocket& socket);
+
+    /// Called for each event and ack packet received from a client.
+    virtual void onPacket(ServerSocket& socket, Packet& packet);
+
+    /// Called when a client has disconnected.
+    virtual void onDisconnect(ServerSocket& socket);
+
+    void onTimer();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    friend class ServerSocket;
+
+    uv::Loop* _loop;
+    Options _options;
+    std::unordered_map<std::string, ServerSocket*> _sockets;
+    Timer _timer;
+    http::Server _http;
+};
+
+
+} // namespace sockio
+} // namespace scy
+
+
+#endif // SCY_SocketIO_Server_H
+
+
+/// @\}
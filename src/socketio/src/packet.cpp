@@ -13,6 +13,10 @@
 #include "scy/logger.h"
 #include "scy/util.h"
 
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+
 
 using std::endl;
 
@@ -21,6 +25,129 @@ namespace scy {
 namespace sockio {
 
 
+namespace {
+
+/// Return a random packet ID.
+/// IDs are written as unsigned decimals, so they must be positive.
+int randomID()
+{
+    return static_cast<int>(util::randomNumber() % 0x7FFFFFFF) + 1;
+}
+
+/// Output stream buffer which appends to a Buffer, so JSON can be
+/// serialized in place without an intermediate string.
+class BufferStreamBuf : public std::streambuf
+{
+public:
+    BufferStreamBuf(Buffer& buf)
+        : _buf(buf)
+    {
+    }
+
+protected:
+    virtual int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            _buf.push_back(traits_type::to_char_type(ch));
+        return ch;
+    }
+
+    virtual std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        _buf.insert(_buf.end(), s, s + n);
+        return n;
+    }
+
+    Buffer& _buf;
+};
+
+
+/// Output stream buffer which only counts the characters written, so the
+/// serialized size of a JSON value can be measured without storing it.
+class CountingStreamBuf : public std::streambuf
+{
+public:
+    size_t count = 0;
+
+protected:
+    virtual int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            count++;
+        return ch;
+    }
+
+    virtual std::streamsize xsputn(const char*, std::streamsize n) override
+    {
+        count += static_cast<size_t>(n);
+        return n;
+    }
+};
+
+
+/// Return true if the character must be escaped inside a JSON string.
+inline bool needsEscape(char c)
+{
+    return c == '"' || c == '\\';
+}
+
+
+/// Append a string with its quotes and backslashes escaped.
+void appendEscaped(Buffer& buf, const std::string& str)
+{
+    for (char c : str) {
+        if (needsEscape(c))
+            buf.push_back('\\');
+        buf.push_back(c);
+    }
+}
+
+
+/// Print a string with its quotes and backslashes escaped.
+void printEscaped(std::ostream& os, const std::string& str)
+{
+    for (char c : str) {
+        if (needsEscape(c))
+            os << '\\';
+        os << c;
+    }
+}
+
+
+/// Return the length of a string once escaped.
+size_t escapedLength(const std::string& str)
+{
+    size_t len = str.size();
+    for (char c : str) {
+        if (needsEscape(c))
+            len++;
+    }
+    return len;
+}
+
+
+/// Append the decimal representation of an integer.
+void appendInt(Buffer& buf, int value)
+{
+    char str[16];
+    int len = std::snprintf(str, sizeof(str), "%d", value);
+    buf.insert(buf.end(), str, str + len);
+}
+
+
+/// Return the length of the decimal representation of an integer.
+size_t intLength(int value)
+{
+    size_t len = value < 0 ? 2 : 1;
+    for (unsigned v = value < 0 ? -static_cast<unsigned>(value) : value; v >= 10; v /= 10)
+        len++;
+    return len;
+}
+
+
+} // namespace
+
+
 Packet::Packet(Frame frame, Type type, int id, const std::string& nsp,
                const std::string& event, const std::string& message, bool ack)
     : _frame(frame)
@@ -36,32 +163,34 @@ Packet::Packet(Frame frame, Type type, int id, const std::string& nsp,
 
 
 Packet::Packet(Type type, const std::string& message, bool ack)
-    : Packet(Frame::Message, type, util::randomNumber(), "/", "message", message, ack)
+    : Packet(Frame::Message, type, randomID(), "/", "message", message, ack)
 {
 }
 
 
 Packet::Packet(const std::string& message, bool ack)
-    : Packet(Frame::Message, Type::Event, util::randomNumber(), "/", "message", message, ack)
+    : Packet(Frame::Message, Type::Event, randomID(), "/", "message", message, ack)
 {
 }
 
 
 Packet::Packet(const json::value& message, bool ack)
-    : Packet(Frame::Message, Type::Event, util::randomNumber(), "/", "message", message.dump(), ack)
+    : Packet(Frame::Message, Type::Event, randomID(), "/", "message", "", ack)
 {
+    setMessage(message);
 }
 
 
 Packet::Packet(const std::string& event, const std::string& message, bool ack)
-    : Packet(Frame::Message, Type::Event, util::randomNumber(), "/", event, message, ack)
+    : Packet(Frame::Message, Type::Event, randomID(), "/", event, message, ack)
 {
 }
 
 
 Packet::Packet(const std::string& event, const json::value& data, bool ack)
-    : Packet(Frame::Message, Type::Event, util::randomNumber(), "/", event, data.dump(), ack)
+    : Packet(Frame::Message, Type::Event, randomID(), "/", event, "", ack)
 {
+    setMessage(data);
 }
 
 
@@ -72,6 +201,7 @@ Packet::Packet(const Packet& r)
     , _nsp(r._nsp)
     , _event(r._event)
     , _message(r._message)
+    , _json(r._json)
     , _ack(r._ack)
     , _size(r._size)
 {
@@ -86,6 +216,7 @@ Packet& Packet::operator=(const Packet& r)
     _nsp = r._nsp;
     _event = r._event;
     _message = r._message;
+    _json = r._json;
     _ack = r._ack;
     _size = r._size;
     return *this;
@@ -113,7 +244,9 @@ ssize_t Packet::read(const ConstBuffer& buf)
     _type = Type::Unknown;
     _id = -1;
     _nsp = "/";
-    _message = "";
+    _event = "";
+    _message.clear();
+    _json.reset();
     _size = 0;
 
     BitReader reader(buf);
@@ -148,24 +281,26 @@ ssize_t Packet::read(const ConstBuffer& buf)
     reader.readNextNumber((unsigned int&)_id);
 
     // parse json data
+    // The parsed DOM is kept so the payload is never parsed twice.
     // TODO: Take into account joined messages
     if (reader.available()) {
-        std::string temp;
-        reader.get(temp, reader.available());
+        const char* begin = reader.current();
+        const char* end = begin + reader.available();
+        json::value json = json::value::parse(begin, end);
+        reader.skip(reader.available());
 
-        json::value json = json::value::parse(temp.begin(), temp.end());
         if (json.is_array()) {
             if (json.size() < 2) {
                 _event = "message";
-                _message = json[0].dump();
+                _json = std::make_shared<const json::value>(std::move(json[0]));
             } else {
                 assert(json[0].is_string());
                 _event = json[0].get<std::string>();
-                _message = json[1].dump();
+                _json = std::make_shared<const json::value>(std::move(json[1]));
             }
-        } 
+        }
         else if (json.is_object()) {
-            _message = json.dump();
+            _json = std::make_shared<const json::value>(std::move(json));
         }
     }
 
@@ -180,10 +315,29 @@ ssize_t Packet::read(const ConstBuffer& buf)
 void Packet::write(Buffer& buf) const
 {
     assert(valid());
-    std::ostringstream os;
-    print(os);
-    std::string str(os.str());
-    buf.insert(buf.end(), str.begin(), str.end());
+
+    // Written in place to avoid intermediate strings; the output
+    // must match print().
+    buf.push_back(static_cast<char>('0' + int(_frame)));
+    buf.push_back(static_cast<char>('0' + int(_type)));
+    appendInt(buf, _id);
+
+    if (_type == Type::Event) {
+        const std::string& event = _event.empty() ? "message" : _event;
+        buf.push_back('[');
+        buf.push_back('"');
+        appendEscaped(buf, event);
+        buf.push_back('"');
+        buf.push_back(',');
+        if (_message.empty() && _json) {
+            BufferStreamBuf sb(buf);
+            std::ostream os(&sb);
+            os << *_json;
+        } else {
+            buf.insert(buf.end(), _message.begin(), _message.end());
+        }
+        buf.push_back(']');
+    }
 }
 
 
@@ -202,6 +356,14 @@ void Packet::setNamespace(const std::string& nsp)
 void Packet::setMessage(const std::string& message)
 {
     _message = message;
+    _json.reset();
+}
+
+
+void Packet::setMessage(const json::value& message)
+{
+    _message.clear();
+    _json = std::make_shared<const json::value>(message);
 }
 
 
@@ -235,23 +397,31 @@ std::string Packet::nsp() const
 }
 
 
+std::string Packet::event() const
+{
+    return _event;
+}
+
+
 std::string Packet::message() const
 {
+    if (_message.empty() && _json)
+        _message = _json->dump();
     return _message;
 }
 
 
-json::value Packet::json() const
+const json::value& Packet::json() const
 {
-    if (!_message.empty()) {
-        return json::value::parse(_message.begin(), _message.end());
-        //json::value data;
-        //json::Reader reader;
-        //if (reader.parse(_message, data)) {
-        //    return data; //[1];
-        //}
+    if (!_json) {
+        if (_message.empty()) {
+            static const json::value null;
+            return null;
+        }
+        _json = std::make_shared<const json::value>(
+            json::value::parse(_message.begin(), _message.end()));
     }
-    return json::value();
+    return *_json;
 }
 
 
@@ -322,10 +492,20 @@ bool Packet::valid() const
 
 size_t Packet::size() const
 {
-    std::ostringstream ss;
-    print(ss);
-    assert(ss.tellp());
-    return static_cast<size_t>(ss.tellp());
+    size_t size = 2 + intLength(_id);
+    if (_type == Type::Event) {
+        size += 5 + (_event.empty() ? 7 : escapedLength(_event));
+        if (_message.empty() && _json) {
+            // Measure the JSON without caching it as the message
+            CountingStreamBuf sb;
+            std::ostream os(&sb);
+            os << *_json;
+            size += sb.count;
+        } else {
+            size += _message.size();
+        }
+    }
+    return size;
 }
 
 
@@ -335,8 +515,9 @@ void Packet::print(std::ostream& os) const
     os << int(_frame) << int(_type) << _id;
 
     if (_type == Type::Event) {
-        os << "[\"" << (_event.empty() ? "message" : _event) << "\","
-           << _message << "]";
+        os << "[\"";
+        printEscaped(os, _event.empty() ? "message" : _event);
+        os << "\"," << message() << "]";
         // << "\",\""
         // << _message
         // << "\"]";
@@ -0,0 +1,338 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup socketio
+/// @{
+
+
+#include "scy/socketio/server.h"
+#include "scy/logger.h"
+#include "scy/util.h"
+
+#include <vector>
+
+
+using std::endl;
+
+
+namespace scy {
+namespace sockio {
+
+
+namespace {
+
+
+/// Rejects requests which do not use the WebSocket transport.
+class BadRequestResponder : public http::ServerResponder
+{
+public:
+    BadRequestResponder(http::ServerConnection& connection)
+        : http::ServerResponder(connection)
+    {
+    }
+
+    virtual void onRequest(http::Request&, http::Response& response) override
+    {
+        std::string body("Only the websocket transport is supported");
+        response.setStatus(http::StatusCode::BadRequest);
+        response.setContentType("text/plain");
+        response.setContentLength(body.size());
+        connection().send(body.c_str(), body.size());
+        connection().close();
+    }
+};
+
+
+class ServerConnectionFactory : public http::ServerConnectionFactory
+{
+public:
+    ServerConnectionFactory(Server& server)
+        : _server(server)
+    {
+    }
+
+    virtual http::ServerResponder* createResponder(http::ServerConnection& connection) override
+    {
+        // The WebSocket handshake has already been sent
+        // for upgraded connections at this point.
+        if (connection.response().getStatus() == http::StatusCode::SwitchingProtocols &&
+            connection.request().getURI().find("/socket.io/") == 0) {
+            return new ServerSocket(connection, _server, util::randomString(20));
+        }
+        return new BadRequestResponder(connection);
+    }
+
+protected:
+    Server& _server;
+};
+
+
+} // namespace
+
+
+//
+// Server Socket
+//
+
+
+ServerSocket::ServerSocket(http::ServerConnection& connection, Server& server,
+                           const std::string& id)
+    : http::ServerResponder(connection)
+    , _server(server)
+    , _id(id)
+    , _lastActivity(uv_now(server.loop()))
+    , _closed(false)
+{
+    LTrace("Create: ", id)
+
+    // Socket.IO packets are small and latency sensitive
+    connection.socket()->setNoDelay(true);
+
+    // Send the Engine.IO open packet followed
+    // by the Socket.IO connect packet.
+    json::value handshake;
+    handshake["sid"] = _id;
+    handshake["upgrades"] = json::value::array();
+    handshake["pingInterval"] = _server.options().pingInterval;
+    handshake["pingTimeout"] = _server.options().pingTimeout;
+    std::string open("0" + handshake.dump());
+    sendRaw(open.c_str(), open.size());
+    sendRaw("40", 2);
+
+    _server._sockets[_id] = this;
+    _server.onConnect(*this);
+}
+
+
+ServerSocket::~ServerSocket()
+{
+    LTrace("Destroy: ", _id)
+}
+
+
+ssize_t ServerSocket::send(const std::string& event, const json::value& data)
+{
+    // Dump the event name too so it gets escaped
+    std::string packet("42" + json::value::array({event, data}).dump());
+    return sendRaw(packet.c_str(), packet.size());
+}
+
+
+ssize_t ServerSocket::sendAck(int id, const json::value& data)
+{
+    std::string packet("43" + std::to_string(id) + "[" + data.dump() + "]");
+    return sendRaw(packet.c_str(), packet.size());
+}
+
+
+ssize_t ServerSocket::sendRaw(const char* data, size_t len)
+{
+    if (_closed || _connection.closed())
+        return -1;
+    return _connection.send(data, len);
+}
+
+
+void ServerSocket::close()
+{
+    if (_closed)
+        return;
+
+    // The socket may be destroyed once the connection closes
+    _connection.close();
+}
+
+
+const std::string& ServerSocket::id() const
+{
+    return _id;
+}
+
+
+Server& ServerSocket::server()
+{
+    return _server;
+}
+
+
+std::uint64_t ServerSocket::lastActivity() const
+{
+    return _lastActivity;
+}
+
+
+void ServerSocket::onPayload(const MutableBuffer& body)
+{
+    if (_closed || body.size() == 0)
+        return;
+
+    _lastActivity = uv_now(_server.loop());
+
+    Packet packet;
+    try {
+        packet.read(constBuffer(body));
+    } catch (std::exception& exc) {
+        LWarn("Closing on invalid packet: ", _id, ": ", exc.what())
+        close();
+        return;
+    }
+
+    switch (packet.frame()) {
+        case Packet::Frame::Ping:
+            sendRaw("3", 1);
+            break;
+        case Packet::Frame::Close:
+            close();
+            break;
+        case Packet::Frame::Message:
+            switch (packet.type()) {
+                case Packet::Type::Event:
+                case Packet::Type::Ack:
+                    _server.onPacket(*this, packet);
+                    break;
+                case Packet::Type::Disconnect:
+                    close();
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+void ServerSocket::onClose()
+{
+    if (_closed)
+        return;
+    _closed = true;
+
+    LTrace("Closed: ", _id)
+    _server.onDisconnect(*this);
+    _server._sockets.erase(_id);
+}
+
+
+//
+// Server
+//
+
+
+Server::Server(const net::Address& address, uv::Loop* loop, const Options& options)
+    : _loop(loop)
+    , _options(options)
+    , _timer(options.pingInterval, options.pingInterval, loop)
+    , _http(address, net::makeSocket<net::TCPSocket>(loop), new ServerConnectionFactory(*this))
+{
+}
+
+
+Server::~Server()
+{
+    shutdown();
+}
+
+
+void Server::start()
+{
+    _http.start();
+
+    _timer.Timeout += slot(this, &Server::onTimer);
+    _timer.start();
+}
+
+
+void Server::shutdown()
+{
+    _timer.Timeout -= slot(this, &Server::onTimer);
+    _timer.stop();
+
+    // Sockets are removed from the map as they close
+    std::vector<ServerSocket*> sockets;
+    sockets.reserve(_sockets.size());
+    for (auto& kv : _sockets)
+        sockets.push_back(kv.second);
+    for (auto socket : sockets)
+        socket->close();
+
+    _http.shutdown();
+}
+
+
+ServerSocket* Server::get(const std::string& id) const
+{
+    auto it = _sockets.find(id);
+    return it != _sockets.end() ? it->second : nullptr;
+}
+
+
+size_t Server::numSockets() const
+{
+    return _sockets.size();
+}
+
+
+Server::Options& Server::options()
+{
+    return _options;
+}
+
+
+http::Server& Server::http()
+{
+    return _http;
+}
+
+
+uv::Loop* Server::loop() const
+{
+    return _loop;
+}
+
+
+void Server::onConnect(ServerSocket& socket)
+{
+    LTrace("Socket connected: ", socket.id())
+}
+
+
+void Server::onPacket(ServerSocket& socket, Packet& packet)
+{
+    LTrace("Socket packet: ", socket.id(), ": ", packet.toString())
+}
+
+
+void Server::onDisconnect(ServerSocket& socket)
+{
+    LTrace("Socket disconnected: ", socket.id())
+}
+
+
+void Server::onTimer()
+{
+    // Close sockets which have stopped sending pings
+    std::uint64_t now = uv_now(_loop);
+    std::uint64_t timeout = _options.pingInterval + _options.pingTimeout;
+    std::vector<ServerSocket*> expired;
+    for (auto& kv : _sockets) {
+        if (now - kv.second->lastActivity() > timeout)
+            expired.push_back(kv.second);
+    }
+    for (auto socket : expired) {
+        LDebug("Closing expired socket: ", socket->id())
+        socket->close();
+    }
+}
+
+
+} // namespace sockio
+} // namespace scy
+
+
+/// @\}
@@ -1,13 +1,16 @@
 #include "scy/application.h"
 #include "scy/net/sslmanager.h"
 #include "scy/socketio/client.h"
+#include "scy/socketio/packet.h"
 #include "scy/socketio/transaction.h"
+#include "scy/test.h"
 #include "scy/util.h"
 
 
 using namespace std;
 using namespace scy;
 using namespace scy::net;
+using namespace scy::test;
 using namespace scy::util;
 
 
@@ -18,6 +21,7 @@ namespace sockio {
 #define SERVER_HOST "localhost"
 #define SERVER_PORT 4444 // 443
 #define USE_SSL 0        // 1
+#define TEST_CLIENT 0    // 1, requires a running Socket.IO server
 
 
 // ----------------------------------------------------------------------------
@@ -119,6 +123,84 @@ public:
 
 int main(int argc, char** argv)
 {
+    // Logger::instance().add(new ConsoleChannel("debug", Level::Trace));
+    test::init();
+
+    // =========================================================================
+    // Packet
+    //
+    describe("packet read", []() {
+        std::string data("42123[\"chat\",{\"text\":\"hi\"}]");
+        sockio::Packet packet;
+        expect(packet.read(constBuffer(data)) == ssize_t(data.size()));
+        expect(packet.frame() == sockio::Packet::Frame::Message);
+        expect(packet.type() == sockio::Packet::Type::Event);
+        expect(packet.id() == 123);
+        expect(packet.event() == "chat");
+        expect(packet.json()["text"].get<std::string>() == "hi");
+        expect(packet.message() == "{\"text\":\"hi\"}");
+        expect(packet.size() == data.size());
+
+        // The DOM parsed by read() is kept and shared by copies
+        sockio::Packet copy(packet);
+        expect(&packet.json() == &packet.json());
+        expect(&copy.json() == &packet.json());
+
+        // Messages without an event name are plain messages
+        data = "42124[{\"text\":\"hi\"}]";
+        expect(packet.read(constBuffer(data)) == ssize_t(data.size()));
+        expect(packet.id() == 124);
+        expect(packet.event() == "message");
+        expect(packet.json()["text"].get<std::string>() == "hi");
+    });
+
+    describe("packet write", []() {
+        json::value data;
+        data["text"] = "hi";
+        sockio::Packet packet("chat", data);
+        packet.setID(123);
+        expect(packet.size() == 27);
+
+        // JSON payloads are serialized straight into the buffer
+        Buffer buf;
+        packet.write(buf);
+        std::string written(buf.data(), buf.size());
+        expect(written == "42123[\"chat\",{\"text\":\"hi\"}]");
+        expect(written == packet.toString());
+        expect(packet.size() == buf.size());
+
+        // String payloads are parsed once on access
+        sockio::Packet strPacket("chat", std::string("{\"text\":\"hi\"}"));
+        strPacket.setID(123);
+        const json::value& json = strPacket.json();
+        expect(json["text"].get<std::string>() == "hi");
+        expect(&strPacket.json() == &json);
+        buf.clear();
+        strPacket.write(buf);
+        expect(std::string(buf.data(), buf.size()) == written);
+
+        // Written packets read back the same
+        sockio::Packet parsed;
+        expect(parsed.read(constBuffer(buf)) == ssize_t(buf.size()));
+        expect(parsed.event() == "chat");
+        expect(parsed.json() == data);
+
+        // Quotes and backslashes in event names are escaped
+        sockio::Packet quoted("say \"hi\" \\o/", data);
+        quoted.setID(123);
+        buf.clear();
+        quoted.write(buf);
+        written.assign(buf.data(), buf.size());
+        expect(written == "42123[\"say \\\"hi\\\" \\\\o/\",{\"text\":\"hi\"}]");
+        expect(quoted.size() == buf.size());
+        expect(written == quoted.toString());
+        expect(parsed.read(constBuffer(buf)) == ssize_t(buf.size()));
+        expect(parsed.event() == "say \"hi\" \\o/");
+    });
+
+    test::runAll();
+
+#if TEST_CLIENT
     Logger::instance().add(new ConsoleChannel("debug", Level::Trace));
 #if USE_SSL
     SSLManager::initNoVerifyClient();
@@ -129,6 +211,7 @@ int main(int argc, char** argv)
 #if USE_SSL
     SSLManager::instance().shutdown();
 #endif
-    Logger::destroy();
-    return 0;
+#endif
+
+    return test::finalize();
 }
@@ -26,6 +26,9 @@
 
 
 namespace scy {
+namespace crypto {
+class HMACContext;
+}
 namespace stun {
 
 
@@ -327,6 +330,10 @@ public:
 
     bool verifyHmac(const std::string& key) const;
 
+    /// Verify the HMAC using a context which has been preinitialized
+    /// with the long-term credential key.
+    bool verifyHmac(const crypto::HMACContext& context) const;
+
     std::string input() const { return _input; }
     std::string hmac() const { return _hmac; }
     std::string key() const { return _key; }
@@ -345,6 +352,13 @@ private:
 };
 
 
+/// Derive the long-term credential key `MD5(username:realm:password)`
+/// which is used to sign MESSAGE-INTEGRITY.
+STUN_API std::string deriveKey(const std::string& username,
+                               const std::string& realm,
+                               const std::string& password);
+
+
 ///
 /// Implements STUN/TURN attribute that reflects an error code.
 class STUN_API ErrorCode : public Attribute
@@ -22,6 +22,11 @@ namespace scy {
 namespace stun {
 
 
+/// STUN request transaction.
+///
+/// Retransmissions use the fixed transaction timeout. Call
+/// `setBackoff(true)` for the exponential backoff which RFC 5389
+/// section 7.2.1 specifies over unreliable transports.
 class STUN_API Transaction : public net::Transaction<Message>
 {
 public:
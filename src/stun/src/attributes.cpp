@@ -13,6 +13,7 @@
 #include <winsock2.h>
 #endif
 
+#include "scy/crypto/hash.h"
 #include "scy/crypto/hmac.h"
 #include "scy/logger.h"
 #include "scy/stun/attributes.h"
@@ -764,6 +765,25 @@ bool MessageIntegrity::verifyHmac(const std::string& key) const
 }
 
 
+bool MessageIntegrity::verifyHmac(const crypto::HMACContext& context) const
+{
+    assert(!_hmac.empty());
+    assert(!_input.empty());
+
+    return context.verify(_input.data(), _input.size(), _hmac.data(), _hmac.size());
+}
+
+
+std::string deriveKey(const std::string& username,
+                      const std::string& realm,
+                      const std::string& password)
+{
+    crypto::Hash engine("md5");
+    engine.update(username + ":" + realm + ":" + password);
+    return engine.digestStr();
+}
+
+
 void MessageIntegrity::read(BitReader& reader)
 {
     // LDebug("Message: Read HMAC")
@@ -1,4 +1,5 @@
 #include "scy/base.h"
+#include "scy/crypto/hmac.h"
 #include "scy/logger.h"
 #include "scy/stun/message.h"
 #include "scy/test.h"
@@ -48,6 +49,8 @@ int main(int argc, char** argv)
         integrityAttr = response.get<stun::MessageIntegrity>();
         expect(integrityAttr != nullptr);
         expect(integrityAttr->verifyHmac(password));
+        expect(integrityAttr->verifyHmac(crypto::HMACContext(password)));
+        expect(!integrityAttr->verifyHmac(crypto::HMACContext("wrongpass")));
     });
 
     // =========================================================================
@@ -25,6 +25,7 @@
 #include "scy/bitwise.h"
 #include "scy/http/websocket.h"
 #include "scy/net/socket.h"
+#include "scy/packetsignal.h"
 #include "scy/util/timedmanager.h"
 
 
@@ -229,109 +230,84 @@ enum FilterFlags
 };
 
 
-struct Filter //: public Flaggable
+/// Message filter for filterSlot().
+///
+/// The path is compiled into its nodes once on construction, so
+/// matching a message neither splits strings nor allocates.
+/// Construct a new Filter to change the path.
+struct Symple_API Filter
 {
-    Filter(const std::string& path, unsigned flags = 0)
-        : flags(flags)
-        , path(path)
-    {
-    }
+    Filter(const std::string& path, unsigned flags = 0);
+    Filter(unsigned flags = 0);
 
-    Filter(unsigned flags = 0)
-        : flags(flags)
-        , path("*")
-    {
-    }
+    /// Returns true if the message is accepted by the flags and path.
+    /// The path is matched against the node of commands and the name
+    /// of events, using `:` separated nodes and `*` wildcards.
+    bool accepts(const Message& message) const;
+
+    /// Returns true if the given node matches the path.
+    bool matches(const std::string& node) const;
 
     Bitwise flags;
     std::string path;
+
+protected:
+    std::vector<std::string> _nodes;
+    bool _any;
 };
 
 
 //
-// Polymorphic Message Delegates
+// Filtered Message Delegate
 //
 
 
-#if 0
-struct MessageDelegate: public PacketDelegateBase
+/// Delegate which only invokes the callback for messages of the
+/// callback's type which are accepted by the filter.
+template <class Class, class RT, class PT>
+struct FilterDelegate : public AbstractDelegate<RT, IPacket&>
 {
-    typedef Filter DataT;
+    Class* instance;
+    RT (Class::*method)(PT&);
     Filter filter;
 
-    MessageDelegate(const Filter& filter = Filter()) : filter(filter) {};
-    MessageDelegate(const MessageDelegate& r) : filter(r.filter) {};
-
-    virtual bool accepts(void* /* sender */, IPacket& data, void*, void*, void*)
+    FilterDelegate(Class* instance, RT (Class::*method)(PT&), const Filter& filter)
+        : instance(instance)
+        , method(method)
+        , filter(filter)
     {
-        auto packet = dynamic_cast<Message*>(&data);
-        if (packet &&
-            (!filter.flags.has(AcceptRequests) ||
-                (filter.flags.has(AcceptRequests) && packet->isRequest())) &&
-            (!filter.flags.has(AcceptResponses) ||
-                (filter.flags.has(AcceptResponses) && !packet->isRequest()))) {
-            return true;
-        }
-        return false;
     }
-};
-
 
-struct CommandDelegate: public MessageDelegate
-{
-    CommandDelegate(const Filter& filter = Filter()) : MessageDelegate(filter) {};
-    CommandDelegate(const CommandDelegate& r) : MessageDelegate(r) {};
-
-    virtual bool accepts(void* sender, IPacket& data, void* empty2, void* empty3, void* empty4)
+    virtual RT operator()(IPacket& object) const override
     {
-        if (MessageDelegate::accepts(sender, data, empty2, empty3, empty4)) {
-            auto c = dynamic_cast<Command*>(&data);
-            return c && c->matches(filter.path);
-        }
-        return false;
+        auto message = dynamic_cast<PT*>(&object);
+        if (message && filter.accepts(*message))
+            return (instance->*method)(*message);
+        return RT();
     }
-};
-
-
-struct PresenceDelegate: public MessageDelegate
-{
-    PresenceDelegate() : MessageDelegate(AcceptRequests) {};
-    PresenceDelegate(const PresenceDelegate& r) : MessageDelegate(r) {};
 
-    virtual bool accepts(void* sender, IPacket& data, void* empty2, void* empty3, void* empty4)
+    virtual bool operator==(const AbstractDelegate<RT, IPacket&>& that) const override
     {
-        if (MessageDelegate::accepts(sender, data, empty2, empty3, empty4)) {
-            auto p = dynamic_cast<Presence*>(&data);
-            return p && p->type() == "presence";
-        }
-        return false;
+        auto other = dynamic_cast<const FilterDelegate*>(&that);
+        return other && other->instance == this->instance &&
+               other->method == this->method;
     }
 };
 
 
-struct EventDelegate: public MessageDelegate
+/// Signal slot which only receives Symple messages accepted by the filter.
+///
+///     client += smpl::filterSlot(this, &MyClass::onCommand,
+///                                smpl::Filter("camera:*", smpl::AcceptRequests));
+///
+template <class Class, class RT, class PT>
+std::shared_ptr<internal::Slot<RT, IPacket&>>
+filterSlot(Class* instance, RT (Class::*method)(PT&), const Filter& filter,
+           int id = -1, int priority = -1)
 {
-    EventDelegate() : MessageDelegate(AcceptRequests) {};
-    EventDelegate(const EventDelegate& r) : MessageDelegate(r) {};
-
-    virtual bool accepts(void* sender, IPacket& data, void* empty2, void* empty3, void* empty4)
-    {
-        if (MessageDelegate::accepts(sender, data, empty2, empty3, empty4)) {
-            auto e = dynamic_cast<Event*>(&data);
-            return e && e->type() == "event" && (
-                filter.path.empty() || filter.path == "*" ||
-                util::matchNodes(e->name(), filter.path, ":"));
-        }
-        return false;
-    }
-};
-
-
-DefinePolymorphicDelegateWithArg(messageDelegate, IPacket, MessageDelegate, const Filter&, Filter())
-DefinePolymorphicDelegateWithArg(commandDelegate, IPacket, CommandDelegate, const Filter&, Filter())
-DefinePolymorphicDelegate(presenceDelegate, IPacket, PresenceDelegate)
-DefinePolymorphicDelegate(eventDelegate, IPacket, EventDelegate)
-#endif
+    return std::make_shared<internal::Slot<RT, IPacket&>>(
+        new FilterDelegate<Class, RT, PT>(instance, method, filter), instance, id, priority);
+}
 
 
 } // namespace smpl
@@ -16,7 +16,15 @@
 #include "scy/symple/symple.h"
 #include "scy/symple/address.h"
 #include "scy/symple/peer.h"
-#include "scy/collection.h"
+#include "scy/signal.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 
 namespace scy {
@@ -25,24 +33,152 @@ namespace smpl {
 
 /// The Roster provides a registry for active network
 /// peers indexed by session ID.
-class Symple_API Roster : public LiveCollection<std::string, Peer>
+///
+/// Peers are stored in a flat array of entries holding the interned
+/// `user`, `name`, `type` and `host` fields, with secondary indexes by
+/// user and type, so lookups never walk the peer JSON. Each entry also
+/// owns the full Peer object which carries any custom presence data.
+/// Interned strings are reference counted and recycled once no peer
+/// uses them.
+///
+/// Presence data is applied as a delta with update(), which only touches
+/// the fields that have changed.
+class Symple_API Roster
 {
 public:
-    typedef LiveCollection<std::string, Peer> Manager;
-    typedef Manager::Map PeerMap;
+    typedef std::map<std::string, Peer*> PeerMap;
+
+    /// Handle of an interned string.
+    typedef std::uint32_t Symbol;
+
+    /// Snapshot of a peer's indexed fields.
+    struct Record
+    {
+        std::string id;
+        std::string user;
+        std::string name;
+        std::string type;
+        std::string host;
+        Peer* peer = nullptr; ///< The peer, which is owned by the roster
+    };
+
+    /// Result of a presence update.
+    enum class Change
+    {
+        None,    ///< The peer is unchanged
+        Added,   ///< A new peer was added
+        Updated, ///< Fields of an existing peer changed
+        Removed, ///< The peer went offline and was removed
+        Invalid  ///< The presence data was invalid
+    };
 
 public:
     Roster();
     virtual ~Roster();
 
+    /// Applies presence data to the roster.
+    ///
+    /// Online peers are added or updated with the fields present in
+    /// `data`, and peers with `online` set to false are removed.
+    /// Returns the resulting change.
+    Change update(const json::value& data);
+
+    /// Adds a peer with the given session ID.
+    /// The roster takes ownership of the peer.
+    bool add(const std::string& id, Peer* peer, bool whiny = true);
+
+    /// Returns the peer with the given session ID.
+    Peer* get(const std::string& id, bool whiny = true) const;
+
+    /// Returns a copy of the record with the given session ID, or an
+    /// empty record with a null peer if none exists.
+    Record record(const std::string& id) const;
+
+    /// Removes and deletes the peer with the given session ID.
+    bool free(const std::string& id);
+
+    /// Returns true if a peer with the given session ID exists.
+    bool exists(const std::string& id) const;
+
     /// Returns the first peer which matches the given host address.
-    Peer* getByHost(const std::string& host);
+    Peer* getByHost(const std::string& host) const;
+
+    /// Returns all peers of the given user.
+    std::vector<Peer*> getByUser(const std::string& user) const;
+
+    /// Returns all peers of the given type.
+    std::vector<Peer*> getByType(const std::string& type) const;
+
+    /// Returns the string for an interned symbol.
+    /// Symbols are recycled once no peer uses them.
+    std::string str(Symbol symbol) const;
+
+    /// Returns the number of interned strings in use.
+    size_t symbols() const;
+
+    /// Removes and deletes all peers.
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
 
     virtual PeerMap peers() const;
 
     virtual void print(std::ostream& os) const;
 
     virtual const char* className() const { return "Symple::Roster"; }
+
+    /// Signals when a peer is added.
+    Signal<void(Peer&)> ItemAdded;
+
+    /// Signals when a peer is removed, before it is deleted.
+    Signal<void(const Peer&)> ItemRemoved;
+
+protected:
+    typedef std::uint32_t Slot;
+    typedef std::unordered_map<Symbol, std::vector<Slot>> SymbolIndex;
+
+    /// Compact peer entry.
+    struct Entry
+    {
+        std::string id;
+        Symbol user = 0;
+        Symbol name = 0;
+        Symbol type = 0;
+        Symbol host = 0;
+        std::unique_ptr<Peer> peer;
+    };
+
+    /// Interns a string and returns its symbol, adding a reference.
+    /// Requires the lock.
+    Symbol intern(const std::string& str);
+
+    /// Drops a reference to a symbol, and recycles it once unused.
+    /// Requires the lock.
+    void release(Symbol symbol);
+
+    /// Re-reads the interned fields from the entry's peer. Requires the lock.
+    void load(Entry& entry);
+
+    /// Releases the interned fields of the entry. Requires the lock.
+    void unload(Entry& entry);
+
+    void index(Slot slot);
+    void unindex(Slot slot);
+    Peer* insert(const std::string& id, std::unique_ptr<Peer> peer);
+    std::unique_ptr<Peer> erase(const std::string& id);
+
+    std::vector<Peer*> lookup(const SymbolIndex& index, const std::string& str) const;
+
+    mutable std::mutex _mutex;
+    std::vector<Entry> _entries;
+    std::unordered_map<std::string, Slot> _ids;
+    SymbolIndex _users;
+    SymbolIndex _types;
+    std::vector<std::string> _symbols;
+    std::vector<std::uint32_t> _symbolRefs;
+    std::vector<Symbol> _freeSymbols;
+    std::unordered_map<std::string, Symbol> _symbolIds;
 };
 
 
@@ -0,0 +1,135 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup symple
+/// @{
+
+
+#ifndef SCY_Symple_Server_H
+#define SCY_Symple_Server_H
+
+
+#include "scy/socketio/server.h"
+#include "scy/symple/address.h"
+#include "scy/symple/peer.h"
+#include "scy/symple/symple.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace scy {
+namespace smpl {
+
+
+/// Counters for the Symple server.
+struct ServerStats
+{
+    std::uint64_t announced = 0; ///< successful announce requests
+    std::uint64_t messages = 0;  ///< messages received from peers
+    std::uint64_t delivered = 0; ///< messages delivered to peers
+    std::uint64_t dropped = 0;   ///< invalid or undeliverable messages
+};
+
+
+/// Native Symple server built on the Socket.IO server.
+///
+/// This is a lightweight broker for local testing, benchmarking and small
+/// deployments which implements the protocol spoken by `smpl::Client`:
+///
+///   - `announce`: registers the peer and replies with its session data.
+///   - `join` and `leave`: add and remove the peer to and from rooms.
+///   - `message`: routes Symple messages, presence, commands and events.
+///     Messages addressed to `user|id` are delivered to the session,
+///     messages addressed to `user` are delivered to all of the user's
+///     sessions, and messages without a recipient are broadcast to all
+///     rooms the sender has joined. The `from` address is always set by
+///     the server.
+///
+/// When a peer disconnects an offline presence is broadcast to its rooms.
+/// Sessions are not persisted, and the server runs on a single loop.
+class Symple_API Server : public sockio::Server
+{
+public:
+    struct Options : public sockio::Server::Options
+    {
+        /// Acknowledge messages with a status response.
+        bool ackMessages = true;
+
+        Options() {
+            // Required on gcc 6
+            // https://gcc.gnu.org/bugzilla/show_bug.cgi?id=70528
+        }
+    };
+
+    Server(const net::Address& address, uv::Loop* loop = uv::defaultLoop(),
+           const Options& options = Options());
+    virtual ~Server();
+
+    /// Return the peer for the given session ID,
+    /// or nullptr if the session has not announced.
+    const Peer* peer(const std::string& id) const;
+
+    /// Return the number of announced peers.
+    size_t numPeers() const;
+
+    /// Return the number of members in the given room.
+    size_t roomSize(const std::string& room) const;
+
+    /// Return the server counters.
+    const ServerStats& stats() const;
+
+protected:
+    struct Session
+    {
+        Peer peer;
+        std::string address; ///< Cached `user|id` address
+        std::vector<std::string> rooms;
+    };
+
+    typedef std::vector<sockio::ServerSocket*> SocketVec;
+
+    /// Authenticate an announce request.
+    /// Returns a HTTP status code, 200 to accept the peer or 401 to reject.
+    /// The default implementation accepts all peers.
+    virtual int authenticate(sockio::ServerSocket& socket, const json::value& data);
+
+    virtual void onPacket(sockio::ServerSocket& socket, sockio::Packet& packet) override;
+    virtual void onDisconnect(sockio::ServerSocket& socket) override;
+
+    void onAnnounce(sockio::ServerSocket& socket, sockio::Packet& packet);
+    void onMessage(sockio::ServerSocket& socket, Session& session, sockio::Packet& packet);
+
+    void join(sockio::ServerSocket& socket, Session& session, const std::string& room);
+    void leave(sockio::ServerSocket& socket, Session& session, const std::string& room);
+
+    /// Send an encoded packet to all members of the sender's rooms.
+    void broadcast(sockio::ServerSocket& sender, Session& session, const std::string& packet);
+
+    /// Send an encoded packet to the given sockets.
+    void deliver(sockio::ServerSocket* sender, const SocketVec& sockets, const std::string& packet);
+
+    void removeSocket(SocketVec& sockets, sockio::ServerSocket* socket);
+
+    Options _options;
+    ServerStats _stats;
+    std::unordered_map<sockio::ServerSocket*, Session> _sessions;
+    std::unordered_map<std::string, SocketVec> _rooms;
+    std::unordered_map<std::string, SocketVec> _users;
+};
+
+
+} // namespace smpl
+} // namespace scy
+
+
+#endif // SCY_Symple_Server_H
+
+
+/// @\}
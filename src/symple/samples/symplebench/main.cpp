@@ -0,0 +1,397 @@
+#include "scy/application.h"
+#include "scy/logger.h"
+#include "scy/memory.h"
+#include "scy/net/tcpsocket.h"
+#include "scy/symple/client.h"
+#include "scy/symple/server.h"
+#include "scy/synchronizer.h"
+#include "scy/thread.h"
+#include "scy/time.h"
+#include "scy/util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using namespace scy;
+
+
+//
+// Symple Load Generator
+//
+// Spawns a number of Symple clients spread across a few event loops. Clients
+// are paired up, and each pair plays ping-pong with timestamped messages
+// routed through the server. The message rate and delivery latency
+// percentiles are printed once all messages have been received.
+//
+// Unless a -host is given the benchmark runs against an embedded
+// smpl::Server on its own loop thread.
+//
+// Examples:
+// symplebench -clients 2000 -loops 4 -messages 100
+// symplebench -host 10.0.0.2 -port 4500 -clients 5000
+//
+
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    uint16_t port = 4502;
+    bool embedded = true;
+    int clients = 1000;
+    int loops = 4;
+    int messages = 100;
+    int timeout = 60; ///< seconds
+};
+
+
+struct Worker;
+
+
+/// Client which answers each message from its partner with another
+/// timestamped message until the configured count has been sent.
+struct BenchClient
+{
+    Worker& worker;
+    smpl::TCPClient client;
+    std::string partner;
+    int sent = 0;
+    int received = 0;
+
+    BenchClient(Worker& worker, const smpl::Client::Options& options,
+                const std::string& partner, uv::Loop* loop);
+
+    void sendNext();
+    void onStateChange(void*, sockio::ClientState& state, const sockio::ClientState&);
+    void onRecvMessage(smpl::Message& message);
+};
+
+
+/// Owns an event loop thread and the clients which run on it.
+struct Worker
+{
+    const Options& options;
+    int index;
+    uv::Loop* loop = nullptr;
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    std::vector<std::uint64_t> samples; ///< latencies in nanoseconds
+    std::unique_ptr<Synchronizer> starter;
+    std::unique_ptr<Synchronizer> stopper;
+    std::promise<void> ready; ///< set once the synchronizers are created
+    std::atomic<int>& online;
+    std::atomic<int>& completed;
+    std::atomic<int>& errors;
+    Thread thread;
+
+    Worker(const Options& options, int index, std::atomic<int>& online,
+           std::atomic<int>& completed, std::atomic<int>& errors)
+        : options(options)
+        , index(index)
+        , online(online)
+        , completed(completed)
+        , errors(errors)
+    {
+    }
+
+    void run()
+    {
+        loop = uv::createLoop();
+
+        // Clients are paired with the next index, so each pair
+        // is always created on the same worker.
+        for (int i = index * 2; i < options.clients; i += options.loops * 2) {
+            for (int j = 0; j < 2 && i + j < options.clients; j++) {
+                smpl::Client::Options copts;
+                copts.host = options.host;
+                copts.port = options.port;
+                copts.reconnection = false;
+                copts.user = "bench" + std::to_string(i + j);
+                copts.name = copts.user;
+                clients.emplace_back(new BenchClient(
+                    *this, copts, "bench" + std::to_string(i + (j ^ 1)), loop));
+            }
+        }
+        samples.reserve(clients.size() * options.messages);
+
+        starter.reset(new Synchronizer([this]() {
+            for (auto& client : clients)
+                client->sendNext();
+        }, loop));
+        stopper.reset(new Synchronizer([this]() {
+            for (auto& client : clients)
+                client->client.close();
+            starter->close();
+            stopper->close();
+        }, loop));
+        ready.set_value();
+
+        for (auto& client : clients)
+            client->client.connect();
+
+        uv::runLoop(loop);
+
+        clients.clear();
+        starter.reset();
+        stopper.reset();
+        GarbageCollector::instance().finalize(loop);
+        uv::closeLoop(loop);
+        delete loop;
+    }
+};
+
+
+BenchClient::BenchClient(Worker& worker, const smpl::Client::Options& options,
+                         const std::string& partner, uv::Loop* loop)
+    : worker(worker)
+    , client(options, loop)
+    , partner(partner)
+{
+    client += packetSlot(this, &BenchClient::onRecvMessage);
+    client.StateChange += slot(this, &BenchClient::onStateChange);
+}
+
+
+void BenchClient::sendNext()
+{
+    if (sent >= worker.options.messages || !client.isOnline())
+        return;
+
+    smpl::Message m;
+    m.setTo(partner);
+    m.setData("t", json::value(time::hrtime()));
+    client.send(m);
+    sent++;
+}
+
+
+void BenchClient::onStateChange(void*, sockio::ClientState& state, const sockio::ClientState&)
+{
+    switch (state.id()) {
+        case sockio::ClientState::Connected:
+            std::static_pointer_cast<net::TCPSocket>(client.ws().socket)->setNoDelay(true);
+            break;
+        case sockio::ClientState::Online:
+            worker.online++;
+            break;
+        case sockio::ClientState::Error:
+            worker.errors++;
+            break;
+    }
+}
+
+
+void BenchClient::onRecvMessage(smpl::Message& message)
+{
+    std::uint64_t now = time::hrtime();
+    std::uint64_t sentAt = message.data("t").get<std::uint64_t>();
+    worker.samples.push_back(now - sentAt);
+    if (++received == worker.options.messages)
+        worker.completed++;
+    sendNext();
+}
+
+
+/// Runs an embedded broker on its own loop thread.
+struct Broker
+{
+    const Options& options;
+    uv::Loop* loop = nullptr;
+    std::unique_ptr<smpl::Server> server;
+    std::unique_ptr<Synchronizer> stopper;
+    std::promise<void> ready;
+    Thread thread;
+
+    Broker(const Options& options)
+        : options(options)
+    {
+    }
+
+    void run()
+    {
+        loop = uv::createLoop();
+        try {
+            smpl::Server::Options sopts;
+            sopts.ackMessages = false;
+            server.reset(new smpl::Server(net::Address("0.0.0.0", options.port), loop, sopts));
+            server->start();
+            stopper.reset(new Synchronizer([this]() {
+                server->shutdown();
+                stopper->close();
+            }, loop));
+            ready.set_value();
+        } catch (...) {
+            ready.set_exception(std::current_exception());
+            server.reset();
+            uv::closeLoop(loop);
+            delete loop;
+            return;
+        }
+
+        uv::runLoop(loop);
+
+        cout << "Broker: announced=" << server->stats().announced
+             << " messages=" << server->stats().messages
+             << " delivered=" << server->stats().delivered
+             << " dropped=" << server->stats().dropped << endl;
+
+        stopper.reset();
+        server.reset();
+        GarbageCollector::instance().finalize(loop);
+        uv::closeLoop(loop);
+        delete loop;
+    }
+};
+
+
+void printHelp()
+{
+    cout << "\nSymple Load Generator"
+            "\n"
+            "\nOptions:"
+            "\n  -help           Print help"
+            "\n  -host           Symple server host (default: embedded server)"
+            "\n  -port           Symple server port"
+            "\n  -clients        Number of clients (default: 1000)"
+            "\n  -loops          Number of client event loops (default: 4)"
+            "\n  -messages       Messages sent per client (default: 100)"
+            "\n  -timeout        Benchmark timeout in seconds (default: 60)"
+         << endl;
+}
+
+
+/// Wait until the predicate returns true or the deadline passes.
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::steady_clock::time_point deadline)
+{
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+
+int main(int argc, char** argv)
+{
+    // Logger::instance().add(new ConsoleChannel("debug", Level::Warn));
+
+    // The garbage collector must be owned by the main thread
+    GarbageCollector::instance();
+
+    Options options;
+    OptionParser optparse(argc, argv, "-");
+    for (auto& kv : optparse.args) {
+        const std::string& key = kv.first;
+        const std::string& value = kv.second;
+        if (key == "help") {
+            printHelp();
+            return 0;
+        } else if (key == "host") {
+            options.host = value;
+            options.embedded = false;
+        } else if (key == "port") {
+            options.port = util::strtoi<uint16_t>(value);
+        } else if (key == "clients") {
+            options.clients = util::strtoi<int>(value);
+        } else if (key == "loops") {
+            options.loops = util::strtoi<int>(value);
+        } else if (key == "messages") {
+            options.messages = util::strtoi<int>(value);
+        } else if (key == "timeout") {
+            options.timeout = util::strtoi<int>(value);
+        } else {
+            cerr << "Unknown option: " << key << endl;
+        }
+    }
+    options.clients = std::max(2, options.clients & ~1);
+    options.loops = std::max(1, std::min(options.loops, options.clients / 2));
+    options.messages = std::max(1, options.messages);
+
+    // Start the embedded broker
+    std::unique_ptr<Broker> broker;
+    if (options.embedded) {
+        broker.reset(new Broker(options));
+        broker->thread.start([&]() { broker->run(); });
+        try {
+            broker->ready.get_future().get();
+        } catch (std::exception& exc) {
+            cerr << "Cannot start broker: " << exc.what() << endl;
+            broker->thread.join();
+            return 1;
+        }
+    }
+
+    std::atomic<int> online(0), completed(0), errors(0);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < options.loops; i++) {
+        workers.emplace_back(new Worker(options, i, online, completed, errors));
+        auto worker = workers.back().get();
+        worker->thread.start([worker]() { worker->run(); });
+    }
+
+    // The synchronizers are created on the worker threads
+    for (auto& worker : workers)
+        worker->ready.get_future().wait();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.timeout);
+    int numClients = options.clients;
+    bool connected = waitFor([&]() {
+        return online + errors >= numClients;
+    }, deadline);
+    cout << "Online: " << online << "/" << numClients
+         << " (" << errors << " errors)" << endl;
+
+    std::uint64_t start = time::hrtime();
+    bool finished = false;
+    if (connected && errors == 0) {
+        for (auto& worker : workers)
+            worker->starter->post();
+        finished = waitFor([&]() { return completed >= numClients; }, deadline);
+    }
+    std::uint64_t elapsed = time::hrtime() - start;
+
+    for (auto& worker : workers)
+        worker->stopper->post();
+    std::vector<std::uint64_t> samples;
+    for (auto& worker : workers) {
+        worker->thread.join();
+        samples.insert(samples.end(), worker->samples.begin(), worker->samples.end());
+    }
+
+    if (broker) {
+        broker->stopper->post();
+        broker->thread.join();
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double seconds = static_cast<double>(elapsed) / 1e9;
+    cout << "Clients: " << numClients << " on " << options.loops << " loops" << endl;
+    cout << "Messages: " << samples.size() << " in " << seconds << "s"
+         << (finished ? "" : " (timed out)") << endl;
+    cout << "Throughput: " << static_cast<std::uint64_t>(samples.size() / seconds) << " msgs/sec" << endl;
+    cout << "Latency: p50=" << percentile(samples, 0.50) / 1000
+         << "us p99=" << percentile(samples, 0.99) / 1000
+         << "us max=" << (samples.empty() ? 0 : samples.back() / 1000) << "us" << endl;
+
+    Logger::destroy();
+    return finished ? 0 : 1;
+}
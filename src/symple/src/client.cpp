@@ -12,6 +12,7 @@
 #include "scy/symple/client.h"
 #include "scy/net/sslsocket.h"
 #include "scy/net/tcpsocket.h"
+#include "scy/util.h"
 
 
 using std::endl;
@@ -287,14 +288,15 @@ void Client::onOnline()
 
 void Client::emit(IPacket& raw)
 {
-    auto packet = reinterpret_cast<sockio::Packet&>(raw);
+    auto& packet = reinterpret_cast<sockio::Packet&>(raw);
     LTrace("Emit packet:", packet.toString())
 
     // Parse Symple messages from Socket.IO packets
     if (packet.type() == sockio::Packet::Type::Event) {
         LTrace("JSON packet:", packet.toString())
 
-        json::value data = packet.json();
+        // The packet caches its parsed payload, so this is not reparsed.
+        const json::value& data = packet.json();
 #ifdef _DEBUG
         LTrace("Received ", data.dump(4))
 #endif
@@ -372,37 +374,45 @@ void Client::onPresenceData(const json::value& data, bool whiny)
 {
     LTrace("Updating:", data.dump(4))
 
-    if (data.is_object() &&
-        data.find("id") != data.end() &&
-        data.find("user") != data.end() &&
-        data.find("name") != data.end() &&
-        data.find("online") != data.end()) {
-        std::string id = data["id"].get<std::string>();
-        bool online = data["online"].get<bool>();
+    // Presence is applied as a delta, so repeated presence
+    // from a peer only touches the fields which have changed.
+    // The roster rejects non-string IDs, so they are
+    // only read here when valid.
+    std::string id;
+    auto idField = data.is_object() ? data.find("id") : data.end();
+    if (idField != data.end() && idField->is_string())
+        id = idField->get<std::string>();
+
+    // Notify before the peer is removed and deleted
+    auto online = data.is_object() ? data.find("online") : data.end();
+    if (online != data.end() && online->is_boolean() && !online->get<bool>()) {
         auto peer = _roster.get(id, false);
-        if (online) {
-            if (!peer) {
-                peer = new Peer(data);
-                _roster.add(id, peer);
-                LDebug("Peer connected:", peer->address().toString())
-                PeerConnected.emit(*peer);
-            } else {
-                static_cast<json::value&>(*peer) = data;
-            }
+        if (peer) {
+            LDebug("Peer disconnected:", peer->address().toString())
+            PeerDisconnected.emit(*peer);
         } else {
-            if (peer) {
-                LDebug("Peer disconnected:", peer->address().toString())
-                PeerDisconnected.emit(*peer);
-                _roster.free(id);
-            } else {
-                LWarn("Unknown peer disconnected")
-            }
+            LWarn("Unknown peer disconnected")
+        }
+    }
+
+    switch (_roster.update(data)) {
+        case Roster::Change::Added: {
+            auto peer = _roster.get(id, false);
+            LDebug("Peer connected:", peer->address().toString())
+            PeerConnected.emit(*peer);
+            break;
+        }
+        case Roster::Change::Removed:
+        case Roster::Change::Updated:
+        case Roster::Change::None:
+            break;
+        case Roster::Change::Invalid: {
+            std::string error("Bad presence data: " + data.dump());
+            LError(error)
+            if (whiny)
+                throw std::runtime_error(error);
+            break;
         }
-    } else {
-        std::string error("Bad presence data: " + data.dump());
-        LError(error)
-        if (whiny)
-            throw std::runtime_error(error);
     }
 
 #if 0
@@ -498,6 +508,75 @@ Client& Client::operator>>(Message& message)
 }
 
 
+//
+// Filter
+//
+
+
+Filter::Filter(const std::string& path, unsigned flags)
+    : flags(flags)
+    , path(path)
+    , _nodes(util::split(path, ":"))
+    , _any(path.empty() || path == "*")
+{
+}
+
+
+Filter::Filter(unsigned flags)
+    : flags(flags)
+    , path("*")
+    , _any(true)
+{
+}
+
+
+bool Filter::accepts(const Message& message) const
+{
+    if (flags.has(AcceptRequests) && !message.isRequest())
+        return false;
+    if (flags.has(AcceptResponses) && message.isRequest())
+        return false;
+    if (_any)
+        return true;
+
+    if (auto command = dynamic_cast<const Command*>(&message))
+        return matches(command->node());
+    if (auto event = dynamic_cast<const Event*>(&message))
+        return matches(event->name());
+    return false;
+}
+
+
+bool Filter::matches(const std::string& node) const
+{
+    if (_any)
+        return true;
+
+    // Same semantics as util::matchNodes(), comparing
+    // each node in place against the compiled path.
+    size_t index = 0;
+    size_t pos = 0;
+    while (true) {
+        size_t end = node.find(':', pos);
+        if (end == std::string::npos)
+            end = node.size();
+
+        // Nodes beyond the path only match a trailing wildcard
+        if (index >= _nodes.size())
+            return _nodes.back() == "*";
+
+        const std::string& xnode = _nodes[index++];
+        if (xnode != "*" && node.compare(pos, end - pos, xnode) != 0)
+            return false;
+
+        if (end == node.size())
+            break;
+        pos = end + 1;
+    }
+    return index == _nodes.size();
+}
+
+
 } // namespace smpl
 } // namespace scy
 
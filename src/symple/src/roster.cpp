@@ -12,6 +12,9 @@
 #include "scy/symple/roster.h"
 #include "scy/logger.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 
 using std::endl;
 
@@ -22,31 +25,227 @@ namespace smpl {
 
 Roster::Roster()
 {
-    // LTrace("Create")
+    // Symbol 0 is the empty string, which is never released
+    _symbols.push_back(std::string());
+    _symbolRefs.push_back(0);
+    _symbolIds[std::string()] = 0;
 }
 
 
 Roster::~Roster()
 {
-    // LTrace("Destroy")
 }
 
 
-Peer* Roster::getByHost(const std::string& host)
+Roster::Change Roster::update(const json::value& data)
+{
+    if (!data.is_object())
+        return Change::Invalid;
+
+    auto idField = data.find("id");
+    auto onlineField = data.find("online");
+    if (idField == data.end() || !idField->is_string() ||
+        onlineField == data.end() || !onlineField->is_boolean())
+        return Change::Invalid;
+
+    std::string id(idField->get<std::string>());
+    if (!onlineField->get<bool>()) {
+        std::unique_ptr<Peer> peer;
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            peer = erase(id);
+        }
+        if (!peer)
+            return Change::None;
+        ItemRemoved.emit(*peer);
+        return Change::Removed;
+    }
+
+    Peer* added = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        auto it = _ids.find(id);
+        if (it == _ids.end()) {
+            if (data.find("user") == data.end() || data.find("name") == data.end())
+                return Change::Invalid;
+            added = insert(id, std::unique_ptr<Peer>(new Peer(data)));
+        } else {
+            // Only apply fields which have changed, and only
+            // reindex when an indexed field has changed.
+            Slot slot = it->second;
+            json::value& peer = *_entries[slot].peer;
+            bool changed = false;
+            bool reindex = false;
+            for (auto field = data.begin(); field != data.end(); ++field) {
+                auto current = peer.find(field.key());
+                if (current != peer.end() && *current == field.value())
+                    continue;
+                peer[field.key()] = field.value();
+                changed = true;
+                const std::string& key = field.key();
+                if (key == "user" || key == "name" || key == "type" || key == "host")
+                    reindex = true;
+            }
+            if (reindex) {
+                unindex(slot);
+                load(_entries[slot]);
+                index(slot);
+            }
+            return changed ? Change::Updated : Change::None;
+        }
+    }
+
+    ItemAdded.emit(*added);
+    return Change::Added;
+}
+
+
+bool Roster::add(const std::string& id, Peer* peer, bool whiny)
+{
+    std::unique_ptr<Peer> ptr(peer);
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_ids.find(id) != _ids.end()) {
+            ptr.release();
+            if (whiny)
+                throw std::runtime_error("Item already exists");
+            return false;
+        }
+        insert(id, std::move(ptr));
+    }
+    ItemAdded.emit(*peer);
+    return true;
+}
+
+
+Peer* Roster::get(const std::string& id, bool whiny) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _ids.find(id);
+    if (it != _ids.end())
+        return _entries[it->second].peer.get();
+    if (whiny)
+        throw std::runtime_error("Item not found");
+    return nullptr;
+}
+
+
+Roster::Record Roster::record(const std::string& id) const
+{
+    Record record;
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _ids.find(id);
+    if (it != _ids.end()) {
+        auto& entry = _entries[it->second];
+        record.id = entry.id;
+        record.user = _symbols[entry.user];
+        record.name = _symbols[entry.name];
+        record.type = _symbols[entry.type];
+        record.host = _symbols[entry.host];
+        record.peer = entry.peer.get();
+    }
+    return record;
+}
+
+
+bool Roster::free(const std::string& id)
+{
+    std::unique_ptr<Peer> peer;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        peer = erase(id);
+    }
+    if (!peer)
+        return false;
+    ItemRemoved.emit(*peer);
+    return true;
+}
+
+
+bool Roster::exists(const std::string& id) const
 {
     std::lock_guard<std::mutex> guard(_mutex);
-    for (auto it = _map.begin(); it != _map.end(); ++it) {
-        if (it->second->host() == host)
-            return it->second;
+    return _ids.find(id) != _ids.end();
+}
+
+
+Peer* Roster::getByHost(const std::string& host) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto symbol = _symbolIds.find(host);
+    if (symbol == _symbolIds.end())
+        return nullptr;
+    for (auto& entry : _entries) {
+        if (entry.host == symbol->second)
+            return entry.peer.get();
     }
-    return NULL;
+    return nullptr;
+}
+
+
+std::vector<Peer*> Roster::getByUser(const std::string& user) const
+{
+    return lookup(_users, user);
+}
+
+
+std::vector<Peer*> Roster::getByType(const std::string& type) const
+{
+    return lookup(_types, type);
+}
+
+
+std::string Roster::str(Symbol symbol) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    assert(symbol < _symbols.size());
+    return _symbols[symbol];
+}
+
+
+size_t Roster::symbols() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _symbols.size() - _freeSymbols.size();
+}
+
+
+void Roster::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _entries.clear();
+    _ids.clear();
+    _users.clear();
+    _types.clear();
+    _symbols.resize(1);
+    _symbolRefs.resize(1);
+    _freeSymbols.clear();
+    _symbolIds.clear();
+    _symbolIds[std::string()] = 0;
+}
+
+
+size_t Roster::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _entries.size();
+}
+
+
+bool Roster::empty() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _entries.empty();
 }
 
 
 Roster::PeerMap Roster::peers() const
 {
     std::lock_guard<std::mutex> guard(_mutex);
-    return _map;
+    PeerMap peers;
+    for (auto& entry : _entries)
+        peers[entry.id] = entry.peer.get();
+    return peers;
 }
 
 
@@ -55,44 +254,160 @@ void Roster::print(std::ostream& os) const
     std::lock_guard<std::mutex> guard(_mutex);
 
     os << "Roster[";
-    for (auto it = _map.begin(); it != _map.end(); ++it) {
-        os << "\n\t" << it->second << ": " << it->first;
+    for (auto& entry : _entries) {
+        os << "\n\t" << entry.peer.get() << ": " << entry.id;
     }
     os << "\n]";
 }
 
 
-#if 0
-void Roster::update(const json::value& data, bool whiny)
-{
-    if (data.is_object() &&
-        data.isMember("id") &&
-        data.isMember("user") &&
-        data.isMember("name") //&&
-        //data.isMember("type")
-        ) {
-        LTrace("Updating: ", json::stringify(data, true))
-        std::string id = data["id"].get<std::string>();
-        Peer* peer = get(id, false);
-        if (!peer) {
-            peer = new Peer(data);
-            add(id, peer);
-        } else
-            static_cast<json::value&>(*peer) = data;
+Roster::Symbol Roster::intern(const std::string& str)
+{
+    Symbol symbol;
+    auto it = _symbolIds.find(str);
+    if (it != _symbolIds.end()) {
+        symbol = it->second;
+    } else if (!_freeSymbols.empty()) {
+        symbol = _freeSymbols.back();
+        _freeSymbols.pop_back();
+        _symbols[symbol] = str;
+        _symbolIds[str] = symbol;
+    } else {
+        symbol = static_cast<Symbol>(_symbols.size());
+        _symbols.push_back(str);
+        _symbolRefs.push_back(0);
+        _symbolIds[str] = symbol;
     }
-    else if (data.isArray()) {
-        for (auto it = data.begin(); it != data.end(); it++) {
-            update(*it, whiny);
-        }
+    if (symbol != 0)
+        _symbolRefs[symbol]++;
+    return symbol;
+}
+
+
+void Roster::release(Symbol symbol)
+{
+    if (symbol == 0)
+        return;
+    assert(_symbolRefs[symbol] > 0);
+    if (--_symbolRefs[symbol] == 0) {
+        _symbolIds.erase(_symbols[symbol]);
+        std::string().swap(_symbols[symbol]);
+        _freeSymbols.push_back(symbol);
     }
-    else {
-        std::string error("Bad presence data: " + json::stringify(data));
-        LError(error, )
-        if (whiny)
-            throw std::runtime_error(error);
+}
+
+
+void Roster::load(Entry& entry)
+{
+    // Intern the new values before releasing the old ones, so
+    // unchanged fields keep their symbols.
+    Entry old;
+    old.user = entry.user;
+    old.name = entry.name;
+    old.type = entry.type;
+    old.host = entry.host;
+    entry.user = intern(entry.peer->user());
+    entry.name = intern(entry.peer->name());
+    entry.type = intern(entry.peer->type());
+    entry.host = intern(entry.peer->host());
+    unload(old);
+}
+
+
+void Roster::unload(Entry& entry)
+{
+    release(entry.user);
+    release(entry.name);
+    release(entry.type);
+    release(entry.host);
+    entry.user = entry.name = entry.type = entry.host = 0;
+}
+
+
+void Roster::index(Slot slot)
+{
+    auto& entry = _entries[slot];
+    _users[entry.user].push_back(slot);
+    _types[entry.type].push_back(slot);
+}
+
+
+void Roster::unindex(Slot slot)
+{
+    auto remove = [slot](SymbolIndex& index, Symbol symbol) {
+        auto it = index.find(symbol);
+        if (it == index.end())
+            return;
+        auto& slots = it->second;
+        auto pos = std::find(slots.begin(), slots.end(), slot);
+        if (pos != slots.end()) {
+            *pos = slots.back();
+            slots.pop_back();
+        }
+        if (slots.empty())
+            index.erase(it);
+    };
+
+    auto& entry = _entries[slot];
+    remove(_users, entry.user);
+    remove(_types, entry.type);
+}
+
+
+Peer* Roster::insert(const std::string& id, std::unique_ptr<Peer> peer)
+{
+    Slot slot = static_cast<Slot>(_entries.size());
+    _entries.emplace_back();
+    auto& entry = _entries.back();
+    entry.id = id;
+    entry.peer = std::move(peer);
+    load(entry);
+    _ids[id] = slot;
+    index(slot);
+    return entry.peer.get();
+}
+
+
+std::unique_ptr<Peer> Roster::erase(const std::string& id)
+{
+    auto it = _ids.find(id);
+    if (it == _ids.end())
+        return nullptr;
+
+    Slot slot = it->second;
+    Slot last = static_cast<Slot>(_entries.size() - 1);
+    unindex(slot);
+    unload(_entries[slot]);
+    _ids.erase(it);
+    std::unique_ptr<Peer> peer(std::move(_entries[slot].peer));
+
+    // Move the last entry into the free slot to keep the array packed
+    if (slot != last) {
+        unindex(last);
+        _entries[slot] = std::move(_entries[last]);
+        _ids[_entries[slot].id] = slot;
+        index(slot);
     }
+    _entries.pop_back();
+    return peer;
+}
+
+
+std::vector<Peer*> Roster::lookup(const SymbolIndex& index, const std::string& str) const
+{
+    std::vector<Peer*> peers;
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto symbol = _symbolIds.find(str);
+    if (symbol == _symbolIds.end())
+        return peers;
+    auto it = index.find(symbol->second);
+    if (it == index.end())
+        return peers;
+    peers.reserve(it->second.size());
+    for (auto slot : it->second)
+        peers.push_back(_entries[slot].peer.get());
+    return peers;
 }
-#endif
 
 
 } // namespace smpl
@@ -0,0 +1,351 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup symple
+/// @{
+
+
+#include "scy/symple/server.h"
+#include "scy/logger.h"
+#include "scy/util.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+
+using std::endl;
+
+
+namespace scy {
+namespace smpl {
+
+
+namespace {
+
+/// Encode a Symple message as a Socket.IO event packet.
+std::string encodeMessage(const json::value& message)
+{
+    std::string data(message.dump());
+    std::string packet;
+    packet.reserve(data.size() + 16);
+    packet.append("42[\"message\",").append(data).append("]");
+    return packet;
+}
+
+} // namespace
+
+
+Server::Server(const net::Address& address, uv::Loop* loop, const Options& options)
+    : sockio::Server(address, loop, options)
+    , _options(options)
+{
+}
+
+
+Server::~Server()
+{
+    // Close sockets while our callbacks are still valid
+    shutdown();
+}
+
+
+const Peer* Server::peer(const std::string& id) const
+{
+    auto socket = get(id);
+    if (!socket)
+        return nullptr;
+    auto it = _sessions.find(socket);
+    return it != _sessions.end() ? &it->second.peer : nullptr;
+}
+
+
+size_t Server::numPeers() const
+{
+    return _sessions.size();
+}
+
+
+size_t Server::roomSize(const std::string& room) const
+{
+    auto it = _rooms.find(room);
+    return it != _rooms.end() ? it->second.size() : 0;
+}
+
+
+const ServerStats& Server::stats() const
+{
+    return _stats;
+}
+
+
+int Server::authenticate(sockio::ServerSocket&, const json::value&)
+{
+    return 200;
+}
+
+
+void Server::onPacket(sockio::ServerSocket& socket, sockio::Packet& packet)
+{
+    if (packet.type() != sockio::Packet::Type::Event)
+        return;
+
+    std::string event(packet.event());
+    if (event == "announce") {
+        onAnnounce(socket, packet);
+        return;
+    }
+
+    auto it = _sessions.find(&socket);
+    if (it == _sessions.end()) {
+        LDebug("Dropping packet from unannounced socket: ", socket.id())
+        _stats.dropped++;
+        return;
+    }
+
+    try {
+        if (event == "message")
+            onMessage(socket, it->second, packet);
+        else if (event == "join")
+            join(socket, it->second, packet.json().get<std::string>());
+        else if (event == "leave")
+            leave(socket, it->second, packet.json().get<std::string>());
+        else
+            LDebug("Unknown event: ", event)
+    } catch (std::exception& exc) {
+        LWarn("Invalid packet: ", socket.id(), ": ", exc.what())
+        _stats.dropped++;
+    }
+}
+
+
+void Server::onDisconnect(sockio::ServerSocket& socket)
+{
+    auto it = _sessions.find(&socket);
+    if (it == _sessions.end())
+        return;
+
+    auto& session = it->second;
+
+    // Notify our rooms that the peer has gone offline
+    if (!session.rooms.empty()) {
+        session.peer["online"] = false;
+        json::value presence;
+        presence["type"] = "presence";
+        presence["id"] = util::randomString(16);
+        presence["from"] = session.address;
+        presence["data"] = static_cast<json::value&>(session.peer);
+        broadcast(socket, session, encodeMessage(presence));
+    }
+
+    for (auto& room : session.rooms) {
+        auto rit = _rooms.find(room);
+        if (rit != _rooms.end()) {
+            removeSocket(rit->second, &socket);
+            if (rit->second.empty())
+                _rooms.erase(rit);
+        }
+    }
+
+    auto uit = _users.find(session.peer.user());
+    if (uit != _users.end()) {
+        removeSocket(uit->second, &socket);
+        if (uit->second.empty())
+            _users.erase(uit);
+    }
+
+    _sessions.erase(it);
+}
+
+
+void Server::onAnnounce(sockio::ServerSocket& socket, sockio::Packet& packet)
+{
+    json::value res;
+    try {
+        if (_sessions.find(&socket) != _sessions.end())
+            throw std::runtime_error("Already announced");
+
+        const json::value& data = packet.json();
+        std::string user(data.value("user", ""));
+        if (user.empty())
+            throw std::runtime_error("No user specified");
+
+        int status = authenticate(socket, data);
+        if (status != 200) {
+            res["status"] = status;
+            res["message"] = "Authentication failed";
+            socket.sendAck(packet.id(), res);
+            return;
+        }
+
+        auto& session = _sessions[&socket];
+        session.peer.setID(socket.id());
+        session.peer.setUser(user);
+        session.peer.setName(data.value("name", ""));
+        session.peer.setType(data.value("type", ""));
+        session.peer["online"] = true;
+        session.address = session.peer.address().toString();
+        _users[user].push_back(&socket);
+        _stats.announced++;
+
+        res["status"] = 200;
+        res["data"] = static_cast<json::value&>(session.peer);
+        LDebug("Announced: ", session.address)
+    } catch (std::exception& exc) {
+        res["status"] = 400;
+        res["message"] = std::string("Bad request: ") + exc.what();
+    }
+    socket.sendAck(packet.id(), res);
+}
+
+
+void Server::onMessage(sockio::ServerSocket& socket, Session& session, sockio::Packet& packet)
+{
+    _stats.messages++;
+
+    const json::value& message = packet.json();
+    if (!message.is_object() ||
+        message.find("type") == message.end() ||
+        message.find("id") == message.end()) {
+        _stats.dropped++;
+        if (_options.ackMessages)
+            socket.sendAck(packet.id(), json::value{{"status", 400}});
+        return;
+    }
+
+    // Keep the peer data up to date for offline presence
+    if (*message.find("type") == "presence") {
+        auto data = message.find("data");
+        if (data != message.end() && data->is_object()) {
+            for (auto it = data->begin(); it != data->end(); ++it) {
+                if (it.key() != "id" && it.key() != "user")
+                    session.peer[it.key()] = it.value();
+            }
+        }
+    }
+
+    // Senders may not spoof their address. Messages which already carry
+    // the sender's address, as sent by our clients, are not copied.
+    std::string data;
+    auto from = message.find("from");
+    if (from != message.end() && *from == session.address)
+        data = encodeMessage(message);
+    else {
+        json::value copy(message);
+        copy["from"] = session.address;
+        data = encodeMessage(copy);
+    }
+
+    int status = 200;
+    std::string to(message.value("to", ""));
+    if (to.empty()) {
+        broadcast(socket, session, data);
+    } else {
+        Address addr(to);
+        if (!addr.id.empty()) {
+            auto recipient = get(addr.id);
+            auto it = recipient ? _sessions.find(recipient) : _sessions.end();
+            if (it != _sessions.end() &&
+                (addr.user.empty() || addr.user == it->second.peer.user())) {
+                deliver(&socket, SocketVec{recipient}, data);
+            } else {
+                status = 404;
+            }
+        } else {
+            auto it = _users.find(addr.user);
+            if (it != _users.end())
+                deliver(&socket, it->second, data);
+            else
+                status = 404;
+        }
+    }
+
+    if (status != 200)
+        _stats.dropped++;
+    if (_options.ackMessages)
+        socket.sendAck(packet.id(), json::value{{"status", status}});
+}
+
+
+void Server::join(sockio::ServerSocket& socket, Session& session, const std::string& room)
+{
+    if (room.empty() ||
+        std::find(session.rooms.begin(), session.rooms.end(), room) != session.rooms.end())
+        return;
+
+    LTrace("Join room: ", session.address, ": ", room)
+    session.rooms.push_back(room);
+    _rooms[room].push_back(&socket);
+}
+
+
+void Server::leave(sockio::ServerSocket& socket, Session& session, const std::string& room)
+{
+    auto it = std::find(session.rooms.begin(), session.rooms.end(), room);
+    if (it == session.rooms.end())
+        return;
+
+    LTrace("Leave room: ", session.address, ": ", room)
+    session.rooms.erase(it);
+    auto rit = _rooms.find(room);
+    if (rit != _rooms.end()) {
+        removeSocket(rit->second, &socket);
+        if (rit->second.empty())
+            _rooms.erase(rit);
+    }
+}
+
+
+void Server::broadcast(sockio::ServerSocket& sender, Session& session, const std::string& packet)
+{
+    if (session.rooms.size() == 1) {
+        auto it = _rooms.find(session.rooms.front());
+        if (it != _rooms.end())
+            deliver(&sender, it->second, packet);
+        return;
+    }
+
+    // Peers which share multiple rooms with the sender
+    // only receive the message once.
+    std::unordered_set<sockio::ServerSocket*> recipients;
+    for (auto& room : session.rooms) {
+        auto it = _rooms.find(room);
+        if (it == _rooms.end())
+            continue;
+        for (auto socket : it->second) {
+            if (socket != &sender && recipients.insert(socket).second) {
+                if (socket->sendRaw(packet.c_str(), packet.size()) > 0)
+                    _stats.delivered++;
+            }
+        }
+    }
+}
+
+
+void Server::deliver(sockio::ServerSocket* sender, const SocketVec& sockets, const std::string& packet)
+{
+    for (auto socket : sockets) {
+        if (socket != sender && socket->sendRaw(packet.c_str(), packet.size()) > 0)
+            _stats.delivered++;
+    }
+}
+
+
+void Server::removeSocket(SocketVec& sockets, sockio::ServerSocket* socket)
+{
+    auto it = std::find(sockets.begin(), sockets.end(), socket);
+    if (it != sockets.end()) {
+        *it = sockets.back();
+        sockets.pop_back();
+    }
+}
+
+
+} // namespace smpl
+} // namespace scy
+
+
+/// @\}
@@ -42,6 +42,108 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // Roster
+    //
+    describe("roster", []() {
+        smpl::Roster roster;
+        int added = 0, removed = 0;
+        roster.ItemAdded += [&](smpl::Peer&) { added++; };
+        roster.ItemRemoved += [&](const smpl::Peer&) { removed++; };
+
+        json::value p1{{"id", "1"}, {"user", "a"}, {"name", "A"}, {"online", true}};
+        json::value p2{{"id", "2"}, {"user", "a"}, {"name", "A2"}, {"online", true}};
+        json::value p3{{"id", "3"}, {"user", "b"}, {"name", "B"}, {"online", true}};
+        expect(roster.update(p1) == smpl::Roster::Change::Added);
+        expect(roster.update(p2) == smpl::Roster::Change::Added);
+        expect(roster.update(p3) == smpl::Roster::Change::Added);
+        expect(roster.update(p1) == smpl::Roster::Change::None);
+        expect(roster.update(json::value{{"id", "4"}}) == smpl::Roster::Change::Invalid);
+        expect(roster.size() == 3);
+        expect(added == 3);
+        expect(roster.getByUser("a").size() == 2);
+        expect(roster.getByUser("b").size() == 1);
+        expect(roster.getByType("Peer").size() == 3);
+
+        // Delta updates only touch changed fields
+        json::value delta{{"id", "1"}, {"user", "b"}, {"online", true}, {"agent", "x"}};
+        expect(roster.update(delta) == smpl::Roster::Change::Updated);
+        expect(roster.get("1")->name() == "A");
+        expect((*roster.get("1"))["agent"] == "x");
+        expect(roster.getByUser("a").size() == 1);
+        expect(roster.getByUser("b").size() == 2);
+        auto record = roster.record("1");
+        expect(record.user == "b");
+        expect(record.name == "A");
+        expect(record.peer == roster.get("1"));
+        expect(roster.record("5").peer == nullptr);
+
+        // Removing a record keeps the array packed and indexes valid
+        json::value offline{{"id", "1"}, {"online", false}};
+        expect(roster.update(offline) == smpl::Roster::Change::Removed);
+        expect(roster.update(offline) == smpl::Roster::Change::None);
+        expect(removed == 1);
+        expect(roster.size() == 2);
+        expect(roster.getByUser("b").size() == 1);
+        expect(roster.get("3", false)->name() == "B");
+        expect(roster.free("2"));
+        expect(roster.getByUser("a").empty());
+        expect(roster.get("3", false) != nullptr);
+
+        // Strings which are no longer used are recycled
+        for (int i = 0; i < 100; i++) {
+            json::value peer{{"id", "x"}, {"user", "user" + std::to_string(i)},
+                             {"name", "name" + std::to_string(i)}, {"online", true}};
+            expect(roster.update(peer) == smpl::Roster::Change::Added);
+            expect(roster.update(json::value{{"id", "x"}, {"online", false}}) ==
+                   smpl::Roster::Change::Removed);
+        }
+        json::value renamed{{"id", "3"}, {"user", "c"}, {"online", true}};
+        expect(roster.update(renamed) == smpl::Roster::Change::Updated);
+        expect(roster.getByUser("b").empty());
+        expect(roster.record("3").user == "c");
+        expect(roster.symbols() <= 8);
+
+        roster.clear();
+        expect(roster.empty());
+    });
+
+
+    // =========================================================================
+    // Filter
+    //
+    describe("filter", []() {
+        smpl::Filter any;
+        expect(any.matches("a:b:c"));
+
+        smpl::Filter exact("camera:start");
+        expect(exact.matches("camera:start"));
+        expect(!exact.matches("camera:stop"));
+        expect(!exact.matches("camera"));
+        expect(!exact.matches("camera:start:now"));
+
+        smpl::Filter wildcard("camera:*");
+        expect(wildcard.matches("camera:start"));
+        expect(wildcard.matches("camera:start:now"));
+        expect(!wildcard.matches("camera"));
+        expect(!wildcard.matches("video:start"));
+
+        smpl::Filter middle("a:*:c");
+        expect(middle.matches("a:b:c"));
+        expect(!middle.matches("a:b:d"));
+
+        smpl::Command c;
+        c.setNode("camera:start");
+        expect(smpl::Filter("camera:*").accepts(c));
+        expect(!smpl::Filter("video:*").accepts(c));
+        expect(smpl::Filter("camera:*", smpl::AcceptRequests).accepts(c) == c.isRequest());
+
+        smpl::Message m;
+        expect(!smpl::Filter("camera:*").accepts(m));
+        expect(smpl::Filter().accepts(m));
+    });
+
+
     // =========================================================================
     // Client
     //
@@ -91,6 +193,50 @@ int main(int argc, char** argv)
         rclient.check();
     });
 
+    // =========================================================================
+    // Broker
+    //
+    describe("broker", []() {
+        smpl::Server server(net::Address("0.0.0.0", SERVER_PORT + 1));
+        server.start();
+
+        smpl::Client::Options loptions;
+        loptions.host = SERVER_HOST;
+        loptions.port = SERVER_PORT + 1;
+        loptions.user = "l";
+        loptions.name = "Left";
+
+        smpl::Client::Options roptions;
+        roptions.host = SERVER_HOST;
+        roptions.port = SERVER_PORT + 1;
+        roptions.user = "r";
+        roptions.name = "Right";
+
+        {
+            TestClient lclient(loptions);
+            TestClient rclient(roptions);
+
+            lclient.connect();
+            rclient.connect();
+
+            while (!lclient.completed() || !rclient.completed()) {
+                uv::runLoop(uv::defaultLoop(), UV_RUN_ONCE);
+            }
+
+            lclient.check();
+            rclient.check();
+
+            expect(server.numPeers() == 2);
+            expect(server.roomSize("test") == 2);
+            expect(server.stats().announced == 2);
+            expect(server.stats().delivered > 0);
+        }
+
+        server.shutdown();
+        uv::runLoop();
+        expect(server.numPeers() == 0);
+    });
+
     // TODO:
     //  - Obtain authentication token
     //  - Transaction test
@@ -9,6 +9,7 @@
 #include "scy/filesystem.h"
 #include "scy/net/sslmanager.h"
 #include "scy/symple/client.h"
+#include "scy/symple/server.h"
 #include "scy/test.h"
 
 
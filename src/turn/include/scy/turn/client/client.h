@@ -185,6 +185,8 @@ protected:
 
     std::string _realm;
     std::string _nonce;
+    std::string _credentialKey;   // MD5(username:realm:password)
+    std::string _credentialRealm; // realm of the cached key
 
     /// A list of queued Send indication packets awaiting server permissions
     std::deque<stun::Message> _pendingIndications;
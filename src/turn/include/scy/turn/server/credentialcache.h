@@ -0,0 +1,107 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup turn
+/// @{
+
+
+#ifndef SCY_TURN_CredentialCache_H
+#define SCY_TURN_CredentialCache_H
+
+
+#include "scy/crypto/hmac.h"
+#include "scy/turn/turn.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+namespace scy {
+namespace turn {
+
+
+/// Bounded cache of long-term credential keys.
+///
+/// Entries are keyed by username and realm, and store the derived key
+/// `MD5(username:realm:password)` along with an HMAC context which is
+/// preinitialized with that key, so that the MESSAGE-INTEGRITY of refresh,
+/// permission and channel requests can be verified without recomputing
+/// the key. The ServerObserver is still consulted to validate the NONCE.
+///
+/// Entries expire a fixed time after they were inserted, which bounds how
+/// long revoked credentials remain valid, and the least recently used entry
+/// is evicted once the cache is full.
+///
+/// The cache is not thread-safe and must only be used from the loop thread.
+class TURN_API CredentialCache
+{
+public:
+    struct Entry
+    {
+        std::string username;
+        std::string realm;
+        std::string key;          ///< The derived long-term credential key
+        crypto::HMACContext hmac; ///< HMAC context initialized with `key`
+        std::uint64_t expires;    ///< Expiry time in milliseconds
+    };
+
+    /// Create a cache with the given entry lifetime
+    /// in milliseconds and maximum number of entries.
+    CredentialCache(std::int64_t ttl = 5 * 60 * 1000, size_t maxSize = 10000);
+    ~CredentialCache();
+
+    /// Return the entry for the given credentials, or nullptr if none has
+    /// been cached or the entry has expired.
+    /// The entry remains valid until the cache is next modified.
+    const Entry* find(const std::string& username, const std::string& realm);
+
+    /// Cache the derived key for the given credentials.
+    const Entry& insert(const std::string& username, const std::string& realm,
+                        const std::string& key);
+
+    /// Remove the entry for the given credentials.
+    bool erase(const std::string& username, const std::string& realm);
+
+    /// Remove all entries.
+    void clear();
+
+    /// Set the entry lifetime in milliseconds.
+    void setTTL(std::int64_t ttl);
+
+    /// Set the maximum number of entries.
+    void setMaxSize(size_t maxSize);
+
+    std::int64_t ttl() const;
+    size_t maxSize() const;
+    size_t size() const;
+
+protected:
+    CredentialCache(const CredentialCache&) = delete;
+    CredentialCache& operator=(const CredentialCache&) = delete;
+
+    typedef std::list<Entry> EntryList;
+
+    static std::string makeKey(const std::string& username, const std::string& realm);
+    void evict();
+
+    EntryList _entries; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> _index;
+    std::int64_t _ttl;
+    size_t _maxSize;
+};
+
+
+} } //  namespace scy::turn
+
+
+#endif // SCY_TURN_CredentialCache_H
+
+
+/// @\}
@@ -18,6 +18,7 @@
 #include "scy/net/udpsocket.h"
 #include "scy/stun/message.h"
 #include "scy/timer.h"
+#include "scy/turn/server/credentialcache.h"
 #include "scy/turn/server/serverallocation.h"
 #include "scy/turn/server/tcpallocation.h"
 #include "scy/turn/server/udpallocation.h"
@@ -52,6 +53,15 @@ struct ServerOptions
     bool enableTCP;
     bool enableUDP;
 
+    /// Bind the UDP listening socket with SO_REUSEPORT so that multiple
+    /// servers can share the listening port. See ShardedServer.
+    bool reusePort;
+
+    uv::Loop* loop; ///< The event loop which the server runs on
+
+    int credentialCacheTTL;  ///< Credential cache entry lifetime in milliseconds, or 0 to disable
+    int credentialCacheSize; ///< Maximum number of cached credentials
+
     ServerOptions()
     {
         software = "Sourcey STUN/TURN Server [rfc5766]";
@@ -65,6 +75,10 @@ struct ServerOptions
         earlyMediaBufferSize = 8192;
         enableTCP = true;
         enableUDP = true;
+        reusePort = false;
+        loop = uv::defaultLoop();
+        credentialCacheTTL = 5 * 60 * 1000;
+        credentialCacheSize = 10000;
     }
 };
 
@@ -83,6 +97,15 @@ struct ServerObserver
     /// asynchronously against a remote database, or locally.
     /// The default implementation returns true to all requests.
     ///
+    /// Once a request carrying USERNAME, REALM and MESSAGE-INTEGRITY is
+    /// authorized with `request.hash` set to the long-term credential key,
+    /// the key is cached by the server until the cache entry expires.
+    /// When a later request's MESSAGE-INTEGRITY verifies against a cached
+    /// key, `request.hash` is already set to that key and `request.verified`
+    /// is true when the observer is called, so the observer may skip
+    /// deriving the key and checking the MESSAGE-INTEGRITY, but must still
+    /// validate the NONCE and reply 438 (Stale Nonce) where appropriate.
+    ///
     /// To mitigate either intentional or unintentional denial-of-service
     /// attacks against the server by clients with valid usernames and
     /// passwords, it is RECOMMENDED that the server impose limits on both
@@ -109,6 +132,10 @@ public:
     virtual void start();
     virtual void stop();
 
+    /// Authenticate the request against the credential cache,
+    /// or the observer if the credentials are not cached.
+    AuthenticationState authenticateRequest(Request& request);
+
     void handleRequest(Request& request, AuthenticationState state);
     void handleAuthorizedRequest(Request& request);
     void handleBindingRequest(Request& request);
@@ -131,6 +158,8 @@ public:
     net::UDPSocket& udpSocket();
     net::TCPSocket& tcpSocket();
     Timer& timer();
+    CredentialCache& credentials();
+    uv::Loop* loop() const;
 
     void onTCPAcceptConnection(const net::TCPSocket::Ptr& sock);
     void onTCPSocketClosed(net::Socket& socket);
@@ -138,6 +167,10 @@ public:
                       const net::Address& peerAddress);
     void onTimer();
 
+protected:
+    /// Cache the long-term credential key of an authorized request.
+    void cacheCredentials(Request& request);
+
 private:
     ServerObserver& _observer;
     ServerOptions _options;
@@ -145,6 +178,7 @@ private:
     net::SocketEmitter _tcpSocket; // net::TCPSocket
     std::vector<net::SocketEmitter> _tcpSockets;
     ServerAllocationMap _allocations;
+    CredentialCache _credentials;
     Timer _timer;
 };
 
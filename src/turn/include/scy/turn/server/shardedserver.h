@@ -0,0 +1,116 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup turn
+/// @{
+
+
+#ifndef SCY_TURN_ShardedServer_H
+#define SCY_TURN_ShardedServer_H
+
+
+#include "scy/synchronizer.h"
+#include "scy/thread.h"
+#include "scy/turn/server/server.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace scy {
+namespace turn {
+
+
+/// Multi-threaded TURN server which runs a Server shard per worker thread.
+///
+/// Each shard is a complete Server with its own event loop, and owns the
+/// allocations, relay sockets and timers created through it, so no state is
+/// shared between threads. The UDP listening port is shared between the
+/// shards with SO_REUSEPORT, and the kernel hashes the client's address to
+/// select the receiving socket, so every request from a client five-tuple
+/// reaches the shard which owns its allocation. Relayed data is handled
+/// entirely on the owning shard's loop.
+///
+/// TCP is only served by the first shard, since ConnectionBind requests
+/// arrive on new connections which must reach the shard that owns the
+/// allocation.
+///
+/// Allocation callbacks are serialized so they need not be thread-safe, but
+/// they are made from the worker threads. `authenticateRequest` is called
+/// concurrently from all shards and must be thread-safe. Asynchronous
+/// authentication must be completed on the loop of the calling shard,
+/// ie. `server->loop()`.
+class TURN_API ShardedServer : public ServerObserver
+{
+public:
+    /// Create a server with the given number of shards.
+    /// A zero value creates one shard per hardware thread.
+    ShardedServer(ServerObserver& observer,
+                  const ServerOptions& options = ServerOptions(),
+                  int numShards = 0);
+    virtual ~ShardedServer();
+
+    /// Start the worker threads and wait for all shards to listen.
+    /// Throws if any shard fails to start.
+    virtual void start();
+
+    /// Stop all shards and join the worker threads.
+    virtual void stop();
+
+    /// Return the number of shards.
+    size_t numShards() const;
+
+    /// Return the number of active allocations across all shards.
+    size_t numAllocations() const;
+
+    ServerOptions& options();
+
+protected:
+    struct Shard
+    {
+        int index;
+        uv::Loop* loop;
+        std::unique_ptr<Server> server;
+        std::unique_ptr<Synchronizer> stopper;
+        std::mutex mutex; ///< Guards the stopper
+        std::promise<void> ready;
+        Thread thread;
+    };
+
+    void run(Shard& shard);
+
+    /// Destroy the shard's server and close its loop.
+    /// Called on the shard's worker thread.
+    void shutdown(Shard& shard);
+
+    /// Create the Server for the given shard.
+    /// Called on the shard's worker thread.
+    virtual Server* createServer(int index, const ServerOptions& options);
+
+    virtual void onServerAllocationCreated(Server* server, IAllocation* alloc) override;
+    virtual void onServerAllocationRemoved(Server* server, IAllocation* alloc) override;
+    virtual AuthenticationState authenticateRequest(Server* server, Request& request) override;
+
+    ServerObserver& _observer;
+    ServerOptions _options;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<size_t> _numAllocations;
+    std::mutex _mutex;
+    int _numShards;
+};
+
+
+} } //  namespace scy::turn
+
+
+#endif // SCY_TURN_ShardedServer_H
+
+
+/// @\}
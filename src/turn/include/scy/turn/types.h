@@ -43,6 +43,7 @@ public:
     net::Address localAddress;
     net::Address remoteAddress;
     std::string hash; // for MessageIntegrity signing
+    bool verified;    // MessageIntegrity was verified against the hash
 
     Request(const stun::Message& message, net::TransportType transport,
             const net::Address& localAddress = net::Address(),
@@ -51,6 +52,7 @@ public:
         , transport(transport)
         , localAddress(localAddress)
         , remoteAddress(remoteAddress)
+        , verified(false)
     {
     }
 };
@@ -1,5 +1,5 @@
 #include "scy/application.h"
-#include "scy/crypto/hash.h"
+#include "scy/stun/attributes.h"
 #include "scy/turn/server/server.h"
 
 
@@ -75,20 +75,23 @@ public:
 
         // Determine authentication status and return either Authorized,
         // Unauthorized or Authenticating.
-        std::string credentials(SERVER_USERNAME + ":" + SERVER_REALM + ":" + SERVER_PASSWORD);
-        crypto::Hash engine("md5");
-        engine.update(credentials);
-        request.hash = engine.digestStr();
-
+        // The server verifies requests signed with a cached key, so the
+        // key only needs deriving and checking for new credentials.
 #if ENABLE_AUTHENTICATION
-        SDebug << "Generating HMAC: data=" << credentials
-               << ", key=" << request.hash << endl;
+        if (request.verified)
+            return turn::Authorized;
+
+        request.hash = stun::deriveKey(SERVER_USERNAME, SERVER_REALM, SERVER_PASSWORD);
+        SDebug << "Generating HMAC: key=" << request.hash << endl;
 
         if (integrityAttr->verifyHmac(request.hash))
             return turn::Authorized;
         return turn::NotAuthorized;
 #else
-        // Since no authentication is required we just return Authorized.
+        // Since no authentication is required we just return Authorized,
+        // with the key set for signing the response.
+        if (request.hash.empty())
+            request.hash = stun::deriveKey(SERVER_USERNAME, SERVER_REALM, SERVER_PASSWORD);
         return turn::Authorized;
 #endif
     }
@@ -11,11 +11,11 @@
 
 #include "scy/turn/client/client.h"
 #include "scy/application.h"
-#include "scy/crypto/hash.h"
 #include "scy/hex.h"
 #include "scy/logger.h"
 #include "scy/net/tcpsocket.h"
 #include "scy/net/udpsocket.h"
+#include "scy/stun/attributes.h"
 
 #include <algorithm>
 #include <assert.h>
@@ -246,17 +246,16 @@ void Client::authenticateRequest(stun::Message& request)
     }
 
     if (_realm.size() && _options.password.size()) {
-        crypto::Hash engine("md5");
-        engine.update(_options.username + ":" + _realm + ":" +
-                      _options.password);
-        // return hex::encode(engine.digest());
-        // std::string key(crypto::hash("MD5", _options.username + ":" + _realm
-        // + ":" + _options.password));
-        STrace << "Generating HMAC: data="
-               << (_options.username + ":" + _realm + ":" + _options.password)
-               << ", key=" << engine.digestStr() << endl;
+        // The key only changes with the realm, so derive it once
+        // rather than for every refresh and permission request.
+        if (_credentialKey.empty() || _credentialRealm != _realm) {
+            _credentialKey = stun::deriveKey(_options.username, _realm,
+                                             _options.password);
+            _credentialRealm = _realm;
+            STrace << "Generating HMAC key: realm=" << _realm << endl;
+        }
         auto integrityAttr = new stun::MessageIntegrity;
-        integrityAttr->setKey(engine.digestStr());
+        integrityAttr->setKey(_credentialKey);
         request.add(integrityAttr);
     }
 }
@@ -52,15 +52,15 @@ bool FiveTuple::operator==(const FiveTuple& r) const
 
 bool FiveTuple::operator<(const FiveTuple& r) const
 {
-    if (_remote.port() < r._remote.port())
+    if (_remote < r._remote)
         return true;
-    if (r._remote.port() < _remote.port())
+    if (r._remote < _remote)
         return false;
-    if (_local.port() < r._local.port())
+    if (_local < r._local)
         return true;
-    if (r._local.port() < _local.port())
+    if (r._local < _local)
         return false;
-    return false;
+    return _transport < r._transport;
 }
 
 
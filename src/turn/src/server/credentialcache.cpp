@@ -0,0 +1,158 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup turn
+/// @{
+
+
+#include "scy/turn/server/credentialcache.h"
+#include "scy/time.h"
+
+#include <algorithm>
+
+
+namespace scy {
+namespace turn {
+
+
+namespace {
+
+std::uint64_t nowMs()
+{
+    return time::hrtime() / 1000000;
+}
+
+} // namespace
+
+
+CredentialCache::CredentialCache(std::int64_t ttl, size_t maxSize)
+    : _ttl(ttl)
+    , _maxSize(maxSize)
+{
+}
+
+
+CredentialCache::~CredentialCache()
+{
+}
+
+
+const CredentialCache::Entry* CredentialCache::find(const std::string& username,
+                                                    const std::string& realm)
+{
+    auto it = _index.find(makeKey(username, realm));
+    if (it == _index.end())
+        return nullptr;
+
+    auto entry = it->second;
+    if (entry->expires <= nowMs()) {
+        _entries.erase(entry);
+        _index.erase(it);
+        return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, entry);
+    return &*entry;
+}
+
+
+const CredentialCache::Entry& CredentialCache::insert(const std::string& username,
+                                                      const std::string& realm,
+                                                      const std::string& key)
+{
+    erase(username, realm);
+
+    _entries.emplace_front();
+    auto& entry = _entries.front();
+    entry.username = username;
+    entry.realm = realm;
+    entry.key = key;
+    entry.hmac.setKey(key);
+    entry.expires = nowMs() + std::max<std::int64_t>(_ttl, 0);
+    _index[makeKey(username, realm)] = _entries.begin();
+
+    evict();
+    return entry;
+}
+
+
+bool CredentialCache::erase(const std::string& username, const std::string& realm)
+{
+    auto it = _index.find(makeKey(username, realm));
+    if (it == _index.end())
+        return false;
+    _entries.erase(it->second);
+    _index.erase(it);
+    return true;
+}
+
+
+void CredentialCache::clear()
+{
+    _index.clear();
+    _entries.clear();
+}
+
+
+void CredentialCache::setTTL(std::int64_t ttl)
+{
+    _ttl = ttl;
+}
+
+
+void CredentialCache::setMaxSize(size_t maxSize)
+{
+    _maxSize = maxSize;
+    evict();
+}
+
+
+std::int64_t CredentialCache::ttl() const
+{
+    return _ttl;
+}
+
+
+size_t CredentialCache::maxSize() const
+{
+    return _maxSize;
+}
+
+
+size_t CredentialCache::size() const
+{
+    return _entries.size();
+}
+
+
+std::string CredentialCache::makeKey(const std::string& username, const std::string& realm)
+{
+    // Usernames may not contain a null character, so it is
+    // safe to use as a separator.
+    std::string key;
+    key.reserve(username.size() + realm.size() + 1);
+    key.append(username).append(1, '\0').append(realm);
+    return key;
+}
+
+
+void CredentialCache::evict()
+{
+    // The list is ordered by use, so the least
+    // recently used entries are evicted first.
+    while (_entries.size() > _maxSize) {
+        auto& entry = _entries.back();
+        _index.erase(makeKey(entry.username, entry.realm));
+        _entries.pop_back();
+    }
+}
+
+
+} } //  namespace scy::turn
+
+
+/// @\}
@@ -31,6 +31,8 @@ Server::Server(ServerObserver& observer, const ServerOptions& options)
     //, _tcpSocket(net::makeSocket<net::TCPSocket>())
     , _udpSocket(nullptr)
     , _tcpSocket(nullptr)
+    , _credentials(options.credentialCacheTTL, options.credentialCacheSize)
+    , _timer(options.loop)
 {
     LTrace("Create")
 }
@@ -49,14 +51,16 @@ void Server::start()
     LTrace("Starting")
 
     if (_options.enableUDP) {
-        _udpSocket.swap(net::makeSocket<net::UDPSocket>());
+        _udpSocket.swap(net::makeSocket<net::UDPSocket>(_options.loop));
         _udpSocket.Recv += slot(this, &Server::onSocketRecv, 1);
+        if (_options.reusePort)
+            _udpSocket.as<net::UDPSocket>()->setReusePort(true);
         _udpSocket->bind(_options.listenAddr);
         LTrace("UDP listening on ", _options.listenAddr)
     }
 
     if (_options.enableTCP) {
-        _tcpSocket.swap(net::makeSocket<net::TCPSocket>());
+        _tcpSocket.swap(net::makeSocket<net::TCPSocket>(_options.loop));
         _tcpSocket->bind(_options.listenAddr);
         _tcpSocket->listen();
         _tcpSocket.as<net::TCPSocket>()->AcceptConnection +=
@@ -89,12 +93,10 @@ void Server::stop()
     _tcpSockets.clear();
 
     // Close server sockets
-    //if (_udpSocket->active()) {
+    if (_udpSocket.impl)
         _udpSocket->close();
-    //}
-    //if (_tcpSocket->active()) {
+    if (_tcpSocket.impl)
         _tcpSocket->close();
-    //}
 }
 
 
@@ -154,7 +156,7 @@ void Server::onSocketRecv(net::Socket& socket, const MutableBuffer& buffer,
             Request request(message, socket.transport(), socket.address(), peerAddress);
 
             // TODO: Only authenticate stun::Message::Request types
-            handleRequest(request, _observer.authenticateRequest(this, request));
+            handleRequest(request, authenticateRequest(request));
         } else {
             assert(0 && "unknown request type");
         }
@@ -206,6 +208,29 @@ void Server::releaseTCPSocket(const net::Socket& socket)
 }
 
 
+AuthenticationState Server::authenticateRequest(Request& request)
+{
+    // Requests signed with cached long-term credentials are verified
+    // against the cached key, which is passed to the observer along with
+    // the result so it need not derive the key or verify it again. The observer is always consulted, since
+    // only it can validate the NONCE and reject stale or replayed requests.
+    if (_options.credentialCacheTTL > 0 && request.hash.empty()) {
+        auto usernameAttr = request.get<stun::Username>();
+        auto realmAttr = request.get<stun::Realm>();
+        auto integrityAttr = request.get<stun::MessageIntegrity>();
+        if (usernameAttr && realmAttr && integrityAttr) {
+            auto entry = _credentials.find(usernameAttr->asString(), realmAttr->asString());
+            if (entry && integrityAttr->verifyHmac(entry->hmac)) {
+                request.hash = entry->key;
+                request.verified = true;
+            }
+        }
+    }
+
+    return _observer.authenticateRequest(this, request);
+}
+
+
 void Server::handleRequest(Request& request, AuthenticationState state)
 {
     STrace << "Received STUN request:\n"
@@ -218,6 +243,7 @@ void Server::handleRequest(Request& request, AuthenticationState state)
             break;
 
         case Authorized:
+            cacheCredentials(request);
             handleAuthorizedRequest(request);
             break;
 
@@ -763,6 +789,36 @@ Timer& Server::timer()
 }
 
 
+CredentialCache& Server::credentials()
+{
+    return _credentials;
+}
+
+
+void Server::cacheCredentials(Request& request)
+{
+    if (_options.credentialCacheTTL <= 0 || request.hash.empty())
+        return;
+
+    auto usernameAttr = request.get<stun::Username>();
+    auto realmAttr = request.get<stun::Realm>();
+    if (!usernameAttr || !realmAttr || !request.get<stun::MessageIntegrity>())
+        return;
+
+    std::string username(usernameAttr->asString());
+    std::string realm(realmAttr->asString());
+    auto entry = _credentials.find(username, realm);
+    if (!entry || entry->key != request.hash)
+        _credentials.insert(username, realm, request.hash);
+}
+
+
+uv::Loop* Server::loop() const
+{
+    return _options.loop;
+}
+
+
 void Server::addAllocation(ServerAllocation* alloc)
 {
     {
@@ -0,0 +1,206 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup turn
+/// @{
+
+
+#include "scy/turn/server/shardedserver.h"
+#include "scy/logger.h"
+#include "scy/memory.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+
+using namespace std;
+
+
+namespace scy {
+namespace turn {
+
+
+ShardedServer::ShardedServer(ServerObserver& observer,
+                             const ServerOptions& options, int numShards)
+    : _observer(observer)
+    , _options(options)
+    , _numAllocations(0)
+    , _numShards(numShards > 0 ? numShards
+                               : std::max(1, static_cast<int>(std::thread::hardware_concurrency())))
+{
+    LTrace("Create: ", _numShards)
+}
+
+
+ShardedServer::~ShardedServer()
+{
+    stop();
+}
+
+
+void ShardedServer::start()
+{
+    assert(_shards.empty());
+    LTrace("Starting: ", _numShards)
+
+    // Create the garbage collector on the calling thread, since it must
+    // be destroyed on the thread which created it.
+    GarbageCollector::instance();
+
+    for (int i = 0; i < _numShards; i++) {
+        _shards.emplace_back(new Shard);
+        auto shard = _shards.back().get();
+        shard->index = i;
+        shard->loop = nullptr;
+        shard->thread.start([this, shard]() { run(*shard); });
+    }
+
+    // Wait for every shard to either bind or fail before stopping any of
+    // them, so that each stop handle has been published or torn down by
+    // the time stop() reads it.
+    std::exception_ptr error;
+    for (auto& shard : _shards) {
+        try {
+            shard->ready.get_future().get();
+        } catch (std::exception& exc) {
+            LError("Failed to start shard ", shard->index, ": ", exc.what())
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error) {
+        stop();
+        std::rethrow_exception(error);
+    }
+}
+
+
+void ShardedServer::stop()
+{
+    if (_shards.empty())
+        return;
+    LTrace("Stopping")
+
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        if (shard->stopper)
+            shard->stopper->post();
+    }
+    for (auto& shard : _shards)
+        shard->thread.join();
+    _shards.clear();
+}
+
+
+void ShardedServer::run(Shard& shard)
+{
+    // The server and all of its handles are created on the worker
+    // thread, since handles may only be used from their loop thread.
+    shard.loop = uv::createLoop();
+    try {
+        ServerOptions options(_options);
+        options.loop = shard.loop;
+        options.reusePort = true;
+        options.enableTCP = _options.enableTCP && shard.index == 0;
+
+        shard.server.reset(createServer(shard.index, options));
+        shard.server->start();
+        if (options.enableUDP && shard.server->udpSocket().error().any())
+            throw std::runtime_error(shard.server->udpSocket().error().message);
+
+        // The stop handle is only unreferenced here, and closed in
+        // shutdown() under the shard lock, since stop() may still be
+        // posting to it from another thread.
+        shard.stopper.reset(new Synchronizer([&shard]() {
+            shard.server->stop();
+            shard.stopper->handle().unref();
+        }, shard.loop));
+        shard.ready.set_value();
+    } catch (...) {
+        // Tear down before signalling so the starting thread never
+        // observes a half destroyed shard.
+        auto error = std::current_exception();
+        shutdown(shard);
+        shard.ready.set_exception(error);
+        return;
+    }
+
+    LTrace("Shard running: ", shard.index)
+    uv::runLoop(shard.loop);
+    LTrace("Shard stopped: ", shard.index)
+
+    shutdown(shard);
+}
+
+
+void ShardedServer::shutdown(Shard& shard)
+{
+    {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        shard.stopper.reset();
+    }
+    shard.server.reset();
+    GarbageCollector::instance().finalize(shard.loop);
+    uv::closeLoop(shard.loop);
+    delete shard.loop;
+    shard.loop = nullptr;
+}
+
+
+Server* ShardedServer::createServer(int index, const ServerOptions& options)
+{
+    return new Server(*this, options);
+}
+
+
+size_t ShardedServer::numShards() const
+{
+    return _numShards;
+}
+
+
+size_t ShardedServer::numAllocations() const
+{
+    return _numAllocations;
+}
+
+
+ServerOptions& ShardedServer::options()
+{
+    return _options;
+}
+
+
+void ShardedServer::onServerAllocationCreated(Server* server, IAllocation* alloc)
+{
+    _numAllocations++;
+    std::lock_guard<std::mutex> guard(_mutex);
+    _observer.onServerAllocationCreated(server, alloc);
+}
+
+
+void ShardedServer::onServerAllocationRemoved(Server* server, IAllocation* alloc)
+{
+    _numAllocations--;
+    std::lock_guard<std::mutex> guard(_mutex);
+    _observer.onServerAllocationRemoved(server, alloc);
+}
+
+
+AuthenticationState ShardedServer::authenticateRequest(Server* server, Request& request)
+{
+    // Not serialized: authentication runs on every request, so a shared
+    // lock here would funnel all shards through a single thread.
+    return _observer.authenticateRequest(server, request);
+}
+
+
+} } //  namespace scy::turn
+
+
+/// @\}
@@ -27,7 +27,7 @@ TCPAllocation::TCPAllocation(Server& server, const net::Socket::Ptr& control,
                              const uint32_t& lifetime)
     : ServerAllocation(server, tuple, username, lifetime)
     , _control(std::dynamic_pointer_cast<net::TCPSocket>(control))
-    , _acceptor(std::make_shared<net::TCPSocket>())
+    , _acceptor(net::makeSocket<net::TCPSocket>(server.loop()))
 {
     // Bind a socket acceptor for incoming peer connections.
     _acceptor->bind(net::Address(server.options().listenAddr.host(), 0));
@@ -64,7 +64,7 @@ bool TCPConnectionPair::doPeerConnect(const net::Address& peerAddr)
 {
     try {
         assert(!transactionID.empty());
-        peer.swap(std::make_shared<net::TCPSocket>());
+        peer.swap(net::makeSocket<net::TCPSocket>(allocation.server().loop()));
         peer.impl->opaque = this;
         peer.Close += slot(this, &TCPConnectionPair::onConnectionClosed);
 
@@ -31,7 +31,7 @@ UDPAllocation::UDPAllocation(Server& server, const FiveTuple& tuple,
                              const std::string& username,
                              const uint32_t& lifetime)
     : ServerAllocation(server, tuple, username, lifetime)
-    , _relaySocket(net::makeSocket<net::UDPSocket>())
+    , _relaySocket(net::makeSocket<net::UDPSocket>(server.loop()))
 {
     // Handle data from the relay socket directly from the allocation.
     // This will remove the need for allocation lookups when receiving
@@ -0,0 +1,222 @@
+#include "scy/base.h"
+#include "scy/logger.h"
+#include "scy/net/udpsocket.h"
+#include "scy/stun/attributes.h"
+#include "scy/test.h"
+#include "scy/turn/server/credentialcache.h"
+#include "scy/turn/server/shardedserver.h"
+
+#include <stdexcept>
+
+
+using namespace std;
+using namespace scy;
+using namespace scy::test;
+
+
+namespace {
+
+
+struct TestObserver : public turn::ServerObserver
+{
+    int authenticated = 0;
+    std::string hash; ///< The request hash seen by the last authentication
+    bool verified = false; ///< The verified flag seen by the last authentication
+
+    void onServerAllocationCreated(turn::Server*, turn::IAllocation*) override {}
+    void onServerAllocationRemoved(turn::Server*, turn::IAllocation*) override {}
+
+    turn::AuthenticationState authenticateRequest(turn::Server*, turn::Request& request) override
+    {
+        authenticated++;
+        hash = request.hash;
+        verified = request.verified;
+        return turn::Authorized;
+    }
+};
+
+
+/// Create a request signed with the given credentials, as read off the wire.
+turn::Request signedRequest(const std::string& username,
+                            const std::string& realm,
+                            const std::string& key)
+{
+    stun::Message message(stun::Message::Request, stun::Message::Refresh);
+
+    auto usernameAttr = new stun::Username;
+    usernameAttr->copyBytes(username.c_str(), username.size());
+    message.add(usernameAttr);
+
+    auto realmAttr = new stun::Realm;
+    realmAttr->copyBytes(realm.c_str(), realm.size());
+    message.add(realmAttr);
+
+    auto integrityAttr = new stun::MessageIntegrity;
+    integrityAttr->setKey(key);
+    message.add(integrityAttr);
+
+    Buffer buf;
+    message.write(buf);
+
+    stun::Message received;
+    received.read(constBuffer(buf));
+    return turn::Request(received, net::UDP);
+}
+
+
+/// Fails the first shard immediately while the others are still
+/// starting, which is the ordering that used to hang stop().
+class FailingShardedServer : public turn::ShardedServer
+{
+public:
+    using turn::ShardedServer::ShardedServer;
+
+protected:
+    turn::Server* createServer(int index, const turn::ServerOptions& options) override
+    {
+        if (index == 0)
+            throw std::runtime_error("shard failed");
+        scy::sleep(100);
+        return turn::ShardedServer::createServer(index, options);
+    }
+};
+
+
+turn::ServerOptions testOptions(int port)
+{
+    turn::ServerOptions options;
+    options.listenAddr = net::Address("127.0.0.1", port);
+    options.enableTCP = false;
+    return options;
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    // Logger::instance().add(new ConsoleChannel("debug", Level::Trace));
+    test::init();
+
+    // =========================================================================
+    // Credential Cache
+    //
+    describe("credential cache expiry", []() {
+        turn::CredentialCache cache(50, 10);
+        std::string key(stun::deriveKey("user", "realm", "pass"));
+        cache.insert("user", "realm", key);
+
+        auto entry = cache.find("user", "realm");
+        expect(entry != nullptr);
+        expect(entry->key == key);
+        expect(cache.find("user", "otherrealm") == nullptr);
+
+        // Expired entries are removed on lookup
+        scy::sleep(80);
+        expect(cache.find("user", "realm") == nullptr);
+        expect(cache.size() == 0);
+    });
+
+    describe("credential cache eviction", []() {
+        turn::CredentialCache cache(60 * 1000, 2);
+        cache.insert("a", "realm", "keya");
+        cache.insert("b", "realm", "keyb");
+
+        // Using "a" leaves "b" as the least recently used entry
+        expect(cache.find("a", "realm") != nullptr);
+        cache.insert("c", "realm", "keyc");
+        expect(cache.size() == 2);
+        expect(cache.find("a", "realm") != nullptr);
+        expect(cache.find("b", "realm") == nullptr);
+        expect(cache.find("c", "realm") != nullptr);
+
+        // Shrinking the cache evicts down to the new size
+        cache.setMaxSize(1);
+        expect(cache.size() == 1);
+        expect(cache.find("c", "realm") != nullptr);
+    });
+
+    describe("credential cache authentication", []() {
+        TestObserver observer;
+        turn::Server server(observer);
+        std::string key(stun::deriveKey("user", "realm", "pass"));
+
+        // Without a cached key the observer derives it
+        auto request = signedRequest("user", "realm", key);
+        server.authenticateRequest(request);
+        expect(observer.authenticated == 1);
+        expect(observer.hash.empty());
+        expect(!observer.verified);
+
+        // A cached key is passed to the observer, which is still consulted
+        // so that it can validate the nonce
+        server.credentials().insert("user", "realm", key);
+        request = signedRequest("user", "realm", key);
+        server.authenticateRequest(request);
+        expect(observer.authenticated == 2);
+        expect(observer.hash == key);
+        expect(observer.verified);
+
+        // A request which fails verification against the cached key is
+        // left for the observer to authenticate
+        request = signedRequest("user", "realm", stun::deriveKey("user", "realm", "wrong"));
+        server.authenticateRequest(request);
+        expect(observer.authenticated == 3);
+        expect(observer.hash.empty());
+        expect(!observer.verified);
+    });
+
+    // =========================================================================
+    // Sharded Server
+    //
+    describe("sharded server start stop", []() {
+        TestObserver observer;
+        turn::ShardedServer server(observer, testOptions(34780), 4);
+        expect(server.numShards() == 4);
+        server.start();
+        expect(server.numAllocations() == 0);
+        server.stop();
+
+        // The shards release the port so the server can be restarted
+        server.start();
+        server.stop();
+    });
+
+    describe("sharded server start failure", []() {
+        TestObserver observer;
+        FailingShardedServer server(observer, testOptions(34781), 4);
+        bool thrown = false;
+        try {
+            server.start();
+        } catch (std::exception& exc) {
+            expect(std::string(exc.what()) == "shard failed");
+            thrown = true;
+        }
+        expect(thrown);
+    });
+
+    describe("sharded server bind conflict", []() {
+        // A socket bound without SO_REUSEPORT prevents the shards from
+        // sharing the port.
+        net::UDPSocket socket;
+        socket.bind(net::Address("127.0.0.1", 34782));
+        expect(!socket.error().any());
+
+        TestObserver observer;
+        turn::ShardedServer server(observer, testOptions(34782), 2);
+        bool thrown = false;
+        try {
+            server.start();
+        } catch (std::exception&) {
+            thrown = true;
+        }
+        expect(thrown);
+
+        socket.close();
+        uv::runLoop();
+    });
+
+    test::runAll();
+    return test::finalize();
+}
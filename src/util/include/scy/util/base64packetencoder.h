@@ -14,9 +14,9 @@
 
 
 #include "scy/base64.h"
+#include "scy/buffer.h"
 #include "scy/packetstream.h"
 #include "scy/signal.h"
-#include <sstream>
 
 
 namespace scy {
@@ -35,16 +35,20 @@ public:
     {
         RawPacket& p = dynamic_cast<RawPacket&>(packet); // cast or throw
 
-        base64::Encoder enc;
-        std::vector<char> result(packet.size() * 2);
-        size_t size =
-            enc.encode((const char*)p.data(), p.size(), &result[0]);
-        size += enc.finalize(&result[size]);
+        // Encode into the reusable buffer, which only
+        // grows when a larger packet arrives
+        size_t required = base64::encodedSize(p.size());
+        if (_buffer.size() < required)
+            _buffer.resize(required);
+        size_t size = base64::encode(p.data(), p.size(), _buffer.data());
 
-        emit(&result[0], size);
+        emit(_buffer.data(), size);
     }
 
     PacketSignal emitter;
+
+protected:
+    Buffer _buffer;
 };
 
 
@@ -14,6 +14,9 @@
 
 
 #include "scy/logger.h"
+#include "scy/time.h"
+
+#include <cstdint>
 
 
 namespace scy {
@@ -21,13 +24,16 @@ namespace scy {
 
 /// @addtogroup util
 /// A simple message rate limiter based on the token bucket algorithm.
+///
+/// Elapsed time is measured with the monotonic clock.
+/// See TokenBucket for byte based rate limiting and traffic shaping.
 class /* SCY_EXTERN */ RateLimiter
 {
 public:
-    double rate;       ///< How many messages
-    double seconds;    ///< Over how many seconds
-    double allowance;  ///< Remaining send allowance
-    clock_t lastCheck; ///< Last time canSend() was called
+    double rate;            ///< How many messages
+    double seconds;         ///< Over how many seconds
+    double allowance;       ///< Remaining send allowance
+    std::uint64_t lastCheck; ///< Last time canSend() was called (nanoseconds)
 
     RateLimiter(double rate = 5.0, double seconds = 6.0)
         : rate(rate)
@@ -39,10 +45,10 @@ public:
 
     bool canSend()
     {
-        clock_t current = clock();
+        std::uint64_t current = time::hrtime();
         if (!lastCheck)
             lastCheck = current;
-        double elapsed = (double)(current - lastCheck) / CLOCKS_PER_SEC;
+        double elapsed = (double)(current - lastCheck) / 1e9;
         lastCheck = current;
         allowance += elapsed * (rate / seconds);
 
@@ -50,7 +56,7 @@ public:
                << "\n\tAllowance: " << allowance
                << "\n\tElapsed: " << elapsed
                << "\n\tRate: " << rate
-               << "\n\tLeconds: "(seconds, )
+               << "\n\tSeconds: " << seconds << std::endl;
 
         if (allowance > rate) {
             allowance = rate; // throttle
@@ -0,0 +1,176 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup util
+/// @{
+
+
+#ifndef SCY_TrafficShaper_H
+#define SCY_TrafficShaper_H
+
+
+#include "scy/base.h"
+#include "scy/packetstream.h"
+#include "scy/timer.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+
+namespace scy {
+
+
+/// Byte based token bucket with an optional parent bucket.
+///
+/// Tokens are replenished at `rate` bytes per second up to `burst` bytes,
+/// using the monotonic clock. Buckets may be chained to form a hierarchy,
+/// ie. a per-flow bucket with a parent bucket shared by all flows of a
+/// tenant or allocation, in which case bytes must conform to every bucket
+/// in the chain before they are consumed.
+///
+/// Packets larger than the burst size conform once the bucket is full, and
+/// leave the bucket in debt until it is replenished.
+class /* SCY_EXTERN */ TokenBucket
+{
+public:
+    typedef std::shared_ptr<TokenBucket> Ptr;
+
+    /// Create a bucket with the given rate in bytes per second.
+    /// The burst size defaults to one second of traffic.
+    /// A zero rate disables shaping for this bucket.
+    TokenBucket(double rate = 0, double burst = 0, const Ptr& parent = nullptr);
+
+    /// Set the refill rate in bytes per second, and the burst size in bytes.
+    void setRate(double rate, double burst = 0);
+
+    /// Set the parent bucket.
+    void setParent(const Ptr& parent);
+
+    /// Consume `bytes` from this bucket and all parent buckets if the
+    /// bytes conform to each of them.
+    /// Returns false without consuming any tokens otherwise.
+    bool consume(size_t bytes);
+
+    /// Return the time in microseconds until `bytes` will conform to this
+    /// bucket and all parent buckets.
+    std::int64_t delay(size_t bytes);
+
+    double rate() const;
+    double burst() const;
+
+    /// Return the currently available tokens.
+    double tokens();
+
+    /// Return the parent bucket.
+    Ptr parent() const;
+
+    /// Return the total number of bytes consumed.
+    std::uint64_t consumed() const;
+
+protected:
+    void refill(std::uint64_t now);
+    bool conforms(size_t bytes) const;
+    std::int64_t delayFor(size_t bytes) const;
+
+    double _rate;
+    double _burst;
+    double _tokens;
+    std::uint64_t _lastRefill;
+    std::uint64_t _consumed;
+    Ptr _parent;
+};
+
+
+/// Counters for the TrafficShaper.
+struct /* SCY_EXTERN */ TrafficShaperStats
+{
+    std::uint64_t packets = 0;        ///< packets emitted
+    std::uint64_t bytes = 0;          ///< bytes emitted
+    std::uint64_t delayed = 0;        ///< packets which were queued for pacing
+    std::uint64_t dropped = 0;        ///< packets dropped
+    std::uint64_t droppedBytes = 0;   ///< bytes dropped
+    std::uint64_t queuedBytes = 0;    ///< bytes currently queued
+};
+
+
+/// Token bucket traffic shaper which can be attached to a PacketStream.
+///
+/// Each shaper owns a per-flow TokenBucket which may be chained to a
+/// shared parent bucket. In pacing mode (the default) packets which exceed
+/// the available tokens are queued and released on a timer as tokens are
+/// replenished, and packets are only dropped once the queue limit is
+/// reached. In policing mode non-conforming packets are dropped immediately.
+///
+/// The stream is torn down before its Closed and Error states are delivered,
+/// so packets still queued at that point can't be sent and are dropped and
+/// counted in the stats. Call `flush()` before closing the stream to deliver
+/// them instead.
+///
+/// The shaper must be used from the event loop thread, ie. as part of a
+/// synchronized packet stream.
+class /* SCY_EXTERN */ TrafficShaper : public PacketProcessor
+{
+public:
+    enum Mode
+    {
+        Pacing,
+        Policing
+    };
+
+    /// Create a shaper with the given flow rate in bytes per second.
+    TrafficShaper(double rate, double burst = 0,
+                  const TokenBucket::Ptr& parent = nullptr,
+                  uv::Loop* loop = uv::defaultLoop());
+    virtual ~TrafficShaper();
+
+    virtual void process(IPacket& packet) override;
+
+    /// Set the shaping mode.
+    void setMode(Mode mode);
+
+    /// Set the maximum number of bytes queued for pacing.
+    /// Packets which would exceed the limit are dropped.
+    void setMaxQueueBytes(size_t bytes);
+
+    /// Emit all queued packets immediately.
+    void flush();
+
+    /// Drop all queued packets.
+    void clear();
+
+    /// Return the per-flow bucket.
+    TokenBucket& bucket();
+
+    /// Return the counters.
+    const TrafficShaperStats& stats() const;
+
+    PacketSignal emitter;
+
+protected:
+    virtual void onStreamStateChange(const PacketStreamState& state) override;
+
+    void release();
+    void schedule();
+    void drop(IPacket& packet);
+
+    TokenBucket _bucket;
+    TrafficShaperStats _stats;
+    std::deque<std::unique_ptr<IPacket>> _queue;
+    Timer _timer;
+    Mode _mode;
+    size_t _maxQueueBytes;
+};
+
+
+} // namespace scy
+
+
+#endif // SCY_TrafficShaper_H
+
+
+/// @\}
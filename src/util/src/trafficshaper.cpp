@@ -0,0 +1,305 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup util
+/// @{
+
+
+#include "scy/util/trafficshaper.h"
+#include "scy/logger.h"
+#include "scy/time.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace scy {
+
+
+/// Default maximum number of bytes queued for pacing.
+const size_t kDefaultMaxQueueBytes = 1024 * 1024;
+
+
+//
+// Token Bucket
+//
+
+
+TokenBucket::TokenBucket(double rate, double burst, const Ptr& parent)
+    : _consumed(0)
+    , _parent(parent)
+{
+    setRate(rate, burst);
+}
+
+
+void TokenBucket::setRate(double rate, double burst)
+{
+    _rate = rate;
+    _burst = burst > 0 ? burst : rate;
+    _tokens = _burst;
+    _lastRefill = time::hrtime();
+}
+
+
+void TokenBucket::setParent(const Ptr& parent)
+{
+    _parent = parent;
+}
+
+
+bool TokenBucket::consume(size_t bytes)
+{
+    // Bytes must conform to every bucket in the chain
+    // before any tokens are consumed.
+    std::uint64_t now = time::hrtime();
+    for (auto bucket = this; bucket; bucket = bucket->_parent.get()) {
+        bucket->refill(now);
+        if (!bucket->conforms(bytes))
+            return false;
+    }
+
+    for (auto bucket = this; bucket; bucket = bucket->_parent.get()) {
+        if (bucket->_rate > 0)
+            bucket->_tokens -= static_cast<double>(bytes);
+        bucket->_consumed += bytes;
+    }
+    return true;
+}
+
+
+std::int64_t TokenBucket::delay(size_t bytes)
+{
+    std::uint64_t now = time::hrtime();
+    std::int64_t delay = 0;
+    for (auto bucket = this; bucket; bucket = bucket->_parent.get()) {
+        bucket->refill(now);
+        delay = std::max(delay, bucket->delayFor(bytes));
+    }
+    return delay;
+}
+
+
+double TokenBucket::rate() const
+{
+    return _rate;
+}
+
+
+double TokenBucket::burst() const
+{
+    return _burst;
+}
+
+
+double TokenBucket::tokens()
+{
+    refill(time::hrtime());
+    return _tokens;
+}
+
+
+TokenBucket::Ptr TokenBucket::parent() const
+{
+    return _parent;
+}
+
+
+std::uint64_t TokenBucket::consumed() const
+{
+    return _consumed;
+}
+
+
+void TokenBucket::refill(std::uint64_t now)
+{
+    if (_rate <= 0 || now <= _lastRefill)
+        return;
+    double elapsed = static_cast<double>(now - _lastRefill) / 1e9;
+    _tokens = std::min(_burst, _tokens + elapsed * _rate);
+    _lastRefill = now;
+}
+
+
+bool TokenBucket::conforms(size_t bytes) const
+{
+    // Oversized packets conform once the bucket is full
+    return _rate <= 0 || _tokens >= std::min(static_cast<double>(bytes), _burst);
+}
+
+
+std::int64_t TokenBucket::delayFor(size_t bytes) const
+{
+    if (_rate <= 0)
+        return 0;
+    double deficit = std::min(static_cast<double>(bytes), _burst) - _tokens;
+    if (deficit <= 0)
+        return 0;
+    return static_cast<std::int64_t>(std::ceil(deficit / _rate * 1e6));
+}
+
+
+//
+// Traffic Shaper
+//
+
+
+TrafficShaper::TrafficShaper(double rate, double burst,
+                             const TokenBucket::Ptr& parent, uv::Loop* loop)
+    : PacketProcessor(this->emitter)
+    , _bucket(rate, burst, parent)
+    , _timer(loop)
+    , _mode(Pacing)
+    , _maxQueueBytes(kDefaultMaxQueueBytes)
+{
+    _timer.Timeout += slot(this, &TrafficShaper::release);
+
+    // Queued packets keep the loop alive until released
+    _timer.handle().ref();
+}
+
+
+TrafficShaper::~TrafficShaper()
+{
+    _timer.Timeout -= slot(this, &TrafficShaper::release);
+    _timer.stop();
+}
+
+
+void TrafficShaper::process(IPacket& packet)
+{
+    size_t size = packet.size();
+
+    // Packets are only sent directly if none are waiting,
+    // otherwise they are queued to preserve ordering.
+    if (_queue.empty() && _bucket.consume(size)) {
+        _stats.packets++;
+        _stats.bytes += size;
+        emit(packet);
+        return;
+    }
+
+    if (_mode == Policing ||
+        _stats.queuedBytes + size > _maxQueueBytes) {
+        drop(packet);
+        return;
+    }
+
+    _queue.emplace_back(packet.clone());
+    _stats.queuedBytes += size;
+    _stats.delayed++;
+    schedule();
+}
+
+
+void TrafficShaper::setMode(Mode mode)
+{
+    _mode = mode;
+}
+
+
+void TrafficShaper::setMaxQueueBytes(size_t bytes)
+{
+    _maxQueueBytes = bytes;
+}
+
+
+void TrafficShaper::flush()
+{
+    _timer.stop();
+    while (!_queue.empty()) {
+        std::unique_ptr<IPacket> packet(std::move(_queue.front()));
+        _queue.pop_front();
+        _stats.queuedBytes -= packet->size();
+        _stats.packets++;
+        _stats.bytes += packet->size();
+        emit(*packet);
+    }
+}
+
+
+void TrafficShaper::clear()
+{
+    _timer.stop();
+    for (auto& packet : _queue) {
+        _stats.dropped++;
+        _stats.droppedBytes += packet->size();
+    }
+    _queue.clear();
+    _stats.queuedBytes = 0;
+}
+
+
+TokenBucket& TrafficShaper::bucket()
+{
+    return _bucket;
+}
+
+
+const TrafficShaperStats& TrafficShaper::stats() const
+{
+    return _stats;
+}
+
+
+void TrafficShaper::onStreamStateChange(const PacketStreamState& state)
+{
+    switch (state.id()) {
+        case PacketStreamState::Closed:
+        case PacketStreamState::Error:
+            // The processor chain is already torn down,
+            // so queued packets are dropped and counted.
+            if (!_queue.empty())
+                LDebug("Dropping queued packets on ", state, ": ", _queue.size())
+            clear();
+            break;
+    }
+}
+
+
+void TrafficShaper::release()
+{
+    while (!_queue.empty()) {
+        size_t size = _queue.front()->size();
+        if (!_bucket.consume(size))
+            break;
+
+        std::unique_ptr<IPacket> packet(std::move(_queue.front()));
+        _queue.pop_front();
+        _stats.queuedBytes -= size;
+        _stats.packets++;
+        _stats.bytes += size;
+        emit(*packet);
+    }
+
+    if (!_queue.empty())
+        schedule();
+}
+
+
+void TrafficShaper::schedule()
+{
+    // Timers have millisecond resolution, so round the delay up.
+    std::int64_t delay = _bucket.delay(_queue.front()->size());
+    _timer.stop();
+    _timer.setTimeout(std::max<std::int64_t>(1, (delay + 999) / 1000));
+    _timer.start();
+}
+
+
+void TrafficShaper::drop(IPacket& packet)
+{
+    LTrace("Dropping packet: ", packet.size())
+    _stats.dropped++;
+    _stats.droppedBytes += packet.size();
+}
+
+
+} // namespace scy
+
+
+/// @\}
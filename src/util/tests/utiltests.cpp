@@ -0,0 +1,190 @@
+#include "scy/base.h"
+#include "scy/logger.h"
+#include "scy/test.h"
+#include "scy/time.h"
+#include "scy/util/trafficshaper.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+using namespace scy;
+using namespace scy::test;
+
+
+// Poll until the condition holds or the timeout in milliseconds expires.
+static bool waitFor(const std::function<bool()>& condition, int timeout = 5000)
+{
+    std::uint64_t deadline = time::hrtime() + timeout * 1000000ull;
+    while (!condition()) {
+        if (time::hrtime() > deadline)
+            return false;
+        scy::sleep(1);
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Logger::instance().add(new ConsoleChannel("debug", Level::Trace));
+    test::init();
+
+    // =========================================================================
+    // Token Bucket
+    //
+    describe("token bucket", []() {
+        TokenBucket bucket(1000, 500);
+        expect(bucket.consume(300));
+        expect(!bucket.consume(300));
+        expect(bucket.consumed() == 300);
+
+        // 100 bytes are missing at 1000 bytes per second
+        expect(bucket.delay(300) > 80000 && bucket.delay(300) <= 100000);
+
+        // Tokens are replenished over time, up to the burst size
+        waitFor([&]() { return bucket.tokens() >= 300; });
+        expect(bucket.consume(300));
+        waitFor([&]() { return bucket.tokens() == 500; });
+        expect(bucket.tokens() == 500);
+
+        // Oversized packets conform once the bucket is full,
+        // and leave it in debt
+        expect(bucket.consume(800));
+        expect(bucket.tokens() < -250);
+        expect(!bucket.consume(1));
+
+        // A zero rate disables shaping
+        TokenBucket unlimited;
+        expect(unlimited.consume(1000000));
+        expect(unlimited.delay(1000000) == 0);
+    });
+
+    describe("token bucket hierarchy", []() {
+        auto parent = std::make_shared<TokenBucket>(1000, 500);
+        TokenBucket child(10000, 5000, parent);
+
+        // Bytes must conform to every bucket in the chain
+        expect(child.consume(400));
+        expect(!child.consume(400));
+        expect(parent->consumed() == 400);
+        expect(child.consumed() == 400);
+
+        // Tokens are only taken when the whole chain conforms
+        expect(child.tokens() > 4500);
+        expect(child.delay(400) > 200000);
+    });
+
+    // =========================================================================
+    // Traffic Shaper
+    //
+    describe("traffic shaper pacing", []() {
+        auto loop = uv::createLoop();
+        {
+            TrafficShaper shaper(10000, 1000, nullptr, loop);
+            std::vector<std::uint64_t> received;
+            shaper.emitter += [&](IPacket& packet) {
+                expect(packet.size() == 500);
+                received.push_back(time::hrtime());
+            };
+
+            // The burst is sent at once and the rest is paced
+            std::string payload(500, 'x');
+            for (int i = 0; i < 5; i++) {
+                RawPacket packet(payload.c_str(), payload.size());
+                shaper.process(packet);
+            }
+            expect(received.size() == 2);
+            expect(shaper.stats().delayed == 3);
+            expect(shaper.stats().queuedBytes == 1500);
+
+            // Queued packets keep the loop alive until released
+            uv::runLoop(loop);
+            expect(received.size() == 5);
+            expect(received.back() - received.front() >= 140000000);
+            expect(shaper.stats().packets == 5);
+            expect(shaper.stats().bytes == 2500);
+            expect(shaper.stats().queuedBytes == 0);
+            expect(shaper.stats().dropped == 0);
+        }
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
+    describe("traffic shaper drop", []() {
+        auto loop = uv::createLoop();
+        {
+            std::string payload(500, 'x');
+            RawPacket packet(payload.c_str(), payload.size());
+
+            // Policing drops packets which don't conform
+            TrafficShaper policer(10000, 1000, nullptr, loop);
+            policer.setMode(TrafficShaper::Policing);
+            int policed = 0;
+            policer.emitter += [&](IPacket&) { policed++; };
+            for (int i = 0; i < 3; i++)
+                policer.process(packet);
+            expect(policed == 2);
+            expect(policer.stats().dropped == 1);
+            expect(policer.stats().droppedBytes == 500);
+            expect(policer.stats().delayed == 0);
+
+            // Pacing drops packets once the queue limit is reached
+            TrafficShaper pacer(10000, 1000, nullptr, loop);
+            pacer.setMaxQueueBytes(1000);
+            int paced = 0;
+            pacer.emitter += [&](IPacket&) { paced++; };
+            for (int i = 0; i < 5; i++)
+                pacer.process(packet);
+            expect(paced == 2);
+            expect(pacer.stats().delayed == 2);
+            expect(pacer.stats().dropped == 1);
+
+            // Flushing sends queued packets without waiting
+            pacer.flush();
+            expect(paced == 4);
+            expect(pacer.stats().queuedBytes == 0);
+
+            // Clearing drops them
+            pacer.process(packet);
+            expect(pacer.stats().queuedBytes == 500);
+            pacer.clear();
+            expect(paced == 4);
+            expect(pacer.stats().dropped == 2);
+            expect(pacer.stats().queuedBytes == 0);
+        }
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
+    describe("traffic shaper stream close", []() {
+        auto loop = uv::createLoop();
+        {
+            TrafficShaper shaper(10000, 1000, nullptr, loop);
+            PacketStream stream;
+            stream.attach(&shaper, 0, false);
+            int received = 0;
+            stream.emitter += [&](IPacket&) { received++; };
+            stream.start();
+
+            std::string payload(500, 'x');
+            for (int i = 0; i < 4; i++)
+                stream.write(payload.c_str(), payload.size());
+            expect(received == 2);
+            expect(shaper.stats().queuedBytes == 1000);
+
+            // Packets still queued when the stream closes are dropped and counted
+            stream.close();
+            expect(received == 2);
+            expect(shaper.stats().dropped == 2);
+            expect(shaper.stats().droppedBytes == 1000);
+            expect(shaper.stats().queuedBytes == 0);
+        }
+        expect(uv::closeLoop(loop));
+        delete loop;
+    });
+
+    test::runAll();
+    return test::finalize();
+}